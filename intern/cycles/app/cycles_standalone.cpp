@@ -22,8 +22,10 @@
 #include "render/scene.h"
 #include "render/session.h"
 #include "render/integrator.h"
+#include "render/stats.h"
 
 #include "util/util_args.h"
+#include "util/util_debug.h"
 #include "util/util_foreach.h"
 #include "util/util_function.h"
 #include "util/util_logging.h"
@@ -169,15 +171,30 @@ static void session_init()
 
 static void session_exit()
 {
+	double total_time = 0.0, sample_time = 0.0;
+	string stats_report;
+
 	if(options.session) {
+		options.session->progress.get_time(total_time, sample_time);
+
+		if(options.session_params.use_profiling) {
+			RenderStats stats;
+			options.session->collect_statistics(&stats);
+			stats_report = stats.full_report();
+		}
+
 		delete options.session;
 		options.session = NULL;
 	}
 
 	if(options.session_params.background && !options.quiet) {
-		session_print("Finished Rendering.");
+		session_print(string_printf("Finished Rendering in %.2f seconds.", total_time));
 		printf("\n");
 	}
+
+	if(!stats_report.empty()) {
+		printf("Render statistics:\n%s\n", stats_report.c_str());
+	}
 }
 
 #ifdef WITH_CYCLES_STANDALONE_GUI
@@ -383,6 +400,7 @@ static void options_parse(int argc, const char **argv)
 	/* parse options */
 	ArgParse ap;
 	bool help = false, debug = false, version = false;
+	bool split_kernel = false;
 	int verbosity = 1;
 
 	ap.options ("Usage: cycles [options] file.xml",
@@ -401,6 +419,8 @@ static void options_parse(int argc, const char **argv)
 		"--tile-width %d", &options.session_params.tile_size.x, "Tile width in pixels",
 		"--tile-height %d", &options.session_params.tile_size.y, "Tile height in pixels",
 		"--list-devices", &list, "List information about all available devices",
+		"--split-kernel", &split_kernel, "Use split kernel on the CPU, to compare against the megakernel",
+		"--profile", &options.session_params.use_profiling, "Print a breakdown of the render time per kernel stage, shader and object (CPU only)",
 #ifdef WITH_CYCLES_LOGGING
 		"--debug", &debug, "Enable debug logging",
 		"--verbose %d", &verbosity, "Set verbosity of the logger",
@@ -420,6 +440,8 @@ static void options_parse(int argc, const char **argv)
 		util_logging_verbosity_set(verbosity);
 	}
 
+	DebugFlags().cpu.split_kernel = split_kernel;
+
 	if(list) {
 		vector<DeviceInfo>& devices = Device::available_devices();
 		printf("Devices:\n");
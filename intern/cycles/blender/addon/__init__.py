@@ -85,6 +85,9 @@ class CyclesRender(bpy.types.RenderEngine):
     def bake(self, scene, obj, pass_type, pass_filter, object_id, pixel_array, num_pixels, depth, result):
         engine.bake(self, obj, pass_type, pass_filter, object_id, pixel_array, num_pixels, depth, result)
 
+    def bake_batch(self, scene, objects, num_objects, pass_type, pass_filter, pixel_array, num_pixels, depth, result):
+        engine.bake_batch(self, objects, num_objects, pass_type, pass_filter, pixel_array, num_pixels, depth, result)
+
     # viewport render
     def view_update(self, context):
         if not self.session:
@@ -65,6 +65,9 @@ def _configure_argument_parser():
     parser.add_argument("--cycles-resumable-end-chunk",
                         help="End chunk to render",
                         default=None)
+    parser.add_argument("--cycles-print-stats",
+                        help="Print rendering statistics to stdout",
+                        action='store_true')
     return parser
 
 
@@ -91,6 +94,9 @@ def _parse_command_line():
                     int(args.cycles_resumable_num_chunks),
                     int(args.cycles_resumable_start_chunk),
                     int(args.cycles_resumable_end_chunk))
+    if args.cycles_print_stats:
+        import _cycles
+        _cycles.enable_print_stats()
 
 
 def init():
@@ -166,6 +172,13 @@ def bake(engine, obj, pass_type, pass_filter, object_id, pixel_array, num_pixels
         _cycles.bake(engine.session, obj.as_pointer(), pass_type, pass_filter, object_id, pixel_array.as_pointer(), num_pixels, depth, result.as_pointer())
 
 
+def bake_batch(engine, objects, num_objects, pass_type, pass_filter, pixel_array, num_pixels, depth, result):
+    import _cycles
+    session = getattr(engine, "session", None)
+    if session is not None:
+        _cycles.bake_batch(engine.session, objects.as_pointer(), num_objects, pass_type, pass_filter, pixel_array.as_pointer(), num_pixels, depth, result.as_pointer())
+
+
 def reset(engine, data, scene):
     import _cycles
     data = data.as_pointer()
@@ -206,6 +219,11 @@ def system_info():
     import _cycles
     return _cycles.system_info()
 
+
+def render_stats():
+    import _cycles
+    return _cycles.get_render_stats()
+
 def register_passes(engine, scene, srl):
     engine.register_pass(scene, srl, "Combined", 4, "RGBA", 'COLOR')
 
@@ -235,6 +253,7 @@ def register_passes(engine, scene, srl):
 
     crl = srl.cycles
     if crl.pass_debug_render_time:             engine.register_pass(scene, srl, "Debug Render Time",             1, "X",   'VALUE')
+    if crl.pass_debug_sample_count:            engine.register_pass(scene, srl, "Debug Sample Count",            1, "X",   'VALUE')
     if crl.pass_debug_bvh_traversed_nodes:     engine.register_pass(scene, srl, "Debug BVH Traversed Nodes",     1, "X",   'VALUE')
     if crl.pass_debug_bvh_traversed_instances: engine.register_pass(scene, srl, "Debug BVH Traversed Instances", 1, "X",   'VALUE')
     if crl.pass_debug_bvh_intersections:       engine.register_pass(scene, srl, "Debug BVH Intersections",       1, "X",   'VALUE')
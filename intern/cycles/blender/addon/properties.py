@@ -110,6 +110,7 @@ enum_use_layer_samples = (
 enum_sampling_pattern = (
     ('SOBOL', "Sobol", "Use Sobol random sampling pattern"),
     ('CORRELATED_MUTI_JITTER', "Correlated Multi-Jitter", "Use Correlated Multi-Jitter random sampling pattern"),
+    ('PROGRESSIVE_MUTI_JITTER', "Progressive Multi-Jitter", "Use Progressive Multi-Jitter random sampling pattern, well stratified at any number of samples"),
     )
 
 enum_integrator = (
@@ -295,6 +296,34 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 min=0.0, max=1.0,
                 default=0.01,
                 )
+        cls.use_light_tree = BoolProperty(
+                name="Light Tree",
+                description="Pick lights based on their distance, orientation and strength relative to the shading point "
+                            "(faster convergence in scenes with many lights)",
+                default=False,
+                )
+
+        cls.use_adaptive_sampling = BoolProperty(
+                name="Adaptive Sampling",
+                description="Automatically stop sampling pixels once their noise is below the threshold, "
+                            "only supported for final renders on the CPU",
+                default=False,
+                )
+        cls.adaptive_threshold = FloatProperty(
+                name="Adaptive Threshold",
+                description="Noise level at which pixels stop being sampled, lower values give less noise "
+                            "but take longer to render. Zero to derive it from the number of samples",
+                min=0.0, max=1.0,
+                default=0.0,
+                precision=4,
+                )
+        cls.adaptive_min_samples = IntProperty(
+                name="Adaptive Min Samples",
+                description="Minimum number of AA samples of every pixel before testing for convergence. "
+                            "Zero to derive it from the number of samples",
+                min=0, max=4096,
+                default=0,
+                )
 
         cls.caustics_reflective = BoolProperty(
                 name="Reflective Caustics",
@@ -545,6 +574,26 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 default=0,
                 min=0, max=16,
                 )
+        cls.debug_bvh_curve_leaf_size = IntProperty(
+                name="Hair Leaf Size",
+                description="Maximum number of hair segments in a BVH leaf, larger values use less memory "
+                            "for dense hair at a cost in render time",
+                default=1,
+                min=1, max=8,
+                )
+        cls.debug_use_bvh_refit = BoolProperty(
+                name="Refit BVH",
+                description="Refit BVH of deforming meshes instead of rebuilding it between frames of final renders "
+                            "with Persistent Data, not used for baking: faster scene updates, slightly slower render",
+                default=False,
+                )
+        cls.debug_bvh_refit_threshold = FloatProperty(
+                name="Refit Threshold",
+                description="Rebuild refitted BVH once its estimated traversal cost grew by more than this fraction "
+                            "(0 to always refit)",
+                default=0.5,
+                min=0.0, max=10.0,
+                )
         cls.tile_order = EnumProperty(
                 name="Tile Order",
                 description="Tile order for rendering",
@@ -650,6 +699,33 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
             items=enum_texture_limit
             )
 
+        cls.use_texture_cache = BoolProperty(
+            name="Use Texture Cache",
+            default=False,
+            description="Load image textures on demand as tiles through a texture cache, "
+                        "instead of loading them fully into memory before rendering (CPU only)",
+            )
+
+        cls.texture_cache_size = IntProperty(
+            name="Texture Cache Size",
+            default=1024,
+            description="Maximum memory used by the texture cache, in megabytes",
+            min=64, max=65536,
+            )
+
+        cls.use_half_textures = BoolProperty(
+            name="Use Half Float Textures",
+            default=False,
+            description="Store float image textures at half precision to reduce memory usage",
+            )
+
+        cls.use_compressed_textures = BoolProperty(
+            name="Use Compressed Textures",
+            default=False,
+            description="Store 8 bit image textures block compressed to reduce memory usage, "
+                        "at the cost of some loss in quality (CPU only)",
+            )
+
         cls.ao_bounces = IntProperty(
             name="AO Bounces",
             default=0,
@@ -682,6 +758,11 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 default='BVH4',
                 )
         cls.debug_use_cpu_split_kernel = BoolProperty(name="Split Kernel", default=False)
+        cls.debug_use_cpu_ray_packets = BoolProperty(
+                name="Ray Packets",
+                description="Trace coherent camera and ambient occlusion rays together in packets",
+                default=False,
+                )
 
         cls.debug_use_cuda_adaptive_compile = BoolProperty(name="Adaptive Compile", default=False)
         cls.debug_use_cuda_split_kernel = BoolProperty(name="Split Kernel", default=False)
@@ -1242,6 +1323,12 @@ class CyclesRenderLayerSettings(bpy.types.PropertyGroup):
                 default=False,
                 update=update_render_passes,
                 )
+        cls.pass_debug_sample_count = BoolProperty(
+                name="Debug Sample Count",
+                description="Number of AA samples taken per pixel, useful with adaptive sampling",
+                default=False,
+                update=update_render_passes,
+                )
         cls.use_pass_volume_direct = BoolProperty(
                 name="Volume Direct",
                 description="Deliver direct volumetric scattering pass",
@@ -84,7 +84,7 @@ def use_branched_path(context):
 def use_sample_all_lights(context):
     cscene = context.scene.cycles
 
-    return cscene.sample_all_lights_direct or cscene.sample_all_lights_indirect
+    return (cscene.sample_all_lights_direct or cscene.sample_all_lights_indirect) and not cscene.use_light_tree
 
 def show_device_active(context):
     cscene = context.scene.cycles
@@ -172,6 +172,7 @@ class CYCLES_RENDER_PT_sampling(CyclesButtonsPanel, Panel):
         sub.prop(cscene, "sample_clamp_direct")
         sub.prop(cscene, "sample_clamp_indirect")
         sub.prop(cscene, "light_sampling_threshold")
+        sub.prop(cscene, "use_light_tree")
 
         if cscene.progressive == 'PATH' or use_branched_path(context) is False:
             col = split.column()
@@ -200,11 +201,19 @@ class CYCLES_RENDER_PT_sampling(CyclesButtonsPanel, Panel):
             sub.prop(cscene, "volume_samples", text="Volume")
 
             col = layout.column(align=True)
+            col.active = not cscene.use_light_tree
             col.prop(cscene, "sample_all_lights_direct")
             col.prop(cscene, "sample_all_lights_indirect")
 
         layout.row().prop(cscene, "sampling_pattern", text="Pattern")
 
+        layout.separator()
+        layout.row().prop(cscene, "use_adaptive_sampling")
+        row = layout.row(align=True)
+        row.active = cscene.use_adaptive_sampling
+        row.prop(cscene, "adaptive_threshold", text="Threshold")
+        row.prop(cscene, "adaptive_min_samples", text="Min Samples")
+
         for rl in scene.render.layers:
             if rl.samples > 0:
                 layout.separator()
@@ -424,18 +433,34 @@ class CYCLES_RENDER_PT_performance(CyclesButtonsPanel, Panel):
 
         col.label(text="Final Render:")
         col.prop(rd, "use_save_buffers")
-        col.prop(rd, "use_persistent_data", text="Persistent Images")
+        col.prop(rd, "use_persistent_data", text="Persistent Data")
+
+        col.separator()
+
+        col.label(text="Image Textures:")
+        col.prop(cscene, "use_texture_cache", text="Texture Cache")
+        row = col.row()
+        row.active = cscene.use_texture_cache
+        row.prop(cscene, "texture_cache_size", text="Cache Size (MB)")
+        col.prop(cscene, "use_half_textures", text="Half Float Textures")
+        col.prop(cscene, "use_compressed_textures", text="Compressed Textures")
 
         col.separator()
 
         col.label(text="Acceleration structure:")
         col.prop(cscene, "debug_use_spatial_splits")
         col.prop(cscene, "debug_use_hair_bvh")
+        col.prop(cscene, "debug_bvh_curve_leaf_size")
 
         row = col.row()
         row.active = not cscene.debug_use_spatial_splits
         row.prop(cscene, "debug_bvh_time_steps")
 
+        sub = col.column()
+        sub.active = rd.use_persistent_data
+        sub.prop(cscene, "debug_use_bvh_refit")
+        sub.prop(cscene, "debug_bvh_refit_threshold")
+
         col = layout.column()
         col.label(text="Viewport Resolution:")
         split = col.split()
@@ -556,6 +581,7 @@ class CYCLES_RENDER_PT_layer_passes(CyclesButtonsPanel, Panel):
 
         col = layout.column()
         col.prop(crl, "pass_debug_render_time")
+        col.prop(crl, "pass_debug_sample_count")
         if _cycles.with_cycles_debug:
             col.prop(crl, "pass_debug_bvh_traversed_nodes")
             col.prop(crl, "pass_debug_bvh_traversed_instances")
@@ -1625,6 +1651,7 @@ class CYCLES_RENDER_PT_debug(CyclesButtonsPanel, Panel):
         row.prop(cscene, "debug_use_cpu_avx2", toggle=True)
         col.prop(cscene, "debug_bvh_layout")
         col.prop(cscene, "debug_use_cpu_split_kernel")
+        col.prop(cscene, "debug_use_cpu_ray_packets")
 
         col.separator()
 
@@ -347,6 +347,12 @@ Object *BlenderSync::sync_object(BL::Object& b_parent,
 
 	if(object_map.sync(&object, b_ob, b_parent, key))
 		object_updated = true;
+
+	/* Transforms changed by drivers, constraints or parents don't tag the
+	 * object. With persistent data the mesh may still have the previous
+	 * transform applied, so it must be synced again. */
+	if(tfm != object->tfm)
+		object_updated = true;
 	
 	/* mesh sync */
 	object->mesh = sync_mesh(b_ob, object_updated, hide_tris);
@@ -71,6 +71,7 @@ bool debug_flags_sync_from_scene(BL::Scene b_scene)
 	flags.cpu.sse2 = get_boolean(cscene, "debug_use_cpu_sse2");
 	flags.cpu.bvh_layout = (BVHLayout)get_enum(cscene, "debug_bvh_layout");
 	flags.cpu.split_kernel = get_boolean(cscene, "debug_use_cpu_split_kernel");
+	flags.cpu.ray_packets = get_boolean(cscene, "debug_use_cpu_ray_packets");
 	/* Synchronize CUDA flags. */
 	flags.cuda.adaptive_compile = get_boolean(cscene, "debug_use_cuda_adaptive_compile");
 	flags.cuda.split_kernel = get_boolean(cscene, "debug_use_cuda_split_kernel");
@@ -325,6 +326,45 @@ static PyObject *bake_func(PyObject * /*self*/, PyObject *args)
 	Py_RETURN_NONE;
 }
 
+/* objects is an array of object pointers, pixel_array and result passed as pointers */
+static PyObject *bake_batch_func(PyObject * /*self*/, PyObject *args)
+{
+	PyObject *pysession, *pyobjects;
+	PyObject *pypixel_array, *pyresult;
+	const char *pass_type;
+	int num_objects, num_pixels, depth, pass_filter;
+
+	if(!PyArg_ParseTuple(args, "OOisiOiiO", &pysession, &pyobjects, &num_objects, &pass_type, &pass_filter, &pypixel_array, &num_pixels, &depth, &pyresult))
+		return NULL;
+
+	BlenderSession *session = (BlenderSession*)PyLong_AsVoidPtr(pysession);
+
+	ID **objects = (ID**)PyLong_AsVoidPtr(pyobjects);
+	vector<BL::Object> b_objects;
+	vector<int> object_ids;
+
+	for(int i = 0; i < num_objects; i++) {
+		PointerRNA objectptr;
+		RNA_id_pointer_create(objects[i], &objectptr);
+		b_objects.push_back(BL::Object(objectptr));
+		object_ids.push_back(i);
+	}
+
+	void *b_result = PyLong_AsVoidPtr(pyresult);
+
+	PointerRNA bakepixelptr;
+	RNA_pointer_create(NULL, &RNA_BakePixel, PyLong_AsVoidPtr(pypixel_array), &bakepixelptr);
+	BL::BakePixel b_bake_pixel(bakepixelptr);
+
+	python_thread_state_save(&session->python_thread_state);
+
+	session->bake_objects(b_objects, object_ids, pass_type, pass_filter, b_bake_pixel, (size_t)num_pixels, depth, (float *)b_result);
+
+	python_thread_state_restore(&session->python_thread_state);
+
+	Py_RETURN_NONE;
+}
+
 static PyObject *draw_func(PyObject * /*self*/, PyObject *args)
 {
 	PyObject *pysession, *pyv3d, *pyrv3d;
@@ -730,6 +770,91 @@ static PyObject *set_resumable_chunk_range_func(PyObject * /*self*/, PyObject *a
 	Py_RETURN_NONE;
 }
 
+static PyObject *enable_render_stats_func(PyObject * /*self*/, PyObject * /*args*/)
+{
+	BlenderSession::collect_render_stats = true;
+	Py_RETURN_NONE;
+}
+
+static PyObject *enable_print_stats_func(PyObject * /*self*/, PyObject * /*args*/)
+{
+	BlenderSession::collect_render_stats = true;
+	BlenderSession::print_render_stats = true;
+	Py_RETURN_NONE;
+}
+
+/* Steals the reference to value. */
+static void render_stats_dict_set(PyObject *dict, const char *key, PyObject *value)
+{
+	PyDict_SetItemString(dict, key, value);
+	Py_DECREF(value);
+}
+
+static PyObject *render_stats_kernel_to_py(const NamedNestedSampleStats& entry,
+                                           double sample_interval)
+{
+	PyObject *dict = PyDict_New();
+	render_stats_dict_set(dict, "time", PyFloat_FromDouble(entry.sum_samples * sample_interval));
+	render_stats_dict_set(dict, "self_time", PyFloat_FromDouble(entry.self_samples * sample_interval));
+
+	PyObject *entries = PyDict_New();
+	foreach(const NamedNestedSampleStats& sub_entry, entry.entries) {
+		render_stats_dict_set(entries,
+		                      sub_entry.name.c_str(),
+		                      render_stats_kernel_to_py(sub_entry, sample_interval));
+	}
+	render_stats_dict_set(dict, "entries", entries);
+
+	return dict;
+}
+
+static PyObject *render_stats_counts_to_py(const NamedSampleCountStats& stats,
+                                           double sample_interval)
+{
+	PyObject *dict = PyDict_New();
+	foreach(NamedSampleCountStats::entry_map::const_reference item, stats.entries) {
+		const NamedSampleCountPair& entry = item.second;
+
+		PyObject *entry_dict = PyDict_New();
+		render_stats_dict_set(entry_dict, "time", PyFloat_FromDouble(entry.samples * sample_interval));
+		render_stats_dict_set(entry_dict, "hits", PyLong_FromUnsignedLongLong(entry.hits));
+		render_stats_dict_set(dict, entry.name.c_str(), entry_dict);
+	}
+	return dict;
+}
+
+static PyObject *render_stats_to_py(RenderStats& stats)
+{
+	PyObject *dict = PyDict_New();
+	render_stats_dict_set(dict, "memory_used", PyLong_FromSize_t(stats.mem_used));
+	render_stats_dict_set(dict, "memory_peak", PyLong_FromSize_t(stats.mem_peak));
+
+	if(stats.has_profiling) {
+		stats.kernel.update_sum();
+		render_stats_dict_set(dict, "kernel", render_stats_kernel_to_py(stats.kernel, stats.sample_interval));
+		render_stats_dict_set(dict, "shaders", render_stats_counts_to_py(stats.shaders, stats.sample_interval));
+		render_stats_dict_set(dict, "objects", render_stats_counts_to_py(stats.objects, stats.sample_interval));
+	}
+
+	return dict;
+}
+
+/* Statistics of the last final render as a dictionary by render layer, with
+ * times in seconds. Profiler breakdowns are only included for CPU renders. */
+static PyObject *get_render_stats_func(PyObject * /*self*/, PyObject * /*args*/)
+{
+	thread_scoped_lock stats_lock(BlenderSession::last_render_stats_mutex);
+
+	PyObject *dict = PyDict_New();
+	for(map<string, RenderStats>::iterator it = BlenderSession::last_render_stats.begin();
+	    it != BlenderSession::last_render_stats.end();
+	    ++it)
+	{
+		render_stats_dict_set(dict, it->first.c_str(), render_stats_to_py(it->second));
+	}
+	return dict;
+}
+
 static PyObject *get_device_types_func(PyObject * /*self*/, PyObject * /*args*/)
 {
 	vector<DeviceInfo>& devices = Device::available_devices();
@@ -751,6 +876,7 @@ static PyMethodDef methods[] = {
 	{"free", free_func, METH_O, ""},
 	{"render", render_func, METH_O, ""},
 	{"bake", bake_func, METH_VARARGS, ""},
+	{"bake_batch", bake_batch_func, METH_VARARGS, ""},
 	{"draw", draw_func, METH_VARARGS, ""},
 	{"sync", sync_func, METH_O, ""},
 	{"reset", reset_func, METH_VARARGS, ""},
@@ -772,6 +898,11 @@ static PyMethodDef methods[] = {
 	{"set_resumable_chunk", set_resumable_chunk_func, METH_VARARGS, ""},
 	{"set_resumable_chunk_range", set_resumable_chunk_range_func, METH_VARARGS, ""},
 
+	/* Statistics. */
+	{"enable_render_stats", enable_render_stats_func, METH_NOARGS, ""},
+	{"enable_print_stats", enable_print_stats_func, METH_NOARGS, ""},
+	{"get_render_stats", get_render_stats_func, METH_NOARGS, ""},
+
 	/* Compute Device selection */
 	{"get_device_types", get_device_types_func, METH_VARARGS, ""},
 
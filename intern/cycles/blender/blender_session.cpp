@@ -28,6 +28,7 @@
 #include "render/scene.h"
 #include "render/session.h"
 #include "render/shader.h"
+#include "render/stats.h"
 
 #include "util/util_color.h"
 #include "util/util_foreach.h"
@@ -48,6 +49,10 @@ int BlenderSession::num_resumable_chunks = 0;
 int BlenderSession::current_resumable_chunk = 0;
 int BlenderSession::start_resumable_chunk = 0;
 int BlenderSession::end_resumable_chunk = 0;
+bool BlenderSession::collect_render_stats = false;
+bool BlenderSession::print_render_stats = false;
+map<string, RenderStats> BlenderSession::last_render_stats;
+thread_mutex BlenderSession::last_render_stats_mutex;
 
 BlenderSession::BlenderSession(BL::RenderEngine& b_engine,
                                BL::UserPreferences& b_userpref,
@@ -193,7 +198,7 @@ void BlenderSession::reset_session(BL::BlendData& b_data_, BL::Scene& b_scene_)
 		 * them rather than trying to distinguish which settings need to be updated
 		 */
 
-		delete session;
+		free_session();
 
 		create_session();
 
@@ -201,7 +206,6 @@ void BlenderSession::reset_session(BL::BlendData& b_data_, BL::Scene& b_scene_)
 	}
 
 	session->progress.reset();
-	scene->reset();
 
 	session->tile_manager.set_tile_order(session_params.tile_order);
 
@@ -210,8 +214,18 @@ void BlenderSession::reset_session(BL::BlendData& b_data_, BL::Scene& b_scene_)
 	 */
 	session->stats.mem_peak = session->stats.mem_used;
 
-	/* sync object should be re-created */
-	sync = new BlenderSync(b_engine, b_data, b_scene, scene, !background, session->progress);
+	if(sync) {
+		/* Scene and synchronization state were kept from the previous frame,
+		 * only re-sync data which might have changed since then.
+		 */
+		sync->reset(b_data, b_scene);
+		sync->sync_recalc_frame();
+	}
+	else {
+		/* sync object should be re-created */
+		scene->reset();
+		sync = new BlenderSync(b_engine, b_data, b_scene, scene, !background, session->progress);
+	}
 
 	/* for final render we will do full data sync per render layer, only
 	 * do some basic syncing here, no objects or materials for speed */
@@ -237,10 +251,13 @@ void BlenderSession::reset_session(BL::BlendData& b_data_, BL::Scene& b_scene_)
 
 void BlenderSession::free_session()
 {
-	if(sync)
+	if(sync) {
 		delete sync;
+		sync = NULL;
+	}
 
 	delete session;
+	session = NULL;
 }
 
 static ShaderEvalType get_shader_type(const string& pass_type)
@@ -386,6 +403,12 @@ void BlenderSession::render()
 	/* We do some special meta attributes when we only have single layer. */
 	const bool is_single_layer = (r.layers.length() == 1);
 
+	const bool use_render_stats = !b_engine.is_preview() && background && collect_render_stats;
+	if(use_render_stats) {
+		thread_scoped_lock stats_lock(last_render_stats_mutex);
+		last_render_stats.clear();
+	}
+
 	for(r.layers.begin(b_layer_iter); b_layer_iter != r.layers.end(); ++b_layer_iter) {
 		b_rlay_name = b_layer_iter->name();
 
@@ -476,6 +499,23 @@ void BlenderSession::render()
 			session->start();
 			session->wait();
 
+			if(use_render_stats) {
+				RenderStats stats;
+				session->collect_statistics(&stats);
+
+				if(print_render_stats) {
+					printf("Render statistics:\n%s\n", stats.full_report().c_str());
+				}
+
+				string stats_name = b_rlay_name;
+				if(b_rview_name != "") {
+					stats_name += "." + b_rview_name;
+				}
+
+				thread_scoped_lock stats_lock(last_render_stats_mutex);
+				last_render_stats[stats_name] = stats;
+			}
+
 			if(session->progress.get_cancel())
 				break;
 		}
@@ -505,6 +545,14 @@ void BlenderSession::render()
 	session->write_render_tile_cb = function_null;
 	session->update_render_tile_cb = function_null;
 
+	if(scene->params.persistent_data) {
+		/* Keep scene with its device memory and the synchronization state,
+		 * so the next frame only needs to update what changed.
+		 */
+		session->tile_manager.device_free();
+		return;
+	}
+
 	/* free all memory used (host and device), so we wouldn't leave render
 	 * engine with extra memory allocated
 	 */
@@ -567,8 +615,23 @@ void BlenderSession::bake(BL::Object& b_object,
                           const int object_id,
                           BL::BakePixel& pixel_array,
                           const size_t num_pixels,
-                          const int /*depth*/,
+                          const int depth,
                           float result[])
+{
+	vector<BL::Object> b_objects(1, b_object);
+	vector<int> object_ids(1, object_id);
+
+	bake_objects(b_objects, object_ids, pass_type, pass_filter, pixel_array, num_pixels, depth, result);
+}
+
+void BlenderSession::bake_objects(vector<BL::Object>& b_objects,
+                                  const vector<int>& object_ids,
+                                  const string& pass_type,
+                                  const int pass_filter,
+                                  BL::BakePixel& pixel_array,
+                                  const size_t num_pixels,
+                                  const int /*depth*/,
+                                  float result[])
 {
 	ShaderEvalType shader_type = get_shader_type(pass_type);
 
@@ -577,6 +640,11 @@ void BlenderSession::bake(BL::Object& b_object,
 	 */
 	scene->bake_manager->set_baking(true);
 
+	/* The scene is freed after baking, BVH refit would never happen. */
+	if(background) {
+		scene->params.bvh_type = SceneParams::BVH_STATIC;
+	}
+
 	/* ensure kernels are loaded before we do any scene updates */
 	session->load_kernels();
 
@@ -609,7 +677,9 @@ void BlenderSession::bake(BL::Object& b_object,
 						b_rlay_name.c_str());
 	}
 
-	BakeData *bake_data = NULL;
+	/* bake data of every object, shared by the bake passes */
+	vector<BakeData*> bake_datas;
+	vector<BakePass> passes;
 
 	if(!session->progress.get_cancel()) {
 		/* get buffer parameters */
@@ -623,22 +693,34 @@ void BlenderSession::bake(BL::Object& b_object,
 		session->reset(buffer_params, session_params.samples);
 		session->update_scene();
 
-		/* find object index. todo: is arbitrary - copied from mesh_displace.cpp */
-		size_t object_index = OBJECT_NONE;
-		int tri_offset = 0;
+		for(size_t i = 0; i < b_objects.size(); i++) {
+			/* find object index. todo: is arbitrary - copied from mesh_displace.cpp */
+			size_t object_index = OBJECT_NONE;
+			int tri_offset = 0;
 
-		for(size_t i = 0; i < scene->objects.size(); i++) {
-			if(strcmp(scene->objects[i]->name.c_str(), b_object.name().c_str()) == 0) {
-				object_index = i;
-				tri_offset = scene->objects[i]->mesh->tri_offset;
-				break;
+			for(size_t j = 0; j < scene->objects.size(); j++) {
+				if(strcmp(scene->objects[j]->name.c_str(), b_objects[i].name().c_str()) == 0) {
+					object_index = j;
+					tri_offset = scene->objects[j]->mesh->tri_offset;
+					break;
+				}
 			}
-		}
 
-		int object = object_index;
+			int object = object_index;
 
-		bake_data = scene->bake_manager->init(object, tri_offset, num_pixels);
-		populate_bake_data(bake_data, object_id, pixel_array, num_pixels);
+			BakeData *bake_data = new BakeData(object, tri_offset, num_pixels);
+			populate_bake_data(bake_data, object_ids[i], pixel_array, num_pixels);
+			bake_datas.push_back(bake_data);
+
+			/* pixels of other objects are not written, so all objects bake
+			 * into the same result */
+			BakePass pass;
+			pass.bake_data = bake_data;
+			pass.shader_type = shader_type;
+			pass.pass_filter = bake_pass_filter;
+			pass.result = result;
+			passes.push_back(pass);
+		}
 
 		/* set number of samples */
 		session->tile_manager.set_samples(session_params.samples);
@@ -650,7 +732,11 @@ void BlenderSession::bake(BL::Object& b_object,
 
 	/* Perform bake. Check cancel to avoid crash with incomplete scene data. */
 	if(!session->progress.get_cancel()) {
-		scene->bake_manager->bake(scene->device, &scene->dscene, scene, session->progress, shader_type, bake_pass_filter, bake_data, result);
+		scene->bake_manager->bake_batch(scene->device, &scene->dscene, scene, session->progress, passes);
+	}
+
+	foreach(BakeData *bake_data, bake_datas) {
+		delete bake_data;
 	}
 
 	/* free all memory used (host and device), so we wouldn't leave render
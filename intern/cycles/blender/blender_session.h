@@ -21,7 +21,10 @@
 #include "render/scene.h"
 #include "render/session.h"
 #include "render/bake.h"
+#include "render/stats.h"
 
+#include "util/util_map.h"
+#include "util/util_thread.h"
 #include "util/util_vector.h"
 
 CCL_NAMESPACE_BEGIN
@@ -70,6 +73,17 @@ public:
 	          const int depth,
 	          float pixels[]);
 
+	/* Bake multiple objects into the same result with a single scene update,
+	 * object_ids are the ids of the objects in pixel_array. */
+	void bake_objects(vector<BL::Object>& b_objects,
+	                  const vector<int>& object_ids,
+	                  const string& pass_type,
+	                  const int custom_flag,
+	                  BL::BakePixel& pixel_array,
+	                  const size_t num_pixels,
+	                  const int depth,
+	                  float pixels[]);
+
 	void write_render_result(BL::RenderResult& b_rr,
 	                         BL::RenderLayer& b_rlay,
 	                         RenderTile& rtile);
@@ -143,6 +157,20 @@ public:
 	static int start_resumable_chunk;
 	static int end_resumable_chunk;
 
+	/* ** Render statistics ** */
+
+	/* Collect render statistics and the profiler breakdown of final renders. */
+	static bool collect_render_stats;
+
+	/* Print them after rendering every render layer. */
+	static bool print_render_stats;
+
+	/* Statistics of the last final render, by render layer (and view, when
+	 * rendering multiple views). Kept after the session is freed, so they can
+	 * still be queried once the render finished. */
+	static map<string, RenderStats> last_render_stats;
+	static thread_mutex last_render_stats_mutex;
+
 protected:
 	void do_write_update_render_result(BL::RenderResult& b_rr,
 	                                   BL::RenderLayer& b_rlay,
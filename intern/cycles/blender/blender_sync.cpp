@@ -74,6 +74,12 @@ BlenderSync::~BlenderSync()
 {
 }
 
+void BlenderSync::reset(BL::BlendData& b_data, BL::Scene& b_scene)
+{
+	this->b_data = b_data;
+	this->b_scene = b_scene;
+}
+
 /* Sync */
 
 bool BlenderSync::sync_recalc()
@@ -188,6 +194,103 @@ bool BlenderSync::sync_recalc()
 	return recalc;
 }
 
+/* Node tree depends on the current frame through image sequences or movies. */
+static bool node_tree_has_frame_dependency(BL::NodeTree& b_ntree)
+{
+	BL::NodeTree::nodes_iterator b_node;
+	for(b_ntree.nodes.begin(b_node); b_node != b_ntree.nodes.end(); ++b_node) {
+		BL::Image b_image(PointerRNA_NULL);
+		if(b_node->is_a(&RNA_ShaderNodeTexImage)) {
+			b_image = BL::ShaderNodeTexImage(*b_node).image();
+		}
+		else if(b_node->is_a(&RNA_ShaderNodeTexEnvironment)) {
+			b_image = BL::ShaderNodeTexEnvironment(*b_node).image();
+		}
+		else if(b_node->is_a(&RNA_ShaderNodeGroup)) {
+			BL::NodeTree b_group_ntree = ((BL::NodeGroup)(*b_node)).node_tree();
+			if(b_group_ntree && node_tree_has_frame_dependency(b_group_ntree)) {
+				return true;
+			}
+		}
+		if(b_image && (b_image.source() == BL::Image::source_SEQUENCE ||
+		               b_image.source() == BL::Image::source_MOVIE))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool node_tree_is_animated(BL::NodeTree b_ntree)
+{
+	return b_ntree && (b_ntree.animation_data() ||
+	                   node_tree_has_frame_dependency(b_ntree));
+}
+
+void BlenderSync::sync_recalc_frame()
+{
+	/* Tag data which might have changed after a frame change, for final
+	 * renders which keep the scene between frames. Blender clears update
+	 * flags before the render starts, so use animation data, image sequences
+	 * and deforming modifiers as a conservative hint instead. Object
+	 * transforms are compared on every sync and do not need to be tagged.
+	 */
+	BL::BlendData::materials_iterator b_mat;
+	for(b_data.materials.begin(b_mat); b_mat != b_data.materials.end(); ++b_mat) {
+		Shader *shader = shader_map.find(*b_mat);
+		if(b_mat->animation_data() ||
+		   node_tree_is_animated(b_mat->node_tree()) ||
+		   (shader != NULL && shader->has_object_dependency))
+		{
+			shader_map.set_recalc(*b_mat);
+		}
+	}
+
+	BL::BlendData::lamps_iterator b_lamp;
+	for(b_data.lamps.begin(b_lamp); b_lamp != b_data.lamps.end(); ++b_lamp) {
+		if(b_lamp->animation_data() || node_tree_is_animated(b_lamp->node_tree())) {
+			shader_map.set_recalc(*b_lamp);
+		}
+	}
+
+	BL::BlendData::objects_iterator b_ob;
+	for(b_data.objects.begin(b_ob); b_ob != b_data.objects.end(); ++b_ob) {
+		if(b_ob->animation_data()) {
+			object_map.set_recalc(*b_ob);
+		}
+
+		if(object_is_mesh(*b_ob)) {
+			if(ccl::BKE_object_is_deform_modified(*b_ob, b_scene, preview) ||
+			   (b_ob->animation_data() && BKE_object_is_modified(*b_ob)) ||
+			   b_ob->particle_systems.length() != 0)
+			{
+				BL::ID key = BKE_object_is_modified(*b_ob)? *b_ob: b_ob->data();
+				mesh_map.set_recalc(key);
+			}
+		}
+		else if(object_is_light(*b_ob)) {
+			/* Lights are not compared on sync, and there are not many of
+			 * them, so simply update all of them. */
+			light_map.set_recalc(*b_ob);
+		}
+
+		if(b_ob->particle_systems.length() != 0) {
+			particle_system_map.set_recalc(*b_ob);
+		}
+	}
+
+	BL::World b_world = b_scene.world();
+	if(b_world) {
+		Shader *shader = scene->default_background;
+		if(b_world.animation_data() ||
+		   node_tree_is_animated(b_world.node_tree()) ||
+		   shader->has_object_dependency)
+		{
+			world_recalc = true;
+		}
+	}
+}
+
 void BlenderSync::sync_data(BL::RenderSettings& b_render,
                             BL::SpaceView3D& b_v3d,
                             BL::Object& b_override,
@@ -285,6 +388,16 @@ void BlenderSync::sync_integrator()
 	integrator->sample_all_lights_indirect = get_boolean(cscene, "sample_all_lights_indirect");
 	integrator->light_sampling_threshold = get_float(cscene, "light_sampling_threshold");
 
+	bool use_light_tree = get_boolean(cscene, "use_light_tree");
+	if(integrator->use_light_tree != use_light_tree) {
+		scene->light_manager->tag_update(scene);
+	}
+	integrator->use_light_tree = use_light_tree;
+
+	integrator->use_adaptive_sampling = get_boolean(cscene, "use_adaptive_sampling");
+	integrator->adaptive_threshold = get_float(cscene, "adaptive_threshold");
+	integrator->adaptive_min_samples = get_int(cscene, "adaptive_min_samples");
+
 	int diffuse_samples = get_int(cscene, "diffuse_samples");
 	int glossy_samples = get_int(cscene, "glossy_samples");
 	int transmission_samples = get_int(cscene, "transmission_samples");
@@ -517,6 +630,7 @@ PassType BlenderSync::get_pass_type(BL::RenderPass& b_pass)
 	MAP_PASS("Debug Ray Bounces", PASS_RAY_BOUNCES);
 #endif
 	MAP_PASS("Debug Render Time", PASS_RENDER_TIME);
+	MAP_PASS("Debug Sample Count", PASS_SAMPLE_COUNT);
 #undef MAP_PASS
 
 	return PASS_NONE;
@@ -607,6 +721,15 @@ array<Pass> BlenderSync::sync_render_passes(BL::RenderLayer& b_rlay,
 		b_engine.add_pass("Debug Render Time", 1, "X", b_srlay.name().c_str());
 		Pass::add(PASS_RENDER_TIME, passes);
 	}
+	if(get_boolean(crp, "pass_debug_sample_count")) {
+		b_engine.add_pass("Debug Sample Count", 1, "X", b_srlay.name().c_str());
+		Pass::add(PASS_SAMPLE_COUNT, passes);
+	}
+
+	/* Internal state of adaptive sampling, not written to the render result. */
+	if(scene->integrator->use_adaptive_sampling) {
+		Pass::add(PASS_ADAPTIVE_AUX_BUFFER, passes);
+	}
 	if(get_boolean(crp, "use_pass_volume_direct")) {
 		b_engine.add_pass("VolumeDir", 3, "RGB", b_srlay.name().c_str());
 		Pass::add(PASS_VOLUME_DIRECT, passes);
@@ -634,7 +757,20 @@ SceneParams BlenderSync::get_scene_params(BL::Scene& b_scene,
 	else if(shadingsystem == 1)
 		params.shadingsystem = SHADINGSYSTEM_OSL;
 	
-	if(background || DebugFlags().viewport_static_bvh)
+	if(background && params.shadingsystem != SHADINGSYSTEM_OSL)
+		params.persistent_data = r.use_persistent_data();
+	else
+		params.persistent_data = false;
+
+	/* With persistent data BlenderSession::render() keeps the scene and its
+	 * BVHs between frames, so with dynamic BVH meshes which only deform are
+	 * refitted instead of rebuilt. Without it, or when baking, the scene is
+	 * freed after every frame and there is nothing to refit.
+	 */
+	const bool use_bvh_refit = params.persistent_data &&
+	                           RNA_boolean_get(&cscene, "debug_use_bvh_refit");
+
+	if((background && !use_bvh_refit) || DebugFlags().viewport_static_bvh)
 		params.bvh_type = SceneParams::BVH_STATIC;
 	else
 		params.bvh_type = SceneParams::BVH_DYNAMIC;
@@ -642,11 +778,11 @@ SceneParams BlenderSync::get_scene_params(BL::Scene& b_scene,
 	params.use_bvh_spatial_split = RNA_boolean_get(&cscene, "debug_use_spatial_splits");
 	params.use_bvh_unaligned_nodes = RNA_boolean_get(&cscene, "debug_use_hair_bvh");
 	params.num_bvh_time_steps = RNA_int_get(&cscene, "debug_bvh_time_steps");
-
-	if(background && params.shadingsystem != SHADINGSYSTEM_OSL)
-		params.persistent_data = r.use_persistent_data();
-	else
-		params.persistent_data = false;
+	params.bvh_curve_leaf_size = RNA_int_get(&cscene, "debug_bvh_curve_leaf_size");
+	/* Estimating the traversal cost takes an extra pass over every built
+	 * BVH, only do it when refitted BVHs are kept. */
+	params.bvh_refit_threshold = (use_bvh_refit)?
+	        RNA_float_get(&cscene, "debug_bvh_refit_threshold"): 0.0f;
 
 	int texture_limit;
 	if(background) {
@@ -662,6 +798,11 @@ SceneParams BlenderSync::get_scene_params(BL::Scene& b_scene,
 		params.texture_limit = 0;
 	}
 
+	params.use_texture_cache = RNA_boolean_get(&cscene, "use_texture_cache");
+	params.texture_cache_size = RNA_int_get(&cscene, "texture_cache_size");
+	params.use_half_textures = RNA_boolean_get(&cscene, "use_half_textures");
+	params.use_compressed_textures = RNA_boolean_get(&cscene, "use_compressed_textures");
+
 	params.bvh_layout = DebugFlags().cpu.bvh_layout;
 
 	return params;
@@ -836,6 +977,12 @@ SessionParams BlenderSync::get_session_params(BL::RenderEngine& b_engine,
 	params.reset_timeout = (double)get_float(cscene, "debug_reset_timeout");
 	params.text_timeout = (double)get_float(cscene, "debug_text_timeout");
 
+	/* profiling */
+	params.use_profiling = params.device.has_profiling &&
+	                       !b_engine.is_preview() &&
+	                       background &&
+	                       BlenderSession::collect_render_stats;
+
 	/* progressive refine */
 	params.progressive_refine = get_boolean(cscene, "use_progressive_refine") &&
 	                            !b_r.use_save_buffers();
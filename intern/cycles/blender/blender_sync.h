@@ -57,8 +57,11 @@ public:
 	            Progress &progress);
 	~BlenderSync();
 
+	void reset(BL::BlendData& b_data, BL::Scene& b_scene);
+
 	/* sync */
 	bool sync_recalc();
+	void sync_recalc_frame();
 	void sync_data(BL::RenderSettings& b_render,
 	               BL::SpaceView3D& b_v3d,
 	               BL::Object& b_override,
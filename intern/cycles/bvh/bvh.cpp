@@ -28,6 +28,8 @@
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
 #include "util/util_progress.h"
+#include "util/util_string.h"
+#include "util/util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -81,7 +83,10 @@ int BVHStackEntry::encodeIdx() const
 /* BVH */
 
 BVH::BVH(const BVHParams& params_, const vector<Object*>& objects_)
-: params(params_), objects(objects_)
+: params(params_),
+  objects(objects_),
+  build_cost(0.0f),
+  refit_cost(0.0f)
 {
 }
 
@@ -107,6 +112,7 @@ void BVH::build(Progress& progress)
 	progress.set_substatus("Building BVH");
 
 	/* build nodes */
+	double build_start_time = time_dt();
 	BVHBuild bvh_build(objects,
 	                   pack.prim_type,
 	                   pack.prim_index,
@@ -115,6 +121,7 @@ void BVH::build(Progress& progress)
 	                   params,
 	                   progress);
 	BVHNode *root = bvh_build.run();
+	double build_time = time_dt() - build_start_time;
 
 	if(progress.get_cancel()) {
 		if(root) root->deleteSubtree();
@@ -123,7 +130,9 @@ void BVH::build(Progress& progress)
 
 	/* pack triangles */
 	progress.set_substatus("Packing BVH triangles and strands");
+	double pack_primitives_start_time = time_dt();
 	pack_primitives();
+	double pack_primitives_time = time_dt() - pack_primitives_start_time;
 
 	if(progress.get_cancel()) {
 		root->deleteSubtree();
@@ -132,10 +141,21 @@ void BVH::build(Progress& progress)
 
 	/* pack nodes */
 	progress.set_substatus("Packing BVH nodes");
+	double pack_nodes_start_time = time_dt();
 	pack_nodes(root);
+	double pack_nodes_time = time_dt() - pack_nodes_start_time;
 
 	/* free build nodes */
 	root->deleteSubtree();
+
+	VLOG(1) << bvh_layout_name(params.bvh_layout) << " build phases:\n"
+	        << "  Build nodes time: " << build_time << "\n"
+	        << "  Pack primitives time: " << pack_primitives_time << "\n"
+	        << "  Pack nodes time: " << pack_nodes_time << "\n"
+	        << "  Packed nodes: "
+	        << string_human_readable_size(pack.nodes.size() * sizeof(int4)) << "\n"
+	        << "  Packed leaf nodes: "
+	        << string_human_readable_size(pack.leaf_nodes.size() * sizeof(int4)) << "\n";
 }
 
 /* Refitting */
@@ -148,7 +168,12 @@ void BVH::refit(Progress& progress)
 	if(progress.get_cancel()) return;
 
 	progress.set_substatus("Refitting BVH nodes");
-	refit_nodes();
+	refit_cost = refit_nodes(true);
+}
+
+void BVH::update_build_cost()
+{
+	build_cost = refit_cost = refit_nodes(false);
 }
 
 void BVH::refit_primitives(int start, int end, BoundBox& bbox, uint& visibility)
@@ -172,8 +197,10 @@ void BVH::refit_primitives(int start, int end, BoundBox& bbox, uint& visibility)
 				int str_offset = (params.top_level)? mesh->curve_offset: 0;
 				Mesh::Curve curve = mesh->get_curve(pidx - str_offset);
 				int k = PRIMITIVE_UNPACK_SEGMENT(pack.prim_type[prim]);
+				int num_segments = PRIMITIVE_UNPACK_NUM_SEGMENTS(pack.prim_type[prim]);
 
-				curve.bounds_grow(k, &mesh->curve_keys[0], &mesh->curve_radius[0], bbox);
+				for(int s = 0; s < num_segments; s++)
+					curve.bounds_grow(k + s, &mesh->curve_keys[0], &mesh->curve_radius[0], bbox);
 
 				visibility |= PATH_RAY_CURVE;
 
@@ -187,7 +214,8 @@ void BVH::refit_primitives(int start, int end, BoundBox& bbox, uint& visibility)
 						float3 *key_steps = attr->data_float3();
 
 						for(size_t i = 0; i < steps; i++)
-							curve.bounds_grow(k, key_steps + i*mesh_size, &mesh->curve_radius[0], bbox);
+							for(int s = 0; s < num_segments; s++)
+								curve.bounds_grow(k + s, key_steps + i*mesh_size, &mesh->curve_radius[0], bbox);
 					}
 				}
 			}
@@ -472,7 +500,7 @@ void BVH::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
 					nsize = use_qbvh
 					            ? BVH_UNALIGNED_QNODE_SIZE
 					            : BVH_UNALIGNED_NODE_SIZE;
-					nsize_bbox = (use_qbvh)? 13: 0;
+					nsize_bbox = (use_qbvh)? 8: 0;
 				}
 				else {
 					nsize = (use_qbvh)? BVH_QNODE_SIZE: BVH_NODE_SIZE;
@@ -88,6 +88,15 @@ public:
 	void build(Progress& progress);
 	void refit(Progress& progress);
 
+	/* Estimated traversal cost of the nodes, as the sum of the surface areas
+	 * of all inner nodes relative to the root node. Measured on demand after
+	 * a full build and updated by every refit, so callers can decide when
+	 * refitting degraded the tree enough to warrant a rebuild.
+	 */
+	void update_build_cost();
+	float build_cost;
+	float refit_cost;
+
 protected:
 	BVH(const BVHParams& params, const vector<Object*>& objects);
 
@@ -103,7 +112,9 @@ protected:
 
 	/* for subclasses to implement */
 	virtual void pack_nodes(const BVHNode *root) = 0;
-	virtual void refit_nodes() = 0;
+	/* Recompute node bounds from primitives, packing them when update is
+	 * true. Returns estimated traversal cost of the nodes. */
+	virtual float refit_nodes(bool update) = 0;
 };
 
 /* Pack Utility */
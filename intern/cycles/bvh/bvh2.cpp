@@ -139,21 +139,23 @@ void BVH2::pack_unaligned_node(int idx,
 	assert(c1 < 0 || c1 < pack.nodes.size());
 
 	float4 data[BVH_UNALIGNED_NODE_SIZE];
-	Transform space0 = BVHUnaligned::compute_node_transform(bounds0,
-	                                                        aligned_space0);
-	Transform space1 = BVHUnaligned::compute_node_transform(bounds1,
-	                                                        aligned_space1);
+	const Transform *aligned_space[2] = {&aligned_space0, &aligned_space1};
+	const BoundBox *bounds[2] = {&bounds0, &bounds1};
 	data[0] = make_float4(__int_as_float(visibility0 | PATH_RAY_NODE_UNALIGNED),
 	                      __int_as_float(visibility1 | PATH_RAY_NODE_UNALIGNED),
 	                      __int_as_float(c0),
 	                      __int_as_float(c1));
 
-	data[1] = space0.x;
-	data[2] = space0.y;
-	data[3] = space0.z;
-	data[4] = space1.x;
-	data[5] = space1.y;
-	data[6] = space1.z;
+	for(int i = 0; i < 2; i++) {
+		uint frame;
+		float3 scale, offset;
+		BVHUnaligned::compute_node_space(*bounds[i],
+		                                 *aligned_space[i],
+		                                 &frame, &scale, &offset);
+		data[i*2 + 1] = make_float4(scale.x, scale.y, scale.z,
+		                            __uint_as_float(frame));
+		data[i*2 + 2] = make_float4(offset.x, offset.y, offset.z, 0.0f);
+	}
 
 	memcpy(&pack.nodes[idx], data, sizeof(float4)*BVH_UNALIGNED_NODE_SIZE);
 }
@@ -235,16 +237,30 @@ void BVH2::pack_nodes(const BVHNode *root)
 	pack.root_index = (root->is_leaf())? -1: 0;
 }
 
-void BVH2::refit_nodes()
+float BVH2::refit_nodes(bool update)
 {
 	assert(!params.top_level);
 
 	BoundBox bbox = BoundBox::empty;
 	uint visibility = 0;
-	refit_node(0, (pack.root_index == -1)? true: false, bbox, visibility);
+	float area = 0.0f;
+	refit_node(0,
+	           (pack.root_index == -1)? true: false,
+	           bbox,
+	           visibility,
+	           area,
+	           update);
+
+	const float root_area = bbox.half_area();
+	return (root_area > 0.0f)? area / root_area: 0.0f;
 }
 
-void BVH2::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
+void BVH2::refit_node(int idx,
+                      bool leaf,
+                      BoundBox& bbox,
+                      uint& visibility,
+                      float& area,
+                      bool update)
 {
 	if(leaf) {
 		/* refit leaf node */
@@ -255,6 +271,10 @@ void BVH2::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
 
 		BVH::refit_primitives(c0, c1, bbox, visibility);
 
+		if(!update) {
+			return;
+		}
+
 		/* TODO(sergey): De-duplicate with pack_leaf(). */
 		float4 leaf_data[BVH_NODE_LEAF_SIZE];
 		leaf_data[0].x = __int_as_float(c0);
@@ -274,8 +294,17 @@ void BVH2::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
 		BoundBox bbox0 = BoundBox::empty, bbox1 = BoundBox::empty;
 		uint visibility0 = 0, visibility1 = 0;
 
-		refit_node((c0 < 0)? -c0-1: c0, (c0 < 0), bbox0, visibility0);
-		refit_node((c1 < 0)? -c1-1: c1, (c1 < 0), bbox1, visibility1);
+		refit_node((c0 < 0)? -c0-1: c0, (c0 < 0), bbox0, visibility0, area, update);
+		refit_node((c1 < 0)? -c1-1: c1, (c1 < 0), bbox1, visibility1, area, update);
+
+		bbox.grow(bbox0);
+		bbox.grow(bbox1);
+		visibility = visibility0|visibility1;
+		area += bbox.half_area();
+
+		if(!update) {
+			return;
+		}
 
 		if(is_unaligned) {
 			Transform aligned_space = transform_identity();
@@ -293,10 +322,6 @@ void BVH2::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
 			                  visibility0,
 			                  visibility1);
 		}
-
-		bbox.grow(bbox0);
-		bbox.grow(bbox1);
-		visibility = visibility0|visibility1;
 	}
 }
 
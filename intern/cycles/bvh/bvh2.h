@@ -36,7 +36,7 @@ class Progress;
 
 #define BVH_NODE_SIZE           4
 #define BVH_NODE_LEAF_SIZE      1
-#define BVH_UNALIGNED_NODE_SIZE 7
+#define BVH_UNALIGNED_NODE_SIZE 5
 
 /* BVH2
  *
@@ -78,8 +78,13 @@ protected:
 	                         uint visibility0, uint visibility1);
 
 	/* refit */
-	void refit_nodes();
-	void refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility);
+	float refit_nodes(bool update);
+	void refit_node(int idx,
+	                bool leaf,
+	                BoundBox& bbox,
+	                uint& visibility,
+	                float& area,
+	                bool update);
 };
 
 CCL_NAMESPACE_END
@@ -214,51 +214,42 @@ void BVH4::pack_unaligned_node(int idx,
 	data[0].z = time_to;
 
 	for(int i = 0; i < num; i++) {
-		Transform space = BVHUnaligned::compute_node_transform(
-		        bounds[i],
-		        aligned_space[i]);
+		uint frame;
+		float3 scale, offset;
+		BVHUnaligned::compute_node_space(bounds[i],
+		                                 aligned_space[i],
+		                                 &frame, &scale, &offset);
 
-		data[1][i] = space.x.x;
-		data[2][i] = space.x.y;
-		data[3][i] = space.x.z;
+		data[1][i] = __uint_as_float(frame);
 
-		data[4][i] = space.y.x;
-		data[5][i] = space.y.y;
-		data[6][i] = space.y.z;
+		data[2][i] = scale.x;
+		data[3][i] = scale.y;
+		data[4][i] = scale.z;
 
-		data[7][i] = space.z.x;
-		data[8][i] = space.z.y;
-		data[9][i] = space.z.z;
+		data[5][i] = offset.x;
+		data[6][i] = offset.y;
+		data[7][i] = offset.z;
 
-		data[10][i] = space.x.w;
-		data[11][i] = space.y.w;
-		data[12][i] = space.z.w;
-
-		data[13][i] = __int_as_float(child[i]);
+		data[8][i] = __int_as_float(child[i]);
 	}
 
+	const uint identity_frame = transform_frame_pack(make_float3(0.0f, 0.0f, 1.0f));
 	for(int i = num; i < 4; i++) {
 		/* We store BB which would never be recorded as intersection
 		 * so kernel might safely assume there are always 4 child nodes.
 		 */
 
-		data[1][i] = NAN;
+		data[1][i] = __uint_as_float(identity_frame);
+
 		data[2][i] = NAN;
 		data[3][i] = NAN;
-
 		data[4][i] = NAN;
+
 		data[5][i] = NAN;
 		data[6][i] = NAN;
-
 		data[7][i] = NAN;
-		data[8][i] = NAN;
-		data[9][i] = NAN;
 
-		data[10][i] = NAN;
-		data[11][i] = NAN;
-		data[12][i] = NAN;
-
-		data[13][i] = __int_as_float(0);
+		data[8][i] = __int_as_float(0);
 	}
 
 	memcpy(&pack.nodes[idx], data, sizeof(float4)*BVH_UNALIGNED_QNODE_SIZE);
@@ -266,23 +257,73 @@ void BVH4::pack_unaligned_node(int idx,
 
 /* Quad SIMD Nodes */
 
-void BVH4::pack_nodes(const BVHNode *root)
+/* Collect children of the quad node which corresponds to the given binary
+ * node, returns number of collected children. */
+static int node_qbvh_children(const BVHNode *node, const BVHNode *nodes[4])
 {
-	/* Calculate size of the arrays required. */
-	const size_t num_nodes = root->getSubtreeSize(BVH_STAT_QNODE_COUNT);
-	const size_t num_leaf_nodes = root->getSubtreeSize(BVH_STAT_LEAF_COUNT);
-	assert(num_leaf_nodes <= num_nodes);
-	const size_t num_inner_nodes = num_nodes - num_leaf_nodes;
-	size_t node_size;
-	if(params.use_unaligned_nodes) {
-		const size_t num_unaligned_nodes =
-		        root->getSubtreeSize(BVH_STAT_UNALIGNED_INNER_QNODE_COUNT);
-		node_size = (num_unaligned_nodes * BVH_UNALIGNED_QNODE_SIZE) +
-		            (num_inner_nodes - num_unaligned_nodes) * BVH_QNODE_SIZE;
+	const BVHNode *node0 = node->get_child(0);
+	const BVHNode *node1 = node->get_child(1);
+	int numnodes = 0;
+	if(node0->is_leaf()) {
+		nodes[numnodes++] = node0;
+	}
+	else {
+		nodes[numnodes++] = node0->get_child(0);
+		nodes[numnodes++] = node0->get_child(1);
+	}
+	if(node1->is_leaf()) {
+		nodes[numnodes++] = node1;
 	}
 	else {
-		node_size = num_inner_nodes * BVH_QNODE_SIZE;
+		nodes[numnodes++] = node1->get_child(0);
+		nodes[numnodes++] = node1->get_child(1);
+	}
+	return numnodes;
+}
+
+static int node_qbvh_size(const BVHNode *node)
+{
+	return node_qbvh_is_unaligned(node)
+	               ? BVH_UNALIGNED_QNODE_SIZE
+	               : BVH_QNODE_SIZE;
+}
+
+/* Calculate space needed in the packed arrays by the given subtree in a
+ * single bottom-up pass. Sizes of the children of subtrees which are large
+ * enough to be packed in parallel are stored, so they are known up front.
+ */
+void BVH4::compute_subtree_size(const BVHNode *node, SubtreeSize *size)
+{
+	if(node->is_leaf()) {
+		size->node_size = 0;
+		size->num_leaf_nodes = 1;
+		return;
+	}
+	const BVHNode *nodes[4];
+	const int numnodes = node_qbvh_children(node, nodes);
+	SubtreeSize child_size[4];
+	size->node_size = node_qbvh_size(node);
+	size->num_leaf_nodes = 0;
+	for(int i = 0; i < numnodes; ++i) {
+		compute_subtree_size(nodes[i], &child_size[i]);
+		size->node_size += child_size[i].node_size;
+		size->num_leaf_nodes += child_size[i].num_leaf_nodes;
 	}
+	if(size->num_leaf_nodes >= PACK_PARALLEL_SIZE) {
+		for(int i = 0; i < numnodes; ++i) {
+			subtree_sizes[nodes[i]] = child_size[i];
+		}
+	}
+}
+
+void BVH4::pack_nodes(const BVHNode *root)
+{
+	/* Calculate size of the arrays required. */
+	SubtreeSize root_size;
+	subtree_sizes.clear();
+	compute_subtree_size(root, &root_size);
+	const size_t node_size = root_size.node_size;
+	const size_t num_leaf_nodes = root_size.num_leaf_nodes;
 	/* Resize arrays. */
 	pack.nodes.clear();
 	pack.leaf_nodes.clear();
@@ -297,18 +338,40 @@ void BVH4::pack_nodes(const BVHNode *root)
 
 	int nextNodeIdx = 0, nextLeafNodeIdx = 0;
 
-	vector<BVHStackEntry> stack;
-	stack.reserve(BVHParams::MAX_DEPTH*2);
+	BVHStackEntry root_entry;
 	if(root->is_leaf()) {
-		stack.push_back(BVHStackEntry(root, nextLeafNodeIdx++));
+		root_entry = BVHStackEntry(root, nextLeafNodeIdx++);
 	}
 	else {
-		stack.push_back(BVHStackEntry(root, nextNodeIdx));
-		nextNodeIdx += node_qbvh_is_unaligned(root)
-		                       ? BVH_UNALIGNED_QNODE_SIZE
-		                       : BVH_QNODE_SIZE;
+		root_entry = BVHStackEntry(root, nextNodeIdx);
+		nextNodeIdx += node_qbvh_size(root);
 	}
 
+	if(num_leaf_nodes < PACK_PARALLEL_SIZE) {
+		pack_subtree(root_entry, nextNodeIdx, nextLeafNodeIdx);
+	}
+	else {
+		/* Every subtree gets its own contiguous range of nodes and leaves,
+		 * so subtrees are packed independently from each other.
+		 */
+		TaskPool pool;
+		pack_subtree_parallel(root_entry, nextNodeIdx, nextLeafNodeIdx, &pool);
+		pool.wait_work();
+	}
+	subtree_sizes.clear();
+
+	/* Root index to start traversal at, to handle case of single leaf node. */
+	pack.root_index = (root->is_leaf())? -1: 0;
+}
+
+void BVH4::pack_subtree(const BVHStackEntry& root_entry,
+                        int nextNodeIdx,
+                        int nextLeafNodeIdx)
+{
+	vector<BVHStackEntry> stack;
+	stack.reserve(BVHParams::MAX_DEPTH*2);
+	stack.push_back(root_entry);
+
 	while(stack.size()) {
 		BVHStackEntry e = stack.back();
 		stack.pop_back();
@@ -320,26 +383,8 @@ void BVH4::pack_nodes(const BVHNode *root)
 		}
 		else {
 			/* Inner node. */
-			const BVHNode *node = e.node;
-			const BVHNode *node0 = node->get_child(0);
-			const BVHNode *node1 = node->get_child(1);
-			/* Collect nodes. */
 			const BVHNode *nodes[4];
-			int numnodes = 0;
-			if(node0->is_leaf()) {
-				nodes[numnodes++] = node0;
-			}
-			else {
-				nodes[numnodes++] = node0->get_child(0);
-				nodes[numnodes++] = node0->get_child(1);
-			}
-			if(node1->is_leaf()) {
-				nodes[numnodes++] = node1;
-			}
-			else {
-				nodes[numnodes++] = node1->get_child(0);
-				nodes[numnodes++] = node1->get_child(1);
-			}
+			const int numnodes = node_qbvh_children(e.node, nodes);
 			/* Push entries on the stack. */
 			for(int i = 0; i < numnodes; ++i) {
 				int idx;
@@ -348,9 +393,7 @@ void BVH4::pack_nodes(const BVHNode *root)
 				}
 				else {
 					idx = nextNodeIdx;
-					nextNodeIdx += node_qbvh_is_unaligned(nodes[i])
-					                       ? BVH_UNALIGNED_QNODE_SIZE
-					                       : BVH_QNODE_SIZE;
+					nextNodeIdx += node_qbvh_size(nodes[i]);
 				}
 				stack.push_back(BVHStackEntry(nodes[i], idx));
 			}
@@ -358,21 +401,95 @@ void BVH4::pack_nodes(const BVHNode *root)
 			pack_inner(e, &stack[stack.size()-numnodes], numnodes);
 		}
 	}
-	assert(node_size == nextNodeIdx);
-	/* Root index to start traversal at, to handle case of single leaf node. */
-	pack.root_index = (root->is_leaf())? -1: 0;
 }
 
-void BVH4::refit_nodes()
+void BVH4::pack_subtree_parallel(BVHStackEntry e,
+                                 int nextNodeIdx,
+                                 int nextLeafNodeIdx,
+                                 TaskPool *pool)
+{
+	if(e.node->is_leaf()) {
+		pack_leaf(e, reinterpret_cast<const LeafNode*>(e.node));
+		return;
+	}
+
+	const BVHNode *nodes[4];
+	const int numnodes = node_qbvh_children(e.node, nodes);
+
+	/* Reserve index ranges for every child subtree. */
+	BVHStackEntry entries[4];
+	int child_next_node_idx[4], child_next_leaf_idx[4];
+	size_t child_num_leaf_nodes[4];
+	for(int i = 0; i < numnodes; ++i) {
+		if(nodes[i]->is_leaf()) {
+			child_num_leaf_nodes[i] = 1;
+			entries[i] = BVHStackEntry(nodes[i], nextLeafNodeIdx++);
+		}
+		else {
+			/* Sizes of all children were stored when computing the size of
+			 * this subtree, the map is only read from here on.
+			 */
+			const SubtreeSizeMap::const_iterator child_size =
+			        subtree_sizes.find(nodes[i]);
+			assert(child_size != subtree_sizes.end());
+			child_num_leaf_nodes[i] = child_size->second.num_leaf_nodes;
+			const int size = node_qbvh_size(nodes[i]);
+			entries[i] = BVHStackEntry(nodes[i], nextNodeIdx);
+			child_next_node_idx[i] = nextNodeIdx + size;
+			child_next_leaf_idx[i] = nextLeafNodeIdx;
+			nextNodeIdx += child_size->second.node_size;
+			nextLeafNodeIdx += child_num_leaf_nodes[i];
+		}
+	}
+
+	pack_inner(e, entries, numnodes);
+
+	for(int i = 0; i < numnodes; ++i) {
+		if(nodes[i]->is_leaf()) {
+			pack_leaf(entries[i], reinterpret_cast<const LeafNode*>(nodes[i]));
+		}
+		else if(child_num_leaf_nodes[i] < PACK_PARALLEL_SIZE) {
+			pool->push(function_bind(&BVH4::pack_subtree,
+			                         this,
+			                         entries[i],
+			                         child_next_node_idx[i],
+			                         child_next_leaf_idx[i]));
+		}
+		else {
+			pool->push(function_bind(&BVH4::pack_subtree_parallel,
+			                         this,
+			                         entries[i],
+			                         child_next_node_idx[i],
+			                         child_next_leaf_idx[i],
+			                         pool));
+		}
+	}
+}
+
+float BVH4::refit_nodes(bool update)
 {
 	assert(!params.top_level);
 
 	BoundBox bbox = BoundBox::empty;
 	uint visibility = 0;
-	refit_node(0, (pack.root_index == -1)? true: false, bbox, visibility);
+	float area = 0.0f;
+	refit_node(0,
+	           (pack.root_index == -1)? true: false,
+	           bbox,
+	           visibility,
+	           area,
+	           update);
+
+	const float root_area = bbox.half_area();
+	return (root_area > 0.0f)? area / root_area: 0.0f;
 }
 
-void BVH4::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
+void BVH4::refit_node(int idx,
+                      bool leaf,
+                      BoundBox& bbox,
+                      uint& visibility,
+                      float& area,
+                      bool update)
 {
 	if(leaf) {
 		/* Refit leaf node. */
@@ -381,6 +498,10 @@ void BVH4::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
 
 		BVH::refit_primitives(c.x, c.y, bbox, visibility);
 
+		if(!update) {
+			return;
+		}
+
 		/* TODO(sergey): This is actually a copy of pack_leaf(),
 		 * but this chunk of code only knows actual data and has
 		 * no idea about BVHNode.
@@ -403,7 +524,7 @@ void BVH4::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
 		bool is_unaligned = (data[0].x & PATH_RAY_NODE_UNALIGNED) != 0;
 		int4 c;
 		if(is_unaligned) {
-			c = data[13];
+			c = data[8];
 		}
 		else {
 			c = data[7];
@@ -419,12 +540,18 @@ void BVH4::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
 		for(int i = 0; i < 4; ++i) {
 			if(c[i] != 0) {
 				refit_node((c[i] < 0)? -c[i]-1: c[i], (c[i] < 0),
-				           child_bbox[i], child_visibility[i]);
+				           child_bbox[i], child_visibility[i],
+				           area, update);
 				++num_nodes;
 				bbox.grow(child_bbox[i]);
 				visibility |= child_visibility[i];
 			}
 		}
+		area += bbox.half_area();
+
+		if(!update) {
+			return;
+		}
 
 		if(is_unaligned) {
 			Transform aligned_space[4] = {transform_identity(),
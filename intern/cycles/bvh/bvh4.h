@@ -21,6 +21,8 @@
 #include "bvh/bvh.h"
 #include "bvh/bvh_params.h"
 
+#include "util/util_map.h"
+#include "util/util_task.h"
 #include "util/util_types.h"
 #include "util/util_vector.h"
 
@@ -36,7 +38,7 @@ class Progress;
 
 #define BVH_QNODE_SIZE           8
 #define BVH_QNODE_LEAF_SIZE      1
-#define BVH_UNALIGNED_QNODE_SIZE 14
+#define BVH_UNALIGNED_QNODE_SIZE 9
 
 /* BVH4
  *
@@ -51,6 +53,28 @@ protected:
 	/* pack */
 	void pack_nodes(const BVHNode *root);
 
+	/* Subtrees with at least this many leaves are packed in parallel. */
+	enum { PACK_PARALLEL_SIZE = 4096 };
+
+	/* Space needed in the packed arrays by a subtree. */
+	struct SubtreeSize {
+		size_t node_size;
+		size_t num_leaf_nodes;
+	};
+	typedef unordered_map<const BVHNode*, SubtreeSize> SubtreeSizeMap;
+	/* Sizes of the children of subtrees which are packed in parallel. */
+	SubtreeSizeMap subtree_sizes;
+
+	void compute_subtree_size(const BVHNode *node, SubtreeSize *size);
+
+	void pack_subtree(const BVHStackEntry& root_entry,
+	                  int nextNodeIdx,
+	                  int nextLeafNodeIdx);
+	void pack_subtree_parallel(BVHStackEntry e,
+	                           int nextNodeIdx,
+	                           int nextLeafNodeIdx,
+	                           TaskPool *pool);
+
 	void pack_leaf(const BVHStackEntry& e, const LeafNode *leaf);
 	void pack_inner(const BVHStackEntry& e, const BVHStackEntry *en, int num);
 
@@ -78,8 +102,13 @@ protected:
 	                         const int num);
 
 	/* refit */
-	void refit_nodes();
-	void refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility);
+	float refit_nodes(bool update);
+	void refit_node(int idx,
+	                bool leaf,
+	                BoundBox& bbox,
+	                uint& visibility,
+	                float& area,
+	                bool update);
 };
 
 CCL_NAMESPACE_END
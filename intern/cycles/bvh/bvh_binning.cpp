@@ -23,7 +23,9 @@
 
 #include "util/util_algorithm.h"
 #include "util/util_boundbox.h"
+#include "util/util_task.h"
 #include "util/util_types.h"
+#include "util/util_vector.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -82,56 +84,17 @@ BVHObjectBinning::BVHObjectBinning(const BVHRange& job,
 	num_bins = min(size_t(MAX_BINS), size_t(4.0f + 0.05f*size()));
 	scale = rcp(cent_bounds_.size()) * make_float3((float)num_bins);
 
-	/* initialize binning counter and bounds */
-	BoundBox bin_bounds[MAX_BINS][4];	/* bounds for every bin in every dimension */
-	int4 bin_count[MAX_BINS];			/* number of primitives mapped to bin */
-
-	for(size_t i = 0; i < num_bins; i++) {
-		bin_count[i] = make_int4(0);
-		bin_bounds[i][0] = bin_bounds[i][1] = bin_bounds[i][2] = BoundBox::empty;
+	/* map geometry to bins */
+	Bins bins;
+	if(size() >= PARALLEL_BINNING_SIZE && TaskScheduler::num_threads() > 1) {
+		fill_bins_parallel(prims, &bins);
 	}
-
-	/* map geometry to bins, unrolled once */
-	{
-		ssize_t i;
-
-		for(i = 0; i < ssize_t(size()) - 1; i += 2) {
-			prefetch_L2(&prims[start() + i + 8]);
-
-			/* map even and odd primitive to bin */
-			const BVHReference& prim0 = prims[start() + i + 0];
-			const BVHReference& prim1 = prims[start() + i + 1];
-
-			BoundBox bounds0 = get_prim_bounds(prim0);
-			BoundBox bounds1 = get_prim_bounds(prim1);
-
-			int4 bin0 = get_bin(bounds0);
-			int4 bin1 = get_bin(bounds1);
-
-			/* increase bounds for bins for even primitive */
-			int b00 = (int)extract<0>(bin0); bin_count[b00][0]++; bin_bounds[b00][0].grow(bounds0);
-			int b01 = (int)extract<1>(bin0); bin_count[b01][1]++; bin_bounds[b01][1].grow(bounds0);
-			int b02 = (int)extract<2>(bin0); bin_count[b02][2]++; bin_bounds[b02][2].grow(bounds0);
-
-			/* increase bounds of bins for odd primitive */
-			int b10 = (int)extract<0>(bin1); bin_count[b10][0]++; bin_bounds[b10][0].grow(bounds1);
-			int b11 = (int)extract<1>(bin1); bin_count[b11][1]++; bin_bounds[b11][1].grow(bounds1);
-			int b12 = (int)extract<2>(bin1); bin_count[b12][2]++; bin_bounds[b12][2].grow(bounds1);
-		}
-
-		/* for uneven number of primitives */
-		if(i < ssize_t(size())) {
-			/* map primitive to bin */
-			const BVHReference& prim0 = prims[start() + i];
-			BoundBox bounds0 = get_prim_bounds(prim0);
-			int4 bin0 = get_bin(bounds0);
-
-			/* increase bounds of bins */
-			int b00 = (int)extract<0>(bin0); bin_count[b00][0]++; bin_bounds[b00][0].grow(bounds0);
-			int b01 = (int)extract<1>(bin0); bin_count[b01][1]++; bin_bounds[b01][1].grow(bounds0);
-			int b02 = (int)extract<2>(bin0); bin_count[b02][2]++; bin_bounds[b02][2].grow(bounds0);
-		}
+	else {
+		bins.clear(num_bins);
+		fill_bins(prims, start(), end(), &bins);
 	}
+	const BoundBox (*bin_bounds)[4] = bins.bounds;
+	const int4 *bin_count = bins.count;
 
 	/* sweep from right to left and compute parallel prefix of merged bounds */
 	float4 r_area[MAX_BINS];	/* area of bounds of primitives on the right */
@@ -188,6 +151,104 @@ BVHObjectBinning::BVHObjectBinning(const BVHRange& job,
 	leafSAH = bounds_.half_area() * blocks(size());
 }
 
+void BVHObjectBinning::Bins::clear(size_t num_bins)
+{
+	for(size_t i = 0; i < num_bins; i++) {
+		count[i] = make_int4(0);
+		bounds[i][0] = bounds[i][1] = bounds[i][2] = BoundBox::empty;
+	}
+}
+
+void BVHObjectBinning::Bins::merge(const Bins& other, size_t num_bins)
+{
+	for(size_t i = 0; i < num_bins; i++) {
+		count[i] = count[i] + other.count[i];
+		bounds[i][0].grow(other.bounds[i][0]);
+		bounds[i][1].grow(other.bounds[i][1]);
+		bounds[i][2].grow(other.bounds[i][2]);
+	}
+}
+
+void BVHObjectBinning::fill_bins(const BVHReference *prims,
+                                 size_t begin,
+                                 size_t end,
+                                 Bins *bins) const
+{
+	BoundBox (*bin_bounds)[4] = bins->bounds;
+	int4 *bin_count = bins->count;
+
+	/* map geometry to bins, unrolled once */
+	size_t i;
+
+	for(i = begin; i + 1 < end; i += 2) {
+		prefetch_L2(&prims[i + 8]);
+
+		/* map even and odd primitive to bin */
+		const BVHReference& prim0 = prims[i + 0];
+		const BVHReference& prim1 = prims[i + 1];
+
+		BoundBox bounds0 = get_prim_bounds(prim0);
+		BoundBox bounds1 = get_prim_bounds(prim1);
+
+		int4 bin0 = get_bin(bounds0);
+		int4 bin1 = get_bin(bounds1);
+
+		/* increase bounds for bins for even primitive */
+		int b00 = (int)extract<0>(bin0); bin_count[b00][0]++; bin_bounds[b00][0].grow(bounds0);
+		int b01 = (int)extract<1>(bin0); bin_count[b01][1]++; bin_bounds[b01][1].grow(bounds0);
+		int b02 = (int)extract<2>(bin0); bin_count[b02][2]++; bin_bounds[b02][2].grow(bounds0);
+
+		/* increase bounds of bins for odd primitive */
+		int b10 = (int)extract<0>(bin1); bin_count[b10][0]++; bin_bounds[b10][0].grow(bounds1);
+		int b11 = (int)extract<1>(bin1); bin_count[b11][1]++; bin_bounds[b11][1].grow(bounds1);
+		int b12 = (int)extract<2>(bin1); bin_count[b12][2]++; bin_bounds[b12][2].grow(bounds1);
+	}
+
+	/* for uneven number of primitives */
+	if(i < end) {
+		/* map primitive to bin */
+		const BVHReference& prim0 = prims[i];
+		BoundBox bounds0 = get_prim_bounds(prim0);
+		int4 bin0 = get_bin(bounds0);
+
+		/* increase bounds of bins */
+		int b00 = (int)extract<0>(bin0); bin_count[b00][0]++; bin_bounds[b00][0].grow(bounds0);
+		int b01 = (int)extract<1>(bin0); bin_count[b01][1]++; bin_bounds[b01][1].grow(bounds0);
+		int b02 = (int)extract<2>(bin0); bin_count[b02][2]++; bin_bounds[b02][2].grow(bounds0);
+	}
+}
+
+void BVHObjectBinning::fill_bins_parallel(const BVHReference *prims,
+                                          Bins *bins) const
+{
+	/* Use a few chunks per thread for better load balancing. */
+	const size_t max_chunks = TaskScheduler::num_threads() * 4;
+	const size_t num_chunks = min(max_chunks,
+	                              divide_up(size(), PARALLEL_CHUNK_SIZE));
+	const size_t chunk_size = divide_up(size(), num_chunks);
+
+	vector<Bins> chunk_bins(num_chunks);
+	TaskPool pool;
+	for(size_t i = 0; i < num_chunks; i++) {
+		const size_t chunk_start = start() + i * chunk_size;
+		const size_t chunk_end = min(chunk_start + chunk_size, (size_t)end());
+		chunk_bins[i].clear(num_bins);
+		pool.push(function_bind(&BVHObjectBinning::fill_bins,
+		                        this,
+		                        prims,
+		                        chunk_start,
+		                        chunk_end,
+		                        &chunk_bins[i]));
+	}
+	pool.wait_work();
+
+	/* Merge is exact, so the result does not depend on chunk layout. */
+	bins->clear(num_bins);
+	for(size_t i = 0; i < num_chunks; i++) {
+		bins->merge(chunk_bins[i], num_bins);
+	}
+}
+
 void BVHObjectBinning::split(BVHReference* prims,
                              BVHObjectBinning& left_o,
                              BVHObjectBinning& right_o) const
@@ -27,12 +27,15 @@ CCL_NAMESPACE_BEGIN
 
 class BVHBuild;
 
-/* Single threaded object binner. Finds the split with the best SAH heuristic
+/* Object binner. Finds the split with the best SAH heuristic
  * by testing for each dimension multiple partitionings for regular spaced
  * partition locations. A partitioning for a partition location is computed,
  * by putting primitives whose centroid is on the left and right of the split
  * location to different sets. The SAH is evaluated by computing the number of
- * blocks occupied by the primitives in the partitions. */
+ * blocks occupied by the primitives in the partitions.
+ *
+ * Big ranges are binned in parallel, each thread fills bins for a chunk of
+ * primitives and the chunks are merged afterwards. */
 
 class BVHObjectBinning : public BVHRange
 {
@@ -69,6 +72,27 @@ protected:
 	enum { MAX_BINS = 32 };
 	enum { LOG_BLOCK_SIZE = 2 };
 
+	/* Ranges with at least this many primitives are binned in parallel,
+	 * using chunks of at least PARALLEL_CHUNK_SIZE primitives. */
+	enum { PARALLEL_BINNING_SIZE = 65536 };
+	enum { PARALLEL_CHUNK_SIZE = 16384 };
+
+	/* Bounds and number of primitives for every bin in every dimension. */
+	struct Bins {
+		BoundBox bounds[MAX_BINS][4];
+		int4 count[MAX_BINS];
+
+		void clear(size_t num_bins);
+		void merge(const Bins& other, size_t num_bins);
+	};
+
+	/* Map primitives in [begin, end) to bins. */
+	void fill_bins(const BVHReference *prims,
+	               size_t begin,
+	               size_t end,
+	               Bins *bins) const;
+	void fill_bins_parallel(const BVHReference *prims, Bins *bins) const;
+
 	/* computes the bin numbers for each dimension for a box. */
 	__forceinline int4 get_bin(const BoundBox& box) const
 	{
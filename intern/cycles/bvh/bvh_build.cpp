@@ -54,7 +54,8 @@ public:
 		                    node,
 		                    child,
 		                    &range_,
-		                    level);
+		                    level,
+		                    _1);
 	}
 private:
 	BVHObjectBinning range_;
@@ -107,10 +108,18 @@ BVHBuild::BVHBuild(const vector<Object*>& objects_,
    unaligned_heuristic(objects_)
 {
 	spatial_min_overlap = 0.0f;
+
+	node_arenas.resize(TaskScheduler::num_threads() + 1);
+	foreach(BVHNodeArena *&arena, node_arenas) {
+		arena = new BVHNodeArena();
+	}
 }
 
 BVHBuild::~BVHBuild()
 {
+	foreach(BVHNodeArena *arena, node_arenas) {
+		delete arena;
+	}
 }
 
 /* Adding References */
@@ -224,26 +233,83 @@ void BVHBuild::add_reference_triangles(BoundBox& root, BoundBox& center, Mesh *m
 }
 
 void BVHBuild::add_reference_curves(BoundBox& root, BoundBox& center, Mesh *mesh, int i)
+{
+	const size_t num_curves = mesh->num_curves();
+	if(num_curves <= CURVE_TASK_SIZE) {
+		add_reference_curves_range(&references, &root, &center, mesh, i, 0, num_curves);
+		return;
+	}
+
+	/* Dense hair, compute segment bounds in parallel. Every task fills its own
+	 * array which are appended in order, so the result is the same as for the
+	 * single threaded case.
+	 */
+	const size_t num_tasks = divide_up(num_curves, CURVE_TASK_SIZE);
+	vector<vector<BVHReference> > task_references(num_tasks);
+	vector<BoundBox> task_root(num_tasks, BoundBox::empty);
+	vector<BoundBox> task_center(num_tasks, BoundBox::empty);
+
+	TaskPool pool;
+	for(size_t task = 0; task < num_tasks; task++) {
+		const size_t start = task * CURVE_TASK_SIZE;
+		const size_t end = min(start + CURVE_TASK_SIZE, num_curves);
+		pool.push(function_bind(&BVHBuild::add_reference_curves_range,
+		                        this,
+		                        &task_references[task],
+		                        &task_root[task],
+		                        &task_center[task],
+		                        mesh,
+		                        i,
+		                        start,
+		                        end));
+	}
+	pool.wait_work();
+
+	for(size_t task = 0; task < num_tasks; task++) {
+		references.insert(references.end(),
+		                  task_references[task].begin(),
+		                  task_references[task].end());
+		/* Free as we go, to not hold two copies of all references. */
+		vector<BVHReference>().swap(task_references[task]);
+		root.grow(task_root[task]);
+		center.grow(task_center[task]);
+	}
+}
+
+void BVHBuild::add_reference_curves_range(vector<BVHReference> *curve_references,
+                                          BoundBox *root,
+                                          BoundBox *center,
+                                          Mesh *mesh,
+                                          int i,
+                                          size_t start,
+                                          size_t end)
 {
 	const Attribute *curve_attr_mP = NULL;
 	if(mesh->has_motion_blur()) {
 		curve_attr_mP = mesh->curve_attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
 	}
-	const size_t num_curves = mesh->num_curves();
-	for(uint j = 0; j < num_curves; j++) {
+	/* Static hair segments are grouped into compact primitives which fill
+	 * a leaf, instead of referencing every segment separately.
+	 */
+	const int max_segments = clamp(params.max_curve_leaf_size, 1, PRIMITIVE_MAX_SEGMENTS);
+	for(uint j = start; j < end; j++) {
 		const Mesh::Curve curve = mesh->get_curve(j);
 		const float *curve_radius = &mesh->curve_radius[0];
 		for(int k = 0; k < curve.num_keys - 1; k++) {
 			if(curve_attr_mP == NULL) {
 				/* Really simple logic for static hair. */
+				const int num_segments = min(curve.num_keys - 1 - k, max_segments);
 				BoundBox bounds = BoundBox::empty;
-				curve.bounds_grow(k, &mesh->curve_keys[0], curve_radius, bounds);
+				for(int s = 0; s < num_segments; s++) {
+					curve.bounds_grow(k + s, &mesh->curve_keys[0], curve_radius, bounds);
+				}
 				if(bounds.valid()) {
-					int packed_type = PRIMITIVE_PACK_SEGMENT(PRIMITIVE_CURVE, k);
-					references.push_back(BVHReference(bounds, j, i, packed_type));
-					root.grow(bounds);
-					center.grow(bounds.center2());
+					int packed_type = PRIMITIVE_PACK_SEGMENTS(PRIMITIVE_CURVE, k, num_segments);
+					curve_references->push_back(BVHReference(bounds, j, i, packed_type));
+					root->grow(bounds);
+					center->grow(bounds.center2());
 				}
+				k += num_segments - 1;
 			}
 			else if(params.num_motion_curve_steps == 0 || params.use_spatial_split) {
 				/* Simple case of motion curves: single node for the while
@@ -264,12 +330,12 @@ void BVHBuild::add_reference_curves(BoundBox& root, BoundBox& center, Mesh *mesh
 				}
 				if(bounds.valid()) {
 					int packed_type = PRIMITIVE_PACK_SEGMENT(PRIMITIVE_MOTION_CURVE, k);
-					references.push_back(BVHReference(bounds,
-					                                  j,
-					                                  i,
-					                                  packed_type));
-					root.grow(bounds);
-					center.grow(bounds.center2());
+					curve_references->push_back(BVHReference(bounds,
+					                                         j,
+					                                         i,
+					                                         packed_type));
+					root->grow(bounds);
+					center->grow(bounds.center2());
 				}
 			}
 			else {
@@ -317,14 +383,14 @@ void BVHBuild::add_reference_curves(BoundBox& root, BoundBox& center, Mesh *mesh
 					if(bounds.valid()) {
 						const float prev_time = (float)(bvh_step - 1) * num_bvh_steps_inv_1;
 						int packed_type = PRIMITIVE_PACK_SEGMENT(PRIMITIVE_MOTION_CURVE, k);
-						references.push_back(BVHReference(bounds,
-						                                  j,
-						                                  i,
-						                                  packed_type,
-						                                  prev_time,
-						                                  curr_time));
-						root.grow(bounds);
-						center.grow(bounds.center2());
+						curve_references->push_back(BVHReference(bounds,
+						                                         j,
+						                                         i,
+						                                         packed_type,
+						                                         prev_time,
+						                                         curr_time));
+						root->grow(bounds);
+						center->grow(bounds.center2());
 					}
 					/* Current time boundbox becomes previous one for the
 					 * next time step.
@@ -433,7 +499,9 @@ BVHNode* BVHBuild::run()
 	BVHRange root;
 
 	/* add references */
+	double references_start_time = time_dt();
 	add_references(root);
+	double references_time = time_dt() - references_start_time;
 
 	if(progress.get_cancel())
 		return NULL;
@@ -498,7 +566,7 @@ BVHNode* BVHBuild::run()
 	else {
 		/* Perform multithreaded binning build. */
 		BVHObjectBinning rootbin(root, (references.size())? &references[0]: NULL);
-		rootnode = build_node(rootbin, 0);
+		rootnode = build_node(rootbin, 0, 0);
 		task_pool.wait_work();
 	}
 
@@ -515,7 +583,12 @@ BVHNode* BVHBuild::run()
 			rootnode->update_time();
 		}
 		if(rootnode != NULL) {
+			size_t node_memory = 0;
+			foreach(BVHNodeArena *arena, node_arenas) {
+				node_memory += arena->mem_used();
+			}
 			VLOG(1) << "BVH build statistics:\n"
+			        << "  References time: " << references_time << "\n"
 			        << "  Build time: " << time_dt() - build_start_time << "\n"
 			        << "  Total number of nodes: "
 			        << string_human_readable_number(rootnode->getSubtreeSize(BVH_STAT_NODE_COUNT)) << "\n"
@@ -530,7 +603,9 @@ BVHNode* BVHBuild::run()
 			                       ? (float)prim_type.size() / prim_type.capacity()
 			                       : 1.0f) << "\n"
 			        << "  Maximum depth: "
-			        << string_human_readable_number(rootnode->getSubtreeSize(BVH_STAT_DEPTH))  << "\n";
+			        << string_human_readable_number(rootnode->getSubtreeSize(BVH_STAT_DEPTH))  << "\n"
+			        << "  Node memory: "
+			        << string_human_readable_size(node_memory) << "\n";
 		}
 	}
 
@@ -556,13 +631,14 @@ void BVHBuild::progress_update()
 void BVHBuild::thread_build_node(InnerNode *inner,
                                  int child,
                                  BVHObjectBinning *range,
-                                 int level)
+                                 int level,
+                                 int thread_id)
 {
 	if(progress.get_cancel())
 		return;
 
 	/* build nodes */
-	BVHNode *node = build_node(*range, level);
+	BVHNode *node = build_node(*range, level, thread_id);
 
 	/* set child in inner node */
 	inner->children[child] = node;
@@ -614,7 +690,7 @@ bool BVHBuild::range_within_max_leaf_size(const BVHRange& range,
 		const BVHReference& ref = references[range.start() + i];
 
 		if(ref.prim_type() & PRIMITIVE_CURVE)
-			num_curves++;
+			num_curves += PRIMITIVE_UNPACK_NUM_SEGMENTS(ref.prim_type());
 		if(ref.prim_type() & PRIMITIVE_MOTION_CURVE)
 			num_motion_curves++;
 		else if(ref.prim_type() & PRIMITIVE_TRIANGLE)
@@ -630,7 +706,9 @@ bool BVHBuild::range_within_max_leaf_size(const BVHRange& range,
 }
 
 /* multithreaded binning builder */
-BVHNode* BVHBuild::build_node(const BVHObjectBinning& range, int level)
+BVHNode* BVHBuild::build_node(const BVHObjectBinning& range,
+                              int level,
+                              int thread_id)
 {
 	size_t size = range.size();
 	float leafSAH = params.sah_primitive_cost * range.leafSAH;
@@ -644,7 +722,7 @@ BVHNode* BVHBuild::build_node(const BVHObjectBinning& range, int level)
 		if((params.small_enough_for_leaf(size, level)) ||
 		   (range_within_max_leaf_size(range, references) && leafSAH < splitSAH))
 		{
-			return create_leaf_node(range, references);
+			return create_leaf_node(range, references, thread_id);
 		}
 	}
 
@@ -669,7 +747,7 @@ BVHNode* BVHBuild::build_node(const BVHObjectBinning& range, int level)
 			if(unalignedLeafSAH < unalignedSplitSAH && unalignedSplitSAH < splitSAH &&
 			   range_within_max_leaf_size(range, references))
 			{
-				return create_leaf_node(range, references);
+				return create_leaf_node(range, references, thread_id);
 			}
 		}
 		/* Check whether unaligned split is better than the regular one. */
@@ -700,14 +778,14 @@ BVHNode* BVHBuild::build_node(const BVHObjectBinning& range, int level)
 	InnerNode *inner;
 	if(range.size() < THREAD_TASK_SIZE) {
 		/* local build */
-		BVHNode *leftnode = build_node(left, level + 1);
-		BVHNode *rightnode = build_node(right, level + 1);
+		BVHNode *leftnode = build_node(left, level + 1, thread_id);
+		BVHNode *rightnode = build_node(right, level + 1, thread_id);
 
-		inner = new InnerNode(bounds, leftnode, rightnode);
+		inner = new(node_arenas[thread_id]) InnerNode(bounds, leftnode, rightnode);
 	}
 	else {
 		/* Threaded build */
-		inner = new InnerNode(bounds);
+		inner = new(node_arenas[thread_id]) InnerNode(bounds);
 
 		task_pool.push(new BVHBuildTask(this, inner, 0, left, level + 1), true);
 		task_pool.push(new BVHBuildTask(this, inner, 1, right, level + 1), true);
@@ -741,7 +819,7 @@ BVHNode* BVHBuild::build_node(const BVHRange& range,
 	if(!(range.size() > 0 && params.top_level && level == 0)) {
 		if(params.small_enough_for_leaf(range.size(), level)) {
 			progress_count += range.size();
-			return create_leaf_node(range, *references);
+			return create_leaf_node(range, *references, thread_id);
 		}
 	}
 
@@ -752,7 +830,7 @@ BVHNode* BVHBuild::build_node(const BVHRange& range,
 	if(!(range.size() > 0 && params.top_level && level == 0)) {
 		if(split.no_split) {
 			progress_count += range.size();
-			return create_leaf_node(range, *references);
+			return create_leaf_node(range, *references, thread_id);
 		}
 	}
 	float leafSAH = params.sah_primitive_cost * split.leafSAH;
@@ -821,11 +899,11 @@ BVHNode* BVHBuild::build_node(const BVHRange& range,
 		/* Build right node. */
 		BVHNode *rightnode = build_node(right, &copy, level + 1, thread_id);
 
-		inner = new InnerNode(bounds, leftnode, rightnode);
+		inner = new(node_arenas[thread_id]) InnerNode(bounds, leftnode, rightnode);
 	}
 	else {
 		/* Threaded build. */
-		inner = new InnerNode(bounds);
+		inner = new(node_arenas[thread_id]) InnerNode(bounds);
 		task_pool.push(new BVHSpatialSplitBuildTask(this,
 		                                            inner,
 		                                            0,
@@ -851,11 +929,15 @@ BVHNode* BVHBuild::build_node(const BVHRange& range,
 
 /* Create Nodes */
 
-BVHNode *BVHBuild::create_object_leaf_nodes(const BVHReference *ref, int start, int num)
+BVHNode *BVHBuild::create_object_leaf_nodes(const BVHReference *ref,
+                                            int start,
+                                            int num,
+                                            int thread_id)
 {
+	BVHNodeArena *arena = node_arenas[thread_id];
 	if(num == 0) {
 		BoundBox bounds = BoundBox::empty;
-		return new LeafNode(bounds, 0, 0, 0);
+		return new(arena) LeafNode(bounds, 0, 0, 0);
 	}
 	else if(num == 1) {
 		assert(start < prim_type.size());
@@ -867,21 +949,21 @@ BVHNode *BVHBuild::create_object_leaf_nodes(const BVHReference *ref, int start,
 		}
 
 		const uint visibility = objects[ref->prim_object()]->visibility_for_tracing();
-		BVHNode *leaf_node =  new LeafNode(ref->bounds(), visibility, start, start+1);
+		BVHNode *leaf_node =  new(arena) LeafNode(ref->bounds(), visibility, start, start+1);
 		leaf_node->time_from = ref->time_from();
 		leaf_node->time_to = ref->time_to();
 		return leaf_node;
 	}
 	else {
 		int mid = num/2;
-		BVHNode *leaf0 = create_object_leaf_nodes(ref, start, mid);
-		BVHNode *leaf1 = create_object_leaf_nodes(ref+mid, start+mid, num-mid);
+		BVHNode *leaf0 = create_object_leaf_nodes(ref, start, mid, thread_id);
+		BVHNode *leaf1 = create_object_leaf_nodes(ref+mid, start+mid, num-mid, thread_id);
 
 		BoundBox bounds = BoundBox::empty;
 		bounds.grow(leaf0->bounds);
 		bounds.grow(leaf1->bounds);
 
-		BVHNode *inner_node = new InnerNode(bounds, leaf0, leaf1);
+		BVHNode *inner_node = new(arena) InnerNode(bounds, leaf0, leaf1);
 		inner_node->time_from = min(leaf0->time_from, leaf1->time_from);
 		inner_node->time_to = max(leaf0->time_to, leaf1->time_to);
 		return inner_node;
@@ -889,7 +971,8 @@ BVHNode *BVHBuild::create_object_leaf_nodes(const BVHReference *ref, int start,
 }
 
 BVHNode* BVHBuild::create_leaf_node(const BVHRange& range,
-                                    const vector<BVHReference>& references)
+                                    const vector<BVHReference>& references,
+                                    int thread_id)
 {
 	/* This is a bit overallocating here (considering leaf size into account),
 	 * but chunk-based re-allocation in vector makes it difficult to use small
@@ -995,10 +1078,11 @@ BVHNode* BVHBuild::create_leaf_node(const BVHRange& range,
 						                                          &aligned_space);
 				}
 			}
-			LeafNode *leaf_node = new LeafNode(bounds[i],
-			                                   visibility[i],
-			                                   start_index,
-			                                   start_index + num);
+			LeafNode *leaf_node =
+			        new(node_arenas[thread_id]) LeafNode(bounds[i],
+			                                             visibility[i],
+			                                             start_index,
+			                                             start_index + num);
 			if(true) {
 				float time_from = 1.0f, time_to = 0.0f;
 				for(int j = 0; j < num; ++j) {
@@ -1111,10 +1195,13 @@ BVHNode* BVHBuild::create_leaf_node(const BVHRange& range,
 		const BVHReference *ref = (ob_num)? &object_references[0]: NULL;
 		leaves[num_leaves] = create_object_leaf_nodes(ref,
 		                                              start_index + num_new_leaf_data,
-		                                              ob_num);
+		                                              ob_num,
+		                                              thread_id);
 		++num_leaves;
 	}
 
+	BVHNodeArena *arena = node_arenas[thread_id];
+
 	/* TODO(sergey): Need to take care of alignment when number of leaves
 	 * is more than 1.
 	 */
@@ -1126,23 +1213,23 @@ BVHNode* BVHBuild::create_leaf_node(const BVHRange& range,
 		return leaves[0];
 	}
 	else if(num_leaves == 2) {
-		return new InnerNode(range.bounds(), leaves[0], leaves[1]);
+		return new(arena) InnerNode(range.bounds(), leaves[0], leaves[1]);
 	}
 	else if(num_leaves == 3) {
 		BoundBox inner_bounds = merge(leaves[1]->bounds, leaves[2]->bounds);
-		BVHNode *inner = new InnerNode(inner_bounds, leaves[1], leaves[2]);
-		return new InnerNode(range.bounds(), leaves[0], inner);
+		BVHNode *inner = new(arena) InnerNode(inner_bounds, leaves[1], leaves[2]);
+		return new(arena) InnerNode(range.bounds(), leaves[0], inner);
 	} else {
 		/* Should be doing more branches if more primitive types added. */
 		assert(num_leaves <= 5);
 		BoundBox inner_bounds_a = merge(leaves[0]->bounds, leaves[1]->bounds);
 		BoundBox inner_bounds_b = merge(leaves[2]->bounds, leaves[3]->bounds);
-		BVHNode *inner_a = new InnerNode(inner_bounds_a, leaves[0], leaves[1]);
-		BVHNode *inner_b = new InnerNode(inner_bounds_b, leaves[2], leaves[3]);
+		BVHNode *inner_a = new(arena) InnerNode(inner_bounds_a, leaves[0], leaves[1]);
+		BVHNode *inner_b = new(arena) InnerNode(inner_bounds_b, leaves[2], leaves[3]);
 		BoundBox inner_bounds_c = merge(inner_a->bounds, inner_b->bounds);
-		BVHNode *inner_c = new InnerNode(inner_bounds_c, inner_a, inner_b);
+		BVHNode *inner_c = new(arena) InnerNode(inner_bounds_c, inner_a, inner_b);
 		if(num_leaves == 5) {
-			return new InnerNode(range.bounds(), inner_c, leaves[4]);
+			return new(arena) InnerNode(range.bounds(), inner_c, leaves[4]);
 		}
 		return inner_c;
 	}
@@ -31,6 +31,7 @@ CCL_NAMESPACE_BEGIN
 class Boundbox;
 class BVHBuildTask;
 class BVHNode;
+class BVHNodeArena;
 class BVHSpatialSplitBuildTask;
 class BVHParams;
 class InnerNode;
@@ -66,6 +67,13 @@ protected:
 	/* Adding references. */
 	void add_reference_triangles(BoundBox& root, BoundBox& center, Mesh *mesh, int i);
 	void add_reference_curves(BoundBox& root, BoundBox& center, Mesh *mesh, int i);
+	void add_reference_curves_range(vector<BVHReference> *curve_references,
+	                                BoundBox *root,
+	                                BoundBox *center,
+	                                Mesh *mesh,
+	                                int i,
+	                                size_t start,
+	                                size_t end);
 	void add_reference_mesh(BoundBox& root, BoundBox& center, Mesh *mesh, int i);
 	void add_reference_object(BoundBox& root, BoundBox& center, Object *ob, int i);
 	void add_references(BVHRange& root);
@@ -75,20 +83,27 @@ protected:
 	                    vector<BVHReference> *references,
 	                    int level,
 	                    int thread_id);
-	BVHNode *build_node(const BVHObjectBinning& range, int level);
+	BVHNode *build_node(const BVHObjectBinning& range,
+	                    int level,
+	                    int thread_id);
 	BVHNode *create_leaf_node(const BVHRange& range,
-	                          const vector<BVHReference>& references);
-	BVHNode *create_object_leaf_nodes(const BVHReference *ref, int start, int num);
+	                          const vector<BVHReference>& references,
+	                          int thread_id);
+	BVHNode *create_object_leaf_nodes(const BVHReference *ref,
+	                                  int start,
+	                                  int num,
+	                                  int thread_id);
 
 	bool range_within_max_leaf_size(const BVHRange& range,
 	                                const vector<BVHReference>& references) const;
 
 	/* Threads. */
-	enum { THREAD_TASK_SIZE = 4096 };
+	enum { THREAD_TASK_SIZE = 4096, CURVE_TASK_SIZE = 16384 };
 	void thread_build_node(InnerNode *node,
 	                       int child,
 	                       BVHObjectBinning *range,
-	                       int level);
+	                       int level,
+	                       int thread_id);
 	void thread_build_spatial_split_node(InnerNode *node,
 	                                     int child,
 	                                     BVHRange *range,
@@ -136,6 +151,11 @@ protected:
 	/* Threads. */
 	TaskPool task_pool;
 
+	/* Node memory, one arena per thread. Nodes returned by run() are only
+	 * valid for as long as the builder itself.
+	 */
+	vector<BVHNodeArena*> node_arenas;
+
 	/* Unaligned building. */
 	BVHUnaligned unaligned_heuristic;
 };
@@ -20,10 +20,46 @@
 #include "bvh/bvh.h"
 #include "bvh/bvh_build.h"
 
+#include "util/util_algorithm.h"
+#include "util/util_aligned_malloc.h"
+#include "util/util_foreach.h"
 #include "util/util_vector.h"
 
 CCL_NAMESPACE_BEGIN
 
+/* BVH Node Arena */
+
+BVHNodeArena::BVHNodeArena()
+: block_(NULL),
+  block_size_(0),
+  block_used_(0),
+  mem_used_(0)
+{
+}
+
+BVHNodeArena::~BVHNodeArena()
+{
+	foreach(char *block, blocks_) {
+		util_aligned_free(block);
+	}
+}
+
+void *BVHNodeArena::alloc(size_t size)
+{
+	size = align_up(size, MIN_ALIGNMENT_CPU_DATA_TYPES);
+	if(block_used_ + size > block_size_) {
+		block_size_ = max(size, (size_t)BLOCK_SIZE);
+		block_ = (char*)util_aligned_malloc(block_size_,
+		                                    MIN_ALIGNMENT_CPU_DATA_TYPES);
+		block_used_ = 0;
+		blocks_.push_back(block_);
+		mem_used_ += block_size_;
+	}
+	void *ptr = block_ + block_used_;
+	block_used_ += size;
+	return ptr;
+}
+
 /* BVH Node */
 
 int BVHNode::getSubtreeSize(BVH_STAT stat) const
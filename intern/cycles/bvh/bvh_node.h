@@ -20,6 +20,7 @@
 
 #include "util/util_boundbox.h"
 #include "util/util_types.h"
+#include "util/util_vector.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -43,6 +44,41 @@ enum BVH_STAT {
 
 class BVHParams;
 
+/* Memory arena for build nodes.
+ *
+ * Nodes are allocated by bumping a pointer inside of big memory blocks,
+ * which is much cheaper than going to the system allocator for every node
+ * and keeps nodes which were created together close to each other in memory.
+ * Every build thread uses its own arena, so no locking is needed.
+ *
+ * Memory is only released when the arena is destroyed, so the arena must
+ * outlive all the nodes allocated from it.
+ */
+class BVHNodeArena
+{
+public:
+	BVHNodeArena();
+	~BVHNodeArena();
+
+	void *alloc(size_t size);
+
+	/* Total size of allocated memory blocks, in bytes. */
+	size_t mem_used() const { return mem_used_; }
+
+protected:
+	enum { BLOCK_SIZE = 64 * 1024 };
+
+	vector<char*> blocks_;
+	char *block_;
+	size_t block_size_;
+	size_t block_used_;
+	size_t mem_used_;
+
+	/* Arena owns memory blocks, copying is not allowed. */
+	BVHNodeArena(const BVHNodeArena& other);
+	BVHNodeArena& operator=(const BVHNodeArena& other);
+};
+
 class BVHNode
 {
 public:
@@ -58,6 +94,22 @@ public:
 		delete aligned_space;
 	}
 
+	/* Nodes are always allocated from an arena. Deleting a node only runs
+	 * its destructor, memory is reclaimed when the arena is destroyed.
+	 */
+	void *operator new(size_t size, BVHNodeArena *arena)
+	{
+		return arena->alloc(size);
+	}
+
+	void operator delete(void * /*ptr*/, BVHNodeArena * /*arena*/)
+	{
+	}
+
+	void operator delete(void * /*ptr*/)
+	{
+	}
+
 	virtual bool is_leaf() const = 0;
 	virtual int num_children() const = 0;
 	virtual BVHNode *get_child(int i) const = 0;
@@ -456,14 +456,18 @@ void BVHSpatialSplit::split_curve_reference(const BVHReference& ref,
                                             BoundBox& left_bounds,
                                             BoundBox& right_bounds)
 {
-	split_curve_primitive(mesh,
-	                      NULL,
-	                      ref.prim_index(),
-	                      PRIMITIVE_UNPACK_SEGMENT(ref.prim_type()),
-	                      dim,
-	                      pos,
-	                      left_bounds,
-	                      right_bounds);
+	const int segment = PRIMITIVE_UNPACK_SEGMENT(ref.prim_type());
+	const int num_segments = PRIMITIVE_UNPACK_NUM_SEGMENTS(ref.prim_type());
+	for(int s = 0; s < num_segments; s++) {
+		split_curve_primitive(mesh,
+		                      NULL,
+		                      ref.prim_index(),
+		                      segment + s,
+		                      dim,
+		                      pos,
+		                      left_bounds,
+		                      right_bounds);
+	}
 }
 
 void BVHSpatialSplit::split_object_reference(const Object *object,
@@ -76,15 +76,20 @@ bool BVHUnaligned::compute_aligned_space(const BVHReference& ref,
 	if(type & PRIMITIVE_CURVE) {
 		const int curve_index = ref.prim_index();
 		const int segment = PRIMITIVE_UNPACK_SEGMENT(packed_type);
+		const int num_segments = PRIMITIVE_UNPACK_NUM_SEGMENTS(packed_type);
 		const Mesh *mesh = object->mesh;
 		const Mesh::Curve& curve = mesh->get_curve(curve_index);
 		const int key = curve.first_key + segment;
 		const float3 v1 = mesh->curve_keys[key],
-		             v2 = mesh->curve_keys[key + 1];
+		             v2 = mesh->curve_keys[key + num_segments];
 		float length;
 		const float3 axis = normalize_len(v2 - v1, &length);
 		if(length > 1e-6f) {
-			*aligned_space = make_transform_frame(axis);
+			/* Use the frame nodes are packed with, so bounds computed in
+			 * it stay tight.
+			 */
+			*aligned_space = make_transform_frame_packed(
+			        transform_frame_pack(axis));
 			return true;
 		}
 	}
@@ -103,13 +108,16 @@ BoundBox BVHUnaligned::compute_aligned_prim_boundbox(
 	if(type & PRIMITIVE_CURVE) {
 		const int curve_index = prim.prim_index();
 		const int segment = PRIMITIVE_UNPACK_SEGMENT(packed_type);
+		const int num_segments = PRIMITIVE_UNPACK_NUM_SEGMENTS(packed_type);
 		const Mesh *mesh = object->mesh;
 		const Mesh::Curve& curve = mesh->get_curve(curve_index);
-		curve.bounds_grow(segment,
-		                  &mesh->curve_keys[0],
-		                  &mesh->curve_radius[0],
-		                  aligned_space,
-		                  bounds);
+		for(int s = 0; s < num_segments; s++) {
+			curve.bounds_grow(segment + s,
+			                  &mesh->curve_keys[0],
+			                  &mesh->curve_radius[0],
+			                  aligned_space,
+			                  bounds);
+		}
 	}
 	else {
 		bounds = prim.bounds().transformed(&aligned_space);
@@ -159,18 +167,36 @@ BoundBox BVHUnaligned::compute_aligned_boundbox(
 	return bounds;
 }
 
-Transform BVHUnaligned::compute_node_transform(
-        const BoundBox& bounds,
-        const Transform& aligned_space)
+void BVHUnaligned::compute_node_space(const BoundBox& bounds,
+                                      const Transform& aligned_space,
+                                      uint *frame,
+                                      float3 *scale,
+                                      float3 *offset)
 {
-	Transform space = aligned_space;
-	space.x.w -= bounds.min.x;
-	space.y.w -= bounds.min.y;
-	space.z.w -= bounds.min.z;
-	float3 dim = bounds.max - bounds.min;
-	return transform_scale(1.0f / max(1e-18f, dim.x),
-	                       1.0f / max(1e-18f, dim.y),
-	                       1.0f / max(1e-18f, dim.z)) * space;
+	*frame = transform_frame_pack(float4_to_float3(aligned_space.z));
+	if(!bounds.valid()) {
+		*scale = make_float3(NAN, NAN, NAN);
+		*offset = make_float3(NAN, NAN, NAN);
+		return;
+	}
+	/* Bounds in the decoded frame, which only differs from the aligned space
+	 * when the orientation did not survive packing.
+	 */
+	const Transform space = make_transform_frame_packed(*frame);
+	const Transform tfm = space * transform_inverse(aligned_space);
+	BoundBox frame_bounds = bounds.transformed(&tfm);
+	/* Pad by a few ulps, so bounds stay conservative when devices decode
+	 * the frame with slightly different rounding.
+	 */
+	const float3 extent = max(fabs(frame_bounds.min), fabs(frame_bounds.max));
+	const float margin = 1e-6f * max3(extent);
+	frame_bounds.min -= make_float3(margin, margin, margin);
+	frame_bounds.max += make_float3(margin, margin, margin);
+	const float3 dim = frame_bounds.max - frame_bounds.min;
+	*scale = make_float3(1.0f / max(1e-18f, dim.x),
+	                     1.0f / max(1e-18f, dim.y),
+	                     1.0f / max(1e-18f, dim.z));
+	*offset = -frame_bounds.min * *scale;
 }
 
 CCL_NAMESPACE_END
@@ -65,11 +65,15 @@ public:
 	        const Transform& aligned_space,
 	        BoundBox *cent_bounds = NULL) const;
 
-	/* Calculate affine transform for node packing.
-	 * Bounds will be in the range of 0..1.
+	/* Calculate quantized oriented bounds for node packing: the packed
+	 * orientation of the aligned space, and scale and offset which map the
+	 * bounds to the range of 0..1 in the frame decoded from it.
 	 */
-	static Transform compute_node_transform(const BoundBox& bounds,
-	                                        const Transform& aligned_space);
+	static void compute_node_space(const BoundBox& bounds,
+	                               const Transform& aligned_space,
+	                               uint *frame,
+	                               float3 *scale,
+	                               float3 *offset);
 protected:
 	/* List of objects BVH is being created for. */
 	const vector<Object*>& objects_;
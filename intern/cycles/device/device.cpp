@@ -206,36 +206,36 @@ void Device::draw_pixels(device_memory& rgba, int y, int w, int h, int dx, int d
 		glDisable(GL_BLEND);
 }
 
-Device *Device::create(DeviceInfo& info, Stats &stats, bool background)
+Device *Device::create(DeviceInfo& info, Stats &stats, Profiler &profiler, bool background)
 {
 	Device *device;
 
 	switch(info.type) {
 		case DEVICE_CPU:
-			device = device_cpu_create(info, stats, background);
+			device = device_cpu_create(info, stats, profiler, background);
 			break;
 #ifdef WITH_CUDA
 		case DEVICE_CUDA:
 			if(device_cuda_init())
-				device = device_cuda_create(info, stats, background);
+				device = device_cuda_create(info, stats, profiler, background);
 			else
 				device = NULL;
 			break;
 #endif
 #ifdef WITH_MULTI
 		case DEVICE_MULTI:
-			device = device_multi_create(info, stats, background);
+			device = device_multi_create(info, stats, profiler, background);
 			break;
 #endif
 #ifdef WITH_NETWORK
 		case DEVICE_NETWORK:
-			device = device_network_create(info, stats, "127.0.0.1");
+			device = device_network_create(info, stats, profiler, "127.0.0.1");
 			break;
 #endif
 #ifdef WITH_OPENCL
 		case DEVICE_OPENCL:
 			if(device_opencl_init())
-				device = device_opencl_create(info, stats, background);
+				device = device_opencl_create(info, stats, profiler, background);
 			else
 				device = NULL;
 			break;
@@ -360,6 +360,9 @@ DeviceInfo Device::get_multi_device(const vector<DeviceInfo>& subdevices, int th
 	info.num = 0;
 
 	info.has_half_images = true;
+	info.has_sparse_images = true;
+	info.has_compressed_images = true;
+	info.has_profiling = true;
 	info.has_volume_decoupled = true;
 	info.bvh_layout_mask = BVH_LAYOUT_ALL;
 	info.has_osl = true;
@@ -395,6 +398,9 @@ DeviceInfo Device::get_multi_device(const vector<DeviceInfo>& subdevices, int th
 
 		/* Accumulate device info. */
 		info.has_half_images &= device.has_half_images;
+		info.has_sparse_images &= device.has_sparse_images;
+		info.has_compressed_images &= device.has_compressed_images;
+		info.has_profiling &= device.has_profiling;
 		info.has_volume_decoupled &= device.has_volume_decoupled;
 		info.bvh_layout_mask = device.bvh_layout_mask & info.bvh_layout_mask;
 		info.has_osl &= device.has_osl;
@@ -34,6 +34,8 @@
 #include "kernel/kernel_types.h"
 #include "kernel/split/kernel_split_data.h"
 #include "kernel/kernel_globals.h"
+#include "kernel/kernel_oiio_globals.h"
+#include "kernel/kernel_adaptive_sampling.h"
 
 #include "kernel/filter/filter.h"
 
@@ -170,11 +172,14 @@ public:
 	OSLGlobals osl_globals;
 #endif
 
+	OIIOGlobals oiio_globals;
+
 	bool use_split_kernel;
 
 	DeviceRequestedFeatures requested_features;
 
 	KernelFunctions<void(*)(KernelGlobals *, float *, int, int, int, int, int)>             path_trace_kernel;
+	KernelFunctions<void(*)(KernelGlobals *, float *, int, int, int, int, int, int)>        path_trace_packet_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uchar4 *, float *, float, int, int, int, int)> convert_to_half_float_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uchar4 *, float *, float, int, int, int, int)> convert_to_byte_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uint4 *, float4 *, int, int, int, int, int)>   shader_kernel;
@@ -207,11 +212,12 @@ public:
 	      KERNEL_NAME_EVAL(cpu_avx, name), \
 	      KERNEL_NAME_EVAL(cpu_avx2, name)
 
-	CPUDevice(DeviceInfo& info_, Stats &stats_, bool background_)
-	: Device(info_, stats_, background_),
+	CPUDevice(DeviceInfo& info_, Stats &stats_, Profiler &profiler_, bool background_)
+	: Device(info_, stats_, profiler_, background_),
 	  texture_info(this, "__texture_info", MEM_TEXTURE),
 #define REGISTER_KERNEL(name) name ## _kernel(KERNEL_FUNCTIONS(name))
 	  REGISTER_KERNEL(path_trace),
+	  REGISTER_KERNEL(path_trace_packet),
 	  REGISTER_KERNEL(convert_to_half_float),
 	  REGISTER_KERNEL(convert_to_byte),
 	  REGISTER_KERNEL(shader),
@@ -237,6 +243,8 @@ public:
 #ifdef WITH_OSL
 		kernel_globals.osl = &osl_globals;
 #endif
+		kernel_globals.oiio = NULL;
+		kernel_globals.oiio_tdata = NULL;
 		use_split_kernel = DebugFlags().cpu.split_kernel;
 		if(use_split_kernel) {
 			VLOG(1) << "Will be using split kernel.";
@@ -370,6 +378,17 @@ public:
 
 	void const_copy_to(const char *name, void *host, size_t size)
 	{
+		if(strcmp(name, "__data") == 0) {
+			assert(size <= sizeof(KernelData));
+
+			/* Ray packets are a CPU only feature, enable them here rather
+			 * than in the scene data shared with other devices. */
+			KernelData data = *(KernelData*)host;
+			data.bvh.use_ray_packets = DebugFlags().cpu.ray_packets;
+			kernel_const_copy(&kernel_globals, name, &data, size);
+			return;
+		}
+
 		kernel_const_copy(&kernel_globals, name, host, size);
 	}
 
@@ -404,10 +423,19 @@ public:
 			}
 
 			TextureInfo& info = texture_info[flat_slot];
-			info.data = (uint64_t)mem.host_pointer;
+			if(mem.data_grid_size) {
+				/* Sparse texture, the voxel tiles follow the tile index. */
+				info.grid = (uint64_t)mem.host_pointer;
+				info.data = (uint64_t)((char*)mem.host_pointer + mem.memory_elements_size(mem.data_grid_size));
+			}
+			else {
+				info.grid = 0;
+				info.data = (uint64_t)mem.host_pointer;
+			}
 			info.cl_buffer = 0;
 			info.interpolation = mem.interpolation;
 			info.extension = mem.extension;
+			info.compression = mem.compression;
 			info.width = mem.data_width;
 			info.height = mem.data_height;
 			info.depth = mem.data_depth;
@@ -439,6 +467,11 @@ public:
 #endif
 	}
 
+	void *oiio_memory()
+	{
+		return &oiio_globals;
+	}
+
 	void thread_run(DeviceTask *task)
 	{
 		if(task->type == DeviceTask::RENDER) {
@@ -691,6 +724,8 @@ public:
 		float *render_buffer = (float*)tile.buffer;
 		int start_sample = tile.start_sample;
 		int end_sample = tile.start_sample + tile.num_samples;
+		bool use_ray_packets = kg->__data.bvh.use_ray_packets;
+		bool use_adaptive_sampling = kg->__data.integrator.use_adaptive_sampling != 0;
 
 		for(int sample = start_sample; sample < end_sample; sample++) {
 			if(task.get_cancel() || task_pool.canceled()) {
@@ -699,15 +734,82 @@ public:
 			}
 
 			for(int y = tile.y; y < tile.y + tile.h; y++) {
-				for(int x = tile.x; x < tile.x + tile.w; x++) {
-					path_trace_kernel()(kg, render_buffer,
-					                    sample, x, y, tile.offset, tile.stride);
+				if(use_ray_packets) {
+					/* Neighbor pixels of a row are traced as one packet. */
+					for(int x = tile.x; x < tile.x + tile.w; x += RAY_PACKET_SIZE) {
+						int num_pixels = min(RAY_PACKET_SIZE, tile.x + tile.w - x);
+						path_trace_packet_kernel()(kg, render_buffer,
+						                           sample, x, y, num_pixels,
+						                           tile.offset, tile.stride);
+					}
+				}
+				else {
+					for(int x = tile.x; x < tile.x + tile.w; x++) {
+						path_trace_kernel()(kg, render_buffer,
+						                    sample, x, y, tile.offset, tile.stride);
+					}
 				}
 			}
 
 			tile.sample = sample + 1;
 
 			task.update_progress(&tile, tile.w*tile.h);
+
+			if(use_adaptive_sampling &&
+			   kernel_adaptive_should_test(kg, tile.sample) &&
+			   adaptive_sampling_filter(kg, tile, tile.sample))
+			{
+				/* All pixels converged, skip remaining samples. */
+				task.update_progress(&tile, tile.w*tile.h*(end_sample - tile.sample));
+				tile.sample = end_sample;
+				break;
+			}
+		}
+
+		if(use_adaptive_sampling) {
+			adaptive_sampling_post(kg, tile);
+		}
+	}
+
+	/* Test convergence of all pixels of the tile, returns true when none of
+	 * them needs more samples. */
+	bool adaptive_sampling_filter(KernelGlobals *kg, RenderTile &tile, int num_samples)
+	{
+		float *render_buffer = (float*)tile.buffer;
+		int pass_stride = kg->__data.film.pass_stride;
+		float *tile_buffer = render_buffer + (tile.offset + tile.x + tile.y*tile.stride)*pass_stride;
+
+		for(int y = 0; y < tile.h; y++) {
+			for(int x = 0; x < tile.w; x++) {
+				kernel_adaptive_stopping(kg, tile_buffer + (x + y*tile.stride)*pass_stride, num_samples);
+			}
+		}
+
+		bool any = false;
+		for(int y = 0; y < tile.h; y++) {
+			any |= kernel_adaptive_filter(kg, tile_buffer + y*tile.stride*pass_stride,
+			                              tile.w, 1, num_samples);
+		}
+		for(int x = 0; x < tile.w; x++) {
+			any |= kernel_adaptive_filter(kg, tile_buffer + x*pass_stride,
+			                              tile.h, tile.stride, num_samples);
+		}
+
+		return !any;
+	}
+
+	/* Scale passes of pixels which stopped early to the sample count of the
+	 * tile. */
+	void adaptive_sampling_post(KernelGlobals *kg, RenderTile &tile)
+	{
+		float *render_buffer = (float*)tile.buffer;
+		int pass_stride = kg->__data.film.pass_stride;
+
+		for(int y = tile.y; y < tile.y + tile.h; y++) {
+			for(int x = tile.x; x < tile.x + tile.w; x++) {
+				int index = tile.offset + x + y*tile.stride;
+				kernel_adaptive_adjust_samples(kg, render_buffer + index*pass_stride, tile.sample);
+			}
 		}
 	}
 
@@ -765,6 +867,10 @@ public:
 			}
 		}
 
+		/* Register the thread with the profiler, which samples it while
+		 * rendering when profiling is enabled. */
+		profiler.add_state(&kg->profiler);
+
 		RenderTile tile;
 		DenoisingTask denoising(this);
 
@@ -779,6 +885,7 @@ public:
 				}
 			}
 			else if(tile.task == RenderTile::DENOISE) {
+				ProfilingHelper profiling(&kg->profiler, PROFILING_DENOISING);
 				denoise(task, denoising, tile);
 			}
 
@@ -790,6 +897,8 @@ public:
 			}
 		}
 
+		profiler.remove_state(&kg->profiler);
+
 		thread_kernel_globals_free((KernelGlobals*)kgbuffer.device_pointer);
 		kg->~KernelGlobals();
 		kgbuffer.free();
@@ -822,6 +931,8 @@ public:
 #ifdef WITH_OSL
 		OSLShader::thread_init(&kg, &kernel_globals, &osl_globals);
 #endif
+		kernel_tex_image_cache_thread_init(&kg);
+
 		for(int sample = 0; sample < task.num_samples; sample++) {
 			for(int x = task.shader_x; x < task.shader_x + task.shader_w; x++)
 				shader_kernel()(&kg,
@@ -843,6 +954,7 @@ public:
 #ifdef WITH_OSL
 		OSLShader::thread_free(&kg);
 #endif
+		kernel_tex_image_cache_thread_free(&kg);
 	}
 
 	int get_split_task_count(DeviceTask& task)
@@ -858,6 +970,10 @@ public:
 		/* Load texture info. */
 		load_texture_info();
 
+		/* Only route image lookups through the texture cache when the
+		 * image manager has set it up. */
+		kernel_globals.oiio = (oiio_globals.tex_sys)? &oiio_globals: NULL;
+
 		/* split task into smaller ones */
 		list<DeviceTask> tasks;
 
@@ -894,6 +1010,7 @@ protected:
 #ifdef WITH_OSL
 		OSLShader::thread_init(&kg, &kernel_globals, &osl_globals);
 #endif
+		kernel_tex_image_cache_thread_init(&kg);
 		return kg;
 	}
 
@@ -916,6 +1033,7 @@ protected:
 #ifdef WITH_OSL
 		OSLShader::thread_free(kg);
 #endif
+		kernel_tex_image_cache_thread_free(kg);
 	}
 
 	virtual bool load_kernels(const DeviceRequestedFeatures& requested_features_) {
@@ -1032,9 +1150,9 @@ uint64_t CPUSplitKernel::state_buffer_size(device_memory& kernel_globals, device
 	return split_data_buffer_size(kg, num_threads);
 }
 
-Device *device_cpu_create(DeviceInfo& info, Stats &stats, bool background)
+Device *device_cpu_create(DeviceInfo& info, Stats &stats, Profiler &profiler, bool background)
 {
-	return new CPUDevice(info, stats, background);
+	return new CPUDevice(info, stats, profiler, background);
 }
 
 void device_cpu_info(vector<DeviceInfo>& devices)
@@ -1053,6 +1171,9 @@ void device_cpu_info(vector<DeviceInfo>& devices)
 	info.has_volume_decoupled = true;
 	info.has_osl = true;
 	info.has_half_images = true;
+	info.has_sparse_images = true;
+	info.has_compressed_images = true;
+	info.has_profiling = true;
 
 	devices.insert(devices.begin(), info);
 }
@@ -29,10 +29,12 @@ device_memory::device_memory(Device *device, const char *name, MemoryType type)
   data_width(0),
   data_height(0),
   data_depth(0),
+  data_grid_size(0),
   type(type),
   name(name),
   interpolation(INTERPOLATION_NONE),
   extension(EXTENSION_REPEAT),
+  compression(IMAGE_COMPRESSION_NONE),
   device(device),
   device_pointer(0),
   host_pointer(0),
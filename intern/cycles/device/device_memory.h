@@ -187,10 +187,14 @@ public:
 	size_t data_width;
 	size_t data_height;
 	size_t data_depth;
+	/* Number of elements at the start of sparse 3D textures holding the tile
+	 * index, 0 for dense storage. */
+	size_t data_grid_size;
 	MemoryType type;
 	const char *name;
 	InterpolationType interpolation;
 	ExtensionType extension;
+	ImageCompression compression;
 
 	/* Pointers. */
 	Device *device;
@@ -320,10 +324,25 @@ public:
 		data_width = width;
 		data_height = height;
 		data_depth = depth;
+		data_grid_size = 0;
+		compression = IMAGE_COMPRESSION_NONE;
 
 		return data();
 	}
 
+	/* Host memory allocation for a compressed 2D texture of the given
+	 * dimensions, stored in num elements. */
+	T *alloc_compressed(size_t num, ImageCompression compression_, size_t width, size_t height)
+	{
+		T *mem = alloc(num);
+
+		data_width = width;
+		data_height = height;
+		compression = compression_;
+
+		return mem;
+	}
+
 	/* Host memory resize. Only use this if the original data needs to be
 	 * preserved, it is faster to call alloc() if it can be discarded. */
 	T *resize(size_t width, size_t height = 0, size_t depth = 0)
@@ -348,6 +367,8 @@ public:
 		data_width = width;
 		data_height = height;
 		data_depth = depth;
+		data_grid_size = 0;
+		compression = IMAGE_COMPRESSION_NONE;
 
 		return data();
 	}
@@ -362,10 +383,23 @@ public:
 		data_width = 0;
 		data_height = 0;
 		data_depth = 0;
+		data_grid_size = 0;
 		host_pointer = from.steal_pointer();
 		assert(device_pointer == 0);
 	}
 
+	/* Take over a sparse 3D texture of the given dimensions from an existing
+	 * array, of which the first grid_size elements hold the tile index. */
+	void steal_sparse(array<T>& from, size_t grid_size, size_t width, size_t height, size_t depth)
+	{
+		steal_data(from);
+
+		data_width = width;
+		data_height = height;
+		data_depth = depth;
+		data_grid_size = grid_size;
+	}
+
 	/* Free device and host memory. */
 	void free()
 	{
@@ -376,6 +410,8 @@ public:
 		data_width = 0;
 		data_height = 0;
 		data_depth = 0;
+		data_grid_size = 0;
+		compression = IMAGE_COMPRESSION_NONE;
 		host_pointer = 0;
 		assert(device_pointer == 0);
 	}
@@ -18,6 +18,7 @@
 #include "device/device_intern.h"
 #include "device/device_network.h"
 
+#include "util/util_algorithm.h"
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
 
@@ -32,6 +33,31 @@ typedef map<device_ptr, DataVector> DataMap;
 /* tile list */
 typedef vector<RenderTile> TileList;
 
+/* hashes of device memory blocks, see NETWORK_MEM_BLOCK_SIZE */
+typedef vector<uint64_t> BlockHashVector;
+typedef map<device_ptr, BlockHashVector> BlockHashMap;
+
+/* byte range of device memory, as offset and size */
+typedef vector<pair<size_t, size_t> > MemRangeList;
+
+static uint64_t mem_block_hash(const uint8_t *data, size_t size)
+{
+	/* FNV-1a, over words for speed. */
+	uint64_t hash = 14695981039346656037ULL;
+	size_t i = 0;
+
+	for(; i + 4 <= size; i += 4) {
+		uint32_t word;
+		memcpy(&word, data + i, 4);
+		hash = (hash ^ word) * 1099511628211ULL;
+	}
+	for(; i < size; i++) {
+		hash = (hash ^ data[i]) * 1099511628211ULL;
+	}
+
+	return hash;
+}
+
 /* search a list of tiles and find the one that matches the passed render tile */
 static TileList::iterator tile_list_find(TileList& tile_list, RenderTile& tile)
 {
@@ -51,13 +77,16 @@ public:
 
 	thread_mutex rpc_lock;
 
+	/* block hashes of memory as last sent to the server */
+	BlockHashMap mem_hashes;
+
 	virtual bool show_samples() const
 	{
 		return false;
 	}
 
-	NetworkDevice(DeviceInfo& info, Stats &stats, const char *address)
-	: Device(info, stats, true), socket(io_service)
+	NetworkDevice(DeviceInfo& info, Stats &stats, Profiler &profiler, const char *address)
+	: Device(info, stats, profiler, true), socket(io_service)
 	{
 		error_func = NetworkError();
 		stringstream portstr;
@@ -98,21 +127,111 @@ public:
 		thread_scoped_lock lock(rpc_lock);
 
 		mem.device_pointer = ++mem_counter;
+		mem_hashes.erase(mem.device_pointer);
 
 		RPCSend snd(socket, &error_func, "mem_alloc");
 		snd.add(mem);
 		snd.write();
 	}
 
+	/* Find the ranges of memory which changed since the previous copy. Only
+	 * memory the device does not write to can be tracked, the server keeps a
+	 * copy of it which stays valid between copies. */
+	void mem_changed_ranges(device_memory& mem, MemRangeList& ranges)
+	{
+		const size_t size = mem.memory_size();
+		const uint8_t *data = (const uint8_t*)mem.host_pointer;
+
+		ranges.clear();
+
+		if(!(mem.type == MEM_READ_ONLY || mem.type == MEM_TEXTURE) || !data) {
+			mem_hashes.erase(mem.device_pointer);
+			ranges.push_back(MemRangeList::value_type(0, size));
+			return;
+		}
+
+		const size_t num_blocks = divide_up(size, NETWORK_MEM_BLOCK_SIZE);
+		BlockHashVector& hashes = mem_hashes[mem.device_pointer];
+		const bool full = (hashes.size() != num_blocks);
+
+		hashes.resize(num_blocks);
+
+		for(size_t block = 0; block < num_blocks; block++) {
+			const size_t offset = block*NETWORK_MEM_BLOCK_SIZE;
+			const size_t block_size = min(NETWORK_MEM_BLOCK_SIZE, size - offset);
+			const uint64_t hash = mem_block_hash(data + offset, block_size);
+
+			if(!full && hashes[block] == hash)
+				continue;
+
+			hashes[block] = hash;
+
+			/* Merge with the previous range if adjacent. */
+			if(ranges.size() && ranges.back().first + ranges.back().second == offset)
+				ranges.back().second += block_size;
+			else
+				ranges.push_back(MemRangeList::value_type(offset, block_size));
+		}
+	}
+
+	/* Copy and zero allocate memory which was not allocated yet, as on other
+	 * devices. Give it a client pointer of its own, so the server and the block
+	 * hashes can tell it apart from other memory. */
+	void mem_ensure_client_pointer(device_memory& mem)
+	{
+		if(!mem.device_pointer) {
+			mem.device_pointer = ++mem_counter;
+			mem_hashes.erase(mem.device_pointer);
+		}
+	}
+
 	void mem_copy_to(device_memory& mem)
 	{
 		thread_scoped_lock lock(rpc_lock);
 
+		mem_ensure_client_pointer(mem);
+
+		MemRangeList ranges;
+		mem_changed_ranges(mem, ranges);
+
+		/* Gather changed ranges into a single buffer. */
+		vector<uint8_t> changed;
+		size_t changed_size = 0;
+
+		if(ranges.size() == 1 && ranges[0].second == mem.memory_size()) {
+			changed_size = mem.memory_size();
+		}
+		else {
+			for(size_t i = 0; i < ranges.size(); i++)
+				changed_size += ranges[i].second;
+
+			changed.resize(changed_size);
+
+			size_t offset = 0;
+			for(size_t i = 0; i < ranges.size(); i++) {
+				memcpy(&changed[offset], (uint8_t*)mem.host_pointer + ranges[i].first, ranges[i].second);
+				offset += ranges[i].second;
+			}
+		}
+
+		VLOG(3) << "Network copy of " << (mem.name ? mem.name : "memory") << ": "
+		        << string_human_readable_size(changed_size) << " of "
+		        << string_human_readable_size(mem.memory_size()) << " changed.";
+
 		RPCSend snd(socket, &error_func, "mem_copy_to");
 
 		snd.add(mem);
+
+		size_t num_ranges = ranges.size();
+		snd.add(num_ranges);
+		for(size_t i = 0; i < num_ranges; i++) {
+			snd.add(ranges[i].first);
+			snd.add(ranges[i].second);
+		}
+
+		snd.add_compressed((changed.size())? (void*)&changed[0]: (void*)mem.host_pointer, changed_size);
 		snd.write();
-		snd.write_buffer(mem.host_pointer, mem.memory_size());
+		snd.write_compressed();
 	}
 
 	void mem_copy_from(device_memory& mem, int y, int w, int h, int elem)
@@ -121,6 +240,9 @@ public:
 
 		size_t data_size = mem.memory_size();
 
+		/* The server copy now holds device data, send everything next time. */
+		mem_hashes.erase(mem.device_pointer);
+
 		RPCSend snd(socket, &error_func, "mem_copy_from");
 
 		snd.add(mem);
@@ -131,13 +253,16 @@ public:
 		snd.write();
 
 		RPCReceive rcv(socket, &error_func);
-		rcv.read_buffer(mem.host_pointer, data_size);
+		rcv.read_compressed(mem.host_pointer, data_size);
 	}
 
 	void mem_zero(device_memory& mem)
 	{
 		thread_scoped_lock lock(rpc_lock);
 
+		mem_ensure_client_pointer(mem);
+		mem_hashes.erase(mem.device_pointer);
+
 		RPCSend snd(socket, &error_func, "mem_zero");
 
 		snd.add(mem);
@@ -149,6 +274,8 @@ public:
 		if(mem.device_pointer) {
 			thread_scoped_lock lock(rpc_lock);
 
+			mem_hashes.erase(mem.device_pointer);
+
 			RPCSend snd(socket, &error_func, "mem_free");
 
 			snd.add(mem);
@@ -181,7 +308,6 @@ public:
 
 		RPCSend snd(socket, &error_func, "load_kernels");
 		snd.add(requested_features.experimental);
-		snd.add(requested_features.max_closure);
 		snd.add(requested_features.max_nodes_group);
 		snd.add(requested_features.nodes_features);
 		snd.write();
@@ -226,15 +352,27 @@ public:
 			RPCReceive rcv(socket, &error_func);
 
 			if(rcv.name == "acquire_tile") {
+				int num_tiles;
+				rcv.read(num_tiles);
 				lock.unlock();
 
+				/* Hand out multiple tiles at once, so the server does not have
+				 * to wait for a round-trip before rendering the next one. */
+				TileList acquired;
+
 				/* todo: watch out for recursive calls! */
-				if(the_task.acquire_tile(this, tile)) { /* write return as bool */
+				while((int)acquired.size() < num_tiles && the_task.acquire_tile(this, tile)) {
+					acquired.push_back(tile);
 					the_tiles.push_back(tile);
+				}
 
+				if(acquired.size()) {
 					lock.lock();
 					RPCSend snd(socket, &error_func, "acquire_tile");
-					snd.add(tile);
+					int num_acquired = acquired.size();
+					snd.add(num_acquired);
+					for(int i = 0; i < num_acquired; i++)
+						snd.add(acquired[i]);
 					snd.write();
 					lock.unlock();
 				}
@@ -289,9 +427,9 @@ private:
 	NetworkError error_func;
 };
 
-Device *device_network_create(DeviceInfo& info, Stats &stats, const char *address)
+Device *device_network_create(DeviceInfo& info, Stats &stats, Profiler &profiler, const char *address)
 {
-	return new NetworkDevice(info, stats, address);
+	return new NetworkDevice(info, stats, profiler, address);
 }
 
 void device_network_info(vector<DeviceInfo>& devices)
@@ -456,7 +594,10 @@ protected:
 			size_t data_size = mem.memory_size();
 			device_ptr client_pointer = mem.device_pointer;
 
-			if(client_pointer) {
+			/* Memory which was not allocated yet is allocated by the device. */
+			const bool is_new = (mem_data.find(client_pointer) == mem_data.end());
+
+			if(!is_new) {
 				/* Lookup existing host side data buffer. */
 				DataVector &data_v = data_vector_find(client_pointer);
 				mem.host_pointer = (void*)&data_v[0];
@@ -468,15 +609,40 @@ protected:
 				/* Allocate host side data buffer. */
 				DataVector &data_v = data_vector_insert(client_pointer, data_size);
 				mem.host_pointer = (data_size)? (void*)&(data_v[0]): 0;
+				mem.device_pointer = 0;
 			}
 
-			/* Copy data from network into memory buffer. */
-			rcv.read_buffer((uint8_t*)mem.host_pointer, data_size);
+			/* Copy changed ranges from network into memory buffer. */
+			size_t num_ranges;
+			rcv.read(num_ranges);
+
+			MemRangeList ranges(num_ranges);
+			size_t changed_size = 0;
+			for(size_t i = 0; i < num_ranges; i++) {
+				rcv.read(ranges[i].first);
+				rcv.read(ranges[i].second);
+				changed_size += ranges[i].second;
+			}
+
+			if(num_ranges == 1 && ranges[0].second == data_size) {
+				rcv.read_compressed((uint8_t*)mem.host_pointer, data_size);
+			}
+			else {
+				vector<uint8_t> changed(changed_size);
+				rcv.read_compressed((changed_size)? &changed[0]: NULL, changed_size);
+
+				size_t offset = 0;
+				for(size_t i = 0; i < num_ranges; i++) {
+					assert(ranges[i].first + ranges[i].second <= data_size);
+					memcpy((uint8_t*)mem.host_pointer + ranges[i].first, &changed[offset], ranges[i].second);
+					offset += ranges[i].second;
+				}
+			}
 
 			/* Copy the data from the memory buffer to the device buffer. */
 			device->mem_copy_to(mem);
 
-			if(!client_pointer) {
+			if(is_new) {
 				/* Store a mapping to/from client_pointer and real device pointer. */
 				pointer_mapping_insert(client_pointer, mem.device_pointer);
 			}
@@ -497,15 +663,16 @@ protected:
 
 			DataVector &data_v = data_vector_find(client_pointer);
 
-			mem.host_pointer = (device_ptr)&(data_v[0]);
+			mem.host_pointer = (void*)&(data_v[0]);
 
 			device->mem_copy_from(mem, y, w, h, elem);
 
 			size_t data_size = mem.memory_size();
 
 			RPCSend snd(socket, &error_func, "mem_copy_from");
+			snd.add_compressed((uint8_t*)mem.host_pointer, data_size);
 			snd.write();
-			snd.write_buffer((uint8_t*)mem.host_pointer, data_size);
+			snd.write_compressed();
 			lock.unlock();
 		}
 		else if(rcv.name == "mem_zero") {
@@ -517,7 +684,10 @@ protected:
 			size_t data_size = mem.memory_size();
 			device_ptr client_pointer = mem.device_pointer;
 
-			if(client_pointer) {
+			/* Memory which was not allocated yet is allocated by the device. */
+			const bool is_new = (mem_data.find(client_pointer) == mem_data.end());
+
+			if(!is_new) {
 				/* Lookup existing host side data buffer. */
 				DataVector &data_v = data_vector_find(client_pointer);
 				mem.host_pointer = (void*)&data_v[0];
@@ -528,13 +698,14 @@ protected:
 			else {
 				/* Allocate host side data buffer. */
 				DataVector &data_v = data_vector_insert(client_pointer, data_size);
-				mem.host_pointer = (void*)? (device_ptr)&(data_v[0]): 0;
+				mem.host_pointer = (data_size)? (void*)&(data_v[0]): 0;
+				mem.device_pointer = 0;
 			}
 
 			/* Zero memory. */
 			device->mem_zero(mem);
 
-			if(!client_pointer) {
+			if(is_new) {
 				/* Store a mapping to/from client_pointer and real device pointer. */
 				pointer_mapping_insert(client_pointer, mem.device_pointer);
 			}
@@ -568,7 +739,6 @@ protected:
 		else if(rcv.name == "load_kernels") {
 			DeviceRequestedFeatures requested_features;
 			rcv.read(requested_features.experimental);
-			rcv.read(requested_features.max_closure);
 			rcv.read(requested_features.max_nodes_group);
 			rcv.read(requested_features.nodes_features);
 
@@ -606,6 +776,8 @@ protected:
 			task.update_tile_sample = function_bind(&DeviceServer::task_update_tile_sample, this, _1);
 			task.get_cancel = function_bind(&DeviceServer::task_get_cancel, this);
 
+			tile_prefetch.clear();
+
 			device->task_add(task);
 		}
 		else if(rcv.name == "task_wait") {
@@ -627,7 +799,13 @@ protected:
 		else if(rcv.name == "acquire_tile") {
 			AcquireEntry entry;
 			entry.name = rcv.name;
-			rcv.read(entry.tile);
+
+			int num_tiles;
+			rcv.read(num_tiles);
+			entry.tiles.resize(num_tiles);
+			for(int i = 0; i < num_tiles; i++)
+				rcv.read(entry.tiles[i]);
+
 			acquire_queue.push_back(entry);
 			lock.unlock();
 		}
@@ -653,10 +831,21 @@ protected:
 	{
 		thread_scoped_lock acquire_lock(acquire_mutex);
 
+		/* Use a tile received along with a previous one if available. */
+		if(!tile_prefetch.empty()) {
+			tile = tile_prefetch.front();
+			tile_prefetch.pop_front();
+			return true;
+		}
+
 		bool result = false;
 
-		RPCSend snd(socket, &error_func, "acquire_tile");
-		snd.write();
+		{
+			thread_scoped_lock lock(rpc_lock);
+			RPCSend snd(socket, &error_func, "acquire_tile");
+			snd.add(NETWORK_TILES_PREFETCH);
+			snd.write();
+		}
 
 		do {
 			if(blocked_waiting)
@@ -670,9 +859,12 @@ protected:
 				acquire_queue.pop_front();
 
 				if(entry.name == "acquire_tile") {
-					tile = entry.tile;
+					foreach(RenderTile& entry_tile, entry.tiles) {
+						if(entry_tile.buffer) entry_tile.buffer = ptr_map[entry_tile.buffer];
+					}
 
-					if(tile.buffer) tile.buffer = ptr_map[tile.buffer];
+					tile = entry.tiles[0];
+					tile_prefetch.insert(tile_prefetch.end(), entry.tiles.begin() + 1, entry.tiles.end());
 
 					result = true;
 					break;
@@ -751,12 +943,15 @@ protected:
 
 	struct AcquireEntry {
 		string name;
-		RenderTile tile;
+		TileList tiles;
 	};
 
 	thread_mutex acquire_mutex;
 	list<AcquireEntry> acquire_queue;
 
+	/* tiles acquired ahead of time, protected by acquire_mutex */
+	list<RenderTile> tile_prefetch;
+
 	bool stop;
 	bool blocked_waiting;
 private:
@@ -766,6 +961,22 @@ private:
 
 };
 
+void device_network_server_accept(Device *device,
+                                  boost::asio::io_service& io_service,
+                                  tcp::acceptor& acceptor)
+{
+	tcp::socket socket(io_service);
+	acceptor.accept(socket);
+
+	string remote_address = socket.remote_endpoint().address().to_string();
+	printf("Connected to remote client at: %s\n", remote_address.c_str());
+
+	DeviceServer server(device, socket);
+	server.listen();
+
+	printf("Disconnected.\n");
+}
+
 void Device::server_run()
 {
 	try {
@@ -777,16 +988,7 @@ void Device::server_run()
 			boost::asio::io_service io_service;
 			tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), SERVER_PORT));
 
-			tcp::socket socket(io_service);
-			acceptor.accept(socket);
-
-			string remote_address = socket.remote_endpoint().address().to_string();
-			printf("Connected to remote client at: %s\n", remote_address.c_str());
-
-			DeviceServer server(this, socket);
-			server.listen();
-
-			printf("Disconnected.\n");
+			device_network_server_accept(this, io_service, acceptor);
 		}
 	}
 	catch(exception& e) {
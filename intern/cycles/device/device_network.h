@@ -35,6 +35,7 @@
 
 #include "render/buffers.h"
 
+#include "util/util_compress.h"
 #include "util/util_foreach.h"
 #include "util/util_list.h"
 #include "util/util_map.h"
@@ -56,6 +57,14 @@ static const int DISCOVER_PORT = 5121;
 static const string DISCOVER_REQUEST_MSG = "REQUEST_RENDER_SERVER_IP";
 static const string DISCOVER_REPLY_MSG = "REPLY_RENDER_SERVER_IP";
 
+/* Number of tiles a server requests at once, so render threads can pick up
+ * a new tile without waiting for a round-trip to the client. */
+static const int NETWORK_TILES_PREFETCH = 4;
+
+/* Granularity at which changes in device memory are detected, only blocks
+ * which changed since the previous copy are sent. */
+static const size_t NETWORK_MEM_BLOCK_SIZE = 64*1024;
+
 #if 0
 typedef boost::archive::text_oarchive o_archive;
 typedef boost::archive::text_iarchive i_archive;
@@ -112,7 +121,8 @@ private:
 class RPCSend {
 public:
 	RPCSend(tcp::socket& socket_, NetworkError* e, const string& name_ = "")
-	: name(name_), socket(socket_), archive(archive_stream), sent(false)
+	: name(name_), socket(socket_), archive(archive_stream), sent(false),
+	  uncompressed(NULL), uncompressed_size(0)
 	{
 		archive & name_;
 		error_func = e;
@@ -198,6 +208,31 @@ public:
 			error_func->network_error(error.message());
 	}
 
+	/* Compress a buffer to be sent with write_compressed() after write().
+	 * Data which does not compress is sent as is. */
+	void add_compressed(void *buffer, size_t size)
+	{
+		util_compress_buffer(buffer, size, compressed);
+
+		bool use_compression = compressed.size() < size;
+		size_t compressed_size = (use_compression)? compressed.size(): size;
+		archive & use_compression & compressed_size;
+
+		if(!use_compression) {
+			compressed.clear();
+			uncompressed = buffer;
+		}
+		uncompressed_size = size;
+	}
+
+	void write_compressed()
+	{
+		if(uncompressed)
+			write_buffer(uncompressed, uncompressed_size);
+		else if(compressed.size())
+			write_buffer(&compressed[0], compressed.size());
+	}
+
 protected:
 	string name;
 	tcp::socket& socket;
@@ -205,6 +240,10 @@ protected:
 	o_archive archive;
 	bool sent;
 	NetworkError *error_func;
+
+	vector<uint8_t> compressed;
+	void *uncompressed;
+	size_t uncompressed_size;
 };
 
 /* Remote procedure call Receive */
@@ -304,6 +343,26 @@ public:
 			cout << "Network receive error: buffer size doesn't match expected size\n";
 	}
 
+	/* Receive a buffer sent with RPCSend::add_compressed(). */
+	void read_compressed(void *buffer, size_t size)
+	{
+		bool use_compression;
+		size_t compressed_size;
+		*archive & use_compression & compressed_size;
+
+		if(!use_compression) {
+			read_buffer(buffer, size);
+			return;
+		}
+
+		vector<uint8_t> compressed(compressed_size);
+		if(compressed_size)
+			read_buffer(&compressed[0], compressed_size);
+
+		if(!util_decompress_buffer(compressed.size()? &compressed[0]: NULL, compressed_size, buffer, size))
+			error_func->network_error("Network receive error: invalid compressed buffer");
+	}
+
 	void read(DeviceTask& task)
 	{
 		int type;
@@ -484,6 +543,12 @@ private:
 	vector<string> servers;
 };
 
+/* Serve a single client on a listening acceptor, until the client disconnects.
+ * The actual work is done by device. */
+void device_network_server_accept(Device *device,
+                                  boost::asio::io_service& io_service,
+                                  tcp::acceptor& acceptor);
+
 CCL_NAMESPACE_END
 
 #endif
@@ -72,8 +72,8 @@ void OpenCLDeviceBase::opencl_assert_err(cl_int err, const char* where)
 	}
 }
 
-OpenCLDeviceBase::OpenCLDeviceBase(DeviceInfo& info, Stats &stats, bool background_)
-: Device(info, stats, background_),
+OpenCLDeviceBase::OpenCLDeviceBase(DeviceInfo& info, Stats &stats, Profiler &profiler, bool background_)
+: Device(info, stats, profiler, background_),
   memory_manager(this),
   texture_info(this, "__texture_info", MEM_TEXTURE)
 {
@@ -676,6 +676,8 @@ void OpenCLDeviceBase::flush_texture_buffers()
 		MemoryManager::BufferDescriptor desc = memory_manager.get_descriptor(slot.name);
 		info.data = desc.offset;
 		info.cl_buffer = desc.device_buffer;
+		info.grid = 0;
+		info.compression = IMAGE_COMPRESSION_NONE;
 
 		if(string_startswith(slot.name, "__tex_image")) {
 			device_memory *mem = textures[slot.name];
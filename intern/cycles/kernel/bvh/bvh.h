@@ -166,6 +166,8 @@ ccl_device_intersect bool scene_intersect(KernelGlobals *kg,
                                           float difl,
                                           float extmax)
 {
+	PROFILING_INIT(kg, PROFILING_INTERSECT);
+
 #ifdef __OBJECT_MOTION__
 	if(kernel_data.bvh.have_motion) {
 #  ifdef __HAIR__
@@ -201,6 +203,49 @@ ccl_device_intersect bool scene_intersect(KernelGlobals *kg,
 #endif /* __KERNEL_CPU__ */
 }
 
+#ifdef __KERNEL_CPU__
+#  ifdef __QBVH__
+#    include "kernel/bvh/qbvh_packet.h"
+#  endif
+
+/* Ray packets are only used for scenes which packet traversal supports, it
+ * is up to the caller to trace rays one by one otherwise. */
+ccl_device_inline bool scene_intersect_packet_supported(KernelGlobals *kg)
+{
+#  ifdef __QBVH__
+	return kernel_data.bvh.use_ray_packets &&
+	       kernel_data.bvh.bvh_layout == BVH_LAYOUT_BVH4 &&
+	       !kernel_data.bvh.have_motion &&
+	       !kernel_data.bvh.have_curves;
+#  else
+	(void)kg;
+	return false;
+#  endif
+}
+
+/* Intersect up to RAY_PACKET_SIZE coherent rays with the scene, falls back
+ * to intersecting the rays one by one if packets are not supported. */
+ccl_device_intersect void scene_intersect_packet(KernelGlobals *kg,
+                                                 const Ray *rays,
+                                                 Intersection *isects,
+                                                 int num_rays,
+                                                 const uint visibility)
+{
+	PROFILING_INIT(kg, PROFILING_INTERSECT);
+
+#  ifdef __QBVH__
+	if(scene_intersect_packet_supported(kg)) {
+		qbvh_intersect_packet(kg, rays, isects, num_rays, visibility);
+		return;
+	}
+#  endif
+
+	for(int i = 0; i < num_rays; i++) {
+		scene_intersect(kg, rays[i], visibility, &isects[i], NULL, 0.0f, 0.0f);
+	}
+}
+#endif  /* __KERNEL_CPU__ */
+
 #ifdef __BVH_LOCAL__
 /* Note: ray is passed by value to work around a possible CUDA compiler bug. */
 ccl_device_intersect void scene_intersect_local(KernelGlobals *kg,
@@ -210,6 +255,8 @@ ccl_device_intersect void scene_intersect_local(KernelGlobals *kg,
                                                 uint *lcg_state,
                                                 int max_hits)
 {
+	PROFILING_INIT(kg, PROFILING_INTERSECT_LOCAL);
+
 #ifdef __OBJECT_MOTION__
 	if(kernel_data.bvh.have_motion) {
 		return bvh_intersect_local_motion(kg,
@@ -237,6 +284,8 @@ ccl_device_intersect bool scene_intersect_shadow_all(KernelGlobals *kg,
                                                      uint max_hits,
                                                      uint *num_hits)
 {
+	PROFILING_INIT(kg, PROFILING_INTERSECT_SHADOW_ALL);
+
 #  ifdef __OBJECT_MOTION__
 	if(kernel_data.bvh.have_motion) {
 #    ifdef __HAIR__
@@ -296,6 +345,8 @@ ccl_device_intersect bool scene_intersect_volume(KernelGlobals *kg,
                                                  Intersection *isect,
                                                  const uint visibility)
 {
+	PROFILING_INIT(kg, PROFILING_INTERSECT_VOLUME);
+
 #  ifdef __OBJECT_MOTION__
 	if(kernel_data.bvh.have_motion) {
 		return bvh_intersect_volume_motion(kg, ray, isect, visibility);
@@ -324,6 +375,8 @@ ccl_device_intersect uint scene_intersect_volume_all(KernelGlobals *kg,
                                                      const uint max_hits,
                                                      const uint visibility)
 {
+	PROFILING_INIT(kg, PROFILING_INTERSECT_VOLUME_ALL);
+
 #  ifdef __OBJECT_MOTION__
 	if(kernel_data.bvh.have_motion) {
 		return bvh_intersect_volume_all_motion(kg, ray, isect, max_hits, visibility);
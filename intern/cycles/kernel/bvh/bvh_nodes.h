@@ -20,11 +20,23 @@ ccl_device_forceinline Transform bvh_unaligned_node_fetch_space(KernelGlobals *k
                                                                 int node_addr,
                                                                 int child)
 {
-	Transform space;
-	const int child_addr = node_addr + child * 3;
-	space.x = kernel_tex_fetch(__bvh_nodes, child_addr+1);
-	space.y = kernel_tex_fetch(__bvh_nodes, child_addr+2);
-	space.z = kernel_tex_fetch(__bvh_nodes, child_addr+3);
+	/* Orientation is packed into the w component of the scale. */
+	const int child_addr = node_addr + child * 2;
+	const float4 scale = kernel_tex_fetch(__bvh_nodes, child_addr+1);
+	const float4 offset = kernel_tex_fetch(__bvh_nodes, child_addr+2);
+	Transform space = make_transform_frame_packed(__float_as_uint(scale.w));
+	space.x = make_float4(space.x.x * scale.x,
+	                      space.x.y * scale.x,
+	                      space.x.z * scale.x,
+	                      offset.x);
+	space.y = make_float4(space.y.x * scale.y,
+	                      space.y.y * scale.y,
+	                      space.y.z * scale.y,
+	                      offset.y);
+	space.z = make_float4(space.z.x * scale.z,
+	                      space.z.y * scale.z,
+	                      space.z.z * scale.z,
+	                      offset.z);
 	return space;
 }
 
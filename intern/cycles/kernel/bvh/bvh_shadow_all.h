@@ -184,6 +184,10 @@ bool BVH_FUNCTION_FULL_NAME(BVH)(KernelGlobals *kg,
 					--stack_ptr;
 
 					/* primitive intersection */
+#if BVH_FEATURE(BVH_HAIR)
+					/* Segment of the compact curve primitive being intersected. */
+					int curve_segment = 0;
+#endif
 					while(prim_addr < prim_addr2) {
 						kernel_assert((kernel_tex_fetch(__prim_type, prim_addr) & PRIMITIVE_ALL) == p_type);
 						bool hit;
@@ -220,6 +224,7 @@ bool BVH_FUNCTION_FULL_NAME(BVH)(KernelGlobals *kg,
 							case PRIMITIVE_CURVE:
 							case PRIMITIVE_MOTION_CURVE: {
 								const uint curve_type = kernel_tex_fetch(__prim_type, prim_addr);
+								const uint segment_type = PRIMITIVE_SEGMENT(curve_type, curve_segment);
 								if(kernel_data.curve.curveflags & CURVE_KN_INTERPOLATE) {
 									hit = cardinal_curve_intersect(kg,
 									                               isect_array,
@@ -229,7 +234,7 @@ bool BVH_FUNCTION_FULL_NAME(BVH)(KernelGlobals *kg,
 									                               object,
 									                               prim_addr,
 									                               ray->time,
-									                               curve_type,
+									                               segment_type,
 									                               NULL,
 									                               0, 0);
 								}
@@ -242,10 +247,16 @@ bool BVH_FUNCTION_FULL_NAME(BVH)(KernelGlobals *kg,
 									                      object,
 									                      prim_addr,
 									                      ray->time,
-									                      curve_type,
+									                      segment_type,
 									                      NULL,
 									                      0, 0);
 								}
+								/* Stay on the primitive until all of its segments are
+								 * intersected, so every hit gets recorded.
+								 */
+								if(++curve_segment == (int)PRIMITIVE_UNPACK_NUM_SEGMENTS(curve_type)) {
+									curve_segment = 0;
+								}
 								break;
 							}
 #endif
@@ -297,7 +308,12 @@ bool BVH_FUNCTION_FULL_NAME(BVH)(KernelGlobals *kg,
 							isect_array->t = isect_t;
 						}
 
-						prim_addr++;
+#if BVH_FEATURE(BVH_HAIR)
+						if(curve_segment == 0)
+#endif
+						{
+							prim_addr++;
+						}
 					}
 				}
 #if BVH_FEATURE(BVH_INSTANCING)
@@ -296,48 +296,53 @@ ccl_device_noinline bool BVH_FUNCTION_FULL_NAME(BVH)(KernelGlobals *kg,
 								BVH_DEBUG_NEXT_INTERSECTION();
 								const uint curve_type = kernel_tex_fetch(__prim_type, prim_addr);
 								kernel_assert((curve_type & PRIMITIVE_ALL) == (type & PRIMITIVE_ALL));
-								bool hit;
-								if(kernel_data.curve.curveflags & CURVE_KN_INTERPOLATE) {
-									hit = cardinal_curve_intersect(kg,
-									                               isect,
-									                               P,
-									                               dir,
-									                               visibility,
-									                               object,
-									                               prim_addr,
-									                               ray->time,
-									                               curve_type,
-									                               lcg_state,
-									                               difl,
-									                               extmax);
-								}
-								else {
-									hit = curve_intersect(kg,
-									                      isect,
-									                      P,
-									                      dir,
-									                      visibility,
-									                      object,
-									                      prim_addr,
-									                      ray->time,
-									                      curve_type,
-									                      lcg_state,
-									                      difl,
-									                      extmax);
-								}
-								if(hit) {
-									/* shadow ray early termination */
+								/* Compact primitives cover several segments of a curve. */
+								const int num_segments = PRIMITIVE_UNPACK_NUM_SEGMENTS(curve_type);
+								for(int segment = 0; segment < num_segments; segment++) {
+									const uint segment_type = PRIMITIVE_SEGMENT(curve_type, segment);
+									bool hit;
+									if(kernel_data.curve.curveflags & CURVE_KN_INTERPOLATE) {
+										hit = cardinal_curve_intersect(kg,
+										                               isect,
+										                               P,
+										                               dir,
+										                               visibility,
+										                               object,
+										                               prim_addr,
+										                               ray->time,
+										                               segment_type,
+										                               lcg_state,
+										                               difl,
+										                               extmax);
+									}
+									else {
+										hit = curve_intersect(kg,
+										                      isect,
+										                      P,
+										                      dir,
+										                      visibility,
+										                      object,
+										                      prim_addr,
+										                      ray->time,
+										                      segment_type,
+										                      lcg_state,
+										                      difl,
+										                      extmax);
+									}
+									if(hit) {
+										/* shadow ray early termination */
 #  if defined(__KERNEL_SSE2__)
-									if(visibility & PATH_RAY_SHADOW_OPAQUE)
-										return true;
-									tsplat = ssef(0.0f, 0.0f, -isect->t, -isect->t);
+										if(visibility & PATH_RAY_SHADOW_OPAQUE)
+											return true;
+										tsplat = ssef(0.0f, 0.0f, -isect->t, -isect->t);
 #    if BVH_FEATURE(BVH_HAIR)
-									tfar = ssef(isect->t);
+										tfar = ssef(isect->t);
 #    endif
 #  else
-									if(visibility & PATH_RAY_SHADOW_OPAQUE)
-										return true;
+										if(visibility & PATH_RAY_SHADOW_OPAQUE)
+											return true;
 #  endif
+									}
 								}
 							}
 							break;
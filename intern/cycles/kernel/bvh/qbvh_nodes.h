@@ -183,6 +183,62 @@ ccl_device_inline int qbvh_aligned_node_intersect_robust(
 
 /* Unaligned nodes intersection */
 
+/* Decode oriented bounds of all four children, packed as orientation, scale
+ * and offset. Matches make_transform_frame_packed() lane-wise.
+ */
+ccl_device_forceinline void qbvh_unaligned_node_fetch_space(
+        KernelGlobals *ccl_restrict kg,
+        const int node_addr,
+        sse3f *ccl_restrict tfm_x,
+        sse3f *ccl_restrict tfm_y,
+        sse3f *ccl_restrict tfm_z,
+        sse3f *ccl_restrict tfm_t)
+{
+	const ssei packed = kernel_tex_fetch_ssei(__bvh_nodes, node_addr+1);
+	const ssef range(32767.0f);
+	const ssef u = ssef(packed & 0xffff) - range;
+	const ssef v = ssef(srl(packed, 16)) - range;
+	const ssef au = abs(u), av = abs(v);
+	const ssef z = range - au - av;
+	const sseb upper = z >= ssef(0.0f);
+	ssef nx = select(upper, u, (range - av) ^ signmsk(u));
+	ssef ny = select(upper, v, (range - au) ^ signmsk(v));
+	ssef nz = z;
+	const ssef inv_len = ssef(1.0f) / mm_sqrt(nx*nx + ny*ny + nz*nz);
+	nx *= inv_len;
+	ny *= inv_len;
+	nz *= inv_len;
+
+	const sseb use_y = av > au;
+	const ssef zero(0.0f);
+	ssef dx_x = select(use_y, zero, nz);
+	ssef dx_y = select(use_y, -nz, zero);
+	ssef dx_z = select(use_y, ny, -nx);
+	const ssef inv_dx_len = ssef(1.0f) / mm_sqrt(dx_x*dx_x + dx_y*dx_y + dx_z*dx_z);
+	dx_x *= inv_dx_len;
+	dx_y *= inv_dx_len;
+	dx_z *= inv_dx_len;
+
+	ssef dy_x = ny*dx_z - nz*dx_y;
+	ssef dy_y = nz*dx_x - nx*dx_z;
+	ssef dy_z = nx*dx_y - ny*dx_x;
+	const ssef inv_dy_len = ssef(1.0f) / mm_sqrt(dy_x*dy_x + dy_y*dy_y + dy_z*dy_z);
+	dy_x *= inv_dy_len;
+	dy_y *= inv_dy_len;
+	dy_z *= inv_dy_len;
+
+	const ssef scale_x = kernel_tex_fetch_ssef(__bvh_nodes, node_addr+2);
+	const ssef scale_y = kernel_tex_fetch_ssef(__bvh_nodes, node_addr+3);
+	const ssef scale_z = kernel_tex_fetch_ssef(__bvh_nodes, node_addr+4);
+
+	*tfm_x = sse3f(dx_x*scale_x, dx_y*scale_x, dx_z*scale_x);
+	*tfm_y = sse3f(dy_x*scale_y, dy_y*scale_y, dy_z*scale_y);
+	*tfm_z = sse3f(nx*scale_z, ny*scale_z, nz*scale_z);
+	*tfm_t = sse3f(kernel_tex_fetch_ssef(__bvh_nodes, node_addr+5),
+	               kernel_tex_fetch_ssef(__bvh_nodes, node_addr+6),
+	               kernel_tex_fetch_ssef(__bvh_nodes, node_addr+7));
+}
+
 ccl_device_inline int qbvh_unaligned_node_intersect(
         KernelGlobals *ccl_restrict kg,
         const ssef& isect_near,
@@ -202,30 +258,16 @@ ccl_device_inline int qbvh_unaligned_node_intersect(
         const int node_addr,
         ssef *ccl_restrict dist)
 {
-	const int offset = node_addr;
-	const ssef tfm_x_x = kernel_tex_fetch_ssef(__bvh_nodes, offset+1);
-	const ssef tfm_x_y = kernel_tex_fetch_ssef(__bvh_nodes, offset+2);
-	const ssef tfm_x_z = kernel_tex_fetch_ssef(__bvh_nodes, offset+3);
+	sse3f tfm_x, tfm_y, tfm_z, tfm_t;
+	qbvh_unaligned_node_fetch_space(kg, node_addr, &tfm_x, &tfm_y, &tfm_z, &tfm_t);
 
-	const ssef tfm_y_x = kernel_tex_fetch_ssef(__bvh_nodes, offset+4);
-	const ssef tfm_y_y = kernel_tex_fetch_ssef(__bvh_nodes, offset+5);
-	const ssef tfm_y_z = kernel_tex_fetch_ssef(__bvh_nodes, offset+6);
+	const ssef aligned_dir_x = dir.x*tfm_x.x + dir.y*tfm_x.y + dir.z*tfm_x.z,
+	           aligned_dir_y = dir.x*tfm_y.x + dir.y*tfm_y.y + dir.z*tfm_y.z,
+	           aligned_dir_z = dir.x*tfm_z.x + dir.y*tfm_z.y + dir.z*tfm_z.z;
 
-	const ssef tfm_z_x = kernel_tex_fetch_ssef(__bvh_nodes, offset+7);
-	const ssef tfm_z_y = kernel_tex_fetch_ssef(__bvh_nodes, offset+8);
-	const ssef tfm_z_z = kernel_tex_fetch_ssef(__bvh_nodes, offset+9);
-
-	const ssef tfm_t_x = kernel_tex_fetch_ssef(__bvh_nodes, offset+10);
-	const ssef tfm_t_y = kernel_tex_fetch_ssef(__bvh_nodes, offset+11);
-	const ssef tfm_t_z = kernel_tex_fetch_ssef(__bvh_nodes, offset+12);
-
-	const ssef aligned_dir_x = dir.x*tfm_x_x + dir.y*tfm_x_y + dir.z*tfm_x_z,
-	           aligned_dir_y = dir.x*tfm_y_x + dir.y*tfm_y_y + dir.z*tfm_y_z,
-	           aligned_dir_z = dir.x*tfm_z_x + dir.y*tfm_z_y + dir.z*tfm_z_z;
-
-	const ssef aligned_P_x = org.x*tfm_x_x + org.y*tfm_x_y + org.z*tfm_x_z + tfm_t_x,
-	           aligned_P_y = org.x*tfm_y_x + org.y*tfm_y_y + org.z*tfm_y_z + tfm_t_y,
-	           aligned_P_z = org.x*tfm_z_x + org.y*tfm_z_y + org.z*tfm_z_z + tfm_t_z;
+	const ssef aligned_P_x = org.x*tfm_x.x + org.y*tfm_x.y + org.z*tfm_x.z + tfm_t.x,
+	           aligned_P_y = org.x*tfm_y.x + org.y*tfm_y.y + org.z*tfm_y.z + tfm_t.y,
+	           aligned_P_z = org.x*tfm_z.x + org.y*tfm_z.y + org.z*tfm_z.z + tfm_t.z;
 
 	const ssef neg_one(-1.0f, -1.0f, -1.0f, -1.0f);
 	const ssef nrdir_x = neg_one / aligned_dir_x,
@@ -287,30 +329,16 @@ ccl_device_inline int qbvh_unaligned_node_intersect_robust(
         const float difl,
         ssef *ccl_restrict dist)
 {
-	const int offset = node_addr;
-	const ssef tfm_x_x = kernel_tex_fetch_ssef(__bvh_nodes, offset+1);
-	const ssef tfm_x_y = kernel_tex_fetch_ssef(__bvh_nodes, offset+2);
-	const ssef tfm_x_z = kernel_tex_fetch_ssef(__bvh_nodes, offset+3);
-
-	const ssef tfm_y_x = kernel_tex_fetch_ssef(__bvh_nodes, offset+4);
-	const ssef tfm_y_y = kernel_tex_fetch_ssef(__bvh_nodes, offset+5);
-	const ssef tfm_y_z = kernel_tex_fetch_ssef(__bvh_nodes, offset+6);
-
-	const ssef tfm_z_x = kernel_tex_fetch_ssef(__bvh_nodes, offset+7);
-	const ssef tfm_z_y = kernel_tex_fetch_ssef(__bvh_nodes, offset+8);
-	const ssef tfm_z_z = kernel_tex_fetch_ssef(__bvh_nodes, offset+9);
-
-	const ssef tfm_t_x = kernel_tex_fetch_ssef(__bvh_nodes, offset+10);
-	const ssef tfm_t_y = kernel_tex_fetch_ssef(__bvh_nodes, offset+11);
-	const ssef tfm_t_z = kernel_tex_fetch_ssef(__bvh_nodes, offset+12);
+	sse3f tfm_x, tfm_y, tfm_z, tfm_t;
+	qbvh_unaligned_node_fetch_space(kg, node_addr, &tfm_x, &tfm_y, &tfm_z, &tfm_t);
 
-	const ssef aligned_dir_x = dir.x*tfm_x_x + dir.y*tfm_x_y + dir.z*tfm_x_z,
-	           aligned_dir_y = dir.x*tfm_y_x + dir.y*tfm_y_y + dir.z*tfm_y_z,
-	           aligned_dir_z = dir.x*tfm_z_x + dir.y*tfm_z_y + dir.z*tfm_z_z;
+	const ssef aligned_dir_x = dir.x*tfm_x.x + dir.y*tfm_x.y + dir.z*tfm_x.z,
+	           aligned_dir_y = dir.x*tfm_y.x + dir.y*tfm_y.y + dir.z*tfm_y.z,
+	           aligned_dir_z = dir.x*tfm_z.x + dir.y*tfm_z.y + dir.z*tfm_z.z;
 
-	const ssef aligned_P_x = P.x*tfm_x_x + P.y*tfm_x_y + P.z*tfm_x_z + tfm_t_x,
-	           aligned_P_y = P.x*tfm_y_x + P.y*tfm_y_y + P.z*tfm_y_z + tfm_t_y,
-	           aligned_P_z = P.x*tfm_z_x + P.y*tfm_z_y + P.z*tfm_z_z + tfm_t_z;
+	const ssef aligned_P_x = P.x*tfm_x.x + P.y*tfm_x.y + P.z*tfm_x.z + tfm_t.x,
+	           aligned_P_y = P.x*tfm_y.x + P.y*tfm_y.y + P.z*tfm_y.z + tfm_t.y,
+	           aligned_P_z = P.x*tfm_z.x + P.y*tfm_z.y + P.z*tfm_z.z + tfm_t.z;
 
 	const ssef neg_one(-1.0f, -1.0f, -1.0f, -1.0f);
 	const ssef nrdir_x = neg_one / aligned_dir_x,
@@ -0,0 +1,423 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Ray packet traversal of QBVH.
+ *
+ * Up to RAY_PACKET_SIZE coherent rays, such as camera rays of neighbor pixels
+ * or AO rays leaving the same shading point, are traversed together. Every
+ * child box of a node is tested against all rays of the packet at once, so
+ * the node data is only fetched once for the whole packet.
+ *
+ * Once only a single ray of the packet remains active in a subtree, packet
+ * traversal has no benefit anymore and that ray continues with a regular
+ * single ray traversal of the subtree. Instanced objects are traversed one
+ * ray at a time as well.
+ *
+ * Only triangles without motion blur are supported, other scenes should use
+ * regular traversal.
+ */
+
+struct QBVHPacketStackItem {
+	int addr;
+	int mask;
+	float dist;
+};
+
+#define QBVH_PACKET_POP() \
+	do { \
+		node_addr = traversal_stack[stack_ptr].addr; \
+		node_dist = traversal_stack[stack_ptr].dist; \
+		--stack_ptr; \
+	} while(0)
+
+/* Single ray traversal, starting at the given node instead of the root. */
+ccl_device bool qbvh_packet_ray_intersect(KernelGlobals *kg,
+                                          const Ray *ray,
+                                          int node_addr,
+                                          const uint visibility,
+                                          Intersection *isect)
+{
+	QBVHStackItem traversal_stack[BVH_QSTACK_SIZE];
+	traversal_stack[0].addr = ENTRYPOINT_SENTINEL;
+	traversal_stack[0].dist = -FLT_MAX;
+
+	int stack_ptr = 0;
+	float node_dist = -FLT_MAX;
+
+	float3 P = ray->P;
+	float3 dir = bvh_clamp_direction(ray->D);
+	float3 idir = bvh_inverse_direction(dir);
+	int object = OBJECT_NONE;
+	bool hit = false;
+
+	ssef tnear(0.0f), tfar(isect->t);
+	sse3f idir4(ssef(idir.x), ssef(idir.y), ssef(idir.z));
+#ifdef __KERNEL_AVX2__
+	float3 P_idir = P*idir;
+	sse3f P_idir4(ssef(P_idir.x), ssef(P_idir.y), ssef(P_idir.z));
+#else
+	sse3f org4(ssef(P.x), ssef(P.y), ssef(P.z));
+#endif
+
+	int near_x, near_y, near_z;
+	int far_x, far_y, far_z;
+	qbvh_near_far_idx_calc(idir,
+	                       &near_x, &near_y, &near_z,
+	                       &far_x, &far_y, &far_z);
+
+	for(;;) {
+		if(node_addr == ENTRYPOINT_SENTINEL) {
+			if(object == OBJECT_NONE) {
+				break;
+			}
+
+			/* Instance pop. */
+			isect->t = bvh_instance_pop(kg, object, ray, &P, &dir, &idir, isect->t);
+			object = OBJECT_NONE;
+		}
+		else if(node_dist > isect->t) {
+			QBVH_PACKET_POP();
+			continue;
+		}
+		else if(node_addr >= 0) {
+			/* Inner node. */
+			float4 inodes = kernel_tex_fetch(__bvh_nodes, node_addr+0);
+			(void)inodes;
+
+#ifdef __VISIBILITY_FLAG__
+			if((__float_as_uint(inodes.x) & visibility) == 0) {
+				QBVH_PACKET_POP();
+				continue;
+			}
+#endif
+
+			BVH_DEBUG_NEXT_NODE();
+
+			ssef dist;
+			int child_mask = qbvh_aligned_node_intersect(kg,
+			                                             tnear,
+			                                             tfar,
+#ifdef __KERNEL_AVX2__
+			                                             P_idir4,
+#else
+			                                             org4,
+#endif
+			                                             idir4,
+			                                             near_x, near_y, near_z,
+			                                             far_x, far_y, far_z,
+			                                             node_addr,
+			                                             &dist);
+
+			/* Push all hit children, closest one ends up on top. */
+			float4 cnodes = kernel_tex_fetch(__bvh_nodes, node_addr+7);
+			int num_children = 0;
+			while(child_mask != 0) {
+				int r = __bscf(child_mask);
+				++stack_ptr;
+				kernel_assert(stack_ptr < BVH_QSTACK_SIZE);
+				traversal_stack[stack_ptr].addr = __float_as_int(cnodes[r]);
+				traversal_stack[stack_ptr].dist = ((float*)&dist)[r];
+				num_children++;
+			}
+
+			if(num_children == 2) {
+				if(traversal_stack[stack_ptr - 1].dist < traversal_stack[stack_ptr].dist) {
+					qbvh_item_swap(&traversal_stack[stack_ptr],
+					               &traversal_stack[stack_ptr - 1]);
+				}
+			}
+			else if(num_children == 3) {
+				qbvh_stack_sort(&traversal_stack[stack_ptr],
+				                &traversal_stack[stack_ptr - 1],
+				                &traversal_stack[stack_ptr - 2]);
+			}
+			else if(num_children == 4) {
+				qbvh_stack_sort(&traversal_stack[stack_ptr],
+				                &traversal_stack[stack_ptr - 1],
+				                &traversal_stack[stack_ptr - 2],
+				                &traversal_stack[stack_ptr - 3]);
+			}
+
+			QBVH_PACKET_POP();
+			continue;
+		}
+		else {
+			/* Leaf node. */
+			float4 leaf = kernel_tex_fetch(__bvh_leaf_nodes, (-node_addr-1));
+			int prim_addr = __float_as_int(leaf.x);
+
+#ifdef __VISIBILITY_FLAG__
+			if((__float_as_uint(leaf.z) & visibility) == 0) {
+				QBVH_PACKET_POP();
+				continue;
+			}
+#endif
+
+			if(prim_addr >= 0) {
+				int prim_addr2 = __float_as_int(leaf.y);
+
+				QBVH_PACKET_POP();
+
+				for(; prim_addr < prim_addr2; prim_addr++) {
+					BVH_DEBUG_NEXT_INTERSECTION();
+					kernel_assert(kernel_tex_fetch(__prim_type, prim_addr) == PRIMITIVE_TRIANGLE);
+					if(triangle_intersect(kg,
+					                      isect,
+					                      P,
+					                      dir,
+					                      visibility,
+					                      object,
+					                      prim_addr))
+					{
+						tfar = ssef(isect->t);
+						hit = true;
+						/* Shadow ray early termination. */
+						if(visibility & PATH_RAY_SHADOW_OPAQUE) {
+							if(object != OBJECT_NONE) {
+								isect->t = bvh_instance_pop(kg, object, ray, &P, &dir, &idir, isect->t);
+							}
+							return true;
+						}
+					}
+				}
+				continue;
+			}
+
+			/* Instance push. */
+			object = kernel_tex_fetch(__prim_object, -prim_addr-1);
+			qbvh_instance_push(kg, object, ray, &P, &dir, &idir, &isect->t, &node_dist);
+
+			++stack_ptr;
+			kernel_assert(stack_ptr < BVH_QSTACK_SIZE);
+			traversal_stack[stack_ptr].addr = ENTRYPOINT_SENTINEL;
+			traversal_stack[stack_ptr].dist = -FLT_MAX;
+
+			node_addr = kernel_tex_fetch(__object_node, object);
+
+			BVH_DEBUG_NEXT_INSTANCE();
+		}
+
+		/* Ray changed space, update precomputed values. */
+		qbvh_near_far_idx_calc(idir,
+		                       &near_x, &near_y, &near_z,
+		                       &far_x, &far_y, &far_z);
+		tfar = ssef(isect->t);
+		idir4 = sse3f(ssef(idir.x), ssef(idir.y), ssef(idir.z));
+#ifdef __KERNEL_AVX2__
+		P_idir = P*idir;
+		P_idir4 = sse3f(ssef(P_idir.x), ssef(P_idir.y), ssef(P_idir.z));
+#else
+		org4 = sse3f(ssef(P.x), ssef(P.y), ssef(P.z));
+#endif
+
+		if(object == OBJECT_NONE) {
+			/* Continue after instance pop. */
+			QBVH_PACKET_POP();
+		}
+	}
+
+	return hit;
+}
+
+#undef QBVH_PACKET_POP
+
+/* Packet traversal. Rays after num_rays, with zero length or with invalid
+ * origin are ignored and reported as not hitting anything. */
+ccl_device void qbvh_intersect_packet(KernelGlobals *kg,
+                                      const Ray *rays,
+                                      Intersection *isects,
+                                      const int num_rays,
+                                      const uint visibility)
+{
+	kernel_assert(num_rays <= RAY_PACKET_SIZE);
+
+	float3 P[RAY_PACKET_SIZE];
+	float3 dir[RAY_PACKET_SIZE];
+	ssef org_x, org_y, org_z;
+	ssef idir_x, idir_y, idir_z;
+	ssef tfar;
+
+	/* Mask of rays which still need to be traversed. */
+	int active = 0;
+
+	for(int i = 0; i < RAY_PACKET_SIZE; i++) {
+		if(i < num_rays) {
+			Intersection *isect = &isects[i];
+			isect->t = rays[i].t;
+			isect->u = 0.0f;
+			isect->v = 0.0f;
+			isect->prim = PRIM_NONE;
+			isect->object = OBJECT_NONE;
+			BVH_DEBUG_INIT();
+
+			P[i] = rays[i].P;
+			dir[i] = bvh_clamp_direction(rays[i].D);
+			if(isfinite(P[i].x) && rays[i].t > 0.0f) {
+				active |= (1 << i);
+			}
+		}
+		else {
+			P[i] = make_float3(0.0f, 0.0f, 0.0f);
+			dir[i] = make_float3(1.0f, 1.0f, 1.0f);
+		}
+
+		const float3 idir = bvh_inverse_direction(dir[i]);
+		org_x[i] = P[i].x; org_y[i] = P[i].y; org_z[i] = P[i].z;
+		idir_x[i] = idir.x; idir_y[i] = idir.y; idir_z[i] = idir.z;
+		tfar[i] = (active & (1 << i)) ? isects[i].t : -FLT_MAX;
+	}
+
+	/* Rays may have different directions, so the near and far planes of
+	 * boxes are selected per ray. */
+	const sseb pos_x = idir_x >= ssef(0.0f);
+	const sseb pos_y = idir_y >= ssef(0.0f);
+	const sseb pos_z = idir_z >= ssef(0.0f);
+
+	QBVHPacketStackItem traversal_stack[BVH_QSTACK_SIZE];
+	traversal_stack[0].addr = ENTRYPOINT_SENTINEL;
+	traversal_stack[0].mask = 0;
+	traversal_stack[0].dist = -FLT_MAX;
+
+	int stack_ptr = 0;
+	int node_addr = kernel_data.bvh.root;
+	int node_mask = active;
+	float node_dist = -FLT_MAX;
+
+	while(node_addr != ENTRYPOINT_SENTINEL) {
+		/* Skip rays which terminated or found a closer hit since the node
+		 * was pushed. */
+		node_mask &= active & (int)movemask(ssef(node_dist) <= tfar);
+
+		if(node_mask == 0) {
+			/* Pop. */
+			node_addr = traversal_stack[stack_ptr].addr;
+			node_mask = traversal_stack[stack_ptr].mask;
+			node_dist = traversal_stack[stack_ptr].dist;
+			--stack_ptr;
+			continue;
+		}
+
+		if((node_mask & (node_mask - 1)) == 0 || node_addr < 0) {
+			/* Only one ray left in this subtree, or a leaf node: continue
+			 * traversal one ray at a time. */
+			int ray_mask = node_mask;
+			while(ray_mask != 0) {
+				int i = __bscf(ray_mask);
+				if(qbvh_packet_ray_intersect(kg, &rays[i], node_addr, visibility, &isects[i])) {
+					tfar[i] = isects[i].t;
+					/* Shadow ray early termination. */
+					if(visibility & PATH_RAY_SHADOW_OPAQUE) {
+						active &= ~(1 << i);
+					}
+				}
+			}
+
+			/* Pop. */
+			node_addr = traversal_stack[stack_ptr].addr;
+			node_mask = traversal_stack[stack_ptr].mask;
+			node_dist = traversal_stack[stack_ptr].dist;
+			--stack_ptr;
+			continue;
+		}
+
+		float4 inodes = kernel_tex_fetch(__bvh_nodes, node_addr+0);
+		(void)inodes;
+
+#ifdef __VISIBILITY_FLAG__
+		if((__float_as_uint(inodes.x) & visibility) == 0) {
+			/* Pop. */
+			node_addr = traversal_stack[stack_ptr].addr;
+			node_mask = traversal_stack[stack_ptr].mask;
+			node_dist = traversal_stack[stack_ptr].dist;
+			--stack_ptr;
+			continue;
+		}
+#endif
+
+		/* Bounds of all four children. */
+		const int offset = node_addr + 1;
+		const ssef min_x = kernel_tex_fetch_ssef(__bvh_nodes, offset+0);
+		const ssef max_x = kernel_tex_fetch_ssef(__bvh_nodes, offset+1);
+		const ssef min_y = kernel_tex_fetch_ssef(__bvh_nodes, offset+2);
+		const ssef max_y = kernel_tex_fetch_ssef(__bvh_nodes, offset+3);
+		const ssef min_z = kernel_tex_fetch_ssef(__bvh_nodes, offset+4);
+		const ssef max_z = kernel_tex_fetch_ssef(__bvh_nodes, offset+5);
+		float4 cnodes = kernel_tex_fetch(__bvh_nodes, node_addr+7);
+
+		/* Intersect every child with all rays of the packet. */
+		int child_addr[4], child_mask[4];
+		float child_dist[4];
+		int num_children = 0;
+
+		for(int c = 0; c < 4; c++) {
+			const ssef near_x = select(pos_x, ssef(min_x[c]), ssef(max_x[c]));
+			const ssef near_y = select(pos_y, ssef(min_y[c]), ssef(max_y[c]));
+			const ssef near_z = select(pos_z, ssef(min_z[c]), ssef(max_z[c]));
+			const ssef far_x = select(pos_x, ssef(max_x[c]), ssef(min_x[c]));
+			const ssef far_y = select(pos_y, ssef(max_y[c]), ssef(min_y[c]));
+			const ssef far_z = select(pos_z, ssef(max_z[c]), ssef(min_z[c]));
+
+			const ssef tnear = max4(ssef(0.0f),
+			                        (near_x - org_x) * idir_x,
+			                        (near_y - org_y) * idir_y,
+			                        (near_z - org_z) * idir_z);
+			const ssef tfar_c = min4(tfar,
+			                         (far_x - org_x) * idir_x,
+			                         (far_y - org_y) * idir_y,
+			                         (far_z - org_z) * idir_z);
+			const sseb hit = tnear <= tfar_c;
+			const int mask = (int)movemask(hit) & node_mask;
+
+			if(mask != 0) {
+				/* Insertion sort by the distance of the closest ray, so
+				 * children are visited front to back. */
+				const float dist = reduce_min(select(hit, tnear, ssef(FLT_MAX)));
+				int j = num_children++;
+				while(j > 0 && child_dist[j - 1] > dist) {
+					child_addr[j] = child_addr[j - 1];
+					child_mask[j] = child_mask[j - 1];
+					child_dist[j] = child_dist[j - 1];
+					j--;
+				}
+				child_addr[j] = __float_as_int(cnodes[c]);
+				child_mask[j] = mask;
+				child_dist[j] = dist;
+			}
+		}
+
+		if(num_children == 0) {
+			/* Pop. */
+			node_addr = traversal_stack[stack_ptr].addr;
+			node_mask = traversal_stack[stack_ptr].mask;
+			node_dist = traversal_stack[stack_ptr].dist;
+			--stack_ptr;
+			continue;
+		}
+
+		/* Push far children, continue with the closest one. */
+		for(int j = num_children - 1; j > 0; j--) {
+			++stack_ptr;
+			kernel_assert(stack_ptr < BVH_QSTACK_SIZE);
+			traversal_stack[stack_ptr].addr = child_addr[j];
+			traversal_stack[stack_ptr].mask = child_mask[j];
+			traversal_stack[stack_ptr].dist = child_dist[j];
+		}
+
+		node_addr = child_addr[0];
+		node_mask = child_mask[0];
+		node_dist = child_dist[0];
+	}
+}
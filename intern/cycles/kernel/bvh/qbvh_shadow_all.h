@@ -143,7 +143,7 @@ ccl_device bool BVH_FUNCTION_FULL_NAME(QBVH)(KernelGlobals *kg,
 					float4 cnodes;
 #if BVH_FEATURE(BVH_HAIR)
 					if(__float_as_uint(inodes.x) & PATH_RAY_NODE_UNALIGNED) {
-						cnodes = kernel_tex_fetch(__bvh_nodes, node_addr+13);
+						cnodes = kernel_tex_fetch(__bvh_nodes, node_addr+8);
 					}
 					else
 #endif
@@ -266,6 +266,10 @@ ccl_device bool BVH_FUNCTION_FULL_NAME(QBVH)(KernelGlobals *kg,
 					--stack_ptr;
 
 					/* Primitive intersection. */
+#if BVH_FEATURE(BVH_HAIR)
+					/* Segment of the compact curve primitive being intersected. */
+					int curve_segment = 0;
+#endif
 					while(prim_addr < prim_addr2) {
 						kernel_assert((kernel_tex_fetch(__prim_type, prim_addr) & PRIMITIVE_ALL) == p_type);
 						bool hit;
@@ -302,6 +306,7 @@ ccl_device bool BVH_FUNCTION_FULL_NAME(QBVH)(KernelGlobals *kg,
 							case PRIMITIVE_CURVE:
 							case PRIMITIVE_MOTION_CURVE: {
 								const uint curve_type = kernel_tex_fetch(__prim_type, prim_addr);
+								const uint segment_type = PRIMITIVE_SEGMENT(curve_type, curve_segment);
 								if(kernel_data.curve.curveflags & CURVE_KN_INTERPOLATE) {
 									hit = cardinal_curve_intersect(kg,
 									                               isect_array,
@@ -311,7 +316,7 @@ ccl_device bool BVH_FUNCTION_FULL_NAME(QBVH)(KernelGlobals *kg,
 									                               object,
 									                               prim_addr,
 									                               ray->time,
-									                               curve_type,
+									                               segment_type,
 									                               NULL,
 									                               0, 0);
 								}
@@ -324,10 +329,16 @@ ccl_device bool BVH_FUNCTION_FULL_NAME(QBVH)(KernelGlobals *kg,
 									                      object,
 									                      prim_addr,
 									                      ray->time,
-									                      curve_type,
+									                      segment_type,
 									                      NULL,
 									                      0, 0);
 								}
+								/* Stay on the primitive until all of its segments are
+								 * intersected, so every hit gets recorded.
+								 */
+								if(++curve_segment == (int)PRIMITIVE_UNPACK_NUM_SEGMENTS(curve_type)) {
+									curve_segment = 0;
+								}
 								break;
 							}
 #endif
@@ -379,7 +390,12 @@ ccl_device bool BVH_FUNCTION_FULL_NAME(QBVH)(KernelGlobals *kg,
 							isect_array->t = isect_t;
 						}
 
-						prim_addr++;
+#if BVH_FEATURE(BVH_HAIR)
+						if(curve_segment == 0)
+#endif
+						{
+							prim_addr++;
+						}
 					}
 				}
 #if BVH_FEATURE(BVH_INSTANCING)
@@ -192,7 +192,7 @@ ccl_device bool BVH_FUNCTION_FULL_NAME(QBVH)(KernelGlobals *kg,
 					 */
 #if BVH_FEATURE(BVH_HAIR)
 					if(__float_as_uint(inodes.x) & PATH_RAY_NODE_UNALIGNED) {
-						cnodes = kernel_tex_fetch(__bvh_nodes, node_addr+13);
+						cnodes = kernel_tex_fetch(__bvh_nodes, node_addr+8);
 					}
 					else
 #endif
@@ -377,40 +377,45 @@ ccl_device bool BVH_FUNCTION_FULL_NAME(QBVH)(KernelGlobals *kg,
 								BVH_DEBUG_NEXT_INTERSECTION();
 								const uint curve_type = kernel_tex_fetch(__prim_type, prim_addr);
 								kernel_assert((curve_type & PRIMITIVE_ALL) == (type & PRIMITIVE_ALL));
-								bool hit;
-								if(kernel_data.curve.curveflags & CURVE_KN_INTERPOLATE) {
-									hit = cardinal_curve_intersect(kg,
-									                               isect,
-									                               P,
-									                               dir,
-									                               visibility,
-									                               object,
-									                               prim_addr,
-									                               ray->time,
-									                               curve_type,
-									                               lcg_state,
-									                               difl,
-									                               extmax);
-								}
-								else {
-									hit = curve_intersect(kg,
-									                      isect,
-									                      P,
-									                      dir,
-									                      visibility,
-									                      object,
-									                      prim_addr,
-									                      ray->time,
-									                      curve_type,
-									                      lcg_state,
-									                      difl,
-									                      extmax);
-								}
-								if(hit) {
-									tfar = ssef(isect->t);
-									/* Shadow ray early termination. */
-									if(visibility & PATH_RAY_SHADOW_OPAQUE) {
-										return true;
+								/* Compact primitives cover several segments of a curve. */
+								const int num_segments = PRIMITIVE_UNPACK_NUM_SEGMENTS(curve_type);
+								for(int segment = 0; segment < num_segments; segment++) {
+									const uint segment_type = PRIMITIVE_SEGMENT(curve_type, segment);
+									bool hit;
+									if(kernel_data.curve.curveflags & CURVE_KN_INTERPOLATE) {
+										hit = cardinal_curve_intersect(kg,
+										                               isect,
+										                               P,
+										                               dir,
+										                               visibility,
+										                               object,
+										                               prim_addr,
+										                               ray->time,
+										                               segment_type,
+										                               lcg_state,
+										                               difl,
+										                               extmax);
+									}
+									else {
+										hit = curve_intersect(kg,
+										                      isect,
+										                      P,
+										                      dir,
+										                      visibility,
+										                      object,
+										                      prim_addr,
+										                      ray->time,
+										                      segment_type,
+										                      lcg_state,
+										                      difl,
+										                      extmax);
+									}
+									if(hit) {
+										tfar = ssef(isect->t);
+										/* Shadow ray early termination. */
+										if(visibility & PATH_RAY_SHADOW_OPAQUE) {
+											return true;
+										}
 									}
 								}
 							}
@@ -16,6 +16,43 @@
 
 CCL_NAMESPACE_BEGIN
 
+/* The horizontal box filters below use a running sum over the row, so their
+ * cost does not depend on the filter radius f. The sum is kept in double
+ * precision, differences can span many orders of magnitude and removing a
+ * large value from a float sum would lose the small ones. */
+
+/* Sum over the window of pixel x-1, clipped to rect, so that
+ * kernel_filter_nlm_window_step() can advance it to pixel x. */
+ccl_device_inline double kernel_filter_nlm_window_init(const float *ccl_restrict row,
+                                                       int x,
+                                                       int4 rect,
+                                                       int f)
+{
+	double sum = 0.0;
+	for(int x1 = max(rect.x, x-f-1); x1 < min(rect.z, x+f); x1++) {
+		sum += (double)row[x1];
+	}
+	return sum;
+}
+
+/* Advance the running sum to pixel x and return the average over its window. */
+ccl_device_inline float kernel_filter_nlm_window_step(const float *ccl_restrict row,
+                                                      int x,
+                                                      int4 rect,
+                                                      int f,
+                                                      double *sum)
+{
+	if(x+f < rect.z) {
+		*sum += (double)row[x+f];
+	}
+	if(x-f-1 >= rect.x) {
+		*sum -= (double)row[x-f-1];
+	}
+	const int low = max(rect.x, x-f);
+	const int high = min(rect.z, x+f+1);
+	return (float)(*sum * (1.0/(high - low)));
+}
+
 ccl_device_inline void kernel_filter_nlm_calc_difference(int dx, int dy,
                                                          const float *ccl_restrict weight_image,
                                                          const float *ccl_restrict variance_image,
@@ -26,10 +63,30 @@ ccl_device_inline void kernel_filter_nlm_calc_difference(int dx, int dy,
                                                          float a,
                                                          float k_2)
 {
+	const int numChannels = channel_offset? 3 : 1;
+
 	for(int y = rect.y; y < rect.w; y++) {
-		for(int x = rect.x; x < rect.z; x++) {
+		int x = rect.x;
+#ifdef __KERNEL_SSE__
+		/* Four pixels at a time, the remainder is handled below. */
+		for(; x + 4 <= rect.z; x += 4) {
+			float4 diff = make_float4(0.0f);
+			for(int c = 0; c < numChannels; c++) {
+				const int p_ofs = c*channel_offset + y*stride + x;
+				const int q_ofs = c*channel_offset + (y+dy)*stride + (x+dx);
+				float4 cdiff = load_float4(weight_image + p_ofs) - load_float4(weight_image + q_ofs);
+				float4 pvar = load_float4(variance_image + p_ofs);
+				float4 qvar = load_float4(variance_image + q_ofs);
+				diff += (cdiff*cdiff - a*(pvar + min(pvar, qvar))) / (make_float4(1e-8f) + k_2*(pvar+qvar));
+			}
+			if(numChannels > 1) {
+				diff = diff * (1.0f/numChannels);
+			}
+			_mm_storeu_ps(difference_image + y*stride + x, diff.m128);
+		}
+#endif
+		for(; x < rect.z; x++) {
 			float diff = 0.0f;
-			int numChannels = channel_offset? 3 : 1;
 			for(int c = 0; c < numChannels; c++) {
 				float cdiff = weight_image[c*channel_offset + y*stride + x] - weight_image[c*channel_offset + (y+dy)*stride + (x+dx)];
 				float pvar = variance_image[c*channel_offset + y*stride + x];
@@ -78,24 +135,11 @@ ccl_device_inline void kernel_filter_nlm_calc_weight(const float *ccl_restrict d
                                                      int f)
 {
 	for(int y = rect.y; y < rect.w; y++) {
+		const float *ccl_restrict row = difference_image + y*stride;
+		double sum = kernel_filter_nlm_window_init(row, rect.x, rect, f);
 		for(int x = rect.x; x < rect.z; x++) {
-			out_image[y*stride + x] = 0.0f;
-		}
-	}
-	for(int dx = -f; dx <= f; dx++) {
-		int pos_dx = max(0, dx);
-		int neg_dx = min(0, dx);
-		for(int y = rect.y; y < rect.w; y++) {
-			for(int x = rect.x-neg_dx; x < rect.z-pos_dx; x++) {
-				out_image[y*stride + x] += difference_image[y*stride + x+dx];
-			}
-		}
-	}
-	for(int y = rect.y; y < rect.w; y++) {
-		for(int x = rect.x; x < rect.z; x++) {
-			const int low = max(rect.x, x-f);
-			const int high = min(rect.z, x+f+1);
-			out_image[y*stride + x] = fast_expf(-max(out_image[y*stride + x] * (1.0f/(high - low)), 0.0f));
+			const float avg = kernel_filter_nlm_window_step(row, x, rect, f, &sum);
+			out_image[y*stride + x] = fast_expf(-max(avg, 0.0f));
 		}
 	}
 }
@@ -110,14 +154,10 @@ ccl_device_inline void kernel_filter_nlm_update_output(int dx, int dy,
                                                        int f)
 {
 	for(int y = rect.y; y < rect.w; y++) {
+		const float *ccl_restrict row = difference_image + y*stride;
+		double sum = kernel_filter_nlm_window_init(row, rect.x, rect, f);
 		for(int x = rect.x; x < rect.z; x++) {
-			const int low = max(rect.x, x-f);
-			const int high = min(rect.z, x+f+1);
-			float sum = 0.0f;
-			for(int x1 = low; x1 < high; x1++) {
-				sum += difference_image[y*stride + x1];
-			}
-			float weight = sum * (1.0f/(high - low));
+			float weight = kernel_filter_nlm_window_step(row, x, rect, f, &sum);
 			accum_image[y*stride + x] += weight;
 			out_image[y*stride + x] += weight*image[(y+dy)*stride + (x+dx)];
 		}
@@ -139,14 +179,10 @@ ccl_device_inline void kernel_filter_nlm_construct_gramian(int dx, int dy,
 	int4 clip_area = rect_clip(rect, filter_window);
 	/* fy and fy are in filter-window-relative coordinates, while x and y are in feature-window-relative coordinates. */
 	for(int y = clip_area.y; y < clip_area.w; y++) {
+		const float *ccl_restrict row = difference_image + y*stride;
+		double sum = kernel_filter_nlm_window_init(row, clip_area.x, rect, f);
 		for(int x = clip_area.x; x < clip_area.z; x++) {
-			const int low = max(rect.x, x-f);
-			const int high = min(rect.z, x+f+1);
-			float sum = 0.0f;
-			for(int x1 = low; x1 < high; x1++) {
-				sum += difference_image[y*stride + x1];
-			}
-			float weight = sum * (1.0f/(high - low));
+			float weight = kernel_filter_nlm_window_step(row, x, rect, f, &sum);
 
 			int storage_ofs = coord_to_local_index(filter_window, x, y);
 			float  *l_transform = transform + storage_ofs*TRANSFORM_SIZE;
@@ -43,6 +43,9 @@ void kernel_tex_copy(KernelGlobals *kg,
                      void *mem,
                      size_t size);
 
+void kernel_tex_image_cache_thread_init(KernelGlobals *kg);
+void kernel_tex_image_cache_thread_free(KernelGlobals *kg);
+
 #define KERNEL_ARCH cpu
 #include "kernel/kernels/cpu/kernel_cpu.h"
 
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KERNEL_ADAPTIVE_SAMPLING_H__
+#define __KERNEL_ADAPTIVE_SAMPLING_H__
+
+CCL_NAMESPACE_BEGIN
+
+/* Adaptive Sampling
+ *
+ * Next to the combined pass, the sum of every second sample is accumulated in
+ * the auxiliary buffer. Comparing both estimates gives a per-pixel error, and
+ * pixels whose error falls below the threshold are not sampled anymore.
+ *
+ * The fourth component of the auxiliary buffer is zero while the pixel is
+ * still being sampled. Once it converged, it holds the number of samples its
+ * passes currently represent, which is used to scale the passes up so they
+ * match the sample count of the rest of the tile. */
+
+ccl_device_inline ccl_global float *kernel_adaptive_aux_buffer(KernelGlobals *kg,
+                                                               ccl_global float *buffer)
+{
+	return buffer + kernel_data.film.pass_adaptive_aux_buffer;
+}
+
+/* Whether the pixel has converged and no more samples are needed. */
+ccl_device_inline bool kernel_adaptive_pixel_converged(KernelGlobals *kg,
+                                                       ccl_global float *buffer)
+{
+	return kernel_data.integrator.use_adaptive_sampling &&
+	       kernel_adaptive_aux_buffer(kg, buffer)[3] != 0.0f;
+}
+
+/* Accumulate the half estimate for a new sample, stored with double weight
+ * so it can be compared to the full estimate directly. */
+ccl_device_inline void kernel_adaptive_write_sample(KernelGlobals *kg,
+                                                    ccl_global float *buffer,
+                                                    int sample,
+                                                    float3 L_sum)
+{
+	if(sample & 1) {
+		ccl_global float *aux = kernel_adaptive_aux_buffer(kg, buffer);
+		aux[0] += 2.0f*L_sum.x;
+		aux[1] += 2.0f*L_sum.y;
+		aux[2] += 2.0f*L_sum.z;
+	}
+}
+
+/* Whether convergence should be tested after the given number of samples. */
+ccl_device_inline bool kernel_adaptive_should_test(KernelGlobals *kg, int num_samples)
+{
+	return num_samples >= kernel_data.integrator.adaptive_min_samples &&
+	       (num_samples % kernel_data.integrator.adaptive_step) == 0;
+}
+
+/* Test whether a pixel converged after num_samples samples, using the error
+ * metric of "A Hierarchical Automatic Stopping Condition for Monte Carlo
+ * Global Illumination" by Dammertz et al. */
+ccl_device void kernel_adaptive_stopping(KernelGlobals *kg,
+                                         ccl_global float *buffer,
+                                         int num_samples)
+{
+	ccl_global float *aux = kernel_adaptive_aux_buffer(kg, buffer);
+	if(aux[3] != 0.0f) {
+		return;
+	}
+
+	const float3 I = make_float3(buffer[0], buffer[1], buffer[2]);
+	const float3 A = make_float3(aux[0], aux[1], aux[2]);
+	const float inv_samples = 1.0f/num_samples;
+
+	/* Small epsilon avoids division by zero for black pixels. */
+	const float difference = (fabsf(I.x - A.x) + fabsf(I.y - A.y) + fabsf(I.z - A.z))*inv_samples;
+	const float error = difference / (1e-4f + sqrtf(max(I.x + I.y + I.z, 0.0f)*inv_samples));
+
+	if(error < kernel_data.integrator.adaptive_threshold) {
+		aux[3] = (float)num_samples;
+	}
+}
+
+/* Pixels next to ones which are still sampled keep sampling as well, which
+ * avoids visible borders between converged and unconverged regions. Only
+ * pixels which converged in the latest test are reset, earlier converged
+ * pixels have missed samples already. Returns true if any of the pixels is
+ * still being sampled. */
+ccl_device bool kernel_adaptive_filter(KernelGlobals *kg,
+                                       ccl_global float *buffer,
+                                       int num_pixels,
+                                       int pixel_stride,
+                                       int num_samples)
+{
+	const int pass_stride = kernel_data.film.pass_stride;
+	bool any = false;
+	bool prev = false;
+
+	for(int i = 0; i < num_pixels; i++) {
+		ccl_global float *aux = kernel_adaptive_aux_buffer(kg, buffer + i*pixel_stride*pass_stride);
+
+		if(aux[3] == 0.0f) {
+			any = true;
+			if(i > 0) {
+				ccl_global float *prev_aux = aux - pixel_stride*pass_stride;
+				if(prev_aux[3] == (float)num_samples) {
+					prev_aux[3] = 0.0f;
+				}
+			}
+			prev = true;
+		}
+		else {
+			if(prev && aux[3] == (float)num_samples) {
+				aux[3] = 0.0f;
+			}
+			prev = false;
+		}
+	}
+
+	return any;
+}
+
+/* Scale passes of a converged pixel so they represent num_samples samples,
+ * like the pixels which were sampled all the way. */
+ccl_device void kernel_adaptive_adjust_samples(KernelGlobals *kg,
+                                               ccl_global float *buffer,
+                                               int num_samples)
+{
+	ccl_global float *aux = kernel_adaptive_aux_buffer(kg, buffer);
+	const float pixel_samples = aux[3];
+
+	if(pixel_samples == 0.0f || pixel_samples >= (float)num_samples) {
+		return;
+	}
+
+	const float scale = (float)num_samples / pixel_samples;
+	const int pass_stride = kernel_data.film.pass_stride;
+	const int pass_flag = kernel_data.film.pass_flag;
+
+	for(int i = 0; i < pass_stride; i++) {
+		/* Passes which are written once instead of being accumulated. */
+		if(((pass_flag & PASSMASK(DEPTH)) && i == kernel_data.film.pass_depth) ||
+		   ((pass_flag & PASSMASK(OBJECT_ID)) && i == kernel_data.film.pass_object_id) ||
+		   ((pass_flag & PASSMASK(MATERIAL_ID)) && i == kernel_data.film.pass_material_id))
+		{
+			continue;
+		}
+		/* Adaptive sampling state itself. */
+		if((i >= kernel_data.film.pass_adaptive_aux_buffer &&
+		    i < kernel_data.film.pass_adaptive_aux_buffer + 4) ||
+		   (kernel_data.film.pass_sample_count && i == kernel_data.film.pass_sample_count))
+		{
+			continue;
+		}
+
+		buffer[i] *= scale;
+	}
+
+	aux[3] = (float)num_samples;
+}
+
+CCL_NAMESPACE_END
+
+#endif  /* __KERNEL_ADAPTIVE_SAMPLING_H__ */
@@ -40,6 +40,7 @@
 #include "util/util_half.h"
 #include "util/util_types.h"
 #include "util/util_texture.h"
+#include "util/util_texture_compression.h"
 
 #define ccl_addr_space
 
@@ -212,6 +212,9 @@ ccl_device_noinline float3 indirect_primitive_emission(KernelGlobals *kg, Shader
 		/* multiple importance sampling, get triangle light pdf,
 		 * and compute weight with respect to BSDF pdf */
 		float pdf = triangle_light_pdf(kg, sd, t);
+		if(kernel_data.integrator.use_light_tree) {
+			pdf *= light_tree_triangle_pdf(kg, sd->object, sd->prim, sd->P + sd->I*t);
+		}
 		float mis_weight = power_heuristic(bsdf_pdf, pdf);
 
 		return L*mis_weight;
@@ -273,6 +276,9 @@ ccl_device_noinline bool indirect_lamp_emission(KernelGlobals *kg,
 		if(!(state->flag & PATH_RAY_MIS_SKIP)) {
 			/* multiple importance sampling, get regular light pdf,
 			 * and compute weight with respect to BSDF pdf */
+			if(kernel_data.integrator.use_light_tree) {
+				ls.pdf *= light_tree_lamp_pdf(kg, lamp, ray->P);
+			}
 			float mis_weight = power_heuristic(state->ray_pdf, ls.pdf);
 			L *= mis_weight;
 		}
@@ -325,6 +331,9 @@ ccl_device_noinline float3 indirect_background(KernelGlobals *kg,
 		/* multiple importance sampling, get background light pdf for ray
 		 * direction, and compute weight with respect to BSDF pdf */
 		float pdf = background_light_pdf(kg, ray->P, ray->D);
+		if(kernel_data.integrator.use_light_tree) {
+			pdf *= light_tree_infinite_pdf(kg);
+		}
 		float mis_weight = power_heuristic(state->ray_pdf, pdf);
 
 		return L*mis_weight;
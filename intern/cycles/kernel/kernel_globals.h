@@ -19,6 +19,8 @@
 #ifndef __KERNEL_GLOBALS_H__
 #define __KERNEL_GLOBALS_H__
 
+#include "kernel/kernel_profiling.h"
+
 #ifdef __KERNEL_CPU__
 #  include "util/util_vector.h"
 #endif
@@ -43,6 +45,8 @@ struct OSLShadingSystem;
 #  endif
 
 struct Intersection;
+struct OIIOGlobals;
+struct OIIOThreadData;
 struct VolumeStep;
 
 typedef struct KernelGlobals {
@@ -59,6 +63,10 @@ typedef struct KernelGlobals {
 	OSLThreadData *osl_tdata;
 #  endif
 
+	/* Image texture cache, NULL when all images are in device memory. */
+	OIIOGlobals *oiio;
+	OIIOThreadData *oiio_tdata;
+
 	/* **** Run-time data ****  */
 
 	/* Heap-allocated storage for transparent shadows intersections. */
@@ -74,6 +82,8 @@ typedef struct KernelGlobals {
 
 	int2 global_size;
 	int2 global_id;
+
+	ProfilingState profiler;
 } KernelGlobals;
 
 #endif  /* __KERNEL_CPU__ */
@@ -225,5 +225,36 @@ ccl_device void cmj_sample_2D(int s, int N, int p, float *fx, float *fy)
 }
 #endif
 
+/* Progressive multi-jitter, from a lookup table of (0,2) sequences generated
+ * on the host. Table values are floats in [1, 2), xor'ing their mantissa with
+ * a per pixel hash scrambles the pattern while keeping its stratification. */
+
+ccl_device float pmj_sample_1D(KernelGlobals *kg, int sample, uint rng_hash, int dimension)
+{
+	/* Fall back to random beyond the table size. */
+	if(sample >= NUM_PMJ_SAMPLES) {
+		return cmj_randfloat(sample, rng_hash + dimension);
+	}
+
+	uint tmp_rng = cmj_hash_simple(dimension, rng_hash);
+	int index = ((dimension % NUM_PMJ_PATTERNS) * NUM_PMJ_SAMPLES + sample) * 2;
+	return __uint_as_float(kernel_tex_fetch(__sample_pattern_lut, index) ^ (tmp_rng & 0x007fffff)) - 1.0f;
+}
+
+ccl_device void pmj_sample_2D(KernelGlobals *kg, int sample, uint rng_hash, int dimension, float *fx, float *fy)
+{
+	if(sample >= NUM_PMJ_SAMPLES) {
+		*fx = cmj_randfloat(sample, rng_hash + dimension);
+		*fy = cmj_randfloat(sample, rng_hash + dimension + 1);
+		return;
+	}
+
+	uint tmp_rng = cmj_hash_simple(dimension, rng_hash);
+	int index = ((dimension % NUM_PMJ_PATTERNS) * NUM_PMJ_SAMPLES + sample) * 2;
+	*fx = __uint_as_float(kernel_tex_fetch(__sample_pattern_lut, index) ^ (tmp_rng & 0x007fffff)) - 1.0f;
+	tmp_rng = cmj_hash_simple(dimension + 1, rng_hash);
+	*fy = __uint_as_float(kernel_tex_fetch(__sample_pattern_lut, index + 1) ^ (tmp_rng & 0x007fffff)) - 1.0f;
+}
+
 CCL_NAMESPACE_END
 
@@ -1087,7 +1087,15 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
                                       LightSample *ls)
 {
 	/* sample index */
-	int index = light_distribution_sample(kg, &randu);
+	int index;
+	float pdf_select = 1.0f;
+
+	if(kernel_data.integrator.use_light_tree) {
+		index = light_tree_select(kg, P, &randu, &pdf_select);
+	}
+	else {
+		index = light_distribution_sample(kg, &randu);
+	}
 
 	/* fetch light data */
 	const ccl_global KernelLightDistribution *kdistribution = &kernel_tex_fetch(__light_distribution, index);
@@ -1099,6 +1107,13 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
 
 		triangle_light_sample(kg, prim, object, randu, randv, time, ls, P);
 		ls->shader |= shader_flag;
+
+		if(kernel_data.integrator.use_light_tree) {
+			/* Triangle pdf is per unit area when using the light tree. */
+			const uint leaf = kernel_tex_fetch(__light_tree_leaf, index);
+			ls->pdf *= pdf_select/kernel_tex_fetch(__light_tree_nodes, leaf).area;
+		}
+
 		return (ls->pdf > 0.0f);
 	}
 	else {
@@ -1108,7 +1123,12 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
 			return false;
 		}
 
-		return lamp_light_sample(kg, lamp, randu, randv, P, ls);
+		if(!lamp_light_sample(kg, lamp, randu, randv, P, ls)) {
+			return false;
+		}
+
+		ls->pdf *= pdf_select;
+		return (ls->pdf > 0.0f);
 	}
 }
 
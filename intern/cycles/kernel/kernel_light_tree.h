@@ -0,0 +1,219 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KERNEL_LIGHT_TREE_H__
+#define __KERNEL_LIGHT_TREE_H__
+
+CCL_NAMESPACE_BEGIN
+
+/* Light Tree
+ *
+ * Local emitters are stored in a binary tree built on the host, see
+ * render/light_tree.cpp. An emitter is selected by descending from the root,
+ * choosing children proportional to an importance estimated from their
+ * energy, bounds and emission cone relative to the shading point. Distant
+ * and background lights are stored as separate leaves after the tree, and
+ * are selected uniformly with a fixed probability. */
+
+ccl_device float light_tree_node_importance(KernelGlobals *kg, int index, float3 P)
+{
+	const ccl_global KernelLightTreeNode *knode = &kernel_tex_fetch(__light_tree_nodes, index);
+
+	if(knode->energy == 0.0f) {
+		return 0.0f;
+	}
+
+	const float3 bbox_min = make_float3(knode->bbox_min[0], knode->bbox_min[1], knode->bbox_min[2]);
+	const float3 bbox_max = make_float3(knode->bbox_max[0], knode->bbox_max[1], knode->bbox_max[2]);
+	const float3 centroid = 0.5f*(bbox_min + bbox_max);
+	const float radius_sq = 0.25f*len_squared(bbox_max - bbox_min);
+
+	float dist_sq = len_squared(P - centroid);
+	float cos_theta_prime = 1.0f;
+
+	if(dist_sq > radius_sq) {
+		/* Smallest angle between the emission cone and the direction to P,
+		 * taking into account all points of the bounding sphere. */
+		const float3 axis = make_float3(knode->axis[0], knode->axis[1], knode->axis[2]);
+		float cos_theta = dot(axis, (P - centroid)/sqrtf(dist_sq));
+		if(knode->flag & LIGHT_TREE_NODE_TWO_SIDED) {
+			cos_theta = fabsf(cos_theta);
+		}
+
+		const float theta = safe_acosf(cos_theta);
+		const float theta_u = safe_asinf(sqrtf(radius_sq/dist_sq));
+		const float theta_prime = max(theta - knode->theta_o - theta_u, 0.0f);
+
+		if(theta_prime >= knode->theta_e) {
+			return 0.0f;
+		}
+
+		cos_theta_prime = cosf(theta_prime);
+	}
+
+	/* Clamp distance for shading points inside the bounds. */
+	dist_sq = max(dist_sq, max(radius_sq, 1e-8f));
+
+	return knode->energy*cos_theta_prime/dist_sq;
+}
+
+/* Probability of descending into the left child of an inner node. */
+ccl_device float light_tree_left_probability(KernelGlobals *kg, int index, float3 P)
+{
+	const int right = kernel_tex_fetch(__light_tree_nodes, index).child;
+	const float importance_left = light_tree_node_importance(kg, index + 1, P);
+	const float importance_right = light_tree_node_importance(kg, right, P);
+	const float importance = importance_left + importance_right;
+
+	return (importance > 0.0f) ? importance_left/importance : 0.5f;
+}
+
+/* Descend the tree to a leaf, rescaling randu so it can be reused. */
+ccl_device int light_tree_sample(KernelGlobals *kg, float3 P, float *randu, float *pdf)
+{
+	int index = 0;
+	*pdf = 1.0f;
+
+	while(!(kernel_tex_fetch(__light_tree_nodes, index).flag & LIGHT_TREE_NODE_LEAF)) {
+		const float p_left = light_tree_left_probability(kg, index, P);
+
+		if(*randu < p_left) {
+			*randu = *randu/p_left;
+			*pdf *= p_left;
+			index = index + 1;
+		}
+		else {
+			*randu = (*randu - p_left)/(1.0f - p_left);
+			*pdf *= 1.0f - p_left;
+			index = kernel_tex_fetch(__light_tree_nodes, index).child;
+		}
+	}
+
+	return index;
+}
+
+/* Probability of light_tree_sample selecting the given leaf. */
+ccl_device float light_tree_leaf_pdf(KernelGlobals *kg, int index, float3 P)
+{
+	float pdf = 1.0f;
+	int parent = kernel_tex_fetch(__light_tree_nodes, index).parent;
+
+	while(parent != -1) {
+		const float p_left = light_tree_left_probability(kg, parent, P);
+		pdf *= (index == parent + 1) ? p_left : 1.0f - p_left;
+
+		index = parent;
+		parent = kernel_tex_fetch(__light_tree_nodes, index).parent;
+	}
+
+	return pdf;
+}
+
+/* Select an emitter for shading point P, returns its index in the light
+ * distribution along with the probability of selecting it. */
+ccl_device int light_tree_select(KernelGlobals *kg, float3 P, float *randu, float *pdf)
+{
+	const float pdf_tree = kernel_data.integrator.light_tree_pdf;
+
+	if(*randu < pdf_tree) {
+		*randu = *randu/pdf_tree;
+
+		float pdf_leaf;
+		const int index = light_tree_sample(kg, P, randu, &pdf_leaf);
+		*pdf = pdf_tree*pdf_leaf;
+
+		return kernel_tex_fetch(__light_tree_nodes, index).child;
+	}
+
+	const int num_infinite = kernel_data.integrator.num_infinite_lights;
+	const float r = (*randu - pdf_tree)/(1.0f - pdf_tree)*num_infinite;
+	const int i = clamp((int)r, 0, num_infinite - 1);
+
+	*randu = r - i;
+	*pdf = (1.0f - pdf_tree)/num_infinite;
+
+	return kernel_tex_fetch(__light_tree_nodes, kernel_data.integrator.light_tree_infinite_offset + i).child;
+}
+
+/* Probability of light_tree_select choosing an infinite light. */
+ccl_device_inline float light_tree_infinite_pdf(KernelGlobals *kg)
+{
+	return (1.0f - kernel_data.integrator.light_tree_pdf)/kernel_data.integrator.num_infinite_lights;
+}
+
+/* Probability of light_tree_select choosing the given distribution entry. */
+ccl_device float light_tree_distribution_pdf(KernelGlobals *kg, int distribution_index, float3 P)
+{
+	const uint index = kernel_tex_fetch(__light_tree_leaf, distribution_index);
+
+	if(index == ~0u) {
+		/* Degenerate emitter, never selected. */
+		return 0.0f;
+	}
+	else if((int)index >= kernel_data.integrator.light_tree_infinite_offset) {
+		return light_tree_infinite_pdf(kg);
+	}
+
+	return kernel_data.integrator.light_tree_pdf*light_tree_leaf_pdf(kg, index, P);
+}
+
+ccl_device float light_tree_lamp_pdf(KernelGlobals *kg, int lamp, float3 P)
+{
+	const int offset = kernel_data.integrator.num_distribution - kernel_data.integrator.num_all_lights;
+	return light_tree_distribution_pdf(kg, offset + lamp, P);
+}
+
+/* Probability of selecting an emissive triangle, divided by its area so it
+ * can be used in place of pdf_triangles. */
+ccl_device float light_tree_triangle_pdf(KernelGlobals *kg, int object, int prim, float3 P)
+{
+	/* Emissive triangles of an object are stored in order in the
+	 * distribution, find the one with the given primitive. */
+	const uint2 range = kernel_tex_fetch(__light_tree_object_range, object);
+	int first = range.x;
+	int len = range.y;
+
+	while(len > 0) {
+		const int half_len = len >> 1;
+		const int middle = first + half_len;
+
+		if(kernel_tex_fetch(__light_distribution, middle).prim < prim) {
+			first = middle + 1;
+			len = len - half_len - 1;
+		}
+		else {
+			len = half_len;
+		}
+	}
+
+	if(first >= (int)(range.x + range.y) ||
+	   kernel_tex_fetch(__light_distribution, first).prim != prim)
+	{
+		return 0.0f;
+	}
+
+	const uint index = kernel_tex_fetch(__light_tree_leaf, first);
+	if(index == ~0u) {
+		return 0.0f;
+	}
+
+	const float area = kernel_tex_fetch(__light_tree_nodes, index).area;
+	return kernel_data.integrator.light_tree_pdf*light_tree_leaf_pdf(kg, index, P)/area;
+}
+
+CCL_NAMESPACE_END
+
+#endif  /* __KERNEL_LIGHT_TREE_H__ */
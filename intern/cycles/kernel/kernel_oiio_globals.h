@@ -0,0 +1,80 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KERNEL_OIIO_GLOBALS_H__
+#define __KERNEL_OIIO_GLOBALS_H__
+
+#include <OpenImageIO/texture.h>
+
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Image texture cache for the CPU device.
+ *
+ * Images which are handled by the cache are not loaded into memory by the
+ * ImageManager. Instead the kernel looks them up through OIIO's texture
+ * system, which reads tiles of MIP levels on demand and evicts the least
+ * recently used ones once the cache exceeds its memory budget. */
+
+struct OIIOTexture {
+	OIIOTexture()
+	: handle(NULL),
+	  interpolation(OIIO::TextureOpt::InterpBilinear),
+	  extension(OIIO::TextureOpt::WrapPeriodic),
+	  use_alpha(true),
+	  is_cmyk(false)
+	{
+	}
+
+	OIIO::TextureSystem::TextureHandle *handle;
+	OIIO::TextureOpt::InterpMode interpolation;
+	OIIO::TextureOpt::Wrap extension;
+	/* Images without alpha are looked up in tex_sys_unassociated. */
+	bool use_alpha;
+	/* CMYK JPEG, converted to RGB after the lookup. */
+	bool is_cmyk;
+};
+
+struct OIIOGlobals {
+	OIIOGlobals()
+	{
+		tex_sys = NULL;
+		tex_sys_unassociated = NULL;
+	}
+
+	/* Same as when loading images into memory, colors are associated with
+	 * alpha, except for images which don't use alpha: those keep the colors
+	 * as stored in the file. The alpha mode is a setting of the whole cache,
+	 * so these images have their own texture system. */
+	OIIO::TextureSystem *tex_sys;
+	OIIO::TextureSystem *tex_sys_unassociated;
+
+	/* Indexed by flattened image slot, NULL handle for slots which are
+	 * stored in regular device memory. */
+	vector<OIIOTexture> textures;
+};
+
+/* Per render thread state of the texture systems, so lookups don't have to
+ * find it in thread local storage every time. */
+struct OIIOThreadData {
+	OIIO::TextureSystem::Perthread *thread_info;
+	OIIO::TextureSystem::Perthread *thread_info_unassociated;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __KERNEL_OIIO_GLOBALS_H__ */
@@ -337,6 +337,8 @@ ccl_device_inline void kernel_write_result(KernelGlobals *kg,
                                            int sample,
                                            PathRadiance *L)
 {
+	PROFILING_INIT(kg, PROFILING_WRITE_RESULT);
+
 	float alpha;
 	float3 L_sum = path_radiance_clamp_and_sum(kg, L, &alpha);
 
@@ -344,6 +346,13 @@ ccl_device_inline void kernel_write_result(KernelGlobals *kg,
 
 	kernel_write_light_passes(kg, buffer, L);
 
+	if(kernel_data.integrator.use_adaptive_sampling) {
+		kernel_adaptive_write_sample(kg, buffer, sample, L_sum);
+	}
+	if(kernel_data.film.pass_sample_count) {
+		kernel_write_pass_float(buffer + kernel_data.film.pass_sample_count, 1.0f);
+	}
+
 #ifdef __DENOISING_FEATURES__
 	if(kernel_data.film.pass_denoising_data) {
 #  ifdef __SHADOW_TRICKS__
@@ -29,7 +29,9 @@
 
 #include "kernel/kernel_accumulate.h"
 #include "kernel/kernel_shader.h"
+#include "kernel/kernel_light_tree.h"
 #include "kernel/kernel_light.h"
+#include "kernel/kernel_adaptive_sampling.h"
 #include "kernel/kernel_passes.h"
 
 #if defined(__VOLUME__) || defined(__SUBSURFACE__)
@@ -57,6 +59,8 @@ ccl_device_forceinline bool kernel_path_scene_intersect(
 	Intersection *isect,
 	PathRadiance *L)
 {
+	PROFILING_INIT(kg, PROFILING_SCENE_INTERSECT);
+
 	uint visibility = path_state_ray_visibility(kg, state);
 
 	if(path_state_ao_bounce(kg, state)) {
@@ -105,6 +109,8 @@ ccl_device_forceinline void kernel_path_lamp_emission(
 	ShaderData *emission_sd,
 	PathRadiance *L)
 {
+	PROFILING_INIT(kg, PROFILING_INDIRECT_EMISSION);
+
 #ifdef __LAMP_MIS__
 	if(kernel_data.integrator.use_lamp_mis && !(state->flag & PATH_RAY_CAMERA)) {
 		/* ray starting from previous non-transparent bounce */
@@ -135,6 +141,8 @@ ccl_device_forceinline void kernel_path_background(
 	ShaderData *sd,
 	PathRadiance *L)
 {
+	PROFILING_INIT(kg, PROFILING_INDIRECT_EMISSION);
+
 	/* eval background shader if nothing hit */
 	if(kernel_data.background.transparent && (state->flag & PATH_RAY_TRANSPARENT_BACKGROUND)) {
 		L->transparent += average(throughput);
@@ -172,6 +180,8 @@ ccl_device_forceinline VolumeIntegrateResult kernel_path_volume(
 	ShaderData *emission_sd,
 	PathRadiance *L)
 {
+	PROFILING_INIT(kg, PROFILING_VOLUME);
+
 	/* Sanitize volume stack. */
 	if(!hit) {
 		kernel_volume_clean_stack(kg, state->volume_stack);
@@ -278,6 +288,8 @@ ccl_device_forceinline bool kernel_path_shader_apply(
 	PathRadiance *L,
 	ccl_global float *buffer)
 {
+	PROFILING_INIT(kg, PROFILING_SHADER_APPLY);
+
 #ifdef __SHADOW_TRICKS__
 	if((sd->object_flag & SD_OBJECT_SHADOW_CATCHER)) {
 		if(state->flag & PATH_RAY_TRANSPARENT_BACKGROUND) {
@@ -355,6 +367,8 @@ ccl_device_noinline void kernel_path_ao(KernelGlobals *kg,
                                         float3 throughput,
                                         float3 ao_alpha)
 {
+	PROFILING_INIT(kg, PROFILING_AO);
+
 	/* todo: solve correlation */
 	float bsdf_u, bsdf_v;
 
@@ -566,8 +580,11 @@ ccl_device_forceinline void kernel_path_integrate(
 	Ray *ray,
 	PathRadiance *L,
 	ccl_global float *buffer,
-	ShaderData *emission_sd)
+	ShaderData *emission_sd,
+	const Intersection *primary_isect)
 {
+	PROFILING_INIT(kg, PROFILING_PATH_INTEGRATE);
+
 	/* Shader data memory used for both volumes and surfaces, saves stack space. */
 	ShaderData sd;
 
@@ -582,7 +599,24 @@ ccl_device_forceinline void kernel_path_integrate(
 	for(;;) {
 		/* Find intersection with objects in scene. */
 		Intersection isect;
-		bool hit = kernel_path_scene_intersect(kg, state, ray, &isect, L);
+		bool hit;
+
+		if(primary_isect != NULL) {
+			/* Camera ray was already intersected as part of a ray packet. */
+			isect = *primary_isect;
+			hit = (isect.prim != PRIM_NONE);
+			primary_isect = NULL;
+
+#ifdef __KERNEL_DEBUG__
+			L->debug_data.num_bvh_traversed_nodes += isect.num_traversed_nodes;
+			L->debug_data.num_bvh_traversed_instances += isect.num_traversed_instances;
+			L->debug_data.num_bvh_intersections += isect.num_intersections;
+			L->debug_data.num_ray_bounces++;
+#endif  /* __KERNEL_DEBUG__ */
+		}
+		else {
+			hit = kernel_path_scene_intersect(kg, state, ray, &isect, L);
+		}
 
 		/* Find intersection with lamps and compute emission for MIS. */
 		kernel_path_lamp_emission(kg, state, ray, throughput, &isect, &sd, L);
@@ -719,12 +753,18 @@ ccl_device void kernel_path_trace(KernelGlobals *kg,
 	ccl_global float *buffer,
 	int sample, int x, int y, int offset, int stride)
 {
+	PROFILING_INIT(kg, PROFILING_RAY_SETUP);
+
 	/* buffer offset */
 	int index = offset + x + y*stride;
 	int pass_stride = kernel_data.film.pass_stride;
 
 	buffer += index*pass_stride;
 
+	if(kernel_adaptive_pixel_converged(kg, buffer)) {
+		return;
+	}
+
 	/* Initialize random numbers and sample ray. */
 	uint rng_hash;
 	Ray ray;
@@ -754,11 +794,94 @@ ccl_device void kernel_path_trace(KernelGlobals *kg,
 	                      &ray,
 	                      &L,
 	                      buffer,
-	                      emission_sd);
+	                      emission_sd,
+	                      NULL);
 
 	kernel_write_result(kg, buffer, sample, &L);
 }
 
+#ifdef __KERNEL_CPU__
+/* Path trace a row of up to RAY_PACKET_SIZE neighbor pixels. Camera rays of
+ * the pixels are coherent, so they are intersected with the scene as a ray
+ * packet, after which every path continues on its own. */
+ccl_device void kernel_path_trace_packet(KernelGlobals *kg,
+	ccl_global float *buffer,
+	int sample, int x, int y, int num_pixels, int offset, int stride)
+{
+	PROFILING_INIT(kg, PROFILING_RAY_SETUP);
+
+	kernel_assert(num_pixels <= RAY_PACKET_SIZE);
+
+	if(!scene_intersect_packet_supported(kg)) {
+		for(int i = 0; i < num_pixels; i++) {
+			kernel_path_trace(kg, buffer, sample, x + i, y, offset, stride);
+		}
+		return;
+	}
+
+	int pass_stride = kernel_data.film.pass_stride;
+
+	ShaderDataTinyStorage emission_sd_storage;
+	ShaderData *emission_sd = AS_SHADER_DATA(&emission_sd_storage);
+
+	/* Initialize random numbers, sample rays and state of all pixels. */
+	Ray rays[RAY_PACKET_SIZE];
+	PathState states[RAY_PACKET_SIZE];
+	Intersection isects[RAY_PACKET_SIZE];
+	int pixels[RAY_PACKET_SIZE];
+	int num_rays = 0;
+
+	for(int i = 0; i < num_pixels; i++) {
+		int index = offset + x + i + y*stride;
+		if(kernel_adaptive_pixel_converged(kg, buffer + index*pass_stride)) {
+			continue;
+		}
+
+		uint rng_hash;
+		Ray *ray = &rays[num_rays];
+
+		kernel_path_trace_setup(kg, sample, x + i, y, &rng_hash, ray);
+
+		if(ray->t == 0.0f) {
+			continue;
+		}
+
+		path_state_init(kg, emission_sd, &states[num_rays], rng_hash, sample, ray);
+		pixels[num_rays++] = i;
+	}
+
+	if(num_rays == 0) {
+		return;
+	}
+
+	/* All camera rays start with the same visibility. */
+	uint visibility = path_state_ray_visibility(kg, &states[0]);
+	scene_intersect_packet(kg, rays, isects, num_rays, visibility);
+
+	/* Integrate. */
+	for(int i = 0; i < num_rays; i++) {
+		int index = offset + x + pixels[i] + y*stride;
+		ccl_global float *pixel_buffer = buffer + index*pass_stride;
+
+		float3 throughput = make_float3(1.0f, 1.0f, 1.0f);
+
+		PathRadiance L;
+		path_radiance_init(&L, kernel_data.film.use_light_pass);
+
+		kernel_path_integrate(kg,
+		                      &states[i],
+		                      throughput,
+		                      &rays[i],
+		                      &L,
+		                      pixel_buffer,
+		                      emission_sd,
+		                      &isects[i]);
+
+		kernel_write_result(kg, pixel_buffer, sample, &L);
+	}
+}
+#endif  /* __KERNEL_CPU__ */
+
 #endif  /* __SPLIT_KERNEL__ */
 
 CCL_NAMESPACE_END
@@ -25,6 +25,8 @@ ccl_device_inline void kernel_branched_path_ao(KernelGlobals *kg,
                                                ccl_addr_space PathState *state,
                                                float3 throughput)
 {
+	PROFILING_INIT(kg, PROFILING_AO);
+
 	int num_samples = kernel_data.integrator.ao_samples;
 	float num_samples_inv = 1.0f/num_samples;
 	float ao_factor = kernel_data.background.ao_factor;
@@ -32,6 +34,54 @@ ccl_device_inline void kernel_branched_path_ao(KernelGlobals *kg,
 	float3 ao_bsdf = shader_bsdf_ao(kg, sd, ao_factor, &ao_N);
 	float3 ao_alpha = shader_bsdf_alpha(kg, sd);
 
+#ifdef __KERNEL_CPU__
+	if(scene_intersect_packet_supported(kg)) {
+		/* All AO rays leave the same shading point, trace them in packets. */
+		Ray rays[RAY_PACKET_SIZE];
+		int num_rays = 0;
+
+		for(int j = 0; j < num_samples; j++) {
+			float bsdf_u, bsdf_v;
+			path_branched_rng_2D(kg, state->rng_hash, state, j, num_samples, PRNG_BSDF_U, &bsdf_u, &bsdf_v);
+
+			float3 ao_D;
+			float ao_pdf;
+
+			sample_cos_hemisphere(ao_N, bsdf_u, bsdf_v, &ao_D, &ao_pdf);
+
+			if(dot(sd->Ng, ao_D) > 0.0f && ao_pdf != 0.0f) {
+				Ray *light_ray = &rays[num_rays++];
+
+				light_ray->P = ray_offset(sd->P, sd->Ng);
+				light_ray->D = ao_D;
+				light_ray->t = kernel_data.background.ao_distance;
+				light_ray->time = sd->time;
+				light_ray->dP = sd->dP;
+				light_ray->dD = differential3_zero();
+			}
+
+			if(num_rays == RAY_PACKET_SIZE || (num_rays > 0 && j == num_samples - 1)) {
+				bool blocked[RAY_PACKET_SIZE];
+				float3 ao_shadow[RAY_PACKET_SIZE];
+
+				shadow_blocked_packet(kg, sd, emission_sd, state, rays, num_rays, blocked, ao_shadow);
+
+				for(int i = 0; i < num_rays; i++) {
+					if(!blocked[i]) {
+						path_radiance_accum_ao(L, state, throughput*num_samples_inv, ao_alpha, ao_bsdf, ao_shadow[i]);
+					}
+					else {
+						path_radiance_accum_total_ao(L, state, throughput*num_samples_inv, ao_bsdf);
+					}
+				}
+
+				num_rays = 0;
+			}
+		}
+		return;
+	}
+#endif  /* __KERNEL_CPU__ */
+
 	for(int j = 0; j < num_samples; j++) {
 		float bsdf_u, bsdf_v;
 		path_branched_rng_2D(kg, state->rng_hash, state, j, num_samples, PRNG_BSDF_U, &bsdf_u, &bsdf_v);
@@ -77,6 +127,8 @@ ccl_device_forceinline void kernel_branched_path_volume(
 	ShaderData *emission_sd,
 	PathRadiance *L)
 {
+	PROFILING_INIT(kg, PROFILING_VOLUME);
+
 	/* Sanitize volume stack. */
 	if(!hit) {
 		kernel_volume_clean_stack(kg, state->volume_stack);
@@ -227,6 +279,8 @@ ccl_device_noinline void kernel_branched_path_surface_indirect_light(KernelGloba
 	ShaderData *sd, ShaderData *indirect_sd, ShaderData *emission_sd,
 	float3 throughput, float num_samples_adjust, PathState *state, PathRadiance *L)
 {
+	PROFILING_INIT(kg, PROFILING_SURFACE_BOUNCE);
+
 	float sum_sample_weight = 0.0f;
 #ifdef __DENOISING_FEATURES__
 	if(state->denoising_feature_weight > 0.0f) {
@@ -325,6 +379,8 @@ ccl_device void kernel_branched_path_subsurface_scatter(KernelGlobals *kg,
                                                         Ray *ray,
                                                         float3 throughput)
 {
+	PROFILING_INIT(kg, PROFILING_SUBSURFACE);
+
 	for(int i = 0; i < sd->num_closure; i++) {
 		ShaderClosure *sc = &sd->closure[i];
 
@@ -434,6 +490,8 @@ ccl_device void kernel_branched_path_integrate(KernelGlobals *kg,
                                                ccl_global float *buffer,
                                                PathRadiance *L)
 {
+	PROFILING_INIT(kg, PROFILING_PATH_INTEGRATE);
+
 	/* initialize */
 	float3 throughput = make_float3(1.0f, 1.0f, 1.0f);
 
@@ -596,12 +654,18 @@ ccl_device void kernel_branched_path_trace(KernelGlobals *kg,
 	ccl_global float *buffer,
 	int sample, int x, int y, int offset, int stride)
 {
+	PROFILING_INIT(kg, PROFILING_RAY_SETUP);
+
 	/* buffer offset */
 	int index = offset + x + y*stride;
 	int pass_stride = kernel_data.film.pass_stride;
 
 	buffer += index*pass_stride;
 
+	if(kernel_adaptive_pixel_converged(kg, buffer)) {
+		return;
+	}
+
 	/* initialize random numbers and ray */
 	uint rng_hash;
 	Ray ray;
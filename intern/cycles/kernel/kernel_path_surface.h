@@ -28,6 +28,8 @@ ccl_device_noinline void kernel_branched_path_surface_connect_light(
         PathRadiance *L,
         int sample_all_lights)
 {
+	PROFILING_INIT(kg, PROFILING_CONNECT_LIGHT);
+
 #ifdef __EMISSION__
 	/* sample illumination from lights to find path contribution */
 	if(!(sd->flag & SD_BSDF_HAS_EVAL))
@@ -154,6 +156,8 @@ ccl_device bool kernel_branched_path_surface_bounce(
         ccl_addr_space Ray *ray,
         float sum_sample_weight)
 {
+	PROFILING_INIT(kg, PROFILING_SURFACE_BOUNCE);
+
 	/* sample BSDF */
 	float bsdf_pdf;
 	BsdfEval bsdf_eval;
@@ -217,6 +221,8 @@ ccl_device_inline void kernel_path_surface_connect_light(KernelGlobals *kg,
 	ShaderData *sd, ShaderData *emission_sd, float3 throughput, ccl_addr_space PathState *state,
 	PathRadiance *L)
 {
+	PROFILING_INIT(kg, PROFILING_CONNECT_LIGHT);
+
 #ifdef __EMISSION__
 	if(!(kernel_data.integrator.use_direct_light && (sd->flag & SD_BSDF_HAS_EVAL)))
 		return;
@@ -274,6 +280,8 @@ ccl_device bool kernel_path_surface_bounce(KernelGlobals *kg,
                                            PathRadianceState *L_state,
                                            ccl_addr_space Ray *ray)
 {
+	PROFILING_INIT(kg, PROFILING_SURFACE_BOUNCE);
+
 	/* no BSDF? we can stop here */
 	if(sd->flag & SD_BSDF) {
 		/* sample BSDF */
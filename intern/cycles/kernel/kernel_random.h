@@ -44,7 +44,7 @@ ccl_device uint sobol_dimension(KernelGlobals *kg, int index, int dimension)
 	uint i = index + SOBOL_SKIP;
 	for(uint j = 0; i; i >>= 1, j++) {
 		if(i & 1) {
-			result ^= kernel_tex_fetch(__sobol_directions, 32*dimension + j);
+			result ^= kernel_tex_fetch(__sample_pattern_lut, 32*dimension + j);
 		}
 	}
 	return result;
@@ -73,6 +73,11 @@ ccl_device_forceinline float path_rng_1D(KernelGlobals *kg,
 	}
 #endif
 
+	if(kernel_data.integrator.sampling_pattern == SAMPLING_PATTERN_PMJ) {
+		/* Progressive multi-jitter. */
+		return pmj_sample_1D(kg, sample, rng_hash, dimension);
+	}
+
 #ifdef __SOBOL__
 	/* Sobol sequence value using direction vectors. */
 	uint result = sobol_dimension(kg, sample, dimension);
@@ -115,6 +120,12 @@ ccl_device_forceinline void path_rng_2D(KernelGlobals *kg,
 	}
 #endif
 
+	if(kernel_data.integrator.sampling_pattern == SAMPLING_PATTERN_PMJ) {
+		/* Progressive multi-jitter. */
+		pmj_sample_2D(kg, sample, rng_hash, dimension, fx, fy);
+		return;
+	}
+
 #ifdef __SOBOL__
 	/* Sobol. */
 	*fx = path_rng_1D(kg, rng_hash, sample, num_samples, dimension);
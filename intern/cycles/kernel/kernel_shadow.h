@@ -551,6 +551,57 @@ ccl_device_inline bool shadow_blocked(KernelGlobals *kg,
 #endif  /* __TRANSPARENT_SHADOWS__ */
 }
 
+#ifdef __KERNEL_CPU__
+/* Same as above for multiple shadow rays at once. Opaque shadow rays are
+ * traced together as a ray packet, transparent shadows are handled one ray
+ * at a time. */
+ccl_device_inline void shadow_blocked_packet(KernelGlobals *kg,
+                                             ShaderData *sd,
+                                             ShaderData *shadow_sd,
+                                             PathState *state,
+                                             Ray *rays,
+                                             int num_rays,
+                                             bool *blocked,
+                                             float3 *shadow)
+{
+#ifdef __TRANSPARENT_SHADOWS__
+	if(kernel_data.integrator.transparent_shadows) {
+		for(int i = 0; i < num_rays; i++) {
+			blocked[i] = shadow_blocked(kg, sd, shadow_sd, state, &rays[i], &shadow[i]);
+		}
+		return;
+	}
+#endif
+#ifdef __SHADOW_TRICKS__
+	const uint visibility = (state->flag & PATH_RAY_SHADOW_CATCHER)
+		? PATH_RAY_SHADOW_NON_CATCHER
+		: PATH_RAY_SHADOW;
+#else
+	const uint visibility = PATH_RAY_SHADOW;
+#endif
+	Intersection isects[RAY_PACKET_SIZE];
+	scene_intersect_packet(kg,
+	                       rays,
+	                       isects,
+	                       num_rays,
+	                       visibility & PATH_RAY_SHADOW_OPAQUE);
+
+	for(int i = 0; i < num_rays; i++) {
+		shadow[i] = make_float3(1.0f, 1.0f, 1.0f);
+		blocked[i] = (isects[i].prim != PRIM_NONE);
+#ifdef __VOLUME__
+		if(!blocked[i] &&
+		   rays[i].t != 0.0f &&
+		   state->volume_stack[0].shader != SHADER_NONE)
+		{
+			/* Apply attenuation from current volume shader. */
+			kernel_volume_shadow(kg, shadow_sd, state, &rays[i], &shadow[i]);
+		}
+#endif
+	}
+}
+#endif  /* __KERNEL_CPU__ */
+
 #undef SHADOW_STACK_MAX_HITS
 
 CCL_NAMESPACE_END
@@ -64,6 +64,9 @@ KERNEL_TEX(KernelLightDistribution, __light_distribution)
 KERNEL_TEX(KernelLight, __lights)
 KERNEL_TEX(float2, __light_background_marginal_cdf)
 KERNEL_TEX(float2, __light_background_conditional_cdf)
+KERNEL_TEX(KernelLightTreeNode, __light_tree_nodes)
+KERNEL_TEX(uint, __light_tree_leaf)
+KERNEL_TEX(uint2, __light_tree_object_range)
 
 /* particles */
 KERNEL_TEX(KernelParticle, __particles)
@@ -75,8 +78,8 @@ KERNEL_TEX(KernelShader, __shaders)
 /* lookup tables */
 KERNEL_TEX(float, __lookup_table)
 
-/* sobol */
-KERNEL_TEX(uint, __sobol_directions)
+/* sample patterns */
+KERNEL_TEX(uint, __sample_pattern_lut)
 
 /* image textures */
 KERNEL_TEX(TextureInfo, __texture_info)
@@ -56,6 +56,8 @@ CCL_NAMESPACE_BEGIN
 
 #define VOLUME_STACK_SIZE		16
 
+#define RAY_PACKET_SIZE			4
+
 /* Split kernel constants */
 #define WORK_POOL_SIZE_GPU 64
 #define WORK_POOL_SIZE_CPU 1
@@ -314,10 +316,16 @@ enum PathTraceDimension {
 enum SamplingPattern {
 	SAMPLING_PATTERN_SOBOL = 0,
 	SAMPLING_PATTERN_CMJ = 1,
+	SAMPLING_PATTERN_PMJ = 2,
 
 	SAMPLING_NUM_PATTERNS,
 };
 
+/* Size of the progressive multi-jitter lookup table, dimensions beyond the
+ * number of patterns reuse them with a different scramble. */
+#define NUM_PMJ_SAMPLES (64*64)
+#define NUM_PMJ_PATTERNS 48
+
 /* these flags values correspond to raytypes in osl.cpp, so keep them in sync! */
 
 enum PathRayFlag {
@@ -415,6 +423,8 @@ typedef enum PassType {
 	PASS_RAY_BOUNCES,
 #endif
 	PASS_RENDER_TIME,
+	PASS_ADAPTIVE_AUX_BUFFER,
+	PASS_SAMPLE_COUNT,
 	PASS_CATEGORY_MAIN_END = 31,
 
 	PASS_MIST = 32,
@@ -747,8 +757,19 @@ typedef enum PrimitiveType {
 	PRIMITIVE_NUM_TOTAL = 4,
 } PrimitiveType;
 
-#define PRIMITIVE_PACK_SEGMENT(type, segment) ((segment << PRIMITIVE_NUM_TOTAL) | (type))
-#define PRIMITIVE_UNPACK_SEGMENT(type) (type >> PRIMITIVE_NUM_TOTAL)
+#define PRIMITIVE_PACK_SEGMENT(type, segment) (((segment) << PRIMITIVE_NUM_TOTAL) | (type))
+#define PRIMITIVE_UNPACK_SEGMENT(type) (((type) >> PRIMITIVE_NUM_TOTAL) & 0xffffff)
+
+/* Curve primitives in the BVH cover up to 8 consecutive segments of a curve,
+ * the number of additional segments is stored in the top bits.
+ */
+#define PRIMITIVE_MAX_SEGMENTS 8
+#define PRIMITIVE_PACK_SEGMENTS(type, segment, num_segments) \
+	(PRIMITIVE_PACK_SEGMENT(type, segment) | (((num_segments) - 1) << 28))
+#define PRIMITIVE_UNPACK_NUM_SEGMENTS(type) ((((type) >> 28) & 0x7) + 1)
+/* Single segment of a primitive packed with PRIMITIVE_PACK_SEGMENTS. */
+#define PRIMITIVE_SEGMENT(type, i) \
+	PRIMITIVE_PACK_SEGMENT((type) & PRIMITIVE_ALL, PRIMITIVE_UNPACK_SEGMENT(type) + (i))
 
 /* Attributes */
 
@@ -1273,7 +1294,9 @@ typedef struct KernelFilm {
 	int pass_denoising_clean;
 	int denoising_flags;
 
-	int pad1, pad2, pad3;
+	int pass_adaptive_aux_buffer;
+	int pass_sample_count;
+	int pad1;
 
 #ifdef __KERNEL_DEBUG__
 	int pass_bvh_traversed_nodes;
@@ -1369,6 +1392,18 @@ typedef struct KernelIntegrator {
 	int start_sample;
 
 	int max_closures;
+
+	/* adaptive sampling */
+	int use_adaptive_sampling;
+	int adaptive_min_samples;
+	int adaptive_step;
+	float adaptive_threshold;
+
+	/* light tree */
+	int use_light_tree;
+	float light_tree_pdf;
+	int light_tree_infinite_offset;
+	int num_infinite_lights;
 } KernelIntegrator;
 static_assert_align(KernelIntegrator, 16);
 
@@ -1390,7 +1425,9 @@ typedef struct KernelBVH {
 	int have_instancing;
 	int bvh_layout;
 	int use_bvh_steps;
-	int pad1, pad2;
+	/* CPU only, trace coherent rays together in packets. */
+	int use_ray_packets;
+	int pad1;
 } KernelBVH;
 static_assert_align(KernelBVH, 16);
 
@@ -1512,6 +1549,32 @@ typedef struct KernelLightDistribution {
 } KernelLightDistribution;
 static_assert_align(KernelLightDistribution, 16);
 
+/* Node of the light tree. Inner nodes bound the position, orientation and
+ * energy of all emitters below them, leaves reference a single emitter. */
+typedef struct KernelLightTreeNode {
+	float bbox_min[3];
+	float energy;
+	float bbox_max[3];
+	/* Spread of emitter normals around the axis. */
+	float theta_o;
+	float axis[3];
+	/* Spread of emission around emitter normals. */
+	float theta_e;
+	/* Inner node: index of the right child, the left child directly follows
+	 * the node. Leaf: index into the light distribution. */
+	int child;
+	int parent;
+	int flag;
+	/* Area of triangle emitters. */
+	float area;
+} KernelLightTreeNode;
+static_assert_align(KernelLightTreeNode, 16);
+
+enum LightTreeNodeFlag {
+	LIGHT_TREE_NODE_LEAF = (1 << 0),
+	LIGHT_TREE_NODE_TWO_SIDED = (1 << 1),
+};
+
 typedef struct KernelParticle {
 	int index;
 	float age;
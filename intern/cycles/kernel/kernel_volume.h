@@ -156,6 +156,88 @@ ccl_device int volume_stack_sampling_method(KernelGlobals *kg, VolumeStack *stac
 	return method;
 }
 
+#ifdef __KERNEL_CPU__
+/* Empty Space Skipping
+ *
+ * As for the volume bounding mesh, volumes with voxel attributes are assumed
+ * to be empty where all their voxel grids are zero. The tile index of sparse
+ * grids tells where that is, so steps through empty tiles can be skipped
+ * without evaluating the shader. */
+
+/* Distance along the ray from t through which all volumes in the stack are
+ * empty, zero if they may not be. */
+ccl_device float volume_stack_empty_distance(KernelGlobals *kg,
+                                             ShaderData *sd,
+                                             ccl_addr_space VolumeStack *stack,
+                                             Ray *ray,
+                                             float t)
+{
+	const int object = sd->object;
+	float distance = FLT_MAX;
+
+	for(int i = 0; stack[i].shader != SHADER_NONE && distance > 0.0f; i++) {
+		sd->object = stack[i].object;
+
+		if(sd->object == OBJECT_NONE ||
+		   !(kernel_tex_fetch(__object_flag, sd->object) & SD_OBJECT_HAS_VOLUME_ATTRIBUTES))
+		{
+			distance = 0.0f;
+			break;
+		}
+
+#ifdef __OBJECT_MOTION__
+		shader_setup_object_transforms(kg, sd, sd->time);
+#endif
+
+		/* All voxel grids of an object share its texture space. */
+		const float3 P = volume_normalized_position(kg, sd, ray->P + t*ray->D);
+		const float3 D = volume_normalized_position(kg, sd, ray->P + (t + 1.0f)*ray->D) - P;
+		bool has_grid = false;
+
+		for(uint id = ATTR_STD_VOLUME_DENSITY; id <= ATTR_STD_VOLUME_VELOCITY; id++) {
+			const AttributeDescriptor desc = find_attribute(kg, sd, id);
+			if(desc.offset != ATTR_STD_NOT_FOUND) {
+				distance = min(distance, kernel_tex_image_empty_distance_3d(kg, desc.offset, P, D));
+				has_grid = true;
+			}
+		}
+
+		if(!has_grid) {
+			distance = 0.0f;
+		}
+	}
+
+	sd->object = object;
+
+	return distance;
+}
+
+/* Number of steps from step i which lie in empty space. The last step is
+ * never skipped, its jitter is drawn from the random number generator. */
+ccl_device int volume_stack_empty_steps(KernelGlobals *kg,
+                                        ShaderData *sd,
+                                        ccl_addr_space VolumeStack *stack,
+                                        Ray *ray,
+                                        int i,
+                                        int max_steps,
+                                        float step_size)
+{
+	const float t = i * step_size;
+	const float distance = min(volume_stack_empty_distance(kg, sd, stack, ray, t), ray->t - t);
+
+	if(distance < step_size) {
+		return 0;
+	}
+
+	int steps = (int)min(distance / step_size, (float)(max_steps - 1 - i));
+	while(steps > 0 && (i + steps) * step_size >= ray->t) {
+		steps--;
+	}
+
+	return steps;
+}
+#endif  /* __KERNEL_CPU__ */
+
 /* Volume Shadows
  *
  * These functions are used to attenuate shadow rays to lights. Both absorption
@@ -197,6 +279,15 @@ ccl_device void kernel_volume_shadow_heterogeneous(KernelGlobals *kg,
 	float3 sum = make_float3(0.0f, 0.0f, 0.0f);
 
 	for(int i = 0; i < max_steps; i++) {
+#ifdef __KERNEL_CPU__
+		/* skip steps through empty space */
+		const int empty_steps = volume_stack_empty_steps(kg, sd, state->volume_stack, ray, i, max_steps, step);
+		if(empty_steps > 0) {
+			i += empty_steps;
+			t = i * step;
+		}
+#endif
+
 		/* advance to new position */
 		float new_t = min(ray->t, (i+1) * step);
 		float dt = new_t - t;
@@ -518,6 +609,15 @@ ccl_device VolumeIntegrateResult kernel_volume_integrate_heterogeneous_distance(
 	bool has_scatter = false;
 
 	for(int i = 0; i < max_steps; i++) {
+#ifdef __KERNEL_CPU__
+		/* skip steps through empty space */
+		const int empty_steps = volume_stack_empty_steps(kg, sd, state->volume_stack, ray, i, max_steps, step_size);
+		if(empty_steps > 0) {
+			i += empty_steps;
+			t = i * step_size;
+		}
+#endif
+
 		/* advance to new position */
 		float new_t = min(ray->t, (i+1) * step_size);
 		float dt = new_t - t;
@@ -753,6 +853,35 @@ ccl_device void kernel_volume_decoupled_record(KernelGlobals *kg, PathState *sta
 	VolumeStep *step = segment->steps;
 
 	for(int i = 0; i < max_steps; i++, step++) {
+#ifdef __KERNEL_CPU__
+		/* skip steps through empty space, recorded as a single empty step */
+		const int empty_steps = (heterogeneous)?
+			volume_stack_empty_steps(kg, sd, state->volume_stack, ray, i, max_steps, step_size): 0;
+		if(empty_steps > 0) {
+			if(is_last_step_empty) {
+				/* consecutive empty step, merge */
+				step--;
+			}
+			else {
+				step->sigma_t = make_float3(0.0f, 0.0f, 0.0f);
+				step->sigma_s = make_float3(0.0f, 0.0f, 0.0f);
+				step->closure_flag = 0;
+
+				segment->numsteps++;
+				is_last_step_empty = true;
+			}
+
+			i += empty_steps;
+			t = i * step_size;
+
+			step->accum_transmittance = accum_transmittance;
+			step->cdf_distance = cdf_distance;
+			step->t = t;
+			step->shade_t = t;
+			step++;
+		}
+#endif
+
 		/* advance to new position */
 		float new_t = min(ray->t, (i+1) * step_size);
 		float dt = new_t - t;
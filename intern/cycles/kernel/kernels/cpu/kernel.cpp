@@ -56,6 +56,8 @@
     /* do nothing */
 #endif
 
+#include "kernel/kernel_oiio_globals.h"
+
 #include "kernel/kernel.h"
 #define KERNEL_ARCH cpu
 #include "kernel/kernels/cpu/kernel_cpu_impl.h"
@@ -91,4 +93,90 @@ void kernel_tex_copy(KernelGlobals *kg,
 	}
 }
 
+/* Image Texture Cache */
+
+bool kernel_tex_image_interp_cache(KernelGlobals *kg, int id, float x, float y, float4 *r)
+{
+	OIIOGlobals *oiio = kg->oiio;
+	if(id < 0 || (size_t)id >= oiio->textures.size() || !oiio->textures[id].handle) {
+		return false;
+	}
+
+	const OIIOTexture& tex = oiio->textures[id];
+
+	OIIO::TextureSystem *tex_sys;
+	OIIO::TextureSystem::Perthread *thread_info;
+	if(tex.use_alpha) {
+		tex_sys = oiio->tex_sys;
+		thread_info = (kg->oiio_tdata)? kg->oiio_tdata->thread_info: NULL;
+	}
+	else {
+		tex_sys = oiio->tex_sys_unassociated;
+		thread_info = (kg->oiio_tdata)? kg->oiio_tdata->thread_info_unassociated: NULL;
+	}
+
+	OIIO::TextureOpt options;
+	options.interpmode = tex.interpolation;
+	options.swrap = tex.extension;
+	options.twrap = tex.extension;
+	/* RGB images get an opaque alpha, same as when loading into memory. */
+	options.fill = 1.0f;
+
+	/* No differentials are available here, so the finest MIP level is
+	 * used. Cycles stores images bottom to top, OIIO is top to bottom. */
+	float result[4];
+	if(!tex_sys->texture(tex.handle, thread_info, options,
+	                     x, 1.0f - y,
+	                     0.0f, 0.0f, 0.0f, 0.0f,
+	                     4, result))
+	{
+		*r = make_float4(TEX_IMAGE_MISSING_R,
+		                 TEX_IMAGE_MISSING_G,
+		                 TEX_IMAGE_MISSING_B,
+		                 TEX_IMAGE_MISSING_A);
+		return true;
+	}
+
+	if(tex.is_cmyk) {
+		/* CMYK, same conversion as when loading into memory. */
+		*r = make_float4(result[0] * result[3],
+		                 result[1] * result[3],
+		                 result[2] * result[3],
+		                 1.0f);
+		return true;
+	}
+
+	*r = make_float4(result[0],
+	                 result[1],
+	                 result[2],
+	                 tex.use_alpha? result[3]: 1.0f);
+	return true;
+}
+
+/* Per thread texture cache state, only used when the texture cache is
+ * active for the render. Must be called from the thread doing lookups. */
+
+void kernel_tex_image_cache_thread_init(KernelGlobals *kg)
+{
+	kg->oiio_tdata = NULL;
+
+	OIIOGlobals *oiio = kg->oiio;
+	if(!oiio) {
+		return;
+	}
+
+	OIIOThreadData *tdata = new OIIOThreadData();
+	tdata->thread_info = oiio->tex_sys->get_perthread_info();
+	tdata->thread_info_unassociated = (oiio->tex_sys_unassociated)?
+	        oiio->tex_sys_unassociated->get_perthread_info(): NULL;
+
+	kg->oiio_tdata = tdata;
+}
+
+void kernel_tex_image_cache_thread_free(KernelGlobals *kg)
+{
+	delete kg->oiio_tdata;
+	kg->oiio_tdata = NULL;
+}
+
 CCL_NAMESPACE_END
@@ -63,14 +63,28 @@ template<typename T> struct TextureInterpolator  {
 		return make_float4(f, f, f, 1.0f);
 	}
 
-	static ccl_always_inline float4 read(const T *data,
+	static ccl_always_inline float4 read_2d(const TextureInfo& info,
+	                                        int x, int y)
+	{
+		if(info.compression == IMAGE_COMPRESSION_BC3) {
+			const int blocks_x = (info.width + TEX_BC3_BLOCK_SIZE - 1) / TEX_BC3_BLOCK_SIZE;
+			const size_t block = (size_t)(y / TEX_BC3_BLOCK_SIZE) * blocks_x + x / TEX_BC3_BLOCK_SIZE;
+			return texture_bc3_decode((const uchar*)info.data + block * TEX_BC3_BLOCK_BYTES,
+			                          x % TEX_BC3_BLOCK_SIZE,
+			                          y % TEX_BC3_BLOCK_SIZE);
+		}
+		const T *data = (const T*)info.data;
+		return read(data[y * info.width + x]);
+	}
+
+	static ccl_always_inline float4 read(const TextureInfo& info,
 	                                     int x, int y,
 	                                     int width, int height)
 	{
 		if(x < 0 || y < 0 || x >= width || y >= height) {
 			return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
 		}
-		return read(data[y * width + x]);
+		return read_2d(info, x, y);
 	}
 
 	static ccl_always_inline int wrap_periodic(int x, int width)
@@ -98,7 +112,6 @@ template<typename T> struct TextureInterpolator  {
 	static ccl_always_inline float4 interp_closest(const TextureInfo& info,
 	                                               float x, float y)
 	{
-		const T *data = (const T*)info.data;
 		const int width = info.width;
 		const int height = info.height;
 		int ix, iy;
@@ -122,13 +135,12 @@ template<typename T> struct TextureInterpolator  {
 				kernel_assert(0);
 				return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
 		}
-		return read(data[ix + iy*width]);
+		return read_2d(info, ix, iy);
 	}
 
 	static ccl_always_inline float4 interp_linear(const TextureInfo& info,
 	                                              float x, float y)
 	{
-		const T *data = (const T*)info.data;
 		const int width = info.width;
 		const int height = info.height;
 		int ix, iy, nix, niy;
@@ -155,16 +167,15 @@ template<typename T> struct TextureInterpolator  {
 				kernel_assert(0);
 				return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
 		}
-		return (1.0f - ty) * (1.0f - tx) * read(data, ix, iy, width, height) +
-		       (1.0f - ty) * tx * read(data, nix, iy, width, height) +
-		       ty * (1.0f - tx) * read(data, ix, niy, width, height) +
-		       ty * tx * read(data, nix, niy, width, height);
+		return (1.0f - ty) * (1.0f - tx) * read(info, ix, iy, width, height) +
+		       (1.0f - ty) * tx * read(info, nix, iy, width, height) +
+		       ty * (1.0f - tx) * read(info, ix, niy, width, height) +
+		       ty * tx * read(info, nix, niy, width, height);
 	}
 
 	static ccl_always_inline float4 interp_cubic(const TextureInfo& info,
 	                                             float x, float y)
 	{
-		const T *data = (const T*)info.data;
 		const int width = info.width;
 		const int height = info.height;
 		int ix, iy, nix, niy;
@@ -210,7 +221,7 @@ template<typename T> struct TextureInterpolator  {
 		/* Some helper macro to keep code reasonable size,
 		 * let compiler to inline all the matrix multiplications.
 		 */
-#define DATA(x, y) (read(data, xc[x], yc[y], width, height))
+#define DATA(x, y) (read(info, xc[x], yc[y], width, height))
 #define TERM(col) \
 		(v[col] * (u[0] * DATA(0, col) + \
 		           u[1] * DATA(1, col) + \
@@ -244,6 +255,31 @@ template<typename T> struct TextureInterpolator  {
 
 	/* ********  3D interpolation ******** */
 
+	static ccl_always_inline float4 read_3d(const TextureInfo& info,
+	                                        int x, int y, int z)
+	{
+		if(info.compression == IMAGE_COMPRESSION_BC3) {
+			/* Only 2D textures are compressed, so z is always zero. */
+			kernel_assert(z == 0);
+			return read_2d(info, x, y);
+		}
+		const T *data = (const T*)info.data;
+		if(info.grid) {
+			/* Sparse texture, see util_texture_sparse.h. */
+			const int *grid = (const int*)info.grid;
+			const int mask = TEX_SPARSE_TILE_SIZE - 1;
+			const int tiles_x = (info.width + mask) >> TEX_SPARSE_TILE_SHIFT;
+			const int tiles_y = (info.height + mask) >> TEX_SPARSE_TILE_SHIFT;
+			const int tile = (x >> TEX_SPARSE_TILE_SHIFT) +
+			                 tiles_x*((y >> TEX_SPARSE_TILE_SHIFT) +
+			                          tiles_y*(z >> TEX_SPARSE_TILE_SHIFT));
+			const int local = (x & mask) +
+			                  (((y & mask) + ((z & mask) << TEX_SPARSE_TILE_SHIFT)) << TEX_SPARSE_TILE_SHIFT);
+			return read(data[((size_t)grid[tile] << (3*TEX_SPARSE_TILE_SHIFT)) + local]);
+		}
+		return read(data[x + y*info.width + z*info.width*info.height]);
+	}
+
 	static ccl_always_inline float4 interp_3d_closest(const TextureInfo& info,
 	                                                  float x, float y, float z)
 	{
@@ -279,8 +315,7 @@ template<typename T> struct TextureInterpolator  {
 				return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
 		}
 
-		const T *data = (const T*)info.data;
-		return read(data[ix + iy*width + iz*width*height]);
+		return read_3d(info, ix, iy, iz);
 	}
 
 	static ccl_always_inline float4 interp_3d_linear(const TextureInfo& info,
@@ -327,18 +362,17 @@ template<typename T> struct TextureInterpolator  {
 				return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
 		}
 
-		const T *data = (const T*)info.data;
 		float4 r;
 
-		r  = (1.0f - tz)*(1.0f - ty)*(1.0f - tx)*read(data[ix + iy*width + iz*width*height]);
-		r += (1.0f - tz)*(1.0f - ty)*tx*read(data[nix + iy*width + iz*width*height]);
-		r += (1.0f - tz)*ty*(1.0f - tx)*read(data[ix + niy*width + iz*width*height]);
-		r += (1.0f - tz)*ty*tx*read(data[nix + niy*width + iz*width*height]);
+		r  = (1.0f - tz)*(1.0f - ty)*(1.0f - tx)*read_3d(info, ix, iy, iz);
+		r += (1.0f - tz)*(1.0f - ty)*tx*read_3d(info, nix, iy, iz);
+		r += (1.0f - tz)*ty*(1.0f - tx)*read_3d(info, ix, niy, iz);
+		r += (1.0f - tz)*ty*tx*read_3d(info, nix, niy, iz);
 
-		r += tz*(1.0f - ty)*(1.0f - tx)*read(data[ix + iy*width + niz*width*height]);
-		r += tz*(1.0f - ty)*tx*read(data[nix + iy*width + niz*width*height]);
-		r += tz*ty*(1.0f - tx)*read(data[ix + niy*width + niz*width*height]);
-		r += tz*ty*tx*read(data[nix + niy*width + niz*width*height]);
+		r += tz*(1.0f - ty)*(1.0f - tx)*read_3d(info, ix, iy, niz);
+		r += tz*(1.0f - ty)*tx*read_3d(info, nix, iy, niz);
+		r += tz*ty*(1.0f - tx)*read_3d(info, ix, niy, niz);
+		r += tz*ty*tx*read_3d(info, nix, niy, niz);
 
 		return r;
 	}
@@ -415,20 +449,14 @@ template<typename T> struct TextureInterpolator  {
 		}
 
 		const int xc[4] = {pix, ix, nix, nnix};
-		const int yc[4] = {width * piy,
-		                   width * iy,
-		                   width * niy,
-		                   width * nniy};
-		const int zc[4] = {width * height * piz,
-		                   width * height * iz,
-		                   width * height * niz,
-		                   width * height * nniz};
+		const int yc[4] = {piy, iy, niy, nniy};
+		const int zc[4] = {piz, iz, niz, nniz};
 		float u[4], v[4], w[4];
 
 		/* Some helper macro to keep code reasonable size,
 		 * let compiler to inline all the matrix multiplications.
 		 */
-#define DATA(x, y, z) (read(data[xc[x] + yc[y] + zc[z]]))
+#define DATA(x, y, z) (read_3d(info, xc[x], yc[y], zc[z]))
 #define COL_TERM(col, row) \
 		(v[col] * (u[0] * DATA(0, col, row) + \
 		           u[1] * DATA(1, col, row) + \
@@ -445,7 +473,6 @@ template<typename T> struct TextureInterpolator  {
 		SET_CUBIC_SPLINE_WEIGHTS(w, tz);
 
 		/* Actual interpolation. */
-		const T *data = (const T*)info.data;
 		return ROW_TERM(0) + ROW_TERM(1) + ROW_TERM(2) + ROW_TERM(3);
 
 #undef COL_TERM
@@ -472,8 +499,20 @@ template<typename T> struct TextureInterpolator  {
 #undef SET_CUBIC_SPLINE_WEIGHTS
 };
 
+/* Lookup of images which are handled by the texture cache, returns false if
+ * the image is stored in device memory instead. Implemented outside of the
+ * architecture specific kernels, see kernel.cpp. */
+bool kernel_tex_image_interp_cache(KernelGlobals *kg, int id, float x, float y, float4 *r);
+
 ccl_device float4 kernel_tex_image_interp(KernelGlobals *kg, int id, float x, float y)
 {
+	if(kg->oiio) {
+		float4 r;
+		if(kernel_tex_image_interp_cache(kg, id, x, y, &r)) {
+			return r;
+		}
+	}
+
 	const TextureInfo& info = kernel_tex_fetch(__texture_info, id);
 
 	switch(kernel_tex_type(id)) {
@@ -514,6 +553,72 @@ ccl_device float4 kernel_tex_image_interp_3d(KernelGlobals *kg, int id, float x,
 	}
 }
 
+/* Distance along P + t*D, in normalized texture coordinates, through which
+ * lookups of a sparse 3D texture only read empty tiles and so return zero.
+ * Zero for dense textures, or if P does not lie in such a tile. */
+ccl_device float kernel_tex_image_empty_distance_3d(const TextureInfo& info, float3 P, float3 D)
+{
+	/* Periodic lookups wrap around to tiles which are not checked here. */
+	if(!info.grid || info.extension == EXTENSION_REPEAT) {
+		return 0.0f;
+	}
+
+	const float3 size = make_float3((float)info.width, (float)info.height, (float)info.depth);
+	const float3 v = P*size;
+	if(!(v.x >= 0.0f && v.y >= 0.0f && v.z >= 0.0f &&
+	     v.x < size.x && v.y < size.y && v.z < size.z))
+	{
+		return 0.0f;
+	}
+
+	/* Lookups read at most two voxels past the tile they are in, and clamp
+	 * or clip voxels outside of the texture. So lookups anywhere in a tile
+	 * return zero when the tile and its neighbours are empty. */
+	const int mask = TEX_SPARSE_TILE_SIZE - 1;
+	const int tiles_x = (info.width + mask) >> TEX_SPARSE_TILE_SHIFT;
+	const int tiles_y = (info.height + mask) >> TEX_SPARSE_TILE_SHIFT;
+	const int tiles_z = (info.depth + mask) >> TEX_SPARSE_TILE_SHIFT;
+	const int tx = (int)v.x >> TEX_SPARSE_TILE_SHIFT;
+	const int ty = (int)v.y >> TEX_SPARSE_TILE_SHIFT;
+	const int tz = (int)v.z >> TEX_SPARSE_TILE_SHIFT;
+	const int *grid = (const int*)info.grid;
+
+	for(int z = max(tz - 1, 0); z <= min(tz + 1, tiles_z - 1); z++) {
+		for(int y = max(ty - 1, 0); y <= min(ty + 1, tiles_y - 1); y++) {
+			for(int x = max(tx - 1, 0); x <= min(tx + 1, tiles_x - 1); x++) {
+				if(grid[x + tiles_x*(y + tiles_y*z)] != 0) {
+					return 0.0f;
+				}
+			}
+		}
+	}
+
+	/* Distance to the boundary of the tile. */
+	const float3 lower = make_float3((float)tx, (float)ty, (float)tz)*(float)TEX_SPARSE_TILE_SIZE;
+	const float3 upper = lower + make_float3((float)TEX_SPARSE_TILE_SIZE,
+	                                         (float)TEX_SPARSE_TILE_SIZE,
+	                                         (float)TEX_SPARSE_TILE_SIZE);
+	const float3 dv = D*size;
+	float t = FLT_MAX;
+
+	if(dv.x != 0.0f) {
+		t = min(t, (((dv.x > 0.0f)? upper.x: lower.x) - v.x)/dv.x);
+	}
+	if(dv.y != 0.0f) {
+		t = min(t, (((dv.y > 0.0f)? upper.y: lower.y) - v.y)/dv.y);
+	}
+	if(dv.z != 0.0f) {
+		t = min(t, (((dv.z > 0.0f)? upper.z: lower.z) - v.z)/dv.z);
+	}
+
+	return max(t, 0.0f);
+}
+
+ccl_device float kernel_tex_image_empty_distance_3d(KernelGlobals *kg, int id, float3 P, float3 D)
+{
+	return kernel_tex_image_empty_distance_3d(kernel_tex_fetch(__texture_info, id), P, D);
+}
+
 CCL_NAMESPACE_END
 
 #endif // __KERNEL_CPU_IMAGE_H__
@@ -99,6 +99,36 @@ void KERNEL_FUNCTION_FULL_NAME(path_trace)(KernelGlobals *kg,
 #endif /* KERNEL_STUB */
 }
 
+void KERNEL_FUNCTION_FULL_NAME(path_trace_packet)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  int sample,
+                                                  int x, int y,
+                                                  int num_pixels,
+                                                  int offset,
+                                                  int stride)
+{
+#ifdef KERNEL_STUB
+	STUB_ASSERT(KERNEL_ARCH, path_trace_packet);
+#else
+#  ifdef __BRANCHED_PATH__
+	if(kernel_data.integrator.branched) {
+		for(int i = 0; i < num_pixels; i++) {
+			kernel_branched_path_trace(kg,
+			                           buffer,
+			                           sample,
+			                           x + i, y,
+			                           offset,
+			                           stride);
+		}
+	}
+	else
+#  endif
+	{
+		kernel_path_trace_packet(kg, buffer, sample, x, y, num_pixels, offset, stride);
+	}
+#endif /* KERNEL_STUB */
+}
+
 /* Film */
 
 void KERNEL_FUNCTION_FULL_NAME(convert_to_byte)(KernelGlobals *kg,
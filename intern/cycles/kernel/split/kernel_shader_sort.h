@@ -55,7 +55,6 @@ ccl_device void kernel_shader_sort(KernelGlobals *kg,
 	}
 	ccl_barrier(CCL_LOCAL_MEM_FENCE);
 
-	/* skip sorting for cpu split kernel */
 #  ifdef __KERNEL_OPENCL__
 
 	/* bitonic sort */
@@ -78,6 +77,42 @@ ccl_device void kernel_shader_sort(KernelGlobals *kg,
 			}
 		}
 	}
+#  else /* __KERNEL_OPENCL__ */
+
+	/* On the CPU a work group is a single thread which handles the whole
+	 * block, so a stable bottom-up merge sort is used. Shading rays in order
+	 * of their shader keeps SVM nodes and closure code hot in the caches. */
+	int num_items = min((int)(qsize - offset), SHADER_SORT_BLOCK_SIZE);
+	ccl_local ushort *index = local_index;
+	ccl_local ushort *index_tmp = &locals->local_index_tmp[0];
+
+	for(int width = 1; width < num_items; width <<= 1) {
+		for(int lo = 0; lo < num_items; lo += 2*width) {
+			int mid = min(lo + width, num_items);
+			int hi = min(lo + 2*width, num_items);
+			int a = lo, b = mid, k = lo;
+
+			while(a < mid && b < hi) {
+				index_tmp[k++] = (local_value[index[b]] < local_value[index[a]]) ? index[b++] : index[a++];
+			}
+			while(a < mid) {
+				index_tmp[k++] = index[a++];
+			}
+			while(b < hi) {
+				index_tmp[k++] = index[b++];
+			}
+		}
+
+		ccl_local ushort *swap_index = index;
+		index = index_tmp;
+		index_tmp = swap_index;
+	}
+
+	if(index != local_index) {
+		for(int i = 0; i < num_items; i++) {
+			local_index[i] = index[i];
+		}
+	}
 #  endif /* __KERNEL_OPENCL__ */
 
 	/* copy to destination */
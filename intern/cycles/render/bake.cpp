@@ -102,7 +102,6 @@ uint4 BakeData::differentials(int i)
 
 BakeManager::BakeManager()
 {
-	m_bake_data = NULL;
 	m_is_baking = false;
 	need_update = true;
 	m_shader_limit = 512 * 512;
@@ -110,8 +109,6 @@ BakeManager::BakeManager()
 
 BakeManager::~BakeManager()
 {
-	if(m_bake_data)
-		delete m_bake_data;
 }
 
 bool BakeManager::get_baking()
@@ -124,12 +121,6 @@ void BakeManager::set_baking(const bool value)
 	m_is_baking = value;
 }
 
-BakeData *BakeManager::init(const int object, const size_t tri_offset, const size_t num_pixels)
-{
-	m_bake_data = new BakeData(object, tri_offset, num_pixels);
-	return m_bake_data;
-}
-
 void BakeManager::set_shader_limit(const size_t x, const size_t y)
 {
 	m_shader_limit = x * y;
@@ -138,90 +129,125 @@ void BakeManager::set_shader_limit(const size_t x, const size_t y)
 
 bool BakeManager::bake(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress, ShaderEvalType shader_type, const int pass_filter, BakeData *bake_data, float result[])
 {
-	size_t num_pixels = bake_data->size();
+	vector<BakePass> passes(1);
+	passes[0].bake_data = bake_data;
+	passes[0].shader_type = shader_type;
+	passes[0].pass_filter = pass_filter;
+	passes[0].result = result;
 
-	int num_samples = aa_samples(scene, bake_data, shader_type);
+	return bake_batch(device, dscene, scene, progress, passes);
+}
 
+/* Bake all passes with the scene and BVH that are already on the device.
+ * Consecutive passes with the same BakeData share the uploaded bake input,
+ * so passes should be grouped by object. */
+bool BakeManager::bake_batch(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress, const vector<BakePass>& passes)
+{
 	/* calculate the total pixel samples for the progress bar */
 	total_pixel_samples = 0;
-	for(size_t shader_offset = 0; shader_offset < num_pixels; shader_offset += m_shader_limit) {
-		size_t shader_size = (size_t)fminf(num_pixels - shader_offset, m_shader_limit);
-		total_pixel_samples += shader_size * num_samples;
+	foreach(const BakePass& pass, passes) {
+		total_pixel_samples += pass.bake_data->size() * aa_samples(scene, pass.bake_data, pass.shader_type);
 	}
 	progress.reset_sample();
 	progress.set_total_pixel_samples(total_pixel_samples);
 
-	/* needs to be up to date for baking specific AA samples */
-	dscene->data.integrator.aa_samples = num_samples;
-	device->const_copy_to("__data", &dscene->data, sizeof(dscene->data));
+	/* number of samples in the constant data on the device */
+	int device_num_samples = -1;
 
-	for(size_t shader_offset = 0; shader_offset < num_pixels; shader_offset += m_shader_limit) {
-		size_t shader_size = (size_t)fminf(num_pixels - shader_offset, m_shader_limit);
+	size_t first_pass = 0;
+	while(first_pass < passes.size()) {
+		BakeData *bake_data = passes[first_pass].bake_data;
+		size_t end_pass = first_pass + 1;
+		while(end_pass < passes.size() && passes[end_pass].bake_data == bake_data) {
+			end_pass++;
+		}
 
-		/* setup input for device task */
-		device_vector<uint4> d_input(device, "bake_input", MEM_READ_ONLY);
-		uint4 *d_input_data = d_input.alloc(shader_size * 2);
-		size_t d_input_size = 0;
+		size_t num_pixels = bake_data->size();
 
-		for(size_t i = shader_offset; i < (shader_offset + shader_size); i++) {
-			d_input_data[d_input_size++] = bake_data->data(i);
-			d_input_data[d_input_size++] = bake_data->differentials(i);
-		}
+		for(size_t shader_offset = 0; shader_offset < num_pixels; shader_offset += m_shader_limit) {
+			size_t shader_size = (size_t)fminf(num_pixels - shader_offset, m_shader_limit);
 
-		if(d_input_size == 0) {
-			m_is_baking = false;
-			return false;
-		}
+			/* setup input for device task, shared by all passes of the object */
+			device_vector<uint4> d_input(device, "bake_input", MEM_READ_ONLY);
+			uint4 *d_input_data = d_input.alloc(shader_size * 2);
+			size_t d_input_size = 0;
 
-		/* run device task */
-		device_vector<float4> d_output(device, "bake_output", MEM_READ_WRITE);
-		d_output.alloc(shader_size);
-		d_output.zero_to_device();
-		d_input.copy_to_device();
-
-		DeviceTask task(DeviceTask::SHADER);
-		task.shader_input = d_input.device_pointer;
-		task.shader_output = d_output.device_pointer;
-		task.shader_eval_type = shader_type;
-		task.shader_filter = pass_filter;
-		task.shader_x = 0;
-		task.offset = shader_offset;
-		task.shader_w = d_output.size();
-		task.num_samples = num_samples;
-		task.get_cancel = function_bind(&Progress::get_cancel, &progress);
-		task.update_progress_sample = function_bind(&Progress::add_samples_update, &progress, _1, _2);
-
-		device->task_add(task);
-		device->task_wait();
-
-		if(progress.get_cancel()) {
-			d_input.free();
-			d_output.free();
-			m_is_baking = false;
-			return false;
-		}
+			for(size_t i = shader_offset; i < (shader_offset + shader_size); i++) {
+				d_input_data[d_input_size++] = bake_data->data(i);
+				d_input_data[d_input_size++] = bake_data->differentials(i);
+			}
 
-		d_output.copy_from_device(0, 1, d_output.size());
-		d_input.free();
+			if(d_input_size == 0) {
+				m_is_baking = false;
+				return false;
+			}
+
+			d_input.copy_to_device();
+
+			device_vector<float4> d_output(device, "bake_output", MEM_READ_WRITE);
+			d_output.alloc(shader_size);
+
+			for(size_t p = first_pass; p < end_pass; p++) {
+				const BakePass& pass = passes[p];
+				int num_samples = aa_samples(scene, bake_data, pass.shader_type);
+
+				/* needs to be up to date for baking specific AA samples */
+				if(num_samples != device_num_samples) {
+					dscene->data.integrator.aa_samples = num_samples;
+					device->const_copy_to("__data", &dscene->data, sizeof(dscene->data));
+					device_num_samples = num_samples;
+				}
 
-		/* read result */
-		int k = 0;
+				/* run device task */
+				d_output.zero_to_device();
+
+				DeviceTask task(DeviceTask::SHADER);
+				task.shader_input = d_input.device_pointer;
+				task.shader_output = d_output.device_pointer;
+				task.shader_eval_type = pass.shader_type;
+				task.shader_filter = pass.pass_filter;
+				task.shader_x = 0;
+				task.offset = shader_offset;
+				task.shader_w = d_output.size();
+				task.num_samples = num_samples;
+				task.get_cancel = function_bind(&Progress::get_cancel, &progress);
+				task.update_progress_sample = function_bind(&Progress::add_samples_update, &progress, _1, _2);
+
+				device->task_add(task);
+				device->task_wait();
+
+				if(progress.get_cancel()) {
+					d_input.free();
+					d_output.free();
+					m_is_baking = false;
+					return false;
+				}
+
+				d_output.copy_from_device(0, 1, d_output.size());
+
+				/* read result */
+				int k = 0;
 
-		float4 *offset = d_output.data();
+				float4 *offset = d_output.data();
 
-		size_t depth = 4;
-		for(size_t i=shader_offset; i < (shader_offset + shader_size); i++) {
-			size_t index = i * depth;
-			float4 out = offset[k++];
+				size_t depth = 4;
+				for(size_t i=shader_offset; i < (shader_offset + shader_size); i++) {
+					size_t index = i * depth;
+					float4 out = offset[k++];
 
-			if(bake_data->is_valid(i)) {
-				for(size_t j=0; j < 4; j++) {
-					result[index + j] = out[j];
+					if(bake_data->is_valid(i)) {
+						for(size_t j=0; j < 4; j++) {
+							pass.result[index + j] = out[j];
+						}
+					}
 				}
 			}
+
+			d_input.free();
+			d_output.free();
 		}
 
-		d_output.free();
+		first_pass = end_pass;
 	}
 
 	m_is_baking = false;
@@ -51,6 +51,15 @@ private:
 	vector<float>m_dvdy;
 };
 
+/* One pass to bake for the pixels of a BakeData, used for baking multiple
+ * objects and passes in one go with BakeManager::bake_batch(). */
+struct BakePass {
+	BakeData *bake_data;
+	ShaderEvalType shader_type;
+	int pass_filter;
+	float *result;
+};
+
 class BakeManager {
 public:
 	BakeManager();
@@ -59,11 +68,10 @@ public:
 	bool get_baking();
 	void set_baking(const bool value);
 
-	BakeData *init(const int object, const size_t tri_offset, const size_t num_pixels);
-
 	void set_shader_limit(const size_t x, const size_t y);
 
 	bool bake(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress, ShaderEvalType shader_type, const int pass_filter, BakeData *bake_data, float result[]);
+	bool bake_batch(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress, const vector<BakePass>& passes);
 
 	void device_update(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
 	void device_free(Device *device, DeviceScene *dscene);
@@ -76,7 +84,6 @@ public:
 	size_t total_pixel_samples;
 
 private:
-	BakeData *m_bake_data;
 	bool m_is_baking;
 	size_t m_shader_limit;
 };
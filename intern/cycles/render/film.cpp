@@ -119,6 +119,15 @@ void Pass::add(PassType type, array<Pass>& passes)
 			/* This pass is handled entirely on the host side. */
 			pass.components = 0;
 			break;
+		case PASS_ADAPTIVE_AUX_BUFFER:
+			pass.components = 4;
+			pass.filter = false;
+			break;
+		case PASS_SAMPLE_COUNT:
+			pass.components = 1;
+			pass.filter = false;
+			pass.exposure = false;
+			break;
 
 		case PASS_DIFFUSE_COLOR:
 		case PASS_GLOSSY_COLOR:
@@ -313,6 +322,8 @@ void Film::device_update(Device *device, DeviceScene *dscene, Scene *scene)
 	kfilm->light_pass_flag = 0;
 	kfilm->pass_stride = 0;
 	kfilm->use_light_pass = use_light_visibility || use_sample_clamp;
+	kfilm->pass_adaptive_aux_buffer = 0;
+	kfilm->pass_sample_count = 0;
 
 	for(size_t i = 0; i < passes.size(); i++) {
 		Pass& pass = passes[i];
@@ -434,6 +445,12 @@ void Film::device_update(Device *device, DeviceScene *dscene, Scene *scene)
 #endif
 			case PASS_RENDER_TIME:
 				break;
+			case PASS_ADAPTIVE_AUX_BUFFER:
+				kfilm->pass_adaptive_aux_buffer = kfilm->pass_stride;
+				break;
+			case PASS_SAMPLE_COUNT:
+				kfilm->pass_sample_count = kfilm->pass_stride;
+				break;
 
 			default:
 				assert(false);
@@ -501,6 +518,9 @@ void Film::tag_passes_update(Scene *scene, const array<Pass>& passes_)
 	else if(Pass::contains(passes, PASS_MOTION) != Pass::contains(passes_, PASS_MOTION))
 		scene->mesh_manager->tag_update(scene);
 
+	if(Pass::contains(passes, PASS_ADAPTIVE_AUX_BUFFER) != Pass::contains(passes_, PASS_ADAPTIVE_AUX_BUFFER))
+		scene->integrator->tag_update(scene);
+
 	passes = passes_;
 }
 
@@ -18,11 +18,15 @@
 #include "render/image.h"
 #include "render/scene.h"
 
+#include "kernel/kernel_oiio_globals.h"
+
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
 #include "util/util_path.h"
 #include "util/util_progress.h"
 #include "util/util_texture.h"
+#include "util/util_texture_compression.h"
+#include "util/util_texture_sparse.h"
 
 #ifdef WITH_OSL
 #include <OSL/oslexec.h>
@@ -40,7 +44,7 @@ static bool isfinite(half /*value*/)
 	return false;
 }
 
-ImageManager::ImageManager(const DeviceInfo& info)
+ImageManager::ImageManager(const DeviceInfo& info, const SceneParams& params)
 {
 	need_update = true;
 	osl_texture_system = NULL;
@@ -49,6 +53,9 @@ ImageManager::ImageManager(const DeviceInfo& info)
 	/* Set image limits */
 	max_num_images = TEX_NUM_MAX;
 	has_half_images = info.has_half_images;
+	has_sparse_images = info.has_sparse_images;
+	use_half_textures = params.use_half_textures && info.has_half_images;
+	use_compressed_textures = params.use_compressed_textures && info.has_compressed_images;
 
 	for(size_t type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
 		tex_num_images[type] = 0;
@@ -280,6 +287,17 @@ int ImageManager::add_image(const string& filename,
 		}
 	}
 
+	/* Store float image files as half float. Builtin images are passed in as
+	 * full float, so they keep that. */
+	if(use_half_textures && !builtin_data) {
+		if(type == IMAGE_DATA_TYPE_FLOAT4) {
+			type = IMAGE_DATA_TYPE_HALF4;
+		}
+		else if(type == IMAGE_DATA_TYPE_FLOAT) {
+			type = IMAGE_DATA_TYPE_HALF;
+		}
+	}
+
 	/* Fnd existing image. */
 	for(slot = 0; slot < images[type].size(); slot++) {
 		img = images[type][slot];
@@ -518,6 +536,7 @@ bool ImageManager::file_load_image(Image *img,
 		return false;
 	}
 	bool cmyk = false;
+	bool is_float_to_half = false;
 	const size_t num_pixels = ((size_t)width) * height * depth;
 	if(in) {
 		StorageType *readpixels = pixels;
@@ -548,6 +567,7 @@ bool ImageManager::file_load_image(Image *img,
 			tmppixels.clear();
 		}
 		cmyk = strcmp(in->format_name(), "jpeg") == 0 && components == 4;
+		is_float_to_half = (FileFormat == TypeDesc::HALF && in->spec().format != TypeDesc::HALF);
 		in->close();
 		delete in;
 	}
@@ -649,6 +669,18 @@ bool ImageManager::file_load_image(Image *img,
 			}
 		}
 	}
+	else if(is_float_to_half) {
+		/* Float files read as half overflow to infinity above 65504, clamp
+		 * those to the largest half value and set NaN to zero. Half files
+		 * are left as they are. */
+		half *values = (half*)pixels;
+		const size_t num_values = num_pixels * (is_rgba ? 4 : 1);
+		for(size_t i = 0; i < num_values; i++) {
+			if((values[i] & 0x7c00) == 0x7c00) {
+				values[i] = (values[i] & 0x03ff)? 0: ((values[i] & 0x8000) | 0x7bff);
+			}
+		}
+	}
 	/* Scale image down if needed. */
 	if(pixels_storage.size() > 0) {
 		float scale_factor = 1.0f;
@@ -679,6 +711,67 @@ bool ImageManager::file_load_image(Image *img,
 		       &scaled_pixels[0],
 		       scaled_pixels.size() * sizeof(StorageType));
 	}
+	/* Store volumes sparse, smoke domains are often mostly empty. */
+	if(has_sparse_images && tex_img.data_depth > 1) {
+		image_make_sparse(img, tex_img);
+	}
+	else if(use_compressed_textures && type == IMAGE_DATA_TYPE_BYTE4 && tex_img.data_depth <= 1) {
+		image_compress(img, tex_img);
+	}
+	return true;
+}
+
+/* Block compress a byte4 texture, in blocks of 4x4 texels. */
+template<typename DeviceType>
+void ImageManager::image_compress(Image *img, device_vector<DeviceType>& tex_img)
+{
+	const size_t width = tex_img.data_width;
+	const size_t height = max(tex_img.data_height, (size_t)1);
+
+	const size_t num_bytes = texture_bc3_size(width, height);
+	vector<uchar> blocks(num_bytes);
+	texture_bc3_encode_image((const uchar4*)tex_img.data(), width, height, &blocks[0]);
+
+	VLOG(1) << "Compressed " << img->filename << " from "
+	        << string_human_readable_size(tex_img.memory_size()) << " to "
+	        << string_human_readable_size(num_bytes) << ".";
+
+	thread_scoped_lock device_lock(device_mutex);
+	DeviceType *mem = tex_img.alloc_compressed(divide_up(num_bytes, sizeof(DeviceType)),
+	                                           IMAGE_COMPRESSION_BC3,
+	                                           width, height);
+	memcpy(mem, &blocks[0], num_bytes);
+}
+
+/* Convert a dense 3D texture to sparse storage, see util_texture_sparse.h.
+ * The tiles are written directly into the new texture memory, and only after
+ * that the dense voxels are freed. So the texture is left dense unless sparse
+ * storage at least halves its memory, which keeps the peak memory usage of
+ * the conversion below one and a half times the dense texture. */
+template<typename DeviceType>
+bool ImageManager::image_make_sparse(Image *img, device_vector<DeviceType>& tex_img)
+{
+	const size_t width = tex_img.data_width;
+	const size_t height = tex_img.data_height;
+	const size_t depth = tex_img.data_depth;
+
+	vector<int> grid;
+	const size_t num_used_tiles = texture_sparse_tiles(tex_img.data(), width, height, depth, grid);
+	const size_t grid_size = texture_sparse_grid_size<DeviceType>(grid.size());
+	const size_t sparse_size = texture_sparse_size<DeviceType>(grid.size(), num_used_tiles);
+	if(sparse_size*2 > width*height*depth) {
+		return false;
+	}
+
+	array<DeviceType> sparse(sparse_size);
+	texture_sparse_encode(tex_img.data(), width, height, depth, grid, sparse.data());
+
+	VLOG(1) << "Sparse storage for " << img->filename << ", "
+	        << num_used_tiles << " of " << grid.size() << " tiles used.";
+
+	thread_scoped_lock device_lock(device_mutex);
+	tex_img.steal_sparse(sparse, grid_size, width, height, depth);
+
 	return true;
 }
 
@@ -712,6 +805,12 @@ void ImageManager::device_load_image(Device *device,
 		img->mem = NULL;
 	}
 
+	/* Images handled by the texture cache are loaded on demand by the kernel. */
+	if(texture_cache_load_image(device, scene, img, flat_slot)) {
+		img->need_load = false;
+		return;
+	}
+
 	/* Create new texture. */
 	if(type == IMAGE_DATA_TYPE_FLOAT4) {
 		device_vector<float4> *tex_img
@@ -861,7 +960,7 @@ void ImageManager::device_load_image(Device *device,
 	img->need_load = false;
 }
 
-void ImageManager::device_free_image(Device *, ImageDataType type, int slot)
+void ImageManager::device_free_image(Device *device, ImageDataType type, int slot)
 {
 	Image *img = images[type][slot];
 
@@ -873,6 +972,12 @@ void ImageManager::device_free_image(Device *, ImageDataType type, int slot)
 #endif
 		}
 
+		OIIOGlobals *oiio = (OIIOGlobals*)device->oiio_memory();
+		size_t flat_slot = type_index_to_flattened_slot(slot, type);
+		if(oiio && flat_slot < oiio->textures.size()) {
+			oiio->textures[flat_slot] = OIIOTexture();
+		}
+
 		if(img->mem) {
 			thread_scoped_lock device_lock(device_mutex);
 			delete img->mem;
@@ -892,6 +997,10 @@ void ImageManager::device_update(Device *device,
 		return;
 	}
 
+	if(scene->params.use_texture_cache) {
+		texture_cache_init(device, scene->params.texture_cache_size);
+	}
+
 	TaskPool pool;
 	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
 		for(size_t slot = 0; slot < images[type].size(); slot++) {
@@ -934,6 +1043,9 @@ void ImageManager::device_update_slot(Device *device,
 		device_free_image(device, type, slot);
 	}
 	else if(image->need_load) {
+		if(scene->params.use_texture_cache) {
+			texture_cache_init(device, scene->params.texture_cache_size);
+		}
 		if(!osl_texture_system || image->builtin_data)
 			device_load_image(device,
 			                  scene,
@@ -961,6 +1073,173 @@ void ImageManager::device_free(Device *device)
 		}
 		images[type].clear();
 	}
+
+	texture_cache_free(device);
+}
+
+static TextureSystem *texture_cache_create(bool unassociated_alpha)
+{
+	TextureSystem *tex_sys = TextureSystem::create(false);
+	/* Images which are not tiled or MIP-mapped on disk are tiled and
+	 * MIP-mapped by the cache itself when reading them. */
+	tex_sys->attribute("automip", 1);
+	tex_sys->attribute("autotile", 64);
+	tex_sys->attribute("gray_to_rgb", 1);
+	tex_sys->attribute("unassociatedalpha", unassociated_alpha? 1: 0);
+	return tex_sys;
+}
+
+void ImageManager::texture_cache_init(Device *device, int cache_size)
+{
+	OIIOGlobals *oiio = (OIIOGlobals*)device->oiio_memory();
+	if(!oiio) {
+		/* Device does not support the texture cache. */
+		return;
+	}
+
+	/* Images which don't use alpha are read with unassociated alpha, like
+	 * in file_load_image(), which needs a separate texture system. */
+	bool need_unassociated = false;
+	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
+		foreach(Image *img, images[type]) {
+			if(img && !img->use_alpha && !img->builtin_data) {
+				need_unassociated = true;
+			}
+		}
+	}
+
+	if(!oiio->tex_sys) {
+		oiio->tex_sys = texture_cache_create(false);
+	}
+	if(need_unassociated && !oiio->tex_sys_unassociated) {
+		oiio->tex_sys_unassociated = texture_cache_create(true);
+	}
+
+	/* Both texture systems share the memory budget. */
+	if(oiio->tex_sys_unassociated) {
+		oiio->tex_sys->attribute("max_memory_MB", 0.5f * cache_size);
+		oiio->tex_sys_unassociated->attribute("max_memory_MB", 0.5f * cache_size);
+	}
+	else {
+		oiio->tex_sys->attribute("max_memory_MB", (float)cache_size);
+	}
+
+	/* Images are loaded from multiple threads, so allocate all slots
+	 * upfront. */
+	size_t num_slots = 0;
+	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
+		size_t type_slots = type_index_to_flattened_slot(images[type].size(),
+		                                                 (ImageDataType)type);
+		if(type_slots > num_slots) {
+			num_slots = type_slots;
+		}
+	}
+	if(oiio->textures.size() < num_slots) {
+		oiio->textures.resize(num_slots);
+	}
+}
+
+bool ImageManager::texture_cache_load_image(Device *device,
+                                            Scene *scene,
+                                            Image *img,
+                                            int flat_slot)
+{
+	/* Builtin images only exist in memory, and downscaled images have to be
+	 * resized when loading. */
+	if(!scene->params.use_texture_cache ||
+	   scene->params.texture_limit > 0 ||
+	   img->builtin_data)
+	{
+		return false;
+	}
+
+	OIIOGlobals *oiio = (OIIOGlobals*)device->oiio_memory();
+	if(!oiio || !oiio->tex_sys || (size_t)flat_slot >= oiio->textures.size()) {
+		return false;
+	}
+
+	/* Missing files go through regular loading, to get the missing image
+	 * color. */
+	if(!path_exists(img->filename) || path_is_directory(img->filename)) {
+		return false;
+	}
+
+	TextureSystem *tex_sys = (img->use_alpha)? oiio->tex_sys: oiio->tex_sys_unassociated;
+	if(!tex_sys) {
+		return false;
+	}
+
+	ustring filename(img->filename);
+	TextureSystem::TextureHandle *handle = tex_sys->get_texture_handle(filename);
+	if(!handle) {
+		return false;
+	}
+
+	/* Forget about tiles from a previous version of the file. */
+	tex_sys->invalidate(filename);
+
+	/* Same as file_load_image(), 4 channel JPEG files are CMYK. */
+	ImageSpec spec;
+	ustring fileformat;
+	if(!tex_sys->get_imagespec(filename, 0, spec) ||
+	   !tex_sys->get_texture_info(filename, 0, ustring("fileformat"), TypeDesc(TypeDesc::STRING), &fileformat))
+	{
+		return false;
+	}
+
+	OIIOTexture& tex = oiio->textures[flat_slot];
+	tex.is_cmyk = (fileformat == "jpeg" && spec.nchannels == 4);
+	switch(img->interpolation) {
+		case INTERPOLATION_CLOSEST:
+			tex.interpolation = TextureOpt::InterpClosest;
+			break;
+		case INTERPOLATION_LINEAR:
+			tex.interpolation = TextureOpt::InterpBilinear;
+			break;
+		default:
+			tex.interpolation = TextureOpt::InterpBicubic;
+			break;
+	}
+	switch(img->extension) {
+		case EXTENSION_CLIP:
+			tex.extension = TextureOpt::WrapBlack;
+			break;
+		case EXTENSION_EXTEND:
+			tex.extension = TextureOpt::WrapClamp;
+			break;
+		default:
+			tex.extension = TextureOpt::WrapPeriodic;
+			break;
+	}
+	tex.use_alpha = img->use_alpha;
+	tex.handle = handle;
+
+	VLOG(1) << "Image " << img->filename << " is handled by the texture cache.";
+
+	return true;
+}
+
+void ImageManager::texture_cache_free(Device *device)
+{
+	OIIOGlobals *oiio = (OIIOGlobals*)device->oiio_memory();
+	if(!oiio || !oiio->tex_sys) {
+		return;
+	}
+
+	VLOG(1) << "Texture cache statistics:\n" << oiio->tex_sys->getstats();
+
+	TextureSystem::destroy(oiio->tex_sys);
+	oiio->tex_sys = NULL;
+
+	if(oiio->tex_sys_unassociated) {
+		VLOG(1) << "Texture cache statistics, unassociated alpha:\n"
+		        << oiio->tex_sys_unassociated->getstats();
+
+		TextureSystem::destroy(oiio->tex_sys_unassociated);
+		oiio->tex_sys_unassociated = NULL;
+	}
+
+	oiio->textures.clear();
 }
 
 CCL_NAMESPACE_END
@@ -30,6 +30,7 @@ CCL_NAMESPACE_BEGIN
 class Device;
 class Progress;
 class Scene;
+class SceneParams;
 
 class ImageMetaData {
 public:
@@ -46,7 +47,7 @@ public:
 
 class ImageManager {
 public:
-	explicit ImageManager(const DeviceInfo& info);
+	ImageManager(const DeviceInfo& info, const SceneParams& params);
 	~ImageManager();
 
 	int add_image(const string& filename,
@@ -129,6 +130,9 @@ private:
 	int tex_num_images[IMAGE_DATA_NUM_TYPES];
 	int max_num_images;
 	bool has_half_images;
+	bool has_sparse_images;
+	bool use_half_textures;
+	bool use_compressed_textures;
 
 	thread_mutex device_mutex;
 	int animation_frame;
@@ -151,6 +155,11 @@ private:
 	                     int texture_limit,
 	                     device_vector<DeviceType>& tex_img);
 
+	template<typename DeviceType>
+	bool image_make_sparse(Image *img, device_vector<DeviceType>& tex_img);
+	template<typename DeviceType>
+	void image_compress(Image *img, device_vector<DeviceType>& tex_img);
+
 	int max_flattened_slot(ImageDataType type);
 	int type_index_to_flattened_slot(int slot, ImageDataType type);
 	int flattened_slot_to_type_index(int flat_slot, ImageDataType *type);
@@ -164,6 +173,13 @@ private:
 	void device_free_image(Device *device,
 	                       ImageDataType type,
 	                       int slot);
+
+	void texture_cache_init(Device *device, int cache_size);
+	bool texture_cache_load_image(Device *device,
+	                              Scene *scene,
+	                              Image *img,
+	                              int flat_slot);
+	void texture_cache_free(Device *device);
 };
 
 CCL_NAMESPACE_END
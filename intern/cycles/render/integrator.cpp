@@ -21,6 +21,7 @@
 #include "render/light.h"
 #include "render/scene.h"
 #include "render/shader.h"
+#include "render/jitter.h"
 #include "render/sobol.h"
 
 #include "util/util_foreach.h"
@@ -67,6 +68,11 @@ NODE_DEFINE(Integrator)
 	SOCKET_BOOLEAN(sample_all_lights_direct, "Sample All Lights Direct", true);
 	SOCKET_BOOLEAN(sample_all_lights_indirect, "Sample All Lights Indirect", true);
 	SOCKET_FLOAT(light_sampling_threshold, "Light Sampling Threshold", 0.05f);
+	SOCKET_BOOLEAN(use_light_tree, "Use Light Tree", false);
+
+	SOCKET_BOOLEAN(use_adaptive_sampling, "Use Adaptive Sampling", false);
+	SOCKET_FLOAT(adaptive_threshold, "Adaptive Threshold", 0.0f);
+	SOCKET_INT(adaptive_min_samples, "Adaptive Min Samples", 0);
 
 	static NodeEnum method_enum;
 	method_enum.insert("path", PATH);
@@ -76,6 +82,7 @@ NODE_DEFINE(Integrator)
 	static NodeEnum sampling_pattern_enum;
 	sampling_pattern_enum.insert("sobol", SAMPLING_PATTERN_SOBOL);
 	sampling_pattern_enum.insert("cmj", SAMPLING_PATTERN_CMJ);
+	sampling_pattern_enum.insert("pmj", SAMPLING_PATTERN_PMJ);
 	SOCKET_ENUM(sampling_pattern, "Sampling Pattern", sampling_pattern_enum, SAMPLING_PATTERN_SOBOL);
 
 	return type;
@@ -156,7 +163,9 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
 	kintegrator->volume_samples = volume_samples;
 	kintegrator->start_sample = start_sample;
 
-	if(method == BRANCHED_PATH) {
+	/* Light tree selects lights per shading point, sampling all lights is
+	 * not supported with it. */
+	if(method == BRANCHED_PATH && !use_light_tree) {
 		kintegrator->sample_all_lights_direct = sample_all_lights_direct;
 		kintegrator->sample_all_lights_indirect = sample_all_lights_indirect;
 	}
@@ -175,7 +184,24 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
 		kintegrator->light_inv_rr_threshold = 0.0f;
 	}
 
-	/* sobol directions table */
+	/* Adaptive sampling. Convergence is tested every few samples, the
+	 * minimum number of samples is rounded up to match. */
+	kintegrator->use_adaptive_sampling = use_adaptive_sampling &&
+	                                     Pass::contains(scene->film->passes, PASS_ADAPTIVE_AUX_BUFFER);
+	kintegrator->adaptive_step = 4;
+	if(adaptive_threshold > 0.0f) {
+		kintegrator->adaptive_threshold = adaptive_threshold;
+	}
+	else {
+		kintegrator->adaptive_threshold = max(0.001f, 1.0f / (float)max(aa_samples, 1));
+	}
+	int min_samples = adaptive_min_samples;
+	if(min_samples <= 0) {
+		min_samples = max(4, (int)sqrtf((float)aa_samples));
+	}
+	kintegrator->adaptive_min_samples = (int)align_up(min_samples, kintegrator->adaptive_step);
+
+	/* sample pattern lookup table, sobol directions or progressive multi-jitter */
 	int max_samples = 1;
 
 	if(method == BRANCHED_PATH) {
@@ -195,11 +221,17 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
 	int dimensions = PRNG_BASE_NUM + max_samples*PRNG_BOUNCE_NUM;
 	dimensions = min(dimensions, SOBOL_MAX_DIMENSIONS);
 
-	uint *directions = dscene->sobol_directions.alloc(SOBOL_BITS*dimensions);
-
-	sobol_generate_direction_vectors((uint(*)[SOBOL_BITS])directions, dimensions);
+	if(sampling_pattern == SAMPLING_PATTERN_PMJ) {
+		/* Progressive multi-jitter table, which covers all dimensions. */
+		uint *table = dscene->sample_pattern_lut.alloc(NUM_PMJ_PATTERNS*NUM_PMJ_SAMPLES*2);
+		progressive_multi_jitter_generate_table(table);
+	}
+	else {
+		uint *directions = dscene->sample_pattern_lut.alloc(SOBOL_BITS*dimensions);
+		sobol_generate_direction_vectors((uint(*)[SOBOL_BITS])directions, dimensions);
+	}
 
-	dscene->sobol_directions.copy_to_device();
+	dscene->sample_pattern_lut.copy_to_device();
 
 	/* Clamping. */
 	bool use_sample_clamp = (sample_clamp_direct != 0.0f ||
@@ -214,7 +246,7 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
 
 void Integrator::device_free(Device *, DeviceScene *dscene)
 {
-	dscene->sobol_directions.free();
+	dscene->sample_pattern_lut.free();
 }
 
 bool Integrator::modified(const Integrator& integrator)
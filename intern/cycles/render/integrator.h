@@ -69,6 +69,16 @@ public:
 	bool sample_all_lights_indirect;
 	float light_sampling_threshold;
 
+	/* Select lights using a light tree, see LightManager. */
+	bool use_light_tree;
+
+	/* Stop sampling pixels once their estimated error is below the
+	 * threshold, zero threshold and minimum samples are chosen from the
+	 * AA sample count. */
+	bool use_adaptive_sampling;
+	float adaptive_threshold;
+	int adaptive_min_samples;
+
 	enum Method {
 		BRANCHED_PATH = 0,
 		PATH = 1,
@@ -0,0 +1,233 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/jitter.h"
+
+#include "kernel/kernel_types.h"
+
+#include "util/util_foreach.h"
+#include "util/util_math.h"
+#include "util/util_task.h"
+#include "util/util_thread.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class PMJ02_Generator {
+public:
+	explicit PMJ02_Generator(int seed)
+	: rng_state((uint64_t)seed * 0x9E3779B97F4A7C15ULL + 1)
+	{
+	}
+
+	void generate_2D(float2 points[], int size)
+	{
+		points[0] = make_float2(quantize(rnd()), quantize(rnd()));
+
+		/* Each iteration first fills the empty diagonal subquadrants of the
+		 * cells of a power of four grid, and then the remaining ones. */
+		for(int N = 1; N < size; N *= 4) {
+			extend_sequence_even(points, N);
+			if(2*N < size) {
+				extend_sequence_odd(points, 2*N);
+			}
+		}
+	}
+
+protected:
+	uint64_t rng_state;
+
+	/* Occupied elementary intervals, for every shape of interval. Shape k has
+	 * size >> k intervals in x and 1 << k in y. */
+	vector<vector<bool> > occupied;
+
+	double rnd()
+	{
+		rng_state = rng_state * 6364136223846793005ULL + 1442695040888963407ULL;
+		return (double)(rng_state >> 40) * (1.0/16777216.0);
+	}
+
+	/* Round down to 23 bits, exactly representable as float and as mantissa
+	 * of the lookup table values, and never crossing an interval boundary. */
+	static float quantize(double x)
+	{
+		return (float)(floor(x * 8388608.0) * (1.0/8388608.0));
+	}
+
+	/* Add N points, one in the subquadrant diagonally opposite each of the
+	 * first N points in their cell of a sqrt(N) by sqrt(N) grid. */
+	void extend_sequence_even(float2 points[], int N)
+	{
+		const int n = (int)sqrtf((float)N);
+		mark_occupied_strata(points, N, 2*N);
+
+		for(int s = 0; s < N; s++) {
+			const float2 p = points[s];
+			const int i = (int)(n * p.x), j = (int)(n * p.y);
+			const int xhalf = 1 - (int)(2.0f * (n * p.x - i));
+			const int yhalf = 1 - (int)(2.0f * (n * p.y - j));
+			points[N + s] = generate_sample_point(i, j, xhalf, yhalf, n, 2*N);
+		}
+	}
+
+	/* Add N points in the two subquadrants of every grid cell which are still
+	 * empty after the even step, first half of them in one of the two chosen
+	 * at random, then the other half in the other. */
+	void extend_sequence_odd(float2 points[], int N)
+	{
+		const int n = (int)sqrtf((float)(N/2));
+		mark_occupied_strata(points, N, 2*N);
+
+		vector<int> xhalves(N/2), yhalves(N/2);
+		for(int s = 0; s < N/2; s++) {
+			const float2 p = points[s];
+			const int i = (int)(n * p.x), j = (int)(n * p.y);
+			int xhalf = (int)(2.0f * (n * p.x - i));
+			int yhalf = (int)(2.0f * (n * p.y - j));
+			if(rnd() > 0.5) {
+				xhalf = 1 - xhalf;
+			}
+			else {
+				yhalf = 1 - yhalf;
+			}
+			xhalves[s] = xhalf;
+			yhalves[s] = yhalf;
+			points[N + s] = generate_sample_point(i, j, xhalf, yhalf, n, 2*N);
+		}
+		for(int s = 0; s < N/2; s++) {
+			const float2 p = points[s];
+			const int i = (int)(n * p.x), j = (int)(n * p.y);
+			points[N + N/2 + s] = generate_sample_point(i, j, 1 - xhalves[s], 1 - yhalves[s], n, 2*N);
+		}
+	}
+
+	void mark_occupied_strata(const float2 points[], int N, int NN)
+	{
+		int num_shapes = 0;
+		for(int divs = NN; divs > 0; divs >>= 1) {
+			num_shapes++;
+		}
+		occupied.resize(num_shapes);
+		for(int shape = 0; shape < num_shapes; shape++) {
+			occupied[shape].assign(NN, false);
+		}
+		for(int s = 0; s < N; s++) {
+			mark_occupied(points[s], NN);
+		}
+	}
+
+	void mark_occupied(float2 p, int NN)
+	{
+		for(int shape = 0, xdivs = NN, ydivs = 1; xdivs > 0; shape++, xdivs >>= 1, ydivs <<= 1) {
+			const int x = (int)(xdivs * p.x), y = (int)(ydivs * p.y);
+			occupied[shape][y*xdivs + x] = true;
+		}
+	}
+
+	/* Test cell x, y of an NN by NN grid, which lies within one elementary
+	 * interval of every shape. NN is two to the power of bits. */
+	bool is_occupied(int x, int y, int NN, int bits)
+	{
+		for(int shape = 0; shape <= bits; shape++) {
+			const int xdivs = NN >> shape;
+			if(occupied[shape][(y >> (bits - shape))*xdivs + (x >> shape)]) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/* Random point in the given subquadrant of cell i, j of an n by n grid,
+	 * which is not in an elementary interval occupied by another point.
+	 *
+	 * Rather than rejection sampling, which gets slow for large sequences,
+	 * all cells of the finest NN by NN grid in the subquadrant are tested and
+	 * one of the free ones is picked at random. */
+	float2 generate_sample_point(int i, int j, int xhalf, int yhalf, int n, int NN)
+	{
+		const int cells = NN / (2*n);
+		const int bits = (int)occupied.size() - 1;
+		const int x0 = (2*i + xhalf) * cells;
+		const int y0 = (2*j + yhalf) * cells;
+		const vector<bool>& occupied_x = occupied[0];
+		const vector<bool>& occupied_y = occupied.back();
+
+		int num_valid = 0, x = x0, y = y0;
+		for(int yi = y0; yi < y0 + cells; yi++) {
+			if(occupied_y[yi]) {
+				continue;
+			}
+			for(int xi = x0; xi < x0 + cells; xi++) {
+				if(occupied_x[xi] || is_occupied(xi, yi, NN, bits)) {
+					continue;
+				}
+				/* Reservoir sampling of the free cells. */
+				num_valid++;
+				if(rnd() * num_valid < 1.0) {
+					x = xi;
+					y = yi;
+				}
+			}
+		}
+		assert(num_valid > 0);
+
+		const float2 p = make_float2(quantize((x + rnd()) / NN),
+		                             quantize((y + rnd()) / NN));
+		mark_occupied(p, NN);
+		return p;
+	}
+};
+
+void progressive_multi_jitter_02_generate_2D(float2 points[], int size, int rng_seed)
+{
+	PMJ02_Generator generator(rng_seed);
+	generator.generate_2D(points, size);
+}
+
+static void pmj_generate_pattern(uint *table, int pattern)
+{
+	vector<float2> points(NUM_PMJ_SAMPLES);
+	progressive_multi_jitter_02_generate_2D(&points[0], NUM_PMJ_SAMPLES, pattern);
+
+	uint *values = table + pattern * NUM_PMJ_SAMPLES * 2;
+	for(int i = 0; i < NUM_PMJ_SAMPLES; i++) {
+		/* Points have 23 bits, stored as mantissa of a float in [1, 2). */
+		values[2*i + 0] = 0x3f800000 | (uint)(points[i].x * 8388608.0f);
+		values[2*i + 1] = 0x3f800000 | (uint)(points[i].y * 8388608.0f);
+	}
+}
+
+void progressive_multi_jitter_generate_table(uint *table)
+{
+	static thread_mutex table_mutex;
+	static vector<uint> cached_table;
+
+	thread_scoped_lock lock(table_mutex);
+
+	if(cached_table.empty()) {
+		cached_table.resize(NUM_PMJ_PATTERNS * NUM_PMJ_SAMPLES * 2);
+
+		TaskPool pool;
+		for(int pattern = 0; pattern < NUM_PMJ_PATTERNS; pattern++) {
+			pool.push(function_bind(&pmj_generate_pattern, &cached_table[0], pattern));
+		}
+		pool.wait_work();
+	}
+
+	memcpy(table, &cached_table[0], sizeof(uint) * cached_table.size());
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,41 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __JITTER_H__
+#define __JITTER_H__
+
+#include "util/util_types.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Progressive multi-jittered (0,2) sequence, from "Progressive Multi-Jittered
+ * Sample Sequences", Christensen et al. 2018.
+ *
+ * Every prefix of the sequence with a power of two number of points has one
+ * point in each of the elementary intervals of that size, so the points are
+ * well stratified in 2D and in both 1D projections for any sample count. Size
+ * must be a power of two, points are in [0, 1). */
+void progressive_multi_jitter_02_generate_2D(float2 points[], int size, int rng_seed);
+
+/* Fill the kernel sample pattern lookup table, NUM_PMJ_PATTERNS sequences of
+ * NUM_PMJ_SAMPLES points with interleaved x and y. Values are stored as the
+ * bits of floats in [1, 2), so the kernel can scramble them per pixel by
+ * xor'ing the mantissa. The table is only generated once. */
+void progressive_multi_jitter_generate_table(uint *table);
+
+CCL_NAMESPACE_END
+
+#endif /* __JITTER_H__ */
@@ -19,6 +19,7 @@
 #include "render/integrator.h"
 #include "render/film.h"
 #include "render/light.h"
+#include "render/light_tree.h"
 #include "render/mesh.h"
 #include "render/object.h"
 #include "render/scene.h"
@@ -30,6 +31,17 @@
 
 CCL_NAMESPACE_BEGIN
 
+/* Estimate of the emitted energy of a shader for the light tree, only
+ * constant emission is known without evaluating the shader. */
+static float light_tree_shader_energy(Shader *shader)
+{
+	float3 emission;
+	if(shader && shader->is_constant_emission(&emission)) {
+		return max(average(emission), 0.0f);
+	}
+	return 1.0f;
+}
+
 static void shade_background_pixels(Device *device, DeviceScene *dscene, int res, vector<float3>& pixels, Progress& progress)
 {
 	/* create input */
@@ -242,6 +254,41 @@ bool LightManager::object_usable_as_light(Object *object) {
 	return false;
 }
 
+/* Light tree emitter of a lamp with the given distribution index. */
+static LightTreeEmitter light_tree_lamp_emitter(Light *light, int index)
+{
+	LightTreeEmitter emitter;
+	/* Shader strength is in Watts, convert to intensity along the normal. */
+	float energy = light_tree_shader_energy(light->shader);
+
+	emitter.area = 0.0f;
+	emitter.index = index;
+
+	if(light->type == LIGHT_AREA) {
+		float3 axisu = light->axisu*(light->sizeu*light->size);
+		float3 axisv = light->axisv*(light->sizev*light->size);
+		float3 extent = 0.5f*(fabs(axisu) + fabs(axisv));
+
+		emitter.bounds = BoundBox(light->co - extent, light->co + extent);
+		emitter.cone = LightTreeCone(normalize(light->dir), 0.0f, M_PI_2_F, false);
+		emitter.energy = 0.25f*energy;
+	}
+	else {
+		float3 extent = make_float3(light->size, light->size, light->size);
+
+		emitter.bounds = BoundBox(light->co - extent, light->co + extent);
+		if(light->type == LIGHT_SPOT) {
+			emitter.cone = LightTreeCone(normalize(light->dir), 0.0f, 0.5f*light->spot_angle, false);
+		}
+		else {
+			emitter.cone = LightTreeCone(make_float3(0.0f, 0.0f, 1.0f), M_PI_F, M_PI_2_F, false);
+		}
+		emitter.energy = energy*M_1_PI_F*0.25f;
+	}
+
+	return emitter;
+}
+
 void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Scene *scene, Progress& progress)
 {
 	progress.set_status("Updating Lights", "Computing distribution");
@@ -254,6 +301,12 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 
 	bool background_mis = false;
 
+	/* Light tree emitters. */
+	const bool use_light_tree = scene->integrator->use_light_tree;
+	vector<LightTreeEmitter> emitters;
+	vector<int> infinite_lights;
+	vector<uint2> object_range(max(scene->objects.size(), (size_t)1), make_uint2(0, 0));
+
 	foreach(Light *light, scene->lights) {
 		if(light->is_enabled) {
 			num_lights++;
@@ -326,6 +379,10 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 			use_light_visibility = true;
 		}
 
+		size_t object_offset = offset;
+		Shader *last_shader = NULL;
+		float shader_energy = 0.0f;
+
 		size_t mesh_num_triangles = mesh->num_triangles();
 		for(size_t i = 0; i < mesh_num_triangles; i++) {
 			int shader_index = mesh->shader[i];
@@ -354,10 +411,31 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 					p3 = transform_point(&tfm, p3);
 				}
 
-				totarea += triangle_area(p1, p2, p3);
+				float area = triangle_area(p1, p2, p3);
+				totarea += area;
+
+				if(use_light_tree && area > 0.0f) {
+					if(shader != last_shader) {
+						last_shader = shader;
+						/* Emission closure radiance is scaled by 1/pi. */
+						shader_energy = light_tree_shader_energy(shader)*M_1_PI_F;
+					}
+
+					LightTreeEmitter emitter;
+					emitter.bounds = BoundBox(p1);
+					emitter.bounds.grow(p2);
+					emitter.bounds.grow(p3);
+					emitter.cone = LightTreeCone(normalize(cross(p2 - p1, p3 - p1)), 0.0f, M_PI_2_F, true);
+					emitter.energy = area*shader_energy;
+					emitter.area = area;
+					emitter.index = offset - 1;
+					emitters.push_back(emitter);
+				}
 			}
 		}
 
+		object_range[j] = make_uint2(object_offset, offset - object_offset);
+
 		j++;
 	}
 
@@ -385,6 +463,15 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 			background_mis = light->use_mis;
 		}
 
+		if(use_light_tree) {
+			if(light->type == LIGHT_BACKGROUND || light->type == LIGHT_DISTANT) {
+				infinite_lights.push_back(offset);
+			}
+			else {
+				emitters.push_back(light_tree_lamp_emitter(light, offset));
+			}
+		}
+
 		light_index++;
 		offset++;
 	}
@@ -443,6 +530,14 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 		if(num_background_lights < num_lights)
 			kfilm->pass_shadow_scale *= (float)(num_lights - num_background_lights)/(float)num_lights;
 
+		/* Light tree */
+		if(use_light_tree) {
+			device_update_light_tree(dscene, emitters, infinite_lights, object_range);
+		}
+		else {
+			kintegrator->use_light_tree = false;
+		}
+
 		/* CDF */
 		dscene->light_distribution.copy_to_device();
 
@@ -469,11 +564,78 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 		kintegrator->num_portals = 0;
 		kintegrator->portal_offset = 0;
 		kintegrator->portal_pdf = 0.0f;
+		kintegrator->use_light_tree = false;
 
 		kfilm->pass_shadow_scale = 1.0f;
 	}
 }
 
+void LightManager::device_update_light_tree(DeviceScene *dscene,
+                                            const vector<LightTreeEmitter>& emitters,
+                                            const vector<int>& infinite_lights,
+                                            const vector<uint2>& object_range)
+{
+	KernelIntegrator *kintegrator = &dscene->data.integrator;
+
+	LightTree tree(emitters);
+
+	const int num_nodes = tree.nodes.size();
+	const int num_infinite = infinite_lights.size();
+
+	/* Tree nodes, followed by a leaf for every infinite light. */
+	KernelLightTreeNode *nodes = dscene->light_tree_nodes.alloc(num_nodes + num_infinite);
+	if(num_nodes) {
+		memcpy(nodes, &tree.nodes[0], sizeof(KernelLightTreeNode)*num_nodes);
+	}
+
+	uint *leaf = dscene->light_tree_leaf.alloc(kintegrator->num_distribution);
+	for(int i = 0; i < kintegrator->num_distribution; i++) {
+		leaf[i] = ~0u;
+	}
+	for(size_t i = 0; i < emitters.size(); i++) {
+		leaf[emitters[i].index] = tree.emitter_leaf[i];
+	}
+
+	for(int i = 0; i < num_infinite; i++) {
+		KernelLightTreeNode *node = &nodes[num_nodes + i];
+		memset(node, 0, sizeof(KernelLightTreeNode));
+		node->child = infinite_lights[i];
+		node->parent = -1;
+		node->flag = LIGHT_TREE_NODE_LEAF;
+
+		leaf[infinite_lights[i]] = num_nodes + i;
+	}
+
+	uint2 *range = dscene->light_tree_object_range.alloc(object_range.size());
+	memcpy(range, &object_range[0], sizeof(uint2)*object_range.size());
+
+	dscene->light_tree_nodes.copy_to_device();
+	dscene->light_tree_leaf.copy_to_device();
+	dscene->light_tree_object_range.copy_to_device();
+
+	kintegrator->use_light_tree = true;
+	kintegrator->light_tree_infinite_offset = num_nodes;
+	kintegrator->num_infinite_lights = num_infinite;
+
+	/* Choose between local and infinite lights with a fixed probability. */
+	if(num_infinite == 0) {
+		kintegrator->light_tree_pdf = 1.0f;
+	}
+	else if(num_nodes == 0) {
+		kintegrator->light_tree_pdf = 0.0f;
+	}
+	else {
+		kintegrator->light_tree_pdf = 0.5f;
+	}
+
+	/* Light tree selection pdf is applied in the kernel, per shading point. */
+	kintegrator->pdf_triangles = 1.0f;
+	kintegrator->pdf_lights = 1.0f;
+
+	VLOG(1) << "Light tree with " << num_nodes << " nodes and "
+	        << num_infinite << " infinite lights.";
+}
+
 static void background_cdf(int start,
                            int end,
                            int res,
@@ -872,6 +1034,9 @@ void LightManager::device_free(Device *, DeviceScene *dscene)
 	dscene->lights.free();
 	dscene->light_background_marginal_cdf.free();
 	dscene->light_background_conditional_cdf.free();
+	dscene->light_tree_nodes.free();
+	dscene->light_tree_leaf.free();
+	dscene->light_tree_object_range.free();
 }
 
 void LightManager::tag_update(Scene * /*scene*/)
@@ -32,6 +32,7 @@ class Object;
 class Progress;
 class Scene;
 class Shader;
+struct LightTreeEmitter;
 
 class Light : public Node {
 public:
@@ -115,6 +116,10 @@ protected:
 	                              DeviceScene *dscene,
 	                              Scene *scene,
 	                              Progress& progress);
+	void device_update_light_tree(DeviceScene *dscene,
+	                              const vector<LightTreeEmitter>& emitters,
+	                              const vector<int>& infinite_lights,
+	                              const vector<uint2>& object_range);
 
 	/* Check whether light manager can use the object as a light-emissive. */
 	bool object_usable_as_light(Object *object);
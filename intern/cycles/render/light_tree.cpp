@@ -0,0 +1,293 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/light_tree.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_logging.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Number of bins used to find the split of a node. */
+#define LIGHT_TREE_NUM_BINS 12
+
+/* Below this depth nodes are split at the median, which bounds the depth of
+ * the tree when the split heuristic keeps cutting off few emitters. */
+#define LIGHT_TREE_MAX_SAH_DEPTH 48
+
+/* Smallest cone bounding both cones. */
+static LightTreeCone light_tree_cone_union(const LightTreeCone& cone_a,
+                                           const LightTreeCone& cone_b)
+{
+	const float theta_e = max(cone_a.theta_e, cone_b.theta_e);
+
+	if(cone_a.two_sided != cone_b.two_sided) {
+		/* One and two sided emitters together, normals can point anywhere. */
+		return LightTreeCone(cone_a.axis, M_PI_F, theta_e, false);
+	}
+
+	/* Make a the wider cone. */
+	LightTreeCone a = cone_a, b = cone_b;
+	if(b.theta_o > a.theta_o) {
+		swap(a, b);
+	}
+
+	/* Two sided cones are symmetric, use the closest axis. */
+	if(a.two_sided && dot(a.axis, b.axis) < 0.0f) {
+		b.axis = -b.axis;
+	}
+
+	const float theta_d = safe_acosf(dot(a.axis, b.axis));
+
+	if(min(theta_d + b.theta_o, M_PI_F) <= a.theta_o) {
+		/* Cone a already contains cone b. */
+		return LightTreeCone(a.axis, a.theta_o, theta_e, a.two_sided);
+	}
+
+	const float theta_o = 0.5f*(a.theta_o + theta_d + b.theta_o);
+	const float3 w = cross(a.axis, b.axis);
+
+	if(theta_o >= M_PI_F || len_squared(w) < 1e-12f) {
+		return LightTreeCone(a.axis, M_PI_F, theta_e, a.two_sided);
+	}
+
+	/* Rotate the axis of a towards b, to the middle of the new cone. */
+	const float3 axis = rotate_around_axis(a.axis, normalize(w), theta_o - a.theta_o);
+	return LightTreeCone(normalize(axis), theta_o, theta_e, a.two_sided);
+}
+
+/* Solid angle measure of the directions a cone emits into, weighted by the
+ * cosine falloff. */
+static float light_tree_cone_measure(const LightTreeCone& cone)
+{
+	const float theta_w = min(cone.theta_o + cone.theta_e, M_PI_F);
+	const float sin_o = sinf(cone.theta_o);
+	const float cos_o = cosf(cone.theta_o);
+	const float measure = M_2PI_F*(1.0f - cos_o) +
+	                      M_PI_2_F*(2.0f*theta_w*sin_o -
+	                                cosf(cone.theta_o - 2.0f*theta_w) -
+	                                2.0f*cone.theta_o*sin_o +
+	                                cos_o);
+	return cone.two_sided ? 2.0f*measure : measure;
+}
+
+static float light_tree_bounds_measure(const BoundBox& bounds)
+{
+	/* Flat bounds of coplanar emitters still need a meaningful size. */
+	return bounds.half_area() + len_squared(bounds.size());
+}
+
+/* Accumulated bounds of a set of emitters, used while searching splits. */
+struct LightTreeBin {
+	LightTreeBin()
+	: bounds(BoundBox::empty),
+	  energy(0.0f),
+	  count(0)
+	{
+	}
+
+	void add(const LightTreeEmitter& emitter)
+	{
+		bounds.grow(emitter.bounds);
+		cone = (count == 0) ? emitter.cone : light_tree_cone_union(cone, emitter.cone);
+		energy += emitter.energy;
+		count++;
+	}
+
+	void add(const LightTreeBin& bin)
+	{
+		if(bin.count == 0) {
+			return;
+		}
+		bounds.grow(bin.bounds);
+		cone = (count == 0) ? bin.cone : light_tree_cone_union(cone, bin.cone);
+		energy += bin.energy;
+		count += bin.count;
+	}
+
+	float cost() const
+	{
+		return energy *
+		       light_tree_bounds_measure(bounds) *
+		       light_tree_cone_measure(cone);
+	}
+
+	BoundBox bounds;
+	LightTreeCone cone;
+	float energy;
+	int count;
+};
+
+/* Sort emitter indices by centroid along an axis. */
+struct LightTreeCentroidCompare {
+	LightTreeCentroidCompare(const vector<LightTreeEmitter>& emitters, int axis)
+	: emitters(emitters),
+	  axis(axis)
+	{
+	}
+
+	bool operator()(int a, int b) const
+	{
+		return emitters[a].centroid()[axis] < emitters[b].centroid()[axis];
+	}
+
+	const vector<LightTreeEmitter>& emitters;
+	int axis;
+};
+
+LightTree::LightTree(const vector<LightTreeEmitter>& emitters)
+: emitters_(emitters)
+{
+	const int num_emitters = emitters.size();
+
+	emitter_leaf.resize(num_emitters, -1);
+	if(num_emitters == 0) {
+		return;
+	}
+
+	order_.resize(num_emitters);
+	for(int i = 0; i < num_emitters; i++) {
+		order_[i] = i;
+	}
+
+	nodes.reserve(2*num_emitters - 1);
+	build(0, num_emitters, -1, 0);
+
+	VLOG(1) << "Light tree built with " << nodes.size() << " nodes for "
+	        << num_emitters << " emitters.";
+}
+
+int LightTree::build(int start, int end, int parent, int depth)
+{
+	const int node_index = nodes.size();
+	nodes.push_back(KernelLightTreeNode());
+
+	LightTreeBin node_bin;
+	BoundBox centroid_bounds = BoundBox::empty;
+	for(int i = start; i < end; i++) {
+		const LightTreeEmitter& emitter = emitters_[order_[i]];
+		node_bin.add(emitter);
+		centroid_bounds.grow(emitter.centroid());
+	}
+
+	KernelLightTreeNode& knode = nodes[node_index];
+	knode.bbox_min[0] = node_bin.bounds.min.x;
+	knode.bbox_min[1] = node_bin.bounds.min.y;
+	knode.bbox_min[2] = node_bin.bounds.min.z;
+	knode.bbox_max[0] = node_bin.bounds.max.x;
+	knode.bbox_max[1] = node_bin.bounds.max.y;
+	knode.bbox_max[2] = node_bin.bounds.max.z;
+	knode.energy = node_bin.energy;
+	knode.axis[0] = node_bin.cone.axis.x;
+	knode.axis[1] = node_bin.cone.axis.y;
+	knode.axis[2] = node_bin.cone.axis.z;
+	knode.theta_o = node_bin.cone.theta_o;
+	knode.theta_e = node_bin.cone.theta_e;
+	knode.parent = parent;
+	knode.flag = node_bin.cone.two_sided ? LIGHT_TREE_NODE_TWO_SIDED : 0;
+
+	if(end - start == 1) {
+		const LightTreeEmitter& emitter = emitters_[order_[start]];
+		knode.child = emitter.index;
+		knode.flag |= LIGHT_TREE_NODE_LEAF;
+		knode.area = emitter.area;
+		emitter_leaf[order_[start]] = node_index;
+		return node_index;
+	}
+
+	/* Find split along the axis with the largest centroid extent. */
+	const float3 extent = centroid_bounds.size();
+	int axis = 0;
+	if(extent.y > extent[axis]) axis = 1;
+	if(extent.z > extent[axis]) axis = 2;
+
+	int mid = -1;
+
+	if(extent[axis] > 0.0f && depth < LIGHT_TREE_MAX_SAH_DEPTH) {
+		LightTreeBin bins[LIGHT_TREE_NUM_BINS];
+		const float inv_extent = LIGHT_TREE_NUM_BINS/extent[axis];
+		const float origin = centroid_bounds.min[axis];
+
+		for(int i = start; i < end; i++) {
+			const LightTreeEmitter& emitter = emitters_[order_[i]];
+			int bin = (int)((emitter.centroid()[axis] - origin)*inv_extent);
+			bins[clamp(bin, 0, LIGHT_TREE_NUM_BINS - 1)].add(emitter);
+		}
+
+		/* Cost of splitting after every bin, sweeping from the right. */
+		float right_cost[LIGHT_TREE_NUM_BINS];
+		LightTreeBin right;
+		for(int i = LIGHT_TREE_NUM_BINS - 1; i > 0; i--) {
+			right.add(bins[i]);
+			right_cost[i - 1] = (right.count > 0) ? right.cost() : FLT_MAX;
+		}
+
+		float best_cost = FLT_MAX;
+		int best_bin = -1;
+		LightTreeBin left;
+		for(int i = 0; i < LIGHT_TREE_NUM_BINS - 1; i++) {
+			left.add(bins[i]);
+			if(left.count == 0 || right_cost[i] == FLT_MAX) {
+				continue;
+			}
+			const float cost = left.cost() + right_cost[i];
+			if(cost < best_cost) {
+				best_cost = cost;
+				best_bin = i;
+			}
+		}
+
+		if(best_bin != -1) {
+			int i = start, j = end - 1;
+			while(i <= j) {
+				const float centroid = emitters_[order_[i]].centroid()[axis];
+				const int bin = clamp((int)((centroid - origin)*inv_extent), 0, LIGHT_TREE_NUM_BINS - 1);
+				if(bin <= best_bin) {
+					i++;
+				}
+				else {
+					swap(order_[i], order_[j]);
+					j--;
+				}
+			}
+			if(i > start && i < end) {
+				mid = i;
+			}
+		}
+	}
+
+	if(mid == -1) {
+		/* Median split, also used when all centroids coincide. */
+		mid = (start + end)/2;
+		if(extent[axis] > 0.0f) {
+			std::nth_element(order_.begin() + start,
+			                 order_.begin() + mid,
+			                 order_.begin() + end,
+			                 LightTreeCentroidCompare(emitters_, axis));
+		}
+	}
+
+	build(start, mid, node_index, depth + 1);
+	const int right_index = build(mid, end, node_index, depth + 1);
+
+	/* Nodes may have been reallocated while building children. */
+	nodes[node_index].child = right_index;
+
+	return node_index;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LIGHT_TREE_H__
+#define __LIGHT_TREE_H__
+
+#include "kernel/kernel_types.h"
+
+#include "util/util_boundbox.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Cone bounding the emission directions of a set of emitters, as described
+ * in "Importance Sampling of Many Lights with Adaptive Tree Splitting" by
+ * Estevez and Kulla. Normals are within theta_o of the axis, and light is
+ * emitted within theta_e of the normals. Two sided emitters emit along both
+ * the normal and its negation. */
+struct LightTreeCone {
+	LightTreeCone()
+	: axis(make_float3(0.0f, 0.0f, 1.0f)),
+	  theta_o(M_PI_F),
+	  theta_e(M_PI_2_F),
+	  two_sided(false)
+	{
+	}
+
+	LightTreeCone(const float3& axis, float theta_o, float theta_e, bool two_sided)
+	: axis(axis),
+	  theta_o(theta_o),
+	  theta_e(theta_e),
+	  two_sided(two_sided)
+	{
+	}
+
+	float3 axis;
+	float theta_o;
+	float theta_e;
+	bool two_sided;
+};
+
+/* Emitter as seen by the light tree builder. */
+struct LightTreeEmitter {
+	BoundBox bounds;
+	LightTreeCone cone;
+	float energy;
+	/* Area of triangle emitters, zero for lamps. */
+	float area;
+	/* Index into the light distribution. */
+	int index;
+
+	float3 centroid() const { return bounds.center(); }
+};
+
+/* Binary tree over local emitters, used for importance sampling lights by
+ * their energy, distance and orientation relative to the shading point.
+ *
+ * Nodes are stored depth first, so the left child of an inner node directly
+ * follows it. Every leaf holds a single emitter. */
+class LightTree {
+public:
+	explicit LightTree(const vector<LightTreeEmitter>& emitters);
+
+	/* Packed nodes. */
+	vector<KernelLightTreeNode> nodes;
+
+	/* Node index of the leaf of every emitter, indexed like the emitters
+	 * passed to the constructor. */
+	vector<int> emitter_leaf;
+
+protected:
+	int build(int start, int end, int parent, int depth);
+
+	const vector<LightTreeEmitter>& emitters_;
+	/* Emitter indices, partitioned during build. */
+	vector<int> order_;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __LIGHT_TREE_H__ */
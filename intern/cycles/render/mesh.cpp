@@ -454,6 +454,7 @@ Mesh::Mesh()
 
 	subdivision_type = SUBDIVISION_NONE;
 	subd_params = NULL;
+	subd_dice_cache = NULL;
 
 	patch_table = NULL;
 }
@@ -463,6 +464,7 @@ Mesh::~Mesh()
 	delete bvh;
 	delete patch_table;
 	delete subd_params;
+	delete subd_dice_cache;
 }
 
 void Mesh::resize_mesh(int numverts, int numtris)
@@ -1055,12 +1057,27 @@ void Mesh::compute_bvh(Device *device,
 		vector<Object*> objects;
 		objects.push_back(&object);
 
-		if(bvh && !need_update_rebuild) {
+		bool need_rebuild = (bvh == NULL || need_update_rebuild);
+
+		if(!need_rebuild) {
 			progress->set_status(msg, "Refitting BVH");
 			bvh->objects = objects;
 			bvh->refit(*progress);
+
+			/* Deformation might make the refitted tree much slower to
+			 * traverse than a freshly built one.
+			 */
+			if(params->bvh_refit_threshold > 0.0f && bvh->build_cost > 0.0f &&
+			   bvh->refit_cost > bvh->build_cost * (1.0f + params->bvh_refit_threshold))
+			{
+				VLOG(1) << "Rebuilding BVH of mesh " << name
+				        << ", refit cost " << bvh->refit_cost
+				        << " exceeds build cost " << bvh->build_cost << ".";
+				need_rebuild = true;
+			}
 		}
-		else {
+
+		if(need_rebuild) {
 			progress->set_status(msg, "Building BVH");
 
 			BVHParams bparams;
@@ -1072,10 +1089,19 @@ void Mesh::compute_bvh(Device *device,
 			                              params->use_bvh_unaligned_nodes;
 			bparams.num_motion_triangle_steps = params->num_bvh_time_steps;
 			bparams.num_motion_curve_steps = params->num_bvh_time_steps;
+			bparams.max_curve_leaf_size = params->bvh_curve_leaf_size;
 
 			delete bvh;
 			bvh = BVH::create(bparams, objects);
 			MEM_GUARDED_CALL(progress, bvh->build, *progress);
+
+			/* Only dynamic BVHs of meshes are refitted between updates. */
+			if(params->bvh_type == SceneParams::BVH_DYNAMIC &&
+			   params->bvh_refit_threshold > 0.0f &&
+			   !progress->get_cancel())
+			{
+				bvh->update_build_cost();
+			}
 		}
 	}
 
@@ -1454,9 +1480,7 @@ static void update_attribute_element_offset(Mesh *mesh,
 			offset = attr_uchar4_offset;
 
 			assert(attr_uchar4.size() >= offset + size);
-			for(size_t k = 0; k < size; k++) {
-				attr_uchar4[offset+k] = data[k];
-			}
+			memcpy(attr_uchar4.data() + offset, data, sizeof(uchar4)*size);
 			attr_uchar4_offset += size;
 		}
 		else if(mattr->type == TypeDesc::TypeFloat) {
@@ -1464,9 +1488,7 @@ static void update_attribute_element_offset(Mesh *mesh,
 			offset = attr_float_offset;
 
 			assert(attr_float.size() >= offset + size);
-			for(size_t k = 0; k < size; k++) {
-				attr_float[offset+k] = data[k];
-			}
+			memcpy(attr_float.data() + offset, data, sizeof(float)*size);
 			attr_float_offset += size;
 		}
 		else if(mattr->type == TypeDesc::TypeMatrix) {
@@ -1474,9 +1496,7 @@ static void update_attribute_element_offset(Mesh *mesh,
 			offset = attr_float3_offset;
 
 			assert(attr_float3.size() >= offset + size * 3);
-			for(size_t k = 0; k < size*3; k++) {
-				attr_float3[offset+k] = (&tfm->x)[k];
-			}
+			memcpy(attr_float3.data() + offset, &tfm->x, sizeof(float4)*size*3);
 			attr_float3_offset += size * 3;
 		}
 		else {
@@ -1484,9 +1504,7 @@ static void update_attribute_element_offset(Mesh *mesh,
 			offset = attr_float3_offset;
 
 			assert(attr_float3.size() >= offset + size);
-			for(size_t k = 0; k < size; k++) {
-				attr_float3[offset+k] = data[k];
-			}
+			memcpy(attr_float3.data() + offset, data, sizeof(float4)*size);
 			attr_float3_offset += size;
 		}
 
@@ -1526,6 +1544,52 @@ static void update_attribute_element_offset(Mesh *mesh,
 	}
 }
 
+static void update_mesh_attributes(Mesh *mesh,
+                                   AttributeRequestSet *attributes,
+                                   DeviceScene *dscene,
+                                   size_t attr_float_offset,
+                                   size_t attr_float3_offset,
+                                   size_t attr_uchar4_offset,
+                                   Progress *progress)
+{
+	if(progress->get_cancel()) return;
+
+	/* todo: we now store std and name attributes from requests even if
+	 * they actually refer to the same mesh attributes, optimize */
+	foreach(AttributeRequest& req, attributes->requests) {
+		Attribute *triangle_mattr = mesh->attributes.find(req);
+		Attribute *curve_mattr = mesh->curve_attributes.find(req);
+		Attribute *subd_mattr = mesh->subd_attributes.find(req);
+
+		update_attribute_element_offset(mesh,
+		                                dscene->attributes_float, attr_float_offset,
+		                                dscene->attributes_float3, attr_float3_offset,
+		                                dscene->attributes_uchar4, attr_uchar4_offset,
+		                                triangle_mattr,
+		                                ATTR_PRIM_TRIANGLE,
+		                                req.triangle_type,
+		                                req.triangle_desc);
+
+		update_attribute_element_offset(mesh,
+		                                dscene->attributes_float, attr_float_offset,
+		                                dscene->attributes_float3, attr_float3_offset,
+		                                dscene->attributes_uchar4, attr_uchar4_offset,
+		                                curve_mattr,
+		                                ATTR_PRIM_CURVE,
+		                                req.curve_type,
+		                                req.curve_desc);
+
+		update_attribute_element_offset(mesh,
+		                                dscene->attributes_float, attr_float_offset,
+		                                dscene->attributes_float3, attr_float3_offset,
+		                                dscene->attributes_uchar4, attr_uchar4_offset,
+		                                subd_mattr,
+		                                ATTR_PRIM_SUBD,
+		                                req.subd_type,
+		                                req.subd_desc);
+	}
+}
+
 void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
 {
 	progress.set_status("Updating Mesh", "Computing attributes");
@@ -1555,9 +1619,15 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 	size_t attr_float_size = 0;
 	size_t attr_float3_size = 0;
 	size_t attr_uchar4_size = 0;
+	vector<size_t> mesh_float_offset(scene->meshes.size());
+	vector<size_t> mesh_float3_offset(scene->meshes.size());
+	vector<size_t> mesh_uchar4_offset(scene->meshes.size());
 	for(size_t i = 0; i < scene->meshes.size(); i++) {
 		Mesh *mesh = scene->meshes[i];
 		AttributeRequestSet& attributes = mesh_attributes[i];
+		mesh_float_offset[i] = attr_float_size;
+		mesh_float3_offset[i] = attr_float3_size;
+		mesh_uchar4_offset[i] = attr_uchar4_size;
 		foreach(AttributeRequest& req, attributes.requests) {
 			Attribute *triangle_mattr = mesh->attributes.find(req);
 			Attribute *curve_mattr = mesh->curve_attributes.find(req);
@@ -1588,52 +1658,22 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 	dscene->attributes_float3.alloc(attr_float3_size);
 	dscene->attributes_uchar4.alloc(attr_uchar4_size);
 
-	size_t attr_float_offset = 0;
-	size_t attr_float3_offset = 0;
-	size_t attr_uchar4_offset = 0;
-
-	/* Fill in attributes. */
+	/* Fill in attributes. Offsets of every mesh are known from the sizes
+	 * above, so meshes are filled in parallel. */
+	TaskPool pool;
 	for(size_t i = 0; i < scene->meshes.size(); i++) {
-		Mesh *mesh = scene->meshes[i];
-		AttributeRequestSet& attributes = mesh_attributes[i];
-
-		/* todo: we now store std and name attributes from requests even if
-		 * they actually refer to the same mesh attributes, optimize */
-		foreach(AttributeRequest& req, attributes.requests) {
-			Attribute *triangle_mattr = mesh->attributes.find(req);
-			Attribute *curve_mattr = mesh->curve_attributes.find(req);
-			Attribute *subd_mattr = mesh->subd_attributes.find(req);
-
-			update_attribute_element_offset(mesh,
-			                                dscene->attributes_float, attr_float_offset,
-			                                dscene->attributes_float3, attr_float3_offset,
-			                                dscene->attributes_uchar4, attr_uchar4_offset,
-			                                triangle_mattr,
-			                                ATTR_PRIM_TRIANGLE,
-			                                req.triangle_type,
-			                                req.triangle_desc);
-
-			update_attribute_element_offset(mesh,
-			                                dscene->attributes_float, attr_float_offset,
-			                                dscene->attributes_float3, attr_float3_offset,
-			                                dscene->attributes_uchar4, attr_uchar4_offset,
-			                                curve_mattr,
-			                                ATTR_PRIM_CURVE,
-			                                req.curve_type,
-			                                req.curve_desc);
-
-			update_attribute_element_offset(mesh,
-			                                dscene->attributes_float, attr_float_offset,
-			                                dscene->attributes_float3, attr_float3_offset,
-			                                dscene->attributes_uchar4, attr_uchar4_offset,
-			                                subd_mattr,
-			                                ATTR_PRIM_SUBD,
-			                                req.subd_type,
-			                                req.subd_desc);
-
-			if(progress.get_cancel()) return;
-		}
+		pool.push(function_bind(&update_mesh_attributes,
+		                        scene->meshes[i],
+		                        &mesh_attributes[i],
+		                        dscene,
+		                        mesh_float_offset[i],
+		                        mesh_float3_offset[i],
+		                        mesh_uchar4_offset[i],
+		                        &progress));
 	}
+	pool.wait_work();
+
+	if(progress.get_cancel()) return;
 
 	/* create attribute lookup maps */
 	if(scene->shader_manager->use_osl())
@@ -1707,6 +1747,54 @@ void MeshManager::mesh_calc_offset(Scene *scene)
 	}
 }
 
+/* Packing of a single mesh into the device arrays, at offsets computed in
+ * mesh_calc_offset(). Meshes write disjoint ranges, so they are packed in
+ * parallel. */
+
+static void pack_mesh_triangles(Scene *scene,
+                                Mesh *mesh,
+                                const vector<uint> *tri_prim_index,
+                                uint *tri_shader,
+                                float4 *vnormal,
+                                uint4 *tri_vindex,
+                                uint *tri_patch,
+                                float2 *tri_patch_uv,
+                                Progress *progress)
+{
+	if(progress->get_cancel()) return;
+
+	mesh->pack_shaders(scene, tri_shader);
+	mesh->pack_normals(vnormal);
+	mesh->pack_verts(*tri_prim_index,
+	                 tri_vindex,
+	                 tri_patch,
+	                 tri_patch_uv,
+	                 mesh->vert_offset,
+	                 mesh->tri_offset);
+}
+
+static void pack_mesh_curves(Scene *scene,
+                             Mesh *mesh,
+                             float4 *curve_keys,
+                             float4 *curves,
+                             Progress *progress)
+{
+	if(progress->get_cancel()) return;
+
+	mesh->pack_curves(scene, curve_keys, curves, mesh->curvekey_offset);
+}
+
+static void pack_mesh_patches(Mesh *mesh, uint *patch_data, Progress *progress)
+{
+	if(progress->get_cancel()) return;
+
+	mesh->pack_patches(&patch_data[mesh->patch_offset], mesh->vert_offset, mesh->face_offset, mesh->corner_offset);
+
+	if(mesh->patch_table) {
+		mesh->patch_table->copy_adjusting_offsets(&patch_data[mesh->patch_table_offset], mesh->patch_table_offset);
+	}
+}
+
 void MeshManager::device_update_mesh(Device *,
                                      DeviceScene *dscene,
                                      Scene *scene,
@@ -1774,18 +1862,21 @@ void MeshManager::device_update_mesh(Device *,
 		uint *tri_patch = dscene->tri_patch.alloc(tri_size);
 		float2 *tri_patch_uv = dscene->tri_patch_uv.alloc(vert_size);
 
+		TaskPool pool;
 		foreach(Mesh *mesh, scene->meshes) {
-			mesh->pack_shaders(scene,
-			                   &tri_shader[mesh->tri_offset]);
-			mesh->pack_normals(&vnormal[mesh->vert_offset]);
-			mesh->pack_verts(tri_prim_index,
-			                 &tri_vindex[mesh->tri_offset],
-			                 &tri_patch[mesh->tri_offset],
-			                 &tri_patch_uv[mesh->vert_offset],
-			                 mesh->vert_offset,
-			                 mesh->tri_offset);
-			if(progress.get_cancel()) return;
+			pool.push(function_bind(&pack_mesh_triangles,
+			                        scene,
+			                        mesh,
+			                        &tri_prim_index,
+			                        &tri_shader[mesh->tri_offset],
+			                        &vnormal[mesh->vert_offset],
+			                        &tri_vindex[mesh->tri_offset],
+			                        &tri_patch[mesh->tri_offset],
+			                        &tri_patch_uv[mesh->vert_offset],
+			                        &progress));
 		}
+		pool.wait_work();
+		if(progress.get_cancel()) return;
 
 		/* vertex coordinates */
 		progress.set_status("Updating Mesh", "Copying Mesh to device");
@@ -1803,10 +1894,17 @@ void MeshManager::device_update_mesh(Device *,
 		float4 *curve_keys = dscene->curve_keys.alloc(curve_key_size);
 		float4 *curves = dscene->curves.alloc(curve_size);
 
+		TaskPool pool;
 		foreach(Mesh *mesh, scene->meshes) {
-			mesh->pack_curves(scene, &curve_keys[mesh->curvekey_offset], &curves[mesh->curve_offset], mesh->curvekey_offset);
-			if(progress.get_cancel()) return;
+			pool.push(function_bind(&pack_mesh_curves,
+			                        scene,
+			                        mesh,
+			                        &curve_keys[mesh->curvekey_offset],
+			                        &curves[mesh->curve_offset],
+			                        &progress));
 		}
+		pool.wait_work();
+		if(progress.get_cancel()) return;
 
 		dscene->curve_keys.copy_to_device();
 		dscene->curves.copy_to_device();
@@ -1817,15 +1915,15 @@ void MeshManager::device_update_mesh(Device *,
 
 		uint *patch_data = dscene->patches.alloc(patch_size);
 
+		TaskPool pool;
 		foreach(Mesh *mesh, scene->meshes) {
-			mesh->pack_patches(&patch_data[mesh->patch_offset], mesh->vert_offset, mesh->face_offset, mesh->corner_offset);
-
-			if(mesh->patch_table) {
-				mesh->patch_table->copy_adjusting_offsets(&patch_data[mesh->patch_table_offset], mesh->patch_table_offset);
-			}
-
-			if(progress.get_cancel()) return;
+			pool.push(function_bind(&pack_mesh_patches,
+			                        mesh,
+			                        patch_data,
+			                        &progress));
 		}
+		pool.wait_work();
+		if(progress.get_cancel()) return;
 
 		dscene->patches.copy_to_device();
 	}
@@ -1860,6 +1958,7 @@ void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *
 	                              scene->params.use_bvh_unaligned_nodes;
 	bparams.num_motion_triangle_steps = scene->params.num_bvh_time_steps;
 	bparams.num_motion_curve_steps = scene->params.num_bvh_time_steps;
+	bparams.max_curve_leaf_size = scene->params.bvh_curve_leaf_size;
 
 	VLOG(1) << "Using " << bvh_layout_name(bparams.bvh_layout)
 	        << " layout.";
@@ -2112,6 +2211,10 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 				progress.set_status("Updating Mesh", msg);
 
 				DiagSplit dsplit(*mesh->subd_params);
+				/* Keep diced geometry around when the scene is likely
+				 * to be updated with small changes. */
+				dsplit.params.use_cache = scene->params.persistent_data ||
+				                          scene->params.bvh_type == SceneParams::BVH_DYNAMIC;
 				mesh->tessellate(&dsplit);
 
 				i++;
@@ -42,6 +42,7 @@ class Scene;
 class SceneParams;
 class AttributeRequest;
 struct SubdParams;
+class SubdDiceCache;
 class DiagSplit;
 struct PackedPatchTable;
 
@@ -218,6 +219,9 @@ public:
 	array<SubdEdgeCrease> subd_creases;
 
 	SubdParams *subd_params;
+	/* Diced geometry of the previous tessellation, kept when the mesh is
+	 * cleared so it can be reused by the next one. */
+	SubdDiceCache *subd_dice_cache;
 
 	vector<Shader*> used_shaders;
 	AttributeSet attributes;
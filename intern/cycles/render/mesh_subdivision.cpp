@@ -24,6 +24,8 @@
 
 #include "util/util_foreach.h"
 #include "util/util_algorithm.h"
+#include "util/util_hash.h"
+#include "util/util_task.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -155,7 +157,10 @@ class OsdData {
 	Far::PatchMap* patch_map;
 
 public:
-	OsdData() : mesh(NULL), refiner(NULL), patch_table(NULL), patch_map(NULL) {}
+	/* adaptive isolation level the patches were created with */
+	int max_isolation;
+
+	OsdData() : mesh(NULL), refiner(NULL), patch_table(NULL), patch_map(NULL), max_isolation(0) {}
 
 	~OsdData()
 	{
@@ -179,7 +184,7 @@ public:
 				Far::TopologyRefinerFactory<Mesh>::Options(type, options));
 
 		/* adaptive refinement */
-		int max_isolation = calculate_max_isolation();
+		max_isolation = calculate_max_isolation();
 		refiner->RefineAdaptive(Far::TopologyRefiner::AdaptiveOptions(max_isolation));
 
 		/* create patch table */
@@ -335,18 +340,125 @@ struct OsdPatch : Patch {
 
 #endif
 
+/* Number of patches split by a single task. */
+#define TESSELLATE_SPLIT_BATCH_SIZE 64
+
+static void tessellate_split_patches(DiagSplit *split,
+                                     const vector<Patch*> *patches,
+                                     const vector<bool> *patch_is_quad,
+                                     int start,
+                                     int end)
+{
+	for(int i = start; i < end; i++) {
+		Patch *patch = (*patches)[i];
+
+		if(!(*patch_is_quad)[i]) {
+			split->split_quad(patch);
+			continue;
+		}
+
+		QuadDice::SubPatch subpatch;
+		subpatch.patch = patch;
+
+		/* Quad faces need to be split at least once to line up with split ngons, we do this
+		 * here in this manner because if we do it later edge factors may end up slightly off.
+		 */
+		subpatch.P00 = make_float2(0.0f, 0.0f);
+		subpatch.P10 = make_float2(0.5f, 0.0f);
+		subpatch.P01 = make_float2(0.0f, 0.5f);
+		subpatch.P11 = make_float2(0.5f, 0.5f);
+		split->split_quad(subpatch.patch, &subpatch);
+
+		subpatch.P00 = make_float2(0.5f, 0.0f);
+		subpatch.P10 = make_float2(1.0f, 0.0f);
+		subpatch.P01 = make_float2(0.5f, 0.5f);
+		subpatch.P11 = make_float2(1.0f, 0.5f);
+		split->split_quad(subpatch.patch, &subpatch);
+
+		subpatch.P00 = make_float2(0.0f, 0.5f);
+		subpatch.P10 = make_float2(0.5f, 0.5f);
+		subpatch.P01 = make_float2(0.0f, 1.0f);
+		subpatch.P11 = make_float2(0.5f, 1.0f);
+		split->split_quad(subpatch.patch, &subpatch);
+
+		subpatch.P00 = make_float2(0.5f, 0.5f);
+		subpatch.P10 = make_float2(1.0f, 0.5f);
+		subpatch.P01 = make_float2(0.5f, 1.0f);
+		subpatch.P11 = make_float2(1.0f, 1.0f);
+		split->split_quad(subpatch.patch, &subpatch);
+	}
+}
+
+/* Hash of everything patch evaluation depends on, to detect whether diced
+ * vertices of a previous tessellation can be reused. OpenSubdiv patches also
+ * depend on the adaptive isolation level, which follows from the camera and
+ * dicing rate. Must be called before any vertices are diced. */
+static uint tessellate_control_hash(Mesh *mesh, const SubdParams& params, int max_isolation)
+{
+	/* Vertex attributes also have slots for the center points of ngons,
+	 * those are only computed after dicing. */
+	const size_t num_control_verts = mesh->verts.size() - mesh->num_subd_verts;
+
+	uint hash = hash_int_2d(mesh->subdivision_type, num_control_verts);
+	hash = hash_int_2d(hash, max_isolation);
+	hash = hash_int_2d(hash, __float_as_uint(params.dicing_rate));
+	hash = hash_int_2d(hash, params.max_level);
+
+	for(size_t i = 0; i < num_control_verts; i++) {
+		const float3& co = mesh->verts[i];
+		hash = hash_int_2d(hash, __float_as_uint(co.x));
+		hash = hash_int_2d(hash, __float_as_uint(co.y));
+		hash = hash_int_2d(hash, __float_as_uint(co.z));
+	}
+
+	for(size_t i = 0; i < mesh->subd_faces.size(); i++) {
+		const Mesh::SubdFace& face = mesh->subd_faces[i];
+		hash = hash_int_2d(hash, face.start_corner);
+		hash = hash_int_2d(hash, face.num_corners);
+		hash = hash_int_2d(hash, face.smooth);
+	}
+
+	for(size_t i = 0; i < mesh->subd_face_corners.size(); i++) {
+		hash = hash_int_2d(hash, mesh->subd_face_corners[i]);
+	}
+
+	for(size_t i = 0; i < mesh->subd_creases.size(); i++) {
+		const Mesh::SubdEdgeCrease& crease = mesh->subd_creases[i];
+		hash = hash_int_2d(hash, crease.v[0]);
+		hash = hash_int_2d(hash, crease.v[1]);
+		hash = hash_int_2d(hash, __float_as_uint(crease.crease));
+	}
+
+	Attribute *attr_vN = mesh->subd_attributes.find(ATTR_STD_VERTEX_NORMAL);
+	if(attr_vN) {
+		const float3 *vN = attr_vN->data_float3();
+
+		for(size_t i = 0; i < num_control_verts; i++) {
+			hash = hash_int_2d(hash, __float_as_uint(vN[i].x));
+			hash = hash_int_2d(hash, __float_as_uint(vN[i].y));
+			hash = hash_int_2d(hash, __float_as_uint(vN[i].z));
+		}
+	}
+
+	return hash;
+}
+
 void Mesh::tessellate(DiagSplit *split)
 {
 #ifdef WITH_OPENSUBDIV
 	OsdData osd_data;
 	bool need_packed_patch_table = false;
+	int max_isolation = 0;
 
 	if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
 		if(subd_faces.size()) {
 			osd_data.build_from_mesh(this);
+			max_isolation = osd_data.max_isolation;
 		}
 	}
 	else
+#else
+	const int max_isolation = 0;
 #endif
 	{
 		/* force linear subdivision if OpenSubdiv is unavailable to avoid
@@ -360,34 +472,59 @@ void Mesh::tessellate(DiagSplit *split)
 		}
 	}
 
+	const uint control_hash = tessellate_control_hash(this, split->params, max_isolation);
+
 	int num_faces = subd_faces.size();
 
 	Attribute *attr_vN = subd_attributes.find(ATTR_STD_VERTEX_NORMAL);
 	float3* vN = attr_vN->data_float3();
 
+	/* Create patches for all faces, indexed by ptex face. Quads are a single
+	 * patch, ngons have one patch per corner. */
+	int num_patches = 0;
 	for(int f = 0; f < num_faces; f++) {
-		SubdFace& face = subd_faces[f];
-
-		if(face.is_quad()) {
-			/* quad */
-			QuadDice::SubPatch subpatch;
+		num_patches += subd_faces[f].num_ptex_faces();
+	}
 
-			LinearQuadPatch quad_patch;
+	vector<Patch*> patches(num_patches);
+	vector<bool> patch_is_quad(num_patches, false);
+	vector<LinearQuadPatch> linear_patches;
 #ifdef WITH_OPENSUBDIV
-			OsdPatch osd_patch(&osd_data);
+	vector<OsdPatch> osd_patches;
 
-			if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
-				osd_patch.patch_index = face.ptex_offset;
+	if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
+		osd_patches.resize(num_patches, OsdPatch(&osd_data));
+
+		for(int f = 0; f < num_faces; f++) {
+			SubdFace& face = subd_faces[f];
+
+			for(int corner = 0; corner < face.num_ptex_faces(); corner++) {
+				OsdPatch& patch = osd_patches[face.ptex_offset + corner];
+
+				patch.patch_index = face.ptex_offset + corner;
+				patch.shader = face.shader;
 
-				subpatch.patch = &osd_patch;
+				patches[face.ptex_offset + corner] = &patch;
+				patch_is_quad[face.ptex_offset + corner] = face.is_quad();
 			}
-			else
+		}
+	}
+	else
 #endif
-			{
+	{
+		linear_patches.resize(num_patches);
+
+		for(int f = 0; f < num_faces; f++) {
+			SubdFace& face = subd_faces[f];
+
+			if(face.is_quad()) {
+				/* quad */
+				LinearQuadPatch& quad_patch = linear_patches[face.ptex_offset];
 				float3 *hull = quad_patch.hull;
 				float3 *normals = quad_patch.normals;
 
 				quad_patch.patch_index = face.ptex_offset;
+				quad_patch.shader = face.shader;
 
 				for(int i = 0; i < 4; i++) {
 					hull[i] = verts[subd_face_corners[face.start_corner+i]];
@@ -408,55 +545,11 @@ void Mesh::tessellate(DiagSplit *split)
 				swap(hull[2], hull[3]);
 				swap(normals[2], normals[3]);
 
-				subpatch.patch = &quad_patch;
+				patches[face.ptex_offset] = &quad_patch;
+				patch_is_quad[face.ptex_offset] = true;
 			}
-
-			subpatch.patch->shader = face.shader;
-
-			/* Quad faces need to be split at least once to line up with split ngons, we do this
-			 * here in this manner because if we do it later edge factors may end up slightly off.
-			 */
-			subpatch.P00 = make_float2(0.0f, 0.0f);
-			subpatch.P10 = make_float2(0.5f, 0.0f);
-			subpatch.P01 = make_float2(0.0f, 0.5f);
-			subpatch.P11 = make_float2(0.5f, 0.5f);
-			split->split_quad(subpatch.patch, &subpatch);
-
-			subpatch.P00 = make_float2(0.5f, 0.0f);
-			subpatch.P10 = make_float2(1.0f, 0.0f);
-			subpatch.P01 = make_float2(0.5f, 0.5f);
-			subpatch.P11 = make_float2(1.0f, 0.5f);
-			split->split_quad(subpatch.patch, &subpatch);
-
-			subpatch.P00 = make_float2(0.0f, 0.5f);
-			subpatch.P10 = make_float2(0.5f, 0.5f);
-			subpatch.P01 = make_float2(0.0f, 1.0f);
-			subpatch.P11 = make_float2(0.5f, 1.0f);
-			split->split_quad(subpatch.patch, &subpatch);
-
-			subpatch.P00 = make_float2(0.5f, 0.5f);
-			subpatch.P10 = make_float2(1.0f, 0.5f);
-			subpatch.P01 = make_float2(0.5f, 1.0f);
-			subpatch.P11 = make_float2(1.0f, 1.0f);
-			split->split_quad(subpatch.patch, &subpatch);
-		}
-		else {
-			/* ngon */
-#ifdef WITH_OPENSUBDIV
-			if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
-				OsdPatch patch(&osd_data);
-
-				patch.shader = face.shader;
-
-				for(int corner = 0; corner < face.num_corners; corner++) {
-					patch.patch_index = face.ptex_offset + corner;
-
-					split->split_quad(&patch);
-				}
-			}
-			else
-#endif
-			{
+			else {
+				/* ngon */
 				float3 center_vert = make_float3(0.0f, 0.0f, 0.0f);
 				float3 center_normal = make_float3(0.0f, 0.0f, 0.0f);
 
@@ -467,7 +560,7 @@ void Mesh::tessellate(DiagSplit *split)
 				}
 
 				for(int corner = 0; corner < face.num_corners; corner++) {
-					LinearQuadPatch patch;
+					LinearQuadPatch& patch = linear_patches[face.ptex_offset + corner];
 					float3 *hull = patch.hull;
 					float3 *normals = patch.normals;
 
@@ -499,12 +592,36 @@ void Mesh::tessellate(DiagSplit *split)
 						}
 					}
 
-					split->split_quad(&patch);
+					patches[face.ptex_offset + corner] = &patch;
 				}
 			}
 		}
 	}
 
+	/* Split patches in parallel, every task splits a range of patches into
+	 * its own list of subpatches. Lists are merged in order afterwards, so
+	 * the result does not depend on scheduling. */
+	const int num_tasks = divide_up(num_patches, TESSELLATE_SPLIT_BATCH_SIZE);
+	vector<DiagSplit> splits(num_tasks, DiagSplit(split->params));
+
+	TaskPool pool;
+	for(int i = 0; i < num_tasks; i++) {
+		pool.push(function_bind(&tessellate_split_patches,
+		                        &splits[i],
+		                        &patches,
+		                        &patch_is_quad,
+		                        i*TESSELLATE_SPLIT_BATCH_SIZE,
+		                        min((i + 1)*TESSELLATE_SPLIT_BATCH_SIZE, num_patches)));
+	}
+	pool.wait_work();
+
+	for(int i = 0; i < num_tasks; i++) {
+		split->append(splits[i]);
+	}
+	splits.clear();
+
+	split->dice(control_hash);
+
 	/* interpolate center points for attributes */
 	foreach(Attribute& attr, subd_attributes.attributes) {
 #ifdef WITH_OPENSUBDIV
@@ -21,6 +21,7 @@
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
 #include "util/util_progress.h"
+#include "util/util_texture.h"
 #include "util/util_types.h"
 
 CCL_NAMESPACE_BEGIN
@@ -396,8 +397,36 @@ void VolumeMeshBuilder::convert_quads_to_tris(const vector<QuadData> &quads,
 struct VoxelAttributeGrid {
 	float *data;
 	int channels;
+	/* Tile index of sparse grids, NULL for dense grids. */
+	const int *grid;
 };
 
+/* Channels of a voxel, see util_texture_sparse.h for the layout
+ * of sparse grids. */
+static const float *voxel_grid_data(const VoxelAttributeGrid &voxel_grid,
+                                    const int3 &resolution,
+                                    int x, int y, int z)
+{
+	size_t voxel_index;
+
+	if(voxel_grid.grid) {
+		const int tile_size = TEX_SPARSE_TILE_SIZE;
+		const int mask = tile_size - 1;
+		const size_t tiles_x = divide_up(resolution.x, tile_size);
+		const size_t tiles_y = divide_up(resolution.y, tile_size);
+		const size_t tile = (x >> TEX_SPARSE_TILE_SHIFT) +
+		                    tiles_x*((y >> TEX_SPARSE_TILE_SHIFT) +
+		                             tiles_y*(z >> TEX_SPARSE_TILE_SHIFT));
+		voxel_index = (size_t)voxel_grid.grid[tile]*tile_size*tile_size*tile_size +
+		              (x & mask) + tile_size*((y & mask) + tile_size*(z & mask));
+	}
+	else {
+		voxel_index = compute_voxel_index(resolution, x, y, z);
+	}
+
+	return voxel_grid.data + voxel_index*voxel_grid.channels;
+}
+
 void MeshManager::create_volume_mesh(Scene *scene,
                                      Mesh *mesh,
                                      Progress& progress)
@@ -431,8 +460,16 @@ void MeshManager::create_volume_mesh(Scene *scene,
 		}
 
 		VoxelAttributeGrid voxel_grid;
-		voxel_grid.data = static_cast<float*>(image_memory->host_pointer);
 		voxel_grid.channels = image_memory->data_elements;
+		if(image_memory->data_grid_size) {
+			voxel_grid.grid = static_cast<int*>(image_memory->host_pointer);
+			voxel_grid.data = static_cast<float*>(image_memory->host_pointer) +
+			                  image_memory->data_grid_size*voxel_grid.channels;
+		}
+		else {
+			voxel_grid.grid = NULL;
+			voxel_grid.data = static_cast<float*>(image_memory->host_pointer);
+		}
 		voxel_grids.push_back(voxel_grid);
 	}
 
@@ -491,54 +528,49 @@ void MeshManager::create_volume_mesh(Scene *scene,
 	for(int z = 0; z < resolution.z; ++z) {
 		for(int y = 0; y < resolution.y; ++y) {
 			for(int x = 0; x < resolution.x; ++x) {
-				size_t voxel_index = compute_voxel_index(resolution, x, y, z);
-
 				for(size_t i = 0; i < voxel_grids.size(); ++i) {
 					const VoxelAttributeGrid &voxel_grid = voxel_grids[i];
+					const float *voxel = voxel_grid_data(voxel_grid, resolution, x, y, z);
 
 					if(voxel_grid.channels == 1) {
-						if(voxel_grid.data[voxel_index] >= isovalue) {
+						if(voxel[0] >= isovalue) {
 							builder.add_node_with_padding(x, y, z);
 							break;
 						}
 					}
 					else if(voxel_grid.channels == 3) {
-						voxel_index = compute_voxel_index(resolution, x*3, y, z);
-
-						if(voxel_grid.data[voxel_index] >= isovalue) {
+						if(voxel[0] >= isovalue) {
 							builder.add_node_with_padding(x, y, z);
 							break;
 						}
 
-						if(voxel_grid.data[voxel_index + 1] >= isovalue) {
+						if(voxel[1] >= isovalue) {
 							builder.add_node_with_padding(x, y, z);
 							break;
 						}
 
-						if(voxel_grid.data[voxel_index + 2] >= isovalue) {
+						if(voxel[2] >= isovalue) {
 							builder.add_node_with_padding(x, y, z);
 							break;
 						}
 					}
 					else if(voxel_grid.channels == 4) {
-						voxel_index = compute_voxel_index(resolution, x*4, y, z);
-
 						/* check alpha first */
-						if(voxel_grid.data[voxel_index + 3] < isovalue) {
+						if(voxel[3] < isovalue) {
 							continue;
 						}
 
-						if(voxel_grid.data[voxel_index] >= isovalue) {
+						if(voxel[0] >= isovalue) {
 							builder.add_node_with_padding(x, y, z);
 							continue;
 						}
 
-						if(voxel_grid.data[voxel_index + 1] >= isovalue) {
+						if(voxel[1] >= isovalue) {
 							builder.add_node_with_padding(x, y, z);
 							continue;
 						}
 
-						if(voxel_grid.data[voxel_index + 2] >= isovalue) {
+						if(voxel[2] >= isovalue) {
 							builder.add_node_with_padding(x, y, z);
 							continue;
 						}
@@ -72,11 +72,14 @@ DeviceScene::DeviceScene(Device *device)
   lights(device, "__lights", MEM_TEXTURE),
   light_background_marginal_cdf(device, "__light_background_marginal_cdf", MEM_TEXTURE),
   light_background_conditional_cdf(device, "__light_background_conditional_cdf", MEM_TEXTURE),
+  light_tree_nodes(device, "__light_tree_nodes", MEM_TEXTURE),
+  light_tree_leaf(device, "__light_tree_leaf", MEM_TEXTURE),
+  light_tree_object_range(device, "__light_tree_object_range", MEM_TEXTURE),
   particles(device, "__particles", MEM_TEXTURE),
   svm_nodes(device, "__svm_nodes", MEM_TEXTURE),
   shaders(device, "__shaders", MEM_TEXTURE),
   lookup_table(device, "__lookup_table", MEM_TEXTURE),
-  sobol_directions(device, "__sobol_directions", MEM_TEXTURE)
+  sample_pattern_lut(device, "__sample_pattern_lut", MEM_TEXTURE)
 {
 	memset(&data, 0, sizeof(data));
 }
@@ -95,7 +98,7 @@ Scene::Scene(const SceneParams& params_, Device *device)
 	mesh_manager = new MeshManager();
 	object_manager = new ObjectManager();
 	integrator = new Integrator();
-	image_manager = new ImageManager(device->info);
+	image_manager = new ImageManager(device->info, params);
 	particle_system_manager = new ParticleSystemManager();
 	curve_system_manager = new CurveSystemManager();
 	bake_manager = new BakeManager();
@@ -105,6 +105,9 @@ public:
 	device_vector<KernelLight> lights;
 	device_vector<float2> light_background_marginal_cdf;
 	device_vector<float2> light_background_conditional_cdf;
+	device_vector<KernelLightTreeNode> light_tree_nodes;
+	device_vector<uint> light_tree_leaf;
+	device_vector<uint2> light_tree_object_range;
 
 	/* particles */
 	device_vector<KernelParticle> particles;
@@ -117,7 +120,7 @@ public:
 	device_vector<float> lookup_table;
 
 	/* integrator */
-	device_vector<uint> sobol_directions;
+	device_vector<uint> sample_pattern_lut;
 
 	KernelData data;
 
@@ -163,9 +166,30 @@ public:
 	bool use_bvh_unaligned_nodes;
 	int num_bvh_time_steps;
 
+	/* Maximum number of curve segments in a BVH leaf. Larger leaves give a
+	 * much smaller hair BVH, the SAH still decides where leaves are made.
+	 */
+	int bvh_curve_leaf_size;
+
+	/* Refitted BVH is rebuilt once its estimated traversal cost grew by more
+	 * than this fraction since the last full build, zero to always refit.
+	 */
+	float bvh_refit_threshold;
+
 	bool persistent_data;
 	int texture_limit;
 
+	/* Look up image files through a tiled texture cache instead of loading
+	 * them into memory, with the cache size limited to the given number of
+	 * megabytes. Only supported by the CPU device. */
+	bool use_texture_cache;
+	int texture_cache_size;
+
+	/* Store float image files as half float, and byte images block compressed
+	 * where the device supports it, to reduce texture memory. */
+	bool use_half_textures;
+	bool use_compressed_textures;
+
 	SceneParams()
 	{
 		shadingsystem = SHADINGSYSTEM_SVM;
@@ -174,8 +198,14 @@ public:
 		use_bvh_spatial_split = false;
 		use_bvh_unaligned_nodes = true;
 		num_bvh_time_steps = 0;
+		bvh_curve_leaf_size = 1;
+		bvh_refit_threshold = 0.0f;
 		persistent_data = false;
 		texture_limit = 0;
+		use_texture_cache = false;
+		texture_cache_size = 1024;
+		use_half_textures = false;
+		use_compressed_textures = false;
 	}
 
 	bool modified(const SceneParams& params)
@@ -185,8 +215,14 @@ public:
 		&& use_bvh_spatial_split == params.use_bvh_spatial_split
 		&& use_bvh_unaligned_nodes == params.use_bvh_unaligned_nodes
 		&& num_bvh_time_steps == params.num_bvh_time_steps
+		&& bvh_curve_leaf_size == params.bvh_curve_leaf_size
+		&& bvh_refit_threshold == params.bvh_refit_threshold
 		&& persistent_data == params.persistent_data
-		&& texture_limit == params.texture_limit); }
+		&& texture_limit == params.texture_limit
+		&& use_texture_cache == params.use_texture_cache
+		&& texture_cache_size == params.texture_cache_size
+		&& use_half_textures == params.use_half_textures
+		&& use_compressed_textures == params.use_compressed_textures); }
 };
 
 /* Scene */
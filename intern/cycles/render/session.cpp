@@ -27,6 +27,7 @@
 #include "render/scene.h"
 #include "render/session.h"
 #include "render/bake.h"
+#include "render/stats.h"
 
 #include "util/util_foreach.h"
 #include "util/util_function.h"
@@ -53,7 +54,7 @@ Session::Session(const SessionParams& params_)
 
 	TaskScheduler::init(params.threads);
 
-	device = Device::create(params.device, stats, params.background);
+	device = Device::create(params.device, stats, profiler, params.background);
 
 	if(params.background && !params.write_render_cb) {
 		buffers = NULL;
@@ -723,6 +724,10 @@ void Session::run()
 	/* load kernels */
 	load_kernels();
 
+	if(params.use_profiling && params.device.has_profiling) {
+		profiler.start();
+	}
+
 	/* session thread loop */
 	progress.set_status("Waiting for render to start");
 
@@ -737,6 +742,8 @@ void Session::run()
 			run_cpu();
 	}
 
+	profiler.stop();
+
 	/* progress update */
 	if(progress.get_cancel())
 		progress.set_status("Cancel", progress.get_cancel_message());
@@ -870,6 +877,12 @@ void Session::update_scene()
 
 		progress.set_status("Updating Scene");
 		MEM_GUARDED_CALL(&progress, scene->device_update, device, progress);
+
+		/* Shader and object counts are known now, no render threads are
+		 * running while the scene is updated. */
+		if(params.use_profiling) {
+			profiler.reset(scene->shaders.size(), scene->objects.size());
+		}
 	}
 }
 
@@ -878,7 +891,9 @@ void Session::update_status_time(bool show_pause, bool show_done)
 	int progressive_sample = tile_manager.state.sample;
 	int num_samples = tile_manager.get_num_effective_samples();
 
-	int tile = progress.get_rendered_tiles();
+	/* Pieces of split tiles are reported as rendered tiles of their own,
+	 * count every split tile once. */
+	int tile = max(progress.get_rendered_tiles() - tile_manager.state.num_split_tiles, 0);
 	int num_tiles = tile_manager.state.num_tiles;
 
 	/* update status */
@@ -1046,6 +1061,17 @@ void Session::device_free()
 	 */
 }
 
+void Session::collect_statistics(RenderStats *render_stats)
+{
+	render_stats->mem_used = stats.mem_used;
+	render_stats->mem_peak = stats.mem_peak;
+
+	thread_scoped_lock scene_lock(scene->mutex);
+	if(params.use_profiling && params.device.has_profiling) {
+		render_stats->collect_profiling(scene, profiler);
+	}
+}
+
 int Session::get_max_closure_count()
 {
 	int max_closures = 0;
@@ -22,6 +22,7 @@
 #include "render/shader.h"
 #include "render/tile.h"
 
+#include "util/util_profiling.h"
 #include "util/util_progress.h"
 #include "util/util_stats.h"
 #include "util/util_thread.h"
@@ -36,6 +37,7 @@ class DeviceRequestedFeatures;
 class DisplayBuffer;
 class Progress;
 class RenderBuffers;
+class RenderStats;
 class Scene;
 
 /* Session Parameters */
@@ -57,6 +59,10 @@ public:
 
 	bool display_buffer_linear;
 
+	/* Sample which kernel stage, shader and object the render threads are
+	 * in, for a breakdown of the render time. CPU only. */
+	bool use_profiling;
+
 	bool use_denoising;
 	int denoising_radius;
 	float denoising_strength;
@@ -96,6 +102,8 @@ public:
 
 		display_buffer_linear = false;
 
+		use_profiling = false;
+
 		cancel_timeout = 0.1;
 		reset_timeout = 0.1;
 		text_timeout = 1.0;
@@ -117,6 +125,7 @@ public:
 		&& pixel_size == params.pixel_size
 		&& threads == params.threads
 		&& display_buffer_linear == params.display_buffer_linear
+		&& use_profiling == params.use_profiling
 		&& cancel_timeout == params.cancel_timeout
 		&& reset_timeout == params.reset_timeout
 		&& text_timeout == params.text_timeout
@@ -141,6 +150,7 @@ public:
 	SessionParams params;
 	TileManager tile_manager;
 	Stats stats;
+	Profiler profiler;
 
 	function<void(RenderTile&)> write_render_tile_cb;
 	function<void(RenderTile&, bool)> update_render_tile_cb;
@@ -162,6 +172,10 @@ public:
 
 	void device_free();
 
+	/* Fill in the memory usage and, when profiling, the breakdown of the
+	 * render time. Only valid after the render finished. */
+	void collect_statistics(RenderStats *stats);
+
 	/* Returns the rendering progress or 0 if no progress can be determined
 	 * (for example, when rendering with unlimited samples). */
 	float get_progress();
@@ -0,0 +1,245 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/stats.h"
+#include "render/object.h"
+#include "render/scene.h"
+#include "render/shader.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_foreach.h"
+#include "util/util_string.h"
+
+CCL_NAMESPACE_BEGIN
+
+static int kIndentNumSpaces = 2;
+
+/* Named Nested Sample Stats */
+
+NamedNestedSampleStats::NamedNestedSampleStats()
+: self_samples(0), sum_samples(0)
+{
+}
+
+NamedNestedSampleStats::NamedNestedSampleStats(const string& name, uint64_t samples)
+: name(name), self_samples(samples), sum_samples(samples)
+{
+}
+
+NamedNestedSampleStats& NamedNestedSampleStats::add_entry(const string& name_, uint64_t samples_)
+{
+	entries.push_back(NamedNestedSampleStats(name_, samples_));
+	return entries[entries.size()-1];
+}
+
+void NamedNestedSampleStats::update_sum()
+{
+	sum_samples = self_samples;
+	foreach(NamedNestedSampleStats& entry, entries) {
+		entry.update_sum();
+		sum_samples += entry.sum_samples;
+	}
+}
+
+static bool namednestedsamplestats_greater(const NamedNestedSampleStats& a,
+                                           const NamedNestedSampleStats& b)
+{
+	return a.sum_samples > b.sum_samples;
+}
+
+string NamedNestedSampleStats::full_report(int indent_level,
+                                           uint64_t total_samples,
+                                           double sample_interval)
+{
+	update_sum();
+
+	if(total_samples == 0) {
+		total_samples = sum_samples;
+	}
+
+	const string indent(indent_level * kIndentNumSpaces, ' ');
+
+	const double sum_percent = 100.0*((double) sum_samples) / total_samples;
+	const double sum_seconds = sum_samples * sample_interval;
+	const double self_percent = 100.0*((double) self_samples) / total_samples;
+	const double self_seconds = self_samples * sample_interval;
+	string info = string_printf("%-32s: Total %3.2f%% (%.2fs), Self %3.2f%% (%.2fs)\n",
+	                            name.c_str(),
+	                            sum_percent,
+	                            sum_seconds,
+	                            self_percent,
+	                            self_seconds);
+	string result = indent + info;
+
+	sort(entries.begin(), entries.end(), namednestedsamplestats_greater);
+	foreach(NamedNestedSampleStats& entry, entries) {
+		result += entry.full_report(indent_level + 1, total_samples, sample_interval);
+	}
+	return result;
+}
+
+/* Named Sample Count Pair */
+
+NamedSampleCountPair::NamedSampleCountPair(const string& name, uint64_t samples, uint64_t hits)
+: name(name), samples(samples), hits(hits)
+{
+}
+
+NamedSampleCountStats::NamedSampleCountStats()
+{
+}
+
+void NamedSampleCountStats::add(const string& name, uint64_t samples, uint64_t hits)
+{
+	entry_map::iterator entry = entries.find(name);
+	if(entry != entries.end()) {
+		entry->second.samples += samples;
+		entry->second.hits += hits;
+		return;
+	}
+	entries.insert(std::make_pair(name, NamedSampleCountPair(name, samples, hits)));
+}
+
+static bool namedsamplecountpair_greater(const NamedSampleCountPair& a,
+                                         const NamedSampleCountPair& b)
+{
+	return a.samples > b.samples;
+}
+
+string NamedSampleCountStats::full_report(int indent_level, double sample_interval)
+{
+	const string indent(indent_level * kIndentNumSpaces, ' ');
+
+	vector<NamedSampleCountPair> sorted_entries;
+	sorted_entries.reserve(entries.size());
+
+	uint64_t total_hits = 0, total_samples = 0;
+	foreach(entry_map::const_reference entry, entries) {
+		const NamedSampleCountPair &pair = entry.second;
+
+		total_hits += pair.hits;
+		total_samples += pair.samples;
+
+		sorted_entries.push_back(pair);
+	}
+	const double avg_samples_per_hit = (total_hits > 0)? ((double) total_samples) / total_hits: 0.0;
+
+	sort(sorted_entries.begin(), sorted_entries.end(), namedsamplecountpair_greater);
+
+	string result = "";
+	foreach(const NamedSampleCountPair& entry, sorted_entries) {
+		const double seconds = entry.samples * sample_interval;
+		const double relative = (entry.hits > 0 && avg_samples_per_hit > 0.0)?
+		                        ((double) entry.samples) / (entry.hits * avg_samples_per_hit): 0.0;
+
+		result += indent + string_printf("%-32s: %.2fs (Relative cost: %.2f)\n",
+		                                 entry.name.c_str(),
+		                                 seconds,
+		                                 relative);
+	}
+	return result;
+}
+
+/* Render Stats */
+
+RenderStats::RenderStats()
+: mem_used(0),
+  mem_peak(0),
+  has_profiling(false),
+  sample_interval(0.0)
+{
+}
+
+void RenderStats::collect_profiling(Scene *scene, Profiler& prof)
+{
+	has_profiling = true;
+	sample_interval = prof.get_sample_interval();
+
+	kernel = NamedNestedSampleStats("Total render time", prof.get_event(PROFILING_UNKNOWN));
+
+	kernel.add_entry("Ray setup", prof.get_event(PROFILING_RAY_SETUP));
+	kernel.add_entry("Result writing", prof.get_event(PROFILING_WRITE_RESULT));
+	kernel.add_entry("Denoising", prof.get_event(PROFILING_DENOISING));
+
+	NamedNestedSampleStats &integrator = kernel.add_entry("Path integration", prof.get_event(PROFILING_PATH_INTEGRATE));
+	integrator.add_entry("Scene intersection", prof.get_event(PROFILING_SCENE_INTERSECT));
+	integrator.add_entry("Indirect emission", prof.get_event(PROFILING_INDIRECT_EMISSION));
+	integrator.add_entry("Volumes", prof.get_event(PROFILING_VOLUME));
+
+	NamedNestedSampleStats &shading = integrator.add_entry("Shading", 0);
+	shading.add_entry("Shader Setup", prof.get_event(PROFILING_SHADER_SETUP));
+	shading.add_entry("Shader Eval", prof.get_event(PROFILING_SHADER_EVAL));
+	shading.add_entry("Shader Apply", prof.get_event(PROFILING_SHADER_APPLY));
+	shading.add_entry("Ambient Occlusion", prof.get_event(PROFILING_AO));
+	shading.add_entry("Subsurface", prof.get_event(PROFILING_SUBSURFACE));
+
+	integrator.add_entry("Connect Light", prof.get_event(PROFILING_CONNECT_LIGHT));
+	integrator.add_entry("Surface Bounce", prof.get_event(PROFILING_SURFACE_BOUNCE));
+
+	NamedNestedSampleStats &intersection = kernel.add_entry("Intersection", 0);
+	intersection.add_entry("Full Intersection", prof.get_event(PROFILING_INTERSECT));
+	intersection.add_entry("Local Intersection", prof.get_event(PROFILING_INTERSECT_LOCAL));
+	intersection.add_entry("Shadow All Intersection", prof.get_event(PROFILING_INTERSECT_SHADOW_ALL));
+	intersection.add_entry("Volume Intersection", prof.get_event(PROFILING_INTERSECT_VOLUME));
+	intersection.add_entry("Volume All Intersection", prof.get_event(PROFILING_INTERSECT_VOLUME_ALL));
+
+	NamedNestedSampleStats &closure = kernel.add_entry("Closures", 0);
+	closure.add_entry("Surface Closure Evaluation", prof.get_event(PROFILING_CLOSURE_EVAL));
+	closure.add_entry("Surface Closure Sampling", prof.get_event(PROFILING_CLOSURE_SAMPLE));
+	closure.add_entry("Volume Closure Evaluation", prof.get_event(PROFILING_CLOSURE_VOLUME_EVAL));
+	closure.add_entry("Volume Closure Sampling", prof.get_event(PROFILING_CLOSURE_VOLUME_SAMPLE));
+
+	shaders.entries.clear();
+	for(size_t i = 0; i < scene->shaders.size(); i++) {
+		uint64_t samples, hits;
+		if(prof.get_shader(i, samples, hits)) {
+			shaders.add(scene->shaders[i]->name.string(), samples, hits);
+		}
+	}
+
+	objects.entries.clear();
+	for(size_t i = 0; i < scene->objects.size(); i++) {
+		uint64_t samples, hits;
+		if(prof.get_object(i, samples, hits)) {
+			objects.add(scene->objects[i]->name.string(), samples, hits);
+		}
+	}
+}
+
+string RenderStats::full_report()
+{
+	string result = "";
+	result += "Memory:\n";
+	result += string_printf("  %-32s: %s\n", "Used", string_human_readable_size(mem_used).c_str());
+	result += string_printf("  %-32s: %s\n", "Peak", string_human_readable_size(mem_peak).c_str());
+
+	if(has_profiling) {
+		result += "Kernel statistics:\n";
+		result += kernel.full_report(1, 0, sample_interval);
+
+		result += "Shader statistics:\n";
+		result += shaders.full_report(1, sample_interval);
+
+		result += "Object statistics:\n";
+		result += objects.full_report(1, sample_interval);
+	}
+	else {
+		result += "Profiling information not available (only works with CPU rendering)\n";
+	}
+	return result;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RENDER_STATS_H__
+#define __RENDER_STATS_H__
+
+#include "util/util_map.h"
+#include "util/util_profiling.h"
+#include "util/util_string.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class Scene;
+
+/* Named statistics entry with a hierarchy of child entries, the time of an
+ * entry is its own samples plus those of all its children. */
+class NamedNestedSampleStats {
+public:
+	NamedNestedSampleStats();
+	NamedNestedSampleStats(const string& name, uint64_t samples);
+
+	NamedNestedSampleStats& add_entry(const string& name, uint64_t samples);
+
+	/* Updates sum_samples recursively. */
+	void update_sum();
+
+	string full_report(int indent_level, uint64_t total_samples, double sample_interval);
+
+	string name;
+
+	/* self_samples contains only the samples that this specific event got,
+	 * while sum_samples also includes the samples of all sub-entries. */
+	uint64_t self_samples, sum_samples;
+
+	vector<NamedNestedSampleStats> entries;
+};
+
+/* Named entry of the number of samples and hits, for shaders and objects.
+ * Hits count how often rendering started on the shader or object, samples
+ * how much time was spent on it. */
+class NamedSampleCountPair {
+public:
+	NamedSampleCountPair(const string& name, uint64_t samples, uint64_t hits);
+
+	string name;
+	uint64_t samples;
+	uint64_t hits;
+};
+
+class NamedSampleCountStats {
+public:
+	NamedSampleCountStats();
+
+	string full_report(int indent_level, double sample_interval);
+	void add(const string& name, uint64_t samples, uint64_t hits);
+
+	typedef unordered_map<string, NamedSampleCountPair> entry_map;
+	entry_map entries;
+};
+
+/* Statistics about a render, gathered by Session::collect_statistics(). */
+class RenderStats {
+public:
+	RenderStats();
+
+	/* Return full report as string. */
+	string full_report();
+
+	/* Collect kernel, shader and object breakdown from the profiler. */
+	void collect_profiling(Scene *scene, Profiler& prof);
+
+	size_t mem_used;
+	size_t mem_peak;
+
+	bool has_profiling;
+	double sample_interval;
+
+	NamedNestedSampleStats kernel;
+	NamedSampleCountStats shaders;
+	NamedSampleCountStats objects;
+};
+
+CCL_NAMESPACE_END
+
+#endif  /* __RENDER_STATS_H__ */
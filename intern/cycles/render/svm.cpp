@@ -23,6 +23,7 @@
 #include "render/shader.h"
 #include "render/svm.h"
 
+#include "util/util_hash.h"
 #include "util/util_logging.h"
 #include "util/util_foreach.h"
 #include "util/util_progress.h"
@@ -42,19 +43,21 @@ SVMShaderManager::~SVMShaderManager()
 
 void SVMShaderManager::reset(Scene * /*scene*/)
 {
+	compiled_shaders_.clear();
 }
 
 void SVMShaderManager::device_update_shader(Scene *scene,
                                             Shader *shader,
                                             Progress *progress,
-                                            array<int4> *global_svm_nodes)
+                                            array<int4> *svm_nodes_ptr)
 {
 	if(progress->get_cancel()) {
 		return;
 	}
 	assert(shader->graph);
 
-	array<int4> svm_nodes;
+	array<int4>& svm_nodes = *svm_nodes_ptr;
+	svm_nodes.clear();
 	svm_nodes.push_back_slow(make_int4(NODE_SHADER_JUMP, 0, 0, 0));
 
 	SVMCompiler::Summary summary;
@@ -66,27 +69,36 @@ void SVMShaderManager::device_update_shader(Scene *scene,
 	        << "Shader name: " << shader->name << "\n"
 	        << summary.full_report();
 
-	nodes_lock_.lock();
 	if(shader->use_mis && shader->has_surface_emission) {
+		nodes_lock_.lock();
 		scene->light_manager->need_update = true;
+		nodes_lock_.unlock();
 	}
+}
 
-	/* The copy needs to be done inside the lock, if another thread resizes the array 
-	 * while memcpy is running, it'll be copying into possibly invalid/freed ram. 
-	 */
-	size_t global_nodes_size = global_svm_nodes->size();
-	global_svm_nodes->resize(global_nodes_size + svm_nodes.size());
-	
-	/* Offset local SVM nodes to a global address space. */
-	int4& jump_node = (*global_svm_nodes)[shader->id];
-	jump_node.y = svm_nodes[0].y + global_nodes_size - 1;
-	jump_node.z = svm_nodes[0].z + global_nodes_size - 1;
-	jump_node.w = svm_nodes[0].w + global_nodes_size - 1;
-	/* Copy new nodes to global storage. */
-	memcpy(&(*global_svm_nodes)[global_nodes_size],
-	       &svm_nodes[1],
-	       sizeof(int4) * (svm_nodes.size() - 1));
-	nodes_lock_.unlock();
+bool SVMShaderManager::shader_need_compile(Shader *shader)
+{
+	/* Integrator dependent nodes are simplified using the integrator
+	 * settings, which are not part of the shader update tag. */
+	return shader->need_update ||
+	       shader->has_integrator_dependency ||
+	       compiled_shaders_.find(shader) == compiled_shaders_.end();
+}
+
+static uint svm_nodes_hash(const array<int4>& svm_nodes)
+{
+	uint hash = svm_nodes.size();
+
+	/* Jump node offsets are relative to the shader, so it's included. */
+	for(size_t i = 0; i < svm_nodes.size(); i++) {
+		const int4& node = svm_nodes[i];
+		hash = hash_int_2d(hash, node.x);
+		hash = hash_int_2d(hash, node.y);
+		hash = hash_int_2d(hash, node.z);
+		hash = hash_int_2d(hash, node.w);
+	}
+
+	return hash;
 }
 
 void SVMShaderManager::device_update(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
@@ -104,30 +116,95 @@ void SVMShaderManager::device_update(Device *device, DeviceScene *dscene, Scene
 	/* determine which shaders are in use */
 	device_update_shaders_used(scene);
 
-	/* svm_nodes */
-	array<int4> svm_nodes;
-	size_t i;
-
-	for(i = 0; i < scene->shaders.size(); i++) {
-		svm_nodes.push_back_slow(make_int4(NODE_SHADER_JUMP, 0, 0, 0));
+	/* Forget about shaders which were removed from the scene. */
+	set<Shader*> scene_shaders(scene->shaders.begin(), scene->shaders.end());
+	for(CompiledShaderMap::iterator it = compiled_shaders_.begin(); it != compiled_shaders_.end(); ) {
+		if(scene_shaders.find(it->first) == scene_shaders.end()) {
+			compiled_shaders_.erase(it++);
+		}
+		else {
+			++it;
+		}
 	}
 
+	/* Compile shaders which changed since the last update, others use the
+	 * nodes compiled before. Map entries are created upfront so the threads
+	 * don't modify the map. */
+	int num_compiled = 0;
 	TaskPool task_pool;
 	foreach(Shader *shader, scene->shaders) {
+		if(!shader_need_compile(shader)) {
+			continue;
+		}
 		task_pool.push(function_bind(&SVMShaderManager::device_update_shader,
 		                             this,
 		                             scene,
 		                             shader,
 		                             &progress,
-		                             &svm_nodes),
+		                             &compiled_shaders_[shader]),
 		               false);
+		num_compiled++;
 	}
 	task_pool.wait_work();
 
 	if(progress.get_cancel()) {
+		/* Partially compiled shaders can not be reused. */
+		compiled_shaders_.clear();
 		return;
 	}
 
+	/* svm_nodes */
+	array<int4> svm_nodes;
+	size_t i;
+
+	for(i = 0; i < scene->shaders.size(); i++) {
+		svm_nodes.push_back_slow(make_int4(NODE_SHADER_JUMP, 0, 0, 0));
+	}
+
+	/* Copy shader nodes to global storage. Shaders which compiled to the
+	 * same nodes share them, their jump nodes point to the same offset. */
+	typedef pair<Shader*, size_t> SharedNodes;
+	map<uint, vector<SharedNodes> > shared_nodes;
+	int num_shared = 0;
+
+	foreach(Shader *shader, scene->shaders) {
+		const array<int4>& shader_nodes = compiled_shaders_[shader];
+		const uint hash = svm_nodes_hash(shader_nodes);
+
+		size_t global_nodes_size = svm_nodes.size();
+		bool found = false;
+
+		vector<SharedNodes>& candidates = shared_nodes[hash];
+		foreach(const SharedNodes& candidate, candidates) {
+			if(compiled_shaders_[candidate.first] == shader_nodes) {
+				global_nodes_size = candidate.second;
+				found = true;
+				break;
+			}
+		}
+
+		if(found) {
+			num_shared++;
+		}
+		else {
+			candidates.push_back(SharedNodes(shader, global_nodes_size));
+			svm_nodes.resize(global_nodes_size + shader_nodes.size() - 1);
+			memcpy(&svm_nodes[global_nodes_size],
+			       &shader_nodes[1],
+			       sizeof(int4) * (shader_nodes.size() - 1));
+		}
+
+		/* Offset local SVM nodes to a global address space. */
+		int4& jump_node = svm_nodes[shader->id];
+		jump_node.y = shader_nodes[0].y + global_nodes_size - 1;
+		jump_node.z = shader_nodes[0].z + global_nodes_size - 1;
+		jump_node.w = shader_nodes[0].w + global_nodes_size - 1;
+	}
+
+	VLOG(1) << "Compiled " << num_compiled << " shaders, "
+	        << num_shared << " shaders share nodes with another shader, "
+	        << svm_nodes.size() << " SVM nodes in total.";
+
 	dscene->svm_nodes.steal_data(svm_nodes);
 	dscene->svm_nodes.copy_to_device();
 
@@ -21,6 +21,7 @@
 #include "render/graph.h"
 #include "render/shader.h"
 
+#include "util/util_map.h"
 #include "util/util_set.h"
 #include "util/util_string.h"
 #include "util/util_thread.h"
@@ -52,10 +53,18 @@ protected:
 	/* Lock used to synchronize threaded nodes compilation. */
 	thread_spin_lock nodes_lock_;
 
+	/* SVM nodes of every shader from the last update, in the address space
+	 * of the shader with its jump node first. Reused for shaders which did
+	 * not change since then. */
+	typedef map<Shader*, array<int4> > CompiledShaderMap;
+	CompiledShaderMap compiled_shaders_;
+
+	bool shader_need_compile(Shader *shader);
+
 	void device_update_shader(Scene *scene,
 	                          Shader *shader,
 	                          Progress *progress,
-	                          array<int4> *global_svm_nodes);
+	                          array<int4> *svm_nodes);
 };
 
 /* Graph Compiler */
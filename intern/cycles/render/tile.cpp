@@ -18,10 +18,18 @@
 
 #include "util/util_algorithm.h"
 #include "util/util_foreach.h"
+#include "util/util_time.h"
 #include "util/util_types.h"
 
 CCL_NAMESPACE_BEGIN
 
+/* Tiles are not split into pieces smaller than this along either axis. */
+#define TILE_SPLIT_MIN_SIZE 16
+
+/* Only split when the tile is this much larger than the device's share of
+ * the remaining work, avoids splitting a tile over and over by tiny amounts. */
+#define TILE_SPLIT_THRESHOLD 1.5
+
 namespace {
 
 class TileComparator {
@@ -103,6 +111,9 @@ TileManager::TileManager(bool progressive_, int num_samples_, int2 tile_size_, i
 	background = background_;
 	schedule_denoising = false;
 
+	device_stats.resize(num_devices);
+	remaining_pixels = 0;
+
 	range_start_sample = 0;
 	range_num_samples = -1;
 
@@ -149,11 +160,18 @@ void TileManager::reset(BufferParams& params_, int num_samples_)
 	state.buffer = BufferParams();
 	state.sample = range_start_sample - 1;
 	state.num_tiles = 0;
+	state.num_split_tiles = 0;
 	state.num_samples = 0;
 	state.resolution_divider = get_divider(params.width, params.height, start_resolution);
 	state.render_tiles.clear();
 	state.denoising_tiles.clear();
 	device_free();
+
+	/* Throughput measurements are kept, they remain useful for the next frame. */
+	foreach(DeviceStats& stats, device_stats) {
+		stats.num_active_tiles = 0;
+	}
+	remaining_pixels = 0;
 }
 
 void TileManager::set_samples(int num_samples_)
@@ -345,6 +363,12 @@ int TileManager::gen_tiles(bool sliced)
 		}
 	}
 
+	/* Room for tiles created by splitting, so existing tiles never move while
+	 * the session holds pointers to them. */
+	if(use_tile_splitting()) {
+		state.tiles.reserve(2*state.tiles.size());
+	}
+
 	return idx;
 }
 
@@ -363,6 +387,12 @@ void TileManager::set_tiles()
 	int image_h = max(1, params.height/resolution);
 
 	state.num_tiles = gen_tiles(!background);
+	state.num_split_tiles = 0;
+
+	remaining_pixels = 0;
+	foreach(Tile& tile, state.tiles) {
+		remaining_pixels += (int64_t)tile.w*tile.h;
+	}
 
 	state.buffer.width = image_w;
 	state.buffer.height = image_h;
@@ -412,6 +442,8 @@ bool TileManager::finish_tile(int index, bool &delete_tile)
 {
 	delete_tile = false;
 
+	tile_render_end(index);
+
 	if(progressive) {
 		return true;
 	}
@@ -481,10 +513,123 @@ bool TileManager::next_tile(Tile* &tile, int device)
 
 	int idx = state.render_tiles[logical_device].front();
 	state.render_tiles[logical_device].pop_front();
+
+	if(use_tile_splitting()) {
+		split_tile(idx, device);
+	}
+
+	tile_render_begin(idx, device);
+
 	tile = &state.tiles[idx];
 	return true;
 }
 
+/* Splitting is only done when tiles are independent of each other: any device
+ * can render any tile, tiles are rendered once and not denoised together
+ * with their neighbors. */
+bool TileManager::use_tile_splitting()
+{
+	return background && !progressive && !preserve_tile_device && !schedule_denoising &&
+	       state.render_tiles.size() == 1;
+}
+
+/* When the tile is larger than the device's share of the remaining work, cut
+ * off a piece matching the share and put the rest back in front of the queue.
+ * The share is estimated from the throughput of all tiles being rendered, so
+ * near the end of a frame slow devices get small tiles and all devices finish
+ * at about the same time. */
+void TileManager::split_tile(int index, int device)
+{
+	if(state.tiles.size() >= state.tiles.capacity() || device >= device_stats.size()) {
+		return;
+	}
+
+	double total_speed = 0.0;
+	foreach(const DeviceStats& stats, device_stats) {
+		total_speed += stats.pixel_samples_per_second * stats.num_active_tiles;
+	}
+
+	const double device_speed = device_stats[device].pixel_samples_per_second;
+	if(device_speed == 0.0) {
+		/* No measurement yet. */
+		return;
+	}
+	total_speed += device_speed;
+
+	const double share = remaining_pixels * (device_speed / total_speed);
+
+	Tile& tile = state.tiles[index];
+	const bool split_x = tile.w > tile.h;
+	const int size = split_x? tile.w: tile.h;
+	const int other_size = split_x? tile.h: tile.w;
+
+	if(tile.w * tile.h < TILE_SPLIT_THRESHOLD * share) {
+		return;
+	}
+
+	const int piece_size = max((int)(share / other_size), TILE_SPLIT_MIN_SIZE);
+	if(size - piece_size < TILE_SPLIT_MIN_SIZE) {
+		return;
+	}
+
+	const int rest_index = state.tiles.size();
+	Tile rest = tile;
+	rest.index = rest_index;
+
+	if(split_x) {
+		tile.w = piece_size;
+		rest.x += piece_size;
+		rest.w -= piece_size;
+	}
+	else {
+		tile.h = piece_size;
+		rest.y += piece_size;
+		rest.h -= piece_size;
+	}
+
+	state.tiles.push_back(rest);
+	state.render_tiles[0].push_front(rest_index);
+	state.num_split_tiles++;
+}
+
+void TileManager::tile_render_begin(int index, int device)
+{
+	Tile& tile = state.tiles[index];
+
+	if(tile.state != Tile::RENDER || device >= device_stats.size()) {
+		return;
+	}
+
+	tile.render_device = device;
+	tile.render_start_time = time_dt();
+
+	device_stats[device].num_active_tiles++;
+	remaining_pixels -= (int64_t)tile.w*tile.h;
+}
+
+void TileManager::tile_render_end(int index)
+{
+	Tile& tile = state.tiles[index];
+
+	if(tile.state != Tile::RENDER || tile.render_device == -1) {
+		return;
+	}
+
+	DeviceStats& stats = device_stats[tile.render_device];
+	stats.num_active_tiles--;
+
+	const double time = time_dt() - tile.render_start_time;
+	if(time > 0.0) {
+		const double speed = (double)tile.w*tile.h*state.num_samples / time;
+		/* Smooth out noise in the measurements, rendering time varies a lot
+		 * between tiles. */
+		stats.pixel_samples_per_second = (stats.pixel_samples_per_second == 0.0)?
+		        speed: 0.5*(stats.pixel_samples_per_second + speed);
+	}
+
+	tile.render_device = -1;
+}
+
 bool TileManager::done()
 {
 	int end_sample = (range_num_samples == -1)
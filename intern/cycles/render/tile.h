@@ -40,11 +40,17 @@ public:
 	State state;
 	RenderBuffers *buffers;
 
+	/* Device which is rendering the tile and when it started, used to
+	 * measure device throughput. */
+	int render_device;
+	double render_start_time;
+
 	Tile()
 	{}
 
 	Tile(int index_, int x_, int y_, int w_, int h_, int device_, State state_ = RENDER)
-	: index(index_), x(x_), y(y_), w(w_), h(h_), device(device_), state(state_), buffers(NULL) {}
+	: index(index_), x(x_), y(y_), w(w_), h(h_), device(device_), state(state_), buffers(NULL),
+	  render_device(-1), render_start_time(0.0) {}
 };
 
 /* Tile order */
@@ -73,6 +79,9 @@ public:
 		int num_samples;
 		int resolution_divider;
 		int num_tiles;
+		/* Tiles cut off from other tiles while rendering, not included in
+		 * num_tiles. */
+		int num_split_tiles;
 
 		/* Total samples over all pixels: Generally num_samples*num_pixels,
 		 * but can be higher due to the initial resolution division for previews. */
@@ -118,6 +127,26 @@ protected:
 
 	void set_tiles();
 
+	/* ** Dynamic tile splitting. ** */
+
+	/* Measured rendering speed of a device, per tile being rendered at once. */
+	struct DeviceStats {
+		DeviceStats()
+		: pixel_samples_per_second(0.0), num_active_tiles(0) {}
+
+		double pixel_samples_per_second;
+		int num_active_tiles;
+	};
+	vector<DeviceStats> device_stats;
+
+	/* Number of pixels in tiles which are still waiting to be rendered. */
+	int64_t remaining_pixels;
+
+	bool use_tile_splitting();
+	void split_tile(int index, int device);
+	void tile_render_begin(int index, int device);
+	void tile_render_end(int index);
+
 	bool progressive;
 	int2 tile_size;
 	TileOrder tile_order;
@@ -22,6 +22,7 @@
  * DiagSplit. For more algorithm details, see the DiagSplit paper or the
  * ARB_tessellation_shader OpenGL extension, Section 2.X.2. */
 
+#include "util/util_map.h"
 #include "util/util_types.h"
 #include "util/util_vector.h"
 
@@ -41,6 +42,8 @@ struct SubdParams {
 	int max_level;
 	Camera *camera;
 	Transform objecttoworld;
+	/* Keep diced geometry for the next tessellation of the mesh. */
+	bool use_cache;
 
 	SubdParams(Mesh *mesh_, bool ptex_ = false)
 	{
@@ -52,6 +55,7 @@ struct SubdParams {
 		dicing_rate = 1.0f;
 		max_level = 12;
 		camera = NULL;
+		use_cache = false;
 	}
 
 };
@@ -63,12 +67,19 @@ public:
 	SubdParams params;
 	float3 *mesh_P;
 	float3 *mesh_N;
+	float3 *mesh_ptex_uv;
+	float *mesh_ptex_face_id;
 	size_t vert_offset;
 	size_t tri_offset;
+	/* Positions and normals of the vertices were filled in already, only
+	 * create the topology. */
+	bool use_cached_verts;
 
 	explicit EdgeDice(const SubdParams& params);
 
-	void reserve(int num_verts);
+	/* Resize the mesh to fit diced geometry, vertices and triangles are
+	 * then written at vert_offset and tri_offset. */
+	void reserve(int num_verts, int num_triangles);
 
 	int add_vert(Patch *patch, float2 uv);
 	void add_triangle(Patch *patch, int v0, int v1, int v2);
@@ -109,7 +120,11 @@ public:
 
 	explicit QuadDice(const SubdParams& params);
 
-	void reserve(EdgeFactors& ef, int Mu, int Mv);
+	/* Size of the inner grid and amount of geometry created by dice(). */
+	void grid_size(SubPatch& sub, EdgeFactors& ef, int *Mu, int *Mv);
+	int num_verts(SubPatch& sub, EdgeFactors& ef);
+	int num_triangles(SubPatch& sub, EdgeFactors& ef);
+
 	float3 eval_projected(SubPatch& sub, float u, float v);
 
 	float2 map_uv(SubPatch& sub, float u, float v);
@@ -132,6 +147,44 @@ public:
 	void dice(SubPatch& sub, EdgeFactors& ef);
 };
 
+/* Dicing Cache
+ *
+ * Positions and normals of the subpatches diced by the previous tessellation
+ * of a mesh. Small camera changes leave the edge factors of most subpatches
+ * unchanged, their vertices are copied instead of evaluated again. Only valid
+ * for the control mesh it was created from. */
+
+class SubdDiceCache {
+public:
+	struct Key {
+		Key(const QuadDice::SubPatch& sub, const QuadDice::EdgeFactors& ef);
+
+		bool operator<(const Key& other) const
+		{
+			return memcmp(this, &other, sizeof(Key)) < 0;
+		}
+
+		int patch_index;
+		float2 P00, P10, P01, P11;
+		QuadDice::EdgeFactors ef;
+	};
+
+	/* Hash of the control mesh the cache was created from. */
+	uint control_hash;
+
+	/* Offset of the vertices of every subpatch. */
+	map<Key, size_t> offsets;
+
+	array<float3> P;
+	array<float3> N;
+
+	SubdDiceCache() : control_hash(0) {}
+
+	bool find(const QuadDice::SubPatch& sub,
+	          const QuadDice::EdgeFactors& ef,
+	          size_t *offset) const;
+};
+
 CCL_NAMESPACE_END
 
 #endif /* __SUBD_DICE_H__ */
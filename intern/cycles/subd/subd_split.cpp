@@ -21,11 +21,17 @@
 #include "subd/subd_patch.h"
 #include "subd/subd_split.h"
 
+#include "util/util_algorithm.h"
+#include "util/util_logging.h"
 #include "util/util_math.h"
+#include "util/util_task.h"
 #include "util/util_types.h"
 
 CCL_NAMESPACE_BEGIN
 
+/* Number of subpatches diced by a single task. */
+#define DSPLIT_DICE_BATCH_SIZE 256
+
 /* DiagSplit */
 
 DiagSplit::DiagSplit(const SubdParams& params_)
@@ -238,10 +244,71 @@ void DiagSplit::split_quad(Patch *patch, QuadDice::SubPatch *subpatch)
 	limit_edge_factors(sub_split, ef_split, 1 << params.max_level);
 
 	split(sub_split, ef_split);
+}
+
+void DiagSplit::append(const DiagSplit& other)
+{
+	subpatches_quad.insert(subpatches_quad.end(),
+	                       other.subpatches_quad.begin(),
+	                       other.subpatches_quad.end());
+	edgefactors_quad.insert(edgefactors_quad.end(),
+	                        other.edgefactors_quad.begin(),
+	                        other.edgefactors_quad.end());
+}
+
+void DiagSplit::dice_range(const QuadDice *dice_template,
+                           const SubdDiceCache *cache,
+                           const vector<size_t> *vert_offsets,
+                           const vector<size_t> *tri_offsets,
+                           size_t start,
+                           size_t end)
+{
+	QuadDice dice(*dice_template);
+
+	for(size_t i = start; i < end; i++) {
+		QuadDice::SubPatch& sub = subpatches_quad[i];
+		QuadDice::EdgeFactors& ef = edgefactors_quad[i];
+
+		dice.vert_offset = (*vert_offsets)[i];
+		dice.tri_offset = (*tri_offsets)[i];
+		dice.use_cached_verts = false;
+
+		size_t cache_offset;
+		if(cache && cache->find(sub, ef, &cache_offset)) {
+			const size_t num_verts = (*vert_offsets)[i + 1] - (*vert_offsets)[i];
+
+			memcpy(dice.mesh_P + dice.vert_offset, &cache->P[cache_offset], sizeof(float3)*num_verts);
+			memcpy(dice.mesh_N + dice.vert_offset, &cache->N[cache_offset], sizeof(float3)*num_verts);
+			dice.use_cached_verts = true;
+		}
+
+		dice.dice(sub, ef);
+
+		assert(dice.vert_offset == (*vert_offsets)[i + 1]);
+		assert(dice.tri_offset == (*tri_offsets)[i + 1]);
+	}
+}
+
+void DiagSplit::dice(uint control_hash)
+{
+	Mesh *mesh = params.mesh;
+	const size_t num_subpatches = subpatches_quad.size();
+
+	if(num_subpatches == 0) {
+		return;
+	}
 
 	QuadDice dice(params);
 
-	for(size_t i = 0; i < subpatches_quad.size(); i++) {
+	/* Dicing a subpatch creates a known amount of vertices and triangles,
+	 * find where every subpatch goes in the mesh. */
+	vector<size_t> vert_offsets(num_subpatches + 1);
+	vector<size_t> tri_offsets(num_subpatches + 1);
+
+	vert_offsets[0] = mesh->verts.size();
+	tri_offsets[0] = mesh->num_triangles();
+
+	for(size_t i = 0; i < num_subpatches; i++) {
 		QuadDice::SubPatch& sub = subpatches_quad[i];
 		QuadDice::EdgeFactors& ef = edgefactors_quad[i];
 
@@ -250,9 +317,60 @@ void DiagSplit::split_quad(Patch *patch, QuadDice::SubPatch *subpatch)
 		ef.tv0 = max(ef.tv0, 1);
 		ef.tv1 = max(ef.tv1, 1);
 
-		dice.dice(sub, ef);
+		vert_offsets[i + 1] = vert_offsets[i] + dice.num_verts(sub, ef);
+		tri_offsets[i + 1] = tri_offsets[i] + dice.num_triangles(sub, ef);
 	}
 
+	const size_t num_verts = vert_offsets[num_subpatches] - vert_offsets[0];
+	const size_t num_triangles = tri_offsets[num_subpatches] - tri_offsets[0];
+
+	dice.reserve(num_verts, num_triangles);
+
+	const SubdDiceCache *cache = mesh->subd_dice_cache;
+	if(cache && cache->control_hash != control_hash) {
+		cache = NULL;
+	}
+
+	TaskPool pool;
+	for(size_t start = 0; start < num_subpatches; start += DSPLIT_DICE_BATCH_SIZE) {
+		pool.push(function_bind(&DiagSplit::dice_range,
+		                        this,
+		                        &dice,
+		                        cache,
+		                        &vert_offsets,
+		                        &tri_offsets,
+		                        start,
+		                        min(start + DSPLIT_DICE_BATCH_SIZE, num_subpatches)));
+	}
+	pool.wait_work();
+
+	mesh->num_subd_verts += num_verts;
+
+	VLOG(2) << "Diced " << num_subpatches << " subpatches into "
+	        << num_verts << " vertices and " << num_triangles << " triangles"
+	        << ((cache) ? ", using dicing cache." : ".");
+
+	/* Store diced vertices for the next tessellation. */
+	SubdDiceCache *new_cache = NULL;
+
+	if(params.use_cache && num_verts) {
+		new_cache = new SubdDiceCache();
+		new_cache->control_hash = control_hash;
+		new_cache->P.resize(num_verts);
+		new_cache->N.resize(num_verts);
+
+		memcpy(new_cache->P.data(), dice.mesh_P + vert_offsets[0], sizeof(float3)*num_verts);
+		memcpy(new_cache->N.data(), dice.mesh_N + vert_offsets[0], sizeof(float3)*num_verts);
+
+		for(size_t i = 0; i < num_subpatches; i++) {
+			SubdDiceCache::Key key(subpatches_quad[i], edgefactors_quad[i]);
+			new_cache->offsets[key] = vert_offsets[i] - vert_offsets[0];
+		}
+	}
+
+	delete mesh->subd_dice_cache;
+	mesh->subd_dice_cache = new_cache;
+
 	subpatches_quad.clear();
 	edgefactors_quad.clear();
 }
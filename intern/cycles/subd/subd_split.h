@@ -52,6 +52,24 @@ public:
 	void split(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef, int depth=0);
 
 	void split_quad(Patch *patch, QuadDice::SubPatch *subpatch=NULL);
+
+	/* Append subpatches of another split, used to merge splits done in
+	 * parallel. */
+	void append(const DiagSplit& other);
+
+	/* Dice all subpatches into the mesh, in parallel. The result is the
+	 * same as dicing them one after another. Vertices are copied from the
+	 * dicing cache of the mesh when it was created from the same control
+	 * mesh. */
+	void dice(uint control_hash);
+
+protected:
+	void dice_range(const QuadDice *dice,
+	                const SubdDiceCache *cache,
+	                const vector<size_t> *vert_offsets,
+	                const vector<size_t> *tri_offsets,
+	                size_t start,
+	                size_t end);
 };
 
 CCL_NAMESPACE_END
@@ -0,0 +1,296 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "kernel/kernel_compat_cpu.h"
+#include "kernel/kernel_math.h"
+#include "kernel/kernel_types.h"
+#include "kernel/split/kernel_split_data.h"
+#include "kernel/kernel_globals.h"
+#include "kernel/geom/geom_object.h"
+#include "kernel/bvh/bvh_types.h"
+
+#include "bvh/bvh2.h"
+#include "bvh/bvh4.h"
+#include "bvh/bvh_params.h"
+#include "bvh/bvh_unaligned.h"
+
+#include "render/mesh.h"
+#include "render/object.h"
+
+#include "util/util_boundbox.h"
+#include "util/util_transform.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Node intersection headers are included by the kernel inside of the
+ * namespace.
+ */
+#ifdef __QBVH__
+#  include "kernel/bvh/qbvh_nodes.h"
+#endif
+#include "kernel/bvh/bvh_nodes.h"
+
+namespace {
+
+/* Simple deterministic random numbers in [0, 1). */
+float random_float(uint *state)
+{
+	*state = *state * 1103515245u + 12345u;
+	return (float)(*state >> 8) * (1.0f / 16777216.0f);
+}
+
+float3 random_direction(uint *state)
+{
+	while(true) {
+		const float3 v = make_float3(random_float(state) * 2.0f - 1.0f,
+		                             random_float(state) * 2.0f - 1.0f,
+		                             random_float(state) * 2.0f - 1.0f);
+		const float l = len(v);
+		if(l > 0.1f && l <= 1.0f) {
+			return v / l;
+		}
+	}
+}
+
+/* Random oriented box, in the frame hair nodes are built in. */
+void random_oriented_box(uint *state, Transform *aligned_space, BoundBox *bounds)
+{
+	*aligned_space = make_transform_frame_packed(
+	        transform_frame_pack(random_direction(state)));
+	const float3 center = make_float3(random_float(state) * 20.0f - 10.0f,
+	                                  random_float(state) * 20.0f - 10.0f,
+	                                  random_float(state) * 20.0f - 10.0f);
+	const float3 size = make_float3(0.01f + random_float(state),
+	                                0.01f + random_float(state),
+	                                0.01f + random_float(state) * 10.0f);
+	*bounds = BoundBox(center - size * 0.5f, center + size * 0.5f);
+}
+
+/* Random point inside of the box, in world space. */
+float3 random_point(uint *state, const Transform& aligned_space, const BoundBox& bounds)
+{
+	const float3 t = make_float3(random_float(state),
+	                             random_float(state),
+	                             random_float(state));
+	const float3 P = bounds.min + (bounds.max - bounds.min) * t;
+	const Transform tfm = transform_inverse(aligned_space);
+	return transform_point(&tfm, P);
+}
+
+void expect_point_inside(const float3 P)
+{
+	EXPECT_GE(P.x, 0.0f);
+	EXPECT_GE(P.y, 0.0f);
+	EXPECT_GE(P.z, 0.0f);
+	EXPECT_LE(P.x, 1.0f);
+	EXPECT_LE(P.y, 1.0f);
+	EXPECT_LE(P.z, 1.0f);
+}
+
+void set_bvh_nodes(KernelGlobals *kg, float4 *nodes, int num_nodes)
+{
+	kg->__bvh_nodes.data = nodes;
+	kg->__bvh_nodes.width = num_nodes;
+}
+
+}  // namespace
+
+TEST(bvh_unaligned, frame_packing)
+{
+	/* Nodes without curves are packed with an identity orientation. */
+	const Transform identity = make_transform_frame_packed(
+	        transform_frame_pack(make_float3(0.0f, 0.0f, 1.0f)));
+	const Transform expected = transform_identity();
+	for(int i = 0; i < 12; i++) {
+		EXPECT_EQ(((const float*)&identity)[i], ((const float*)&expected)[i]);
+	}
+
+	uint state = 1;
+	for(int i = 0; i < 1024; i++) {
+		const float3 N = random_direction(&state);
+		const uint packed = transform_frame_pack(N);
+		const Transform frame = make_transform_frame_packed(packed);
+		const float3 dx = float4_to_float3(frame.x);
+		const float3 dy = float4_to_float3(frame.y);
+		const float3 dz = float4_to_float3(frame.z);
+		EXPECT_LT(len(dz - N), 1e-4f);
+		EXPECT_NEAR(len(dx), 1.0f, 1e-6f);
+		EXPECT_NEAR(len(dy), 1.0f, 1e-6f);
+		EXPECT_NEAR(dot(dx, dy), 0.0f, 1e-6f);
+		EXPECT_NEAR(dot(dx, dz), 0.0f, 1e-6f);
+		EXPECT_NEAR(dot(dy, dz), 0.0f, 1e-6f);
+		/* Packing the decoded frame again gives the same orientation, so
+		 * nodes built in the decoded frame stay tight.
+		 */
+		EXPECT_EQ(transform_frame_pack(dz), packed);
+	}
+}
+
+TEST(bvh_unaligned, node_bounds)
+{
+	float4 nodes[BVH_UNALIGNED_NODE_SIZE];
+	KernelGlobals kg;
+	set_bvh_nodes(&kg, nodes, BVH_UNALIGNED_NODE_SIZE);
+
+	uint state = 1;
+	for(int i = 0; i < 256; i++) {
+		Transform aligned_space;
+		BoundBox bounds;
+		random_oriented_box(&state, &aligned_space, &bounds);
+
+		uint frame;
+		float3 scale, offset;
+		BVHUnaligned::compute_node_space(bounds, aligned_space,
+		                                 &frame, &scale, &offset);
+		nodes[0] = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+		nodes[1] = make_float4(scale.x, scale.y, scale.z, __uint_as_float(frame));
+		nodes[2] = make_float4(offset.x, offset.y, offset.z, 0.0f);
+		nodes[3] = nodes[1];
+		nodes[4] = nodes[2];
+
+		const Transform space = bvh_unaligned_node_fetch_space(&kg, 0, 0);
+
+		/* All points of the box are inside of the packed bounds. */
+		const Transform tfm = transform_inverse(aligned_space);
+		for(int j = 0; j < 8; j++) {
+			const float3 corner = make_float3((j & 1)? bounds.max.x: bounds.min.x,
+			                                  (j & 2)? bounds.max.y: bounds.min.y,
+			                                  (j & 4)? bounds.max.z: bounds.min.z);
+			expect_point_inside(transform_point(&space, transform_point(&tfm, corner)));
+		}
+		for(int j = 0; j < 64; j++) {
+			const float3 P = random_point(&state, aligned_space, bounds);
+			expect_point_inside(transform_point(&space, P));
+		}
+
+		/* Packed bounds are only padded by a small margin. */
+		const float3 center = transform_point(&space, transform_point(&tfm, bounds.center()));
+		EXPECT_NEAR(center.x, 0.5f, 1e-2f);
+		EXPECT_NEAR(center.y, 0.5f, 1e-2f);
+		EXPECT_NEAR(center.z, 0.5f, 1e-2f);
+		const float3 dim = bounds.size();
+		EXPECT_NEAR(scale.x * dim.x, 1.0f, 1e-2f);
+		EXPECT_NEAR(scale.y * dim.y, 1.0f, 1e-2f);
+		EXPECT_NEAR(scale.z * dim.z, 1.0f, 1e-2f);
+	}
+}
+
+TEST(bvh_unaligned, compact_curve_primitive)
+{
+	const int type = PRIMITIVE_PACK_SEGMENTS(PRIMITIVE_CURVE, 1000, PRIMITIVE_MAX_SEGMENTS);
+	EXPECT_EQ(type & PRIMITIVE_ALL, PRIMITIVE_CURVE);
+	EXPECT_EQ(PRIMITIVE_UNPACK_SEGMENT(type), 1000);
+	EXPECT_EQ(PRIMITIVE_UNPACK_NUM_SEGMENTS(type), PRIMITIVE_MAX_SEGMENTS);
+	EXPECT_EQ(PRIMITIVE_SEGMENT(type, 3), PRIMITIVE_PACK_SEGMENT(PRIMITIVE_CURVE, 1003));
+	EXPECT_EQ(PRIMITIVE_UNPACK_NUM_SEGMENTS(PRIMITIVE_PACK_SEGMENT(PRIMITIVE_CURVE, 1000)), 1);
+
+	/* Bent strand of five keys. */
+	Mesh mesh;
+	mesh.reserve_curves(1, 5);
+	mesh.add_curve_key(make_float3(0.0f, 0.0f, 0.0f), 0.1f);
+	mesh.add_curve_key(make_float3(0.0f, 0.0f, 1.0f), 0.1f);
+	mesh.add_curve_key(make_float3(0.5f, 0.0f, 2.0f), 0.1f);
+	mesh.add_curve_key(make_float3(1.0f, 0.5f, 2.5f), 0.1f);
+	mesh.add_curve_key(make_float3(2.0f, 1.0f, 2.5f), 0.1f);
+	mesh.add_curve(0, 0);
+	Object object;
+	object.mesh = &mesh;
+	vector<Object*> objects(1, &object);
+	BVHUnaligned unaligned(objects);
+
+	/* Bounds of a compact primitive cover all of its segments. */
+	const BVHReference compact(BoundBox::empty, 0, 0,
+	                           PRIMITIVE_PACK_SEGMENTS(PRIMITIVE_CURVE, 0, 4));
+	Transform aligned_space;
+	EXPECT_TRUE(unaligned.compute_aligned_space(compact, &aligned_space));
+	const BoundBox bounds = unaligned.compute_aligned_prim_boundbox(compact, aligned_space);
+	BoundBox expected_bounds = BoundBox::empty;
+	for(int s = 0; s < 4; s++) {
+		const BVHReference segment(BoundBox::empty, 0, 0,
+		                           PRIMITIVE_SEGMENT(compact.prim_type(), s));
+		expected_bounds.grow(unaligned.compute_aligned_prim_boundbox(segment, aligned_space));
+	}
+	EXPECT_EQ(bounds.min.x, expected_bounds.min.x);
+	EXPECT_EQ(bounds.min.y, expected_bounds.min.y);
+	EXPECT_EQ(bounds.min.z, expected_bounds.min.z);
+	EXPECT_EQ(bounds.max.x, expected_bounds.max.x);
+	EXPECT_EQ(bounds.max.y, expected_bounds.max.y);
+	EXPECT_EQ(bounds.max.z, expected_bounds.max.z);
+
+	/* Nodes are oriented along the whole primitive. */
+	const float3 axis = normalize(mesh.curve_keys[4] - mesh.curve_keys[0]);
+	EXPECT_LT(len(float4_to_float3(aligned_space.z) - axis), 1e-4f);
+}
+
+#ifdef __QBVH__
+TEST(bvh_unaligned, qnode_bounds)
+{
+	float4 nodes[BVH_UNALIGNED_QNODE_SIZE];
+	KernelGlobals kg;
+	set_bvh_nodes(&kg, nodes, BVH_UNALIGNED_QNODE_SIZE);
+
+	uint state = 1;
+	for(int i = 0; i < 64; i++) {
+		Transform aligned_space[3];
+		BoundBox bounds[3];
+		memset(nodes, 0, sizeof(nodes));
+		/* Three children, the fourth one is an empty slot. */
+		for(int k = 0; k < 4; k++) {
+			uint frame;
+			float3 scale, offset;
+			if(k < 3) {
+				random_oriented_box(&state, &aligned_space[k], &bounds[k]);
+				BVHUnaligned::compute_node_space(bounds[k], aligned_space[k],
+				                                 &frame, &scale, &offset);
+			}
+			else {
+				BVHUnaligned::compute_node_space(BoundBox::empty, transform_identity(),
+				                                 &frame, &scale, &offset);
+			}
+			nodes[1][k] = __uint_as_float(frame);
+			nodes[2][k] = scale.x;
+			nodes[3][k] = scale.y;
+			nodes[4][k] = scale.z;
+			nodes[5][k] = offset.x;
+			nodes[6][k] = offset.y;
+			nodes[7][k] = offset.z;
+		}
+
+		sse3f tfm_x, tfm_y, tfm_z, tfm_t;
+		qbvh_unaligned_node_fetch_space(&kg, 0, &tfm_x, &tfm_y, &tfm_z, &tfm_t);
+
+		for(int k = 0; k < 3; k++) {
+			for(int j = 0; j < 64; j++) {
+				const float3 P = random_point(&state, aligned_space[k], bounds[k]);
+				const float3 aligned_P = make_float3(
+				        P.x*tfm_x.x.f[k] + P.y*tfm_x.y.f[k] + P.z*tfm_x.z.f[k] + tfm_t.x.f[k],
+				        P.x*tfm_y.x.f[k] + P.y*tfm_y.y.f[k] + P.z*tfm_y.z.f[k] + tfm_t.y.f[k],
+				        P.x*tfm_z.x.f[k] + P.y*tfm_z.y.f[k] + P.z*tfm_z.z.f[k] + tfm_t.z.f[k]);
+				expect_point_inside(aligned_P);
+			}
+		}
+
+		/* Empty slots never intersect. */
+		EXPECT_TRUE(isnan(tfm_x.x.f[3]));
+		EXPECT_TRUE(isnan(tfm_t.x.f[3]));
+	}
+}
+#endif  /* __QBVH__ */
+
+CCL_NAMESPACE_END
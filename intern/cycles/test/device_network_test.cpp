@@ -0,0 +1,207 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#ifdef WITH_NETWORK
+
+#include "device/device.h"
+#include "device/device_intern.h"
+#include "device/device_network.h"
+
+#include "util/util_map.h"
+#include "util/util_stats.h"
+#include "util/util_thread.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Device which keeps memory in host buffers, so the test can look at what the
+ * server received. */
+class LoopbackDevice : public Device {
+public:
+	LoopbackDevice(DeviceInfo& info, Stats& stats, Profiler& profiler)
+	: Device(info, stats, profiler, true), mem_counter(0)
+	{
+	}
+
+	map<device_ptr, vector<uint8_t> > memory;
+
+	bool load_kernels(const DeviceRequestedFeatures& /*requested_features*/)
+	{
+		return true;
+	}
+
+	void const_copy_to(const char * /*name*/, void * /*host*/, size_t /*size*/) {}
+	int get_split_task_count(DeviceTask& /*task*/) { return 1; }
+	void task_add(DeviceTask& /*task*/) {}
+	void task_wait() {}
+	void task_cancel() {}
+
+protected:
+	void mem_alloc(device_memory& mem)
+	{
+		mem.device_pointer = ++mem_counter;
+		memory[mem.device_pointer].resize(mem.memory_size());
+	}
+
+	void mem_copy_to(device_memory& mem)
+	{
+		if(!mem.device_pointer) {
+			mem_alloc(mem);
+		}
+
+		vector<uint8_t>& data = memory[mem.device_pointer];
+		if(data.size()) {
+			memcpy(&data[0], mem.host_pointer, data.size());
+		}
+	}
+
+	void mem_copy_from(device_memory& mem, int /*y*/, int /*w*/, int /*h*/, int /*elem*/)
+	{
+		vector<uint8_t>& data = memory[mem.device_pointer];
+		if(data.size()) {
+			memcpy(mem.host_pointer, &data[0], data.size());
+		}
+	}
+
+	void mem_zero(device_memory& mem)
+	{
+		if(!mem.device_pointer) {
+			mem_alloc(mem);
+		}
+
+		vector<uint8_t>& data = memory[mem.device_pointer];
+		std::fill(data.begin(), data.end(), 0);
+	}
+
+	void mem_free(device_memory& mem)
+	{
+		memory.erase(mem.device_pointer);
+		mem.device_pointer = 0;
+	}
+
+private:
+	device_ptr mem_counter;
+};
+
+struct ServerData {
+	Device *device;
+	boost::asio::io_service *io_service;
+	tcp::acceptor *acceptor;
+};
+
+void server_thread_run(ServerData *data)
+{
+	device_network_server_accept(data->device, *data->io_service, *data->acceptor);
+}
+
+const size_t num_elements = 3 * NETWORK_MEM_BLOCK_SIZE / sizeof(uint);
+
+void fill_buffer(device_vector<uint>& buffer, uint seed)
+{
+	uint *data = buffer.alloc(num_elements);
+	for(size_t i = 0; i < num_elements; i++) {
+		data[i] = seed + (uint)i;
+	}
+}
+
+void expect_device_equal(LoopbackDevice *device, device_ptr ptr, device_vector<uint>& buffer)
+{
+	ASSERT_EQ(device->memory.count(ptr), 1);
+
+	const vector<uint8_t>& data = device->memory[ptr];
+	ASSERT_EQ(data.size(), buffer.memory_size());
+	EXPECT_EQ(memcmp(&data[0], buffer.data(), data.size()), 0);
+}
+
+}  // namespace
+
+TEST(device_network, loopback_mem_copy)
+{
+	DeviceInfo info;
+	Stats stats;
+	Profiler profiler;
+	LoopbackDevice server_device(info, stats, profiler);
+
+	/* Listen before connecting, so the client can't miss the server. */
+	boost::asio::io_service io_service;
+	tcp::acceptor acceptor(io_service, tcp::endpoint(boost::asio::ip::address_v4::loopback(), SERVER_PORT));
+
+	ServerData server_data = {&server_device, &io_service, &acceptor};
+	thread server_thread(function_bind(server_thread_run, &server_data));
+
+	Device *client = device_network_create(info, stats, profiler, "127.0.0.1");
+
+	{
+		/* Memory copied without allocating first. Both buffers start out with a
+		 * zero device pointer, but must not share their block hashes. */
+		device_vector<uint> a(client, "a", MEM_READ_ONLY);
+		device_vector<uint> b(client, "b", MEM_READ_ONLY);
+
+		fill_buffer(a, 0);
+		fill_buffer(b, 0);
+		b[NETWORK_MEM_BLOCK_SIZE / sizeof(uint)] = 12345;
+
+		a.copy_to_device();
+		b.copy_to_device();
+
+		/* Round trip, so all previous calls have been handled by the server. */
+		EXPECT_TRUE(client->load_kernels(DeviceRequestedFeatures()));
+
+		expect_device_equal(&server_device, 1, a);
+		expect_device_equal(&server_device, 2, b);
+
+		/* Only the changed block is sent now. */
+		a[2 * NETWORK_MEM_BLOCK_SIZE / sizeof(uint) + 7] = 54321;
+		a.copy_to_device();
+
+		EXPECT_TRUE(client->load_kernels(DeviceRequestedFeatures()));
+
+		expect_device_equal(&server_device, 1, a);
+		expect_device_equal(&server_device, 2, b);
+
+		/* Memory written by the device comes back. */
+		device_vector<uint> c(client, "c", MEM_READ_WRITE);
+		fill_buffer(c, 7);
+		c.copy_to_device();
+
+		EXPECT_TRUE(client->load_kernels(DeviceRequestedFeatures()));
+
+		/* Pretend the device wrote to it. */
+		vector<uint8_t>& c_device = server_device.memory[3];
+		ASSERT_EQ(c_device.size(), c.memory_size());
+		((uint*)&c_device[0])[num_elements - 1] = 0;
+
+		c.copy_from_device(0, num_elements, 1);
+		EXPECT_EQ(c[0], 7);
+		EXPECT_EQ(c[num_elements - 1], 0);
+	}
+
+	/* Freed memory is released on the server. */
+	EXPECT_TRUE(client->load_kernels(DeviceRequestedFeatures()));
+	EXPECT_EQ(server_device.memory.size(), 0);
+
+	/* Sends the stop command to the server. */
+	delete client;
+	server_thread.join();
+}
+
+CCL_NAMESPACE_END
+
+#endif  /* WITH_NETWORK */
@@ -0,0 +1,293 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "kernel/kernel_compat_cpu.h"
+#include "kernel/kernel_math.h"
+#include "kernel/kernel_types.h"
+#include "kernel/split/kernel_split_data.h"
+#include "kernel/kernel_globals.h"
+#include "kernel/kernels/cpu/kernel_cpu_image.h"
+
+#include "util/util_texture_compression.h"
+#include "util/util_texture_sparse.h"
+#include "util/util_time.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+const int image_size = 64;
+
+/* Smooth gradients, which block compression handles well. */
+void make_byte_image(vector<uchar4>& texels)
+{
+	texels.resize(image_size*image_size);
+	for(int y = 0; y < image_size; y++) {
+		for(int x = 0; x < image_size; x++) {
+			texels[y*image_size + x] = make_uchar4((uchar)(x*4), (uchar)(y*4), 128, (uchar)(255 - x*2));
+		}
+	}
+}
+
+TextureInfo make_texture_info(const void *data, ImageCompression compression)
+{
+	TextureInfo info;
+	memset(&info, 0, sizeof(info));
+	info.data = (uint64_t)data;
+	info.interpolation = INTERPOLATION_LINEAR;
+	info.extension = EXTENSION_REPEAT;
+	info.width = image_size;
+	info.height = image_size;
+	info.depth = 1;
+	info.compression = compression;
+	return info;
+}
+
+/* Volume with dimensions which are not a multiple of the tile size, empty
+ * apart from a ball of smoke and a single voxel in the far corner. */
+const int volume_width = 27;
+const int volume_height = 20;
+const int volume_depth = 13;
+
+void make_volume(vector<float>& voxels)
+{
+	voxels.resize(volume_width*volume_height*volume_depth);
+	for(int z = 0; z < volume_depth; z++) {
+		for(int y = 0; y < volume_height; y++) {
+			for(int x = 0; x < volume_width; x++) {
+				const float d = len(make_float3(x - 6.0f, y - 5.0f, z - 4.0f));
+				voxels[(z*volume_height + y)*volume_width + x] = max(3.0f - d, 0.0f);
+			}
+		}
+	}
+	voxels[(volume_depth*volume_height - 2)*volume_width - 3] = 1.0f;
+}
+
+TextureInfo make_volume_info(const void *data, const void *grid)
+{
+	TextureInfo info;
+	memset(&info, 0, sizeof(info));
+	info.data = (uint64_t)data;
+	info.grid = (uint64_t)grid;
+	info.interpolation = INTERPOLATION_LINEAR;
+	info.extension = EXTENSION_CLIP;
+	info.width = volume_width;
+	info.height = volume_height;
+	info.depth = volume_depth;
+	return info;
+}
+
+/* Simple deterministic random numbers in [0, 1). */
+float random_float(uint *state)
+{
+	*state = *state * 1103515245u + 12345u;
+	return (float)(*state >> 8) * (1.0f / 16777216.0f);
+}
+
+void expect_float4_near(const float4& a, const float4& b, float tolerance)
+{
+	EXPECT_NEAR(a.x, b.x, tolerance);
+	EXPECT_NEAR(a.y, b.y, tolerance);
+	EXPECT_NEAR(a.z, b.z, tolerance);
+	EXPECT_NEAR(a.w, b.w, tolerance);
+}
+
+}  // namespace
+
+TEST(kernel_cpu_image, compressed_memory)
+{
+	/* Four bytes per texel uncompressed, one byte per texel in blocks. */
+	EXPECT_EQ(texture_bc3_size(image_size, image_size)*4,
+	          image_size*image_size*sizeof(uchar4));
+	/* Partial blocks at the border take a full block. */
+	EXPECT_EQ(texture_bc3_size(5, 1), 2*TEX_BC3_BLOCK_BYTES);
+}
+
+TEST(kernel_cpu_image, compressed_sampling)
+{
+	vector<uchar4> texels;
+	make_byte_image(texels);
+	vector<uchar> blocks(texture_bc3_size(image_size, image_size));
+	texture_bc3_encode_image(&texels[0], image_size, image_size, &blocks[0]);
+
+	TextureInfo info = make_texture_info(&texels[0], IMAGE_COMPRESSION_NONE);
+	TextureInfo compressed_info = make_texture_info(&blocks[0], IMAGE_COMPRESSION_BC3);
+
+	const InterpolationType interpolations[] = {INTERPOLATION_CLOSEST,
+	                                            INTERPOLATION_LINEAR,
+	                                            INTERPOLATION_CUBIC};
+	uint state = 1;
+	for(int i = 0; i < 3; i++) {
+		info.interpolation = compressed_info.interpolation = interpolations[i];
+		for(int j = 0; j < 256; j++) {
+			const float x = random_float(&state);
+			const float y = random_float(&state);
+			/* Lookups of 2D textures through the 3D interpolation, as for
+			 * volume attributes, decode the same blocks. */
+			expect_float4_near(TextureInterpolator<uchar4>::interp(info, x, y),
+			                   TextureInterpolator<uchar4>::interp(compressed_info, x, y),
+			                   0.05f);
+			expect_float4_near(TextureInterpolator<uchar4>::interp_3d(info, x, y, 0.5f, INTERPOLATION_NONE),
+			                   TextureInterpolator<uchar4>::interp_3d(compressed_info, x, y, 0.5f, INTERPOLATION_NONE),
+			                   0.05f);
+		}
+	}
+}
+
+TEST(kernel_cpu_image, sparse_memory)
+{
+	vector<float> voxels;
+	make_volume(voxels);
+
+	vector<int> grid;
+	const size_t num_used_tiles = texture_sparse_tiles(&voxels[0], volume_width, volume_height, volume_depth, grid);
+	/* 4x3x2 tiles, the ball is in the first two and the voxel in the last. */
+	EXPECT_EQ(grid.size(), 24);
+	EXPECT_EQ(num_used_tiles, 3);
+	EXPECT_EQ(grid[0], 1);
+	EXPECT_EQ(grid[1], 2);
+	EXPECT_EQ(grid[2], 0);
+	EXPECT_EQ(grid[23], 3);
+	EXPECT_LT(texture_sparse_size<float>(grid.size(), num_used_tiles), voxels.size());
+}
+
+TEST(kernel_cpu_image, sparse_sampling)
+{
+	vector<float> voxels;
+	make_volume(voxels);
+
+	vector<int> grid;
+	const size_t num_used_tiles = texture_sparse_tiles(&voxels[0], volume_width, volume_height, volume_depth, grid);
+	vector<float> sparse(texture_sparse_size<float>(grid.size(), num_used_tiles));
+	texture_sparse_encode(&voxels[0], volume_width, volume_height, volume_depth, grid, &sparse[0]);
+
+	TextureInfo info = make_volume_info(&voxels[0], NULL);
+	TextureInfo sparse_info = make_volume_info(&sparse[texture_sparse_grid_size<float>(grid.size())], &sparse[0]);
+
+	const InterpolationType interpolations[] = {INTERPOLATION_CLOSEST,
+	                                            INTERPOLATION_LINEAR,
+	                                            INTERPOLATION_CUBIC};
+	const ExtensionType extensions[] = {EXTENSION_REPEAT,
+	                                    EXTENSION_EXTEND,
+	                                    EXTENSION_CLIP};
+	uint state = 1;
+	for(int i = 0; i < 3; i++) {
+		for(int j = 0; j < 3; j++) {
+			info.extension = sparse_info.extension = extensions[j];
+			for(int k = 0; k < 1024; k++) {
+				/* Include lookups just outside of the volume. */
+				const float x = random_float(&state)*1.2f - 0.1f;
+				const float y = random_float(&state)*1.2f - 0.1f;
+				const float z = random_float(&state)*1.2f - 0.1f;
+				expect_float4_near(TextureInterpolator<float>::interp_3d(info, x, y, z, interpolations[i]),
+				                   TextureInterpolator<float>::interp_3d(sparse_info, x, y, z, interpolations[i]),
+				                   1e-6f);
+			}
+		}
+	}
+}
+
+TEST(kernel_cpu_image, sparse_empty_distance)
+{
+	vector<float> voxels;
+	make_volume(voxels);
+
+	vector<int> grid;
+	const size_t num_used_tiles = texture_sparse_tiles(&voxels[0], volume_width, volume_height, volume_depth, grid);
+	vector<float> sparse(texture_sparse_size<float>(grid.size(), num_used_tiles));
+	texture_sparse_encode(&voxels[0], volume_width, volume_height, volume_depth, grid, &sparse[0]);
+
+	TextureInfo info = make_volume_info(&voxels[0], NULL);
+	TextureInfo sparse_info = make_volume_info(&sparse[texture_sparse_grid_size<float>(grid.size())], &sparse[0]);
+
+	/* Dense textures have no tile index to tell where they are empty. */
+	EXPECT_EQ(kernel_tex_image_empty_distance_3d(info, make_float3(0.9f, 0.1f, 0.1f), make_float3(1.0f, 0.0f, 0.0f)), 0.0f);
+
+	const InterpolationType interpolations[] = {INTERPOLATION_CLOSEST,
+	                                            INTERPOLATION_LINEAR,
+	                                            INTERPOLATION_CUBIC};
+	const ExtensionType extensions[] = {EXTENSION_EXTEND,
+	                                    EXTENSION_CLIP};
+	int num_empty = 0;
+	uint state = 1;
+	for(int j = 0; j < 2; j++) {
+		info.extension = sparse_info.extension = extensions[j];
+		for(int k = 0; k < 1024; k++) {
+			const float3 P = make_float3(random_float(&state),
+			                             random_float(&state),
+			                             random_float(&state));
+			const float3 D = make_float3(random_float(&state) - 0.5f,
+			                             random_float(&state) - 0.5f,
+			                             random_float(&state) - 0.5f);
+			const float distance = kernel_tex_image_empty_distance_3d(sparse_info, P, D);
+			if(distance == 0.0f) {
+				continue;
+			}
+			num_empty++;
+
+			/* All lookups up to the distance are zero. */
+			for(int l = 0; l <= 16; l++) {
+				const float3 Q = P + D*(distance*l/16.0f);
+				for(int i = 0; i < 3; i++) {
+					const float4 r = TextureInterpolator<float>::interp_3d(info, Q.x, Q.y, Q.z, interpolations[i]);
+					EXPECT_EQ(r.x, 0.0f);
+				}
+			}
+		}
+	}
+	EXPECT_GT(num_empty, 0);
+
+	/* Periodic lookups can wrap around to tiles which are not empty. */
+	sparse_info.extension = EXTENSION_REPEAT;
+	EXPECT_EQ(kernel_tex_image_empty_distance_3d(sparse_info, make_float3(0.9f, 0.1f, 0.1f), make_float3(1.0f, 0.0f, 0.0f)), 0.0f);
+}
+
+/* Lookup speed of compressed versus uncompressed textures. Disabled since it
+ * only reports timings, run with --gtest_also_run_disabled_tests. */
+TEST(kernel_cpu_image, DISABLED_compressed_sampling_speed)
+{
+	const int num_lookups = 4*1024*1024;
+
+	vector<uchar4> texels;
+	make_byte_image(texels);
+	vector<uchar> blocks(texture_bc3_size(image_size, image_size));
+	texture_bc3_encode_image(&texels[0], image_size, image_size, &blocks[0]);
+
+	const TextureInfo infos[] = {make_texture_info(&texels[0], IMAGE_COMPRESSION_NONE),
+	                             make_texture_info(&blocks[0], IMAGE_COMPRESSION_BC3)};
+	const size_t sizes[] = {texels.size()*sizeof(uchar4), blocks.size()};
+	const char *names[] = {"uncompressed", "compressed"};
+
+	for(int i = 0; i < 2; i++) {
+		uint state = 1;
+		float4 sum = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+		const double start_time = time_dt();
+		for(int j = 0; j < num_lookups; j++) {
+			const float x = random_float(&state);
+			const float y = random_float(&state);
+			sum += TextureInterpolator<uchar4>::interp(infos[i], x, y);
+		}
+		const double time = time_dt() - start_time;
+
+		printf("%-12s: %6d bytes, %8.3f ms, %6.2f Mlookups/s (sum %f)\n",
+		       names[i], (int)sizes[i], time*1000.0, num_lookups/time*1e-6, (double)(sum.x + sum.y + sum.z + sum.w));
+	}
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "device/device.h"
+
+#include "render/bake.h"
+#include "render/integrator.h"
+#include "render/scene.h"
+
+#include "util/util_map.h"
+#include "util/util_progress.h"
+#include "util/util_stats.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Device which evaluates shader tasks by writing what it was asked to
+ * evaluate, instead of shading. */
+class BakeTestDevice : public Device {
+public:
+	BakeTestDevice(DeviceInfo& info, Stats& stats, Profiler& profiler)
+	: Device(info, stats, profiler, true), num_input_copies(0), mem_counter(0)
+	{
+	}
+
+	/* Number of times bake input was copied to the device. */
+	int num_input_copies;
+
+	bool load_kernels(const DeviceRequestedFeatures& /*requested_features*/)
+	{
+		return true;
+	}
+
+	void const_copy_to(const char * /*name*/, void * /*host*/, size_t /*size*/) {}
+	int get_split_task_count(DeviceTask& /*task*/) { return 1; }
+	void task_wait() {}
+	void task_cancel() {}
+
+	void task_add(DeviceTask& task)
+	{
+		ASSERT_EQ(task.type, DeviceTask::SHADER);
+
+		const uint4 *input = (const uint4*)&memory[task.shader_input][0];
+		float4 *output = (float4*)&memory[task.shader_output][0];
+
+		for(int x = task.shader_x; x < task.shader_x + task.shader_w; x++) {
+			const uint4 in = input[x * 2];
+			output[x] = make_float4((float)task.shader_eval_type,
+			                        (float)(int)in.x,
+			                        (float)(int)in.y,
+			                        (float)task.num_samples);
+		}
+	}
+
+protected:
+	void mem_alloc(device_memory& mem)
+	{
+		mem.device_pointer = ++mem_counter;
+		memory[mem.device_pointer].resize(mem.memory_size());
+	}
+
+	void mem_copy_to(device_memory& mem)
+	{
+		if(!mem.device_pointer) {
+			mem_alloc(mem);
+		}
+
+		vector<uint8_t>& data = memory[mem.device_pointer];
+		memcpy(&data[0], mem.host_pointer, data.size());
+
+		if(strcmp(mem.name, "bake_input") == 0) {
+			num_input_copies++;
+		}
+	}
+
+	void mem_copy_from(device_memory& mem, int /*y*/, int /*w*/, int /*h*/, int /*elem*/)
+	{
+		vector<uint8_t>& data = memory[mem.device_pointer];
+		memcpy(mem.host_pointer, &data[0], data.size());
+	}
+
+	void mem_zero(device_memory& mem)
+	{
+		if(!mem.device_pointer) {
+			mem_alloc(mem);
+		}
+
+		vector<uint8_t>& data = memory[mem.device_pointer];
+		std::fill(data.begin(), data.end(), 0);
+	}
+
+	void mem_free(device_memory& mem)
+	{
+		memory.erase(mem.device_pointer);
+		mem.device_pointer = 0;
+	}
+
+private:
+	map<device_ptr, vector<uint8_t> > memory;
+	device_ptr mem_counter;
+};
+
+const int num_pixels = 40;
+const int num_samples = 4;
+
+/* Pixels of the objects alternate, like pixels of multiple selected objects
+ * baked to the active object. */
+void fill_bake_data(BakeData *bake_data, int object_id)
+{
+	for(int i = 0; i < num_pixels; i++) {
+		if(i % 2 == object_id) {
+			float uv[2] = {0.5f, 0.5f};
+			bake_data->set(i, i, uv, 0.0f, 0.0f, 0.0f, 0.0f);
+		}
+		else {
+			bake_data->set_null(i);
+		}
+	}
+}
+
+}  // namespace
+
+TEST(render_bake, batch_objects_and_passes)
+{
+	DeviceInfo info;
+	Stats stats;
+	Profiler profiler;
+	BakeTestDevice device(info, stats, profiler);
+
+	Scene scene(SceneParams(), &device);
+	scene.integrator->aa_samples = num_samples;
+
+	/* Split pixels into multiple shader tasks. */
+	BakeManager *bake_manager = scene.bake_manager;
+	bake_manager->set_shader_limit(4, 4);
+
+	BakeData bake_data0(0, 0, num_pixels);
+	BakeData bake_data1(1, 100, num_pixels);
+	fill_bake_data(&bake_data0, 0);
+	fill_bake_data(&bake_data1, 1);
+
+	vector<float> result_uv(num_pixels * 4, -1.0f);
+	vector<float> result_diffuse(num_pixels * 4, -1.0f);
+
+	const BakePass passes[] = {
+		{&bake_data0, SHADER_EVAL_UV, 0, &result_uv[0]},
+		{&bake_data0, SHADER_EVAL_DIFFUSE, BAKE_FILTER_DIFFUSE, &result_diffuse[0]},
+		{&bake_data1, SHADER_EVAL_UV, 0, &result_uv[0]},
+		{&bake_data1, SHADER_EVAL_DIFFUSE, BAKE_FILTER_DIFFUSE, &result_diffuse[0]},
+	};
+
+	Progress progress;
+	EXPECT_TRUE(bake_manager->bake_batch(&device,
+	                                     &scene.dscene,
+	                                     &scene,
+	                                     progress,
+	                                     vector<BakePass>(passes, passes + 4)));
+
+	/* Every pixel is written by the passes of its own object. */
+	for(int i = 0; i < num_pixels; i++) {
+		const int object = i % 2;
+		const int prim = (object == 0) ? i : 100 + i;
+
+		EXPECT_EQ(result_uv[i*4 + 0], (float)SHADER_EVAL_UV) << "pixel " << i;
+		EXPECT_EQ(result_uv[i*4 + 1], (float)object) << "pixel " << i;
+		EXPECT_EQ(result_uv[i*4 + 2], (float)prim) << "pixel " << i;
+		EXPECT_EQ(result_uv[i*4 + 3], 1.0f) << "pixel " << i;
+
+		EXPECT_EQ(result_diffuse[i*4 + 0], (float)SHADER_EVAL_DIFFUSE) << "pixel " << i;
+		EXPECT_EQ(result_diffuse[i*4 + 1], (float)object) << "pixel " << i;
+		EXPECT_EQ(result_diffuse[i*4 + 2], (float)prim) << "pixel " << i;
+		EXPECT_EQ(result_diffuse[i*4 + 3], (float)num_samples) << "pixel " << i;
+	}
+
+	/* Passes of the same object share their input, 3 shader tasks per object. */
+	EXPECT_EQ(device.num_input_copies, 2 * 3);
+
+	EXPECT_FALSE(bake_manager->get_baking());
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "render/jitter.h"
+
+#include "kernel/kernel_types.h"
+
+#include "util/util_math.h"
+#include "util/util_task.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Check that every elementary interval of the first size points holds
+ * exactly one point. */
+bool is_02_stratified(const float2 *points, int size)
+{
+	for(int xdivs = size, ydivs = 1; xdivs > 0; xdivs >>= 1, ydivs <<= 1) {
+		vector<int> count(size, 0);
+		for(int i = 0; i < size; i++) {
+			const int x = (int)(xdivs * points[i].x);
+			const int y = (int)(ydivs * points[i].y);
+			if(x < 0 || x >= xdivs || y < 0 || y >= ydivs) {
+				return false;
+			}
+			if(++count[y*xdivs + x] > 1) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/* RMS error of integrating a quarter disk over the unit square, with
+ * reference value pi/4, using the first num_samples points of a number of
+ * sequences. */
+float disk_integration_error(const vector<vector<float2> >& sequences, int num_samples)
+{
+	double error = 0.0;
+	for(size_t s = 0; s < sequences.size(); s++) {
+		int inside = 0;
+		for(int i = 0; i < num_samples; i++) {
+			const float2 p = sequences[s][i];
+			if(p.x*p.x + p.y*p.y < 1.0f) {
+				inside++;
+			}
+		}
+		const double e = (double)inside / num_samples - (double)M_PI_4_F;
+		error += e*e;
+	}
+	return (float)sqrt(error / sequences.size());
+}
+
+}  // namespace
+
+TEST(render_jitter, pmj02_stratification)
+{
+	const int size = 1024;
+	vector<float2> points(size);
+	for(int seed = 0; seed < 4; seed++) {
+		progressive_multi_jitter_02_generate_2D(&points[0], size, seed);
+		/* Every power of two prefix is stratified, not only the full set. */
+		for(int n = 1; n <= size; n *= 2) {
+			EXPECT_TRUE(is_02_stratified(&points[0], n)) << "seed " << seed << ", " << n << " points";
+		}
+	}
+}
+
+TEST(render_jitter, pmj02_error_per_sample_count)
+{
+	const int num_sequences = 32;
+	vector<vector<float2> > sequences(num_sequences, vector<float2>(NUM_PMJ_SAMPLES));
+	for(int s = 0; s < num_sequences; s++) {
+		progressive_multi_jitter_02_generate_2D(&sequences[s][0], NUM_PMJ_SAMPLES, s);
+	}
+
+	/* Uniform random samples have a standard deviation of sqrt(p(1-p)/N).
+	 * Stratified samples converge faster, for a disk edge the error is
+	 * expected to fall with N^-3/4. */
+	const float p = M_PI_4_F;
+	for(int n = 64; n <= NUM_PMJ_SAMPLES; n *= 4) {
+		const float random_error = sqrtf(p*(1.0f - p) / n);
+		const float pmj_error = disk_integration_error(sequences, n);
+		EXPECT_LT(pmj_error, 0.5f * random_error) << n << " samples";
+		EXPECT_LT(pmj_error, 2.0f * powf((float)n, -0.75f)) << n << " samples";
+	}
+}
+
+TEST(render_jitter, pmj_table)
+{
+	TaskScheduler::init(0);
+	vector<uint> table(NUM_PMJ_PATTERNS * NUM_PMJ_SAMPLES * 2);
+	progressive_multi_jitter_generate_table(&table[0]);
+	TaskScheduler::exit();
+
+	/* Values are floats in [1, 2) holding the points of each pattern. */
+	vector<float2> points(NUM_PMJ_SAMPLES);
+	for(int pattern = 0; pattern < NUM_PMJ_PATTERNS; pattern += NUM_PMJ_PATTERNS - 1) {
+		for(int i = 0; i < NUM_PMJ_SAMPLES; i++) {
+			const uint *values = &table[(pattern * NUM_PMJ_SAMPLES + i) * 2];
+			EXPECT_EQ(values[0] & 0xff800000, 0x3f800000);
+			EXPECT_EQ(values[1] & 0xff800000, 0x3f800000);
+			points[i] = make_float2(__uint_as_float(values[0]) - 1.0f,
+			                        __uint_as_float(values[1]) - 1.0f);
+		}
+		EXPECT_TRUE(is_02_stratified(&points[0], NUM_PMJ_SAMPLES)) << "pattern " << pattern;
+	}
+}
+
+CCL_NAMESPACE_END
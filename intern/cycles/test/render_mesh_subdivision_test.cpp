@@ -0,0 +1,140 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "render/mesh.h"
+
+#include "subd/subd_dice.h"
+#include "subd/subd_split.h"
+
+#include "util/util_types.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+const size_t num_control_verts = 7;
+
+/* A quad next to a pentagon, so there is an ngon center point. */
+void build_control_mesh(Mesh *mesh)
+{
+	const float3 verts[num_control_verts] = {
+		make_float3(0.0f, 0.0f, 0.0f),
+		make_float3(1.0f, 0.0f, 0.0f),
+		make_float3(1.0f, 1.0f, 0.0f),
+		make_float3(0.0f, 1.0f, 0.0f),
+		make_float3(2.0f, 0.0f, 0.0f),
+		make_float3(2.5f, 0.5f, 0.0f),
+		make_float3(2.0f, 1.0f, 0.0f),
+	};
+	int quad[4] = {0, 1, 2, 3};
+	int pentagon[5] = {1, 4, 5, 6, 2};
+
+	mesh->clear();
+	mesh->subdivision_type = Mesh::SUBDIVISION_LINEAR;
+
+	mesh->reserve_mesh(num_control_verts, 0);
+	for(size_t i = 0; i < num_control_verts; i++) {
+		mesh->add_vertex(verts[i]);
+	}
+
+	mesh->reserve_subd_faces(2, 1, 9);
+	mesh->add_subd_face(quad, 4, 0, true);
+	mesh->add_subd_face(pentagon, 5, 0, true);
+
+	mesh->add_vertex_normals();
+}
+
+void tessellate(Mesh *mesh)
+{
+	DiagSplit dsplit(*mesh->subd_params);
+	dsplit.params.use_cache = true;
+	mesh->tessellate(&dsplit);
+}
+
+/* Replace the cached positions, to see whether they are used. */
+const float3 cache_marker = make_float3(-1.0f, -2.0f, -3.0f);
+
+void mark_cache(Mesh *mesh)
+{
+	ASSERT_TRUE(mesh->subd_dice_cache != NULL);
+
+	array<float3>& P = mesh->subd_dice_cache->P;
+	for(size_t i = 0; i < P.size(); i++) {
+		P[i] = cache_marker;
+	}
+}
+
+size_t num_marked_verts(Mesh *mesh)
+{
+	size_t num_marked = 0;
+
+	for(size_t i = num_control_verts; i < mesh->verts.size(); i++) {
+		const float3& co = mesh->verts[i];
+		if(co.x == cache_marker.x && co.y == cache_marker.y && co.z == cache_marker.z) {
+			num_marked++;
+		}
+	}
+
+	return num_marked;
+}
+
+}  // namespace
+
+TEST(render_mesh_subdivision, dice_cache)
+{
+	Mesh mesh;
+	mesh.subd_params = new SubdParams(&mesh);
+	mesh.subd_params->dicing_rate = 0.25f;
+
+	build_control_mesh(&mesh);
+	tessellate(&mesh);
+
+	const size_t num_diced_verts = mesh.verts.size() - num_control_verts;
+	ASSERT_GT(num_diced_verts, 0);
+	EXPECT_EQ(num_marked_verts(&mesh), 0);
+
+	/* Unchanged control mesh, all vertices come from the cache. The normal
+	 * slot of the ngon center is not filled in yet, and must not matter. */
+	mark_cache(&mesh);
+	build_control_mesh(&mesh);
+	mesh.subd_attributes.find(ATTR_STD_VERTEX_NORMAL)->data_float3()[num_control_verts] =
+	        make_float3(1.0f, 2.0f, 3.0f);
+	tessellate(&mesh);
+
+	EXPECT_EQ(mesh.verts.size() - num_control_verts, num_diced_verts);
+	EXPECT_EQ(num_marked_verts(&mesh), num_diced_verts);
+
+	/* Changed subdivision parameters, even when the subpatches stay the same. */
+	mark_cache(&mesh);
+	build_control_mesh(&mesh);
+	mesh.subd_params->max_level = 11;
+	tessellate(&mesh);
+
+	EXPECT_EQ(mesh.verts.size() - num_control_verts, num_diced_verts);
+	EXPECT_EQ(num_marked_verts(&mesh), 0);
+
+	/* Moved control vertex. */
+	mark_cache(&mesh);
+	build_control_mesh(&mesh);
+	mesh.verts[5].z = 0.01f;
+	tessellate(&mesh);
+
+	EXPECT_EQ(num_marked_verts(&mesh), 0);
+}
+
+CCL_NAMESPACE_END
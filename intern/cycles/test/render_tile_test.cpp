@@ -0,0 +1,150 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "render/buffers.h"
+#include "render/tile.h"
+
+#include "util/util_foreach.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+const int IMAGE_SIZE = 128;
+const int TILE_SIZE = 64;
+
+/* Tile manager of a background render without progressive refine, in which
+ * the measured device throughput can be set. */
+class TestTileManager : public TileManager {
+public:
+	explicit TestTileManager(int num_devices)
+	: TileManager(false, 1, make_int2(TILE_SIZE, TILE_SIZE), INT_MAX,
+	              false, true, TILE_TOP_TO_BOTTOM, num_devices)
+	{
+		BufferParams buffer_params;
+		buffer_params.width = buffer_params.full_width = IMAGE_SIZE;
+		buffer_params.height = buffer_params.full_height = IMAGE_SIZE;
+		reset(buffer_params, 1);
+		next();
+	}
+
+	void set_device_speed(int device, double pixel_samples_per_second)
+	{
+		device_stats[device].pixel_samples_per_second = pixel_samples_per_second;
+	}
+};
+
+/* Check that the tiles cover every pixel of the image exactly once. */
+bool tiles_cover_image(const vector<Tile>& tiles)
+{
+	vector<int> count(IMAGE_SIZE*IMAGE_SIZE, 0);
+	foreach(const Tile& tile, tiles) {
+		for(int y = tile.y; y < tile.y + tile.h; y++) {
+			for(int x = tile.x; x < tile.x + tile.w; x++) {
+				count[y*IMAGE_SIZE + x]++;
+			}
+		}
+	}
+	foreach(int c, count) {
+		if(c != 1) {
+			return false;
+		}
+	}
+	return true;
+}
+
+}  // namespace
+
+TEST(render_tile, split_by_throughput)
+{
+	TestTileManager manager(2);
+	ASSERT_EQ(manager.state.num_tiles, 4);
+
+	/* The fast device has the whole image as its share. */
+	manager.set_device_speed(0, 6000.0);
+	manager.set_device_speed(1, 1000.0);
+	Tile *tile;
+	ASSERT_TRUE(manager.next_tile(tile, 0));
+	EXPECT_EQ(tile->w*tile->h, TILE_SIZE*TILE_SIZE);
+
+	/* While it renders, the slow device gets a piece matching its share of
+	 * the remaining three tiles. */
+	ASSERT_TRUE(manager.next_tile(tile, 1));
+	const int share = 3*TILE_SIZE*TILE_SIZE*1000/7000;
+	EXPECT_EQ(tile->w, TILE_SIZE);
+	EXPECT_EQ(tile->h, share/TILE_SIZE);
+	EXPECT_EQ(manager.state.num_split_tiles, 1);
+
+	/* Splitting doesn't change the number of tiles shown in the progress. */
+	EXPECT_EQ(manager.state.num_tiles, 4);
+
+	/* The rest of the tile is rendered next. */
+	const int rest_index = manager.state.tiles.size() - 1;
+	const Tile& rest = manager.state.tiles[rest_index];
+	EXPECT_EQ(rest.y, tile->y + tile->h);
+	EXPECT_EQ(rest.h, TILE_SIZE - tile->h);
+	ASSERT_TRUE(manager.next_tile(tile, 0));
+	EXPECT_EQ(tile->index, rest_index);
+
+	EXPECT_TRUE(tiles_cover_image(manager.state.tiles));
+}
+
+TEST(render_tile, split_without_measurement)
+{
+	TestTileManager manager(2);
+
+	/* Devices which have not finished a tile yet get whole tiles. */
+	Tile *tile;
+	for(int device = 0; device < 2; device++) {
+		ASSERT_TRUE(manager.next_tile(tile, device));
+		EXPECT_EQ(tile->w*tile->h, TILE_SIZE*TILE_SIZE);
+	}
+	EXPECT_EQ(manager.state.num_split_tiles, 0);
+}
+
+TEST(render_tile, split_until_done)
+{
+	TestTileManager manager(2);
+
+	/* Render with a device which is ten times slower than the other one,
+	 * finishing tiles in the order they were acquired. */
+	vector<int> rendering;
+	Tile *tile;
+	for(int i = 0; manager.next_tile(tile, i % 2); i++) {
+		rendering.push_back(tile->index);
+		if(rendering.size() > 2) {
+			bool delete_tile;
+			manager.finish_tile(rendering.front(), delete_tile);
+			rendering.erase(rendering.begin());
+		}
+		manager.set_device_speed(0, 10000.0);
+		manager.set_device_speed(1, 1000.0);
+	}
+
+	/* The slow device gets smaller pieces towards the end, which are not
+	 * smaller than the minimum size. */
+	EXPECT_GT(manager.state.num_split_tiles, 0);
+	EXPECT_EQ(manager.state.num_tiles, 4);
+	foreach(const Tile& tile, manager.state.tiles) {
+		EXPECT_GE(min(tile.w, tile.h), 16);
+	}
+	EXPECT_TRUE(tiles_cover_image(manager.state.tiles));
+}
+
+CCL_NAMESPACE_END
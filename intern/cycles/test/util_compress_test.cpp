@@ -0,0 +1,98 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "util/util_compress.h"
+#include "util/util_hash.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+void expect_roundtrip(const vector<uint8_t>& data)
+{
+	vector<uint8_t> compressed;
+	util_compress_buffer(data.empty() ? NULL : &data[0], data.size(), compressed);
+
+	vector<uint8_t> result(data.size() + 1, 0xAB);
+	const bool ok = util_decompress_buffer(compressed.empty() ? NULL : &compressed[0],
+	                                       compressed.size(),
+	                                       &result[0],
+	                                       data.size());
+	EXPECT_TRUE(ok);
+
+	for(size_t i = 0; i < data.size(); i++) {
+		EXPECT_EQ(data[i], result[i]) << "at byte " << i;
+	}
+	/* Nothing written past the end. */
+	EXPECT_EQ(0xAB, result[data.size()]);
+}
+
+}  // namespace
+
+TEST(util_compress, empty)
+{
+	expect_roundtrip(vector<uint8_t>());
+}
+
+TEST(util_compress, zeros)
+{
+	vector<uint8_t> data(100000, 0);
+	expect_roundtrip(data);
+
+	vector<uint8_t> compressed;
+	util_compress_buffer(&data[0], data.size(), compressed);
+	EXPECT_LT(compressed.size(), data.size() / 50);
+}
+
+TEST(util_compress, floats)
+{
+	vector<float> values(4096*3);
+	for(size_t i = 0; i < values.size(); i++) {
+		values[i] = (i % 3 == 0) ? 0.0f : 0.5f + (float)(i % 17) * 0.125f;
+	}
+
+	vector<uint8_t> data(values.size() * sizeof(float));
+	memcpy(&data[0], &values[0], data.size());
+	expect_roundtrip(data);
+}
+
+TEST(util_compress, random_unaligned_sizes)
+{
+	for(size_t size = 1; size < 700; size += 37) {
+		vector<uint8_t> data(size);
+		for(size_t i = 0; i < size; i++) {
+			/* Mix of runs and noise. */
+			data[i] = (i % 64 < 20) ? 7 : (uint8_t)hash_int((uint)i);
+		}
+		expect_roundtrip(data);
+	}
+}
+
+TEST(util_compress, malformed)
+{
+	float value = 1.0f;
+	vector<uint8_t> compressed;
+	util_compress_buffer(&value, sizeof(value), compressed);
+
+	/* Decompressing to the wrong size or from truncated data fails. */
+	float result[2];
+	EXPECT_FALSE(util_decompress_buffer(&compressed[0], compressed.size(), result, 2*sizeof(float)));
+	EXPECT_FALSE(util_decompress_buffer(&compressed[0], compressed.size() - 1, result, sizeof(float)));
+}
+
+CCL_NAMESPACE_END
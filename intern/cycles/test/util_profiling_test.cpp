@@ -0,0 +1,69 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "util/util_profiling.h"
+#include "util/util_time.h"
+
+CCL_NAMESPACE_BEGIN
+
+TEST(util_profiling, shader_object_times)
+{
+	Profiler profiler;
+	profiler.reset(2, 2);
+	profiler.start();
+
+	/* Pretend to be a render thread, shading object 0 with shader 1 and then
+	 * intersecting object 1. */
+	ProfilingState state;
+	profiler.add_state(&state);
+
+	{
+		ProfilingHelper helper(&state, PROFILING_SHADER_EVAL);
+		helper.set_object(0);
+		helper.set_shader(1);
+		time_sleep(0.05);
+
+		helper.set_event(PROFILING_INTERSECT);
+		helper.set_object(1);
+		time_sleep(0.05);
+	}
+
+	profiler.remove_state(&state);
+	profiler.stop();
+
+	EXPECT_GT(profiler.get_event(PROFILING_SHADER_EVAL), 0);
+	EXPECT_GT(profiler.get_event(PROFILING_INTERSECT), 0);
+
+	uint64_t samples = 0, hits = 0;
+
+	/* Shader time is only counted while shading. */
+	EXPECT_FALSE(profiler.get_shader(0, samples, hits));
+	ASSERT_TRUE(profiler.get_shader(1, samples, hits));
+	EXPECT_GT(samples * profiler.get_sample_interval(), 0.0);
+	EXPECT_EQ(hits, 1);
+
+	ASSERT_TRUE(profiler.get_object(0, samples, hits));
+	EXPECT_GT(samples * profiler.get_sample_interval(), 0.0);
+	EXPECT_EQ(hits, 1);
+
+	ASSERT_TRUE(profiler.get_object(1, samples, hits));
+	EXPECT_GT(samples * profiler.get_sample_interval(), 0.0);
+	EXPECT_EQ(hits, 1);
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "util/util_texture_compression.h"
+
+CCL_NAMESPACE_BEGIN
+
+TEST(util_texture_compression, constant)
+{
+	uchar4 texels[16];
+	for(int i = 0; i < 16; i++) {
+		texels[i] = make_uchar4(255, 0, 255, 128);
+	}
+
+	uchar block[TEX_BC3_BLOCK_BYTES];
+	texture_bc3_encode(texels, block);
+
+	for(int y = 0; y < 4; y++) {
+		for(int x = 0; x < 4; x++) {
+			const float4 c = texture_bc3_decode(block, x, y);
+			EXPECT_EQ(1.0f, c.x);
+			EXPECT_EQ(0.0f, c.y);
+			EXPECT_EQ(1.0f, c.z);
+			EXPECT_NEAR(128.0f/255.0f, c.w, 1e-6f);
+		}
+	}
+}
+
+TEST(util_texture_compression, gradient)
+{
+	/* Colors along a line with anti-correlated channels, and an alpha ramp.
+	 * Alpha error is bounded by half of the eight level palette step. */
+	uchar4 texels[16];
+	for(int i = 0; i < 16; i++) {
+		const uchar v = (uchar)(i*17);
+		texels[i] = make_uchar4(v, 255 - v, 64, v);
+	}
+
+	uchar block[TEX_BC3_BLOCK_BYTES];
+	texture_bc3_encode(texels, block);
+
+	for(int i = 0; i < 16; i++) {
+		const float4 c = texture_bc3_decode(block, i & 3, i >> 2);
+		EXPECT_NEAR(texels[i].x/255.0f, c.x, 0.2f) << "at texel " << i;
+		EXPECT_NEAR(texels[i].y/255.0f, c.y, 0.2f) << "at texel " << i;
+		EXPECT_NEAR(texels[i].z/255.0f, c.z, 0.05f) << "at texel " << i;
+		EXPECT_NEAR(texels[i].w/255.0f, c.w, 0.075f) << "at texel " << i;
+	}
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/util_compress.h"
+
+#include <string.h>
+
+CCL_NAMESPACE_BEGIN
+
+/* Run length encoding: a control byte below 128 is followed by control + 1
+ * literal bytes, otherwise the next byte is repeated control - 128 +
+ * RLE_MIN_RUN times. */
+#define RLE_MAX_LITERAL 128
+#define RLE_MIN_RUN 3
+#define RLE_MAX_RUN (127 + RLE_MIN_RUN)
+
+static void rle_flush_literal(const uint8_t *in,
+                              size_t start,
+                              size_t end,
+                              vector<uint8_t>& out)
+{
+	while(start < end) {
+		const size_t n = (end - start < RLE_MAX_LITERAL) ? end - start : RLE_MAX_LITERAL;
+		out.push_back((uint8_t)(n - 1));
+		out.insert(out.end(), in + start, in + start + n);
+		start += n;
+	}
+}
+
+static void rle_encode(const uint8_t *in, size_t size, vector<uint8_t>& out)
+{
+	size_t i = 0, literal_start = 0;
+
+	while(i < size) {
+		size_t run = 1;
+		while(i + run < size && run < RLE_MAX_RUN && in[i + run] == in[i]) {
+			run++;
+		}
+
+		if(run >= RLE_MIN_RUN) {
+			rle_flush_literal(in, literal_start, i, out);
+			out.push_back((uint8_t)(128 + run - RLE_MIN_RUN));
+			out.push_back(in[i]);
+			literal_start = i + run;
+		}
+
+		i += run;
+	}
+
+	rle_flush_literal(in, literal_start, size, out);
+}
+
+static bool rle_decode(const uint8_t *in, size_t in_size, uint8_t *out, size_t size)
+{
+	size_t i = 0, o = 0;
+
+	while(i < in_size) {
+		const uint8_t control = in[i++];
+
+		if(control < 128) {
+			const size_t n = control + 1;
+			if(i + n > in_size || o + n > size) {
+				return false;
+			}
+			memcpy(out + o, in + i, n);
+			i += n;
+			o += n;
+		}
+		else {
+			const size_t n = control - 128 + RLE_MIN_RUN;
+			if(i >= in_size || o + n > size) {
+				return false;
+			}
+			memset(out + o, in[i++], n);
+			o += n;
+		}
+	}
+
+	return o == size;
+}
+
+void util_compress_buffer(const void *data, size_t size, vector<uint8_t>& compressed)
+{
+	compressed.clear();
+	if(size == 0) {
+		return;
+	}
+
+	const uint8_t *bytes = (const uint8_t*)data;
+	const size_t num_words = size / 4;
+
+	/* Delta against the previous word, split into byte planes so the
+	 * sign and exponent bytes end up next to each other. */
+	vector<uint8_t> planes(size);
+	uint32_t prev = 0;
+
+	for(size_t i = 0; i < num_words; i++) {
+		uint32_t word;
+		memcpy(&word, bytes + i*4, 4);
+
+		const uint32_t delta = word ^ prev;
+		prev = word;
+
+		for(int b = 0; b < 4; b++) {
+			planes[b*num_words + i] = (uint8_t)(delta >> (b*8));
+		}
+	}
+
+	/* Remaining bytes are stored as is. */
+	for(size_t i = num_words*4; i < size; i++) {
+		planes[i] = bytes[i];
+	}
+
+	compressed.reserve(size + size/RLE_MAX_LITERAL + 1);
+	rle_encode(&planes[0], size, compressed);
+}
+
+bool util_decompress_buffer(const uint8_t *compressed,
+                            size_t compressed_size,
+                            void *data,
+                            size_t size)
+{
+	if(size == 0) {
+		return compressed_size == 0;
+	}
+
+	uint8_t *bytes = (uint8_t*)data;
+	const size_t num_words = size / 4;
+
+	vector<uint8_t> planes(size);
+	if(!rle_decode(compressed, compressed_size, &planes[0], size)) {
+		return false;
+	}
+
+	uint32_t prev = 0;
+
+	for(size_t i = 0; i < num_words; i++) {
+		uint32_t delta = 0;
+		for(int b = 0; b < 4; b++) {
+			delta |= (uint32_t)planes[b*num_words + i] << (b*8);
+		}
+
+		prev ^= delta;
+		memcpy(bytes + i*4, &prev, 4);
+	}
+
+	for(size_t i = num_words*4; i < size; i++) {
+		bytes[i] = planes[i];
+	}
+
+	return true;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __UTIL_COMPRESS_H__
+#define __UTIL_COMPRESS_H__
+
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Lossless Buffer Compression
+ *
+ * Fast compression of buffers made of 32 bit words, mainly floats. Every word
+ * is XOR-ed with the previous one, the result is split into byte planes and
+ * run length encoded. Render buffers and scene data contain many zeros and
+ * slowly varying values, which compress well this way while keeping the cost
+ * far below the network transfer time. */
+
+/* Compress size bytes of data, replacing the contents of compressed. */
+void util_compress_buffer(const void *data, size_t size, vector<uint8_t>& compressed);
+
+/* Decompress into a buffer of exactly size bytes, returns false if the
+ * compressed data is malformed or decompresses to a different size. */
+bool util_decompress_buffer(const uint8_t *compressed,
+                            size_t compressed_size,
+                            void *data,
+                            size_t size);
+
+CCL_NAMESPACE_END
+
+#endif /* __UTIL_COMPRESS_H__ */
@@ -65,6 +65,9 @@ public:
 
 		/* Whether split kernel is used */
 		bool split_kernel;
+
+		/* Whether coherent rays are traced together in packets. */
+		bool ray_packets;
 	};
 
 	/* Descriptor of CUDA feature-set to be used. */
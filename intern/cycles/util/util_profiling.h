@@ -0,0 +1,171 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __UTIL_PROFILING_H__
+#define __UTIL_PROFILING_H__
+
+#include <assert.h>
+
+#include "util/util_thread.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Stages of the CPU kernel that render threads report to the profiler. */
+enum ProfilingEvent {
+	PROFILING_UNKNOWN,
+	PROFILING_RAY_SETUP,
+	PROFILING_PATH_INTEGRATE,
+	PROFILING_SCENE_INTERSECT,
+	PROFILING_INDIRECT_EMISSION,
+	PROFILING_VOLUME,
+	PROFILING_SHADER_SETUP,
+	PROFILING_SHADER_EVAL,
+	PROFILING_SHADER_APPLY,
+	PROFILING_AO,
+	PROFILING_SUBSURFACE,
+	PROFILING_CONNECT_LIGHT,
+	PROFILING_SURFACE_BOUNCE,
+	PROFILING_WRITE_RESULT,
+
+	PROFILING_INTERSECT,
+	PROFILING_INTERSECT_LOCAL,
+	PROFILING_INTERSECT_SHADOW_ALL,
+	PROFILING_INTERSECT_VOLUME,
+	PROFILING_INTERSECT_VOLUME_ALL,
+
+	PROFILING_CLOSURE_EVAL,
+	PROFILING_CLOSURE_SAMPLE,
+	PROFILING_CLOSURE_VOLUME_EVAL,
+	PROFILING_CLOSURE_VOLUME_SAMPLE,
+
+	PROFILING_DENOISING,
+
+	PROFILING_NUM_EVENTS,
+};
+
+/* Per render thread state, written by the thread and read by the profiler.
+ * Shader and object hits count how often a thread started shading them,
+ * which together with the number of samples gives the average cost. */
+struct ProfilingState {
+	ProfilingState()
+	: event(PROFILING_UNKNOWN), shader(-1), object(-1), active(false)
+	{
+	}
+
+	volatile uint32_t event;
+	volatile int32_t shader;
+	volatile int32_t object;
+	volatile bool active;
+
+	vector<uint64_t> shader_hits;
+	vector<uint64_t> object_hits;
+};
+
+/* Sampling profiler: a worker thread periodically records the event, shader
+ * and object of all active render threads. This has a low enough overhead to
+ * be left on during a full render, and does not require any changes to the
+ * kernel apart from threads updating their state. */
+class Profiler {
+public:
+	Profiler();
+	~Profiler();
+
+	void reset(int num_shaders, int num_objects);
+
+	void start();
+	void stop();
+
+	void add_state(ProfilingState *state);
+	void remove_state(ProfilingState *state);
+
+	uint64_t get_event(ProfilingEvent event);
+	bool get_shader(int shader, uint64_t &samples, uint64_t &hits);
+	bool get_object(int object, uint64_t &samples, uint64_t &hits);
+
+	/* Time between samples in seconds. */
+	double get_sample_interval() const { return sample_interval; }
+
+protected:
+	void run();
+
+	/* Tracks how often the worker was in each ProfilingEvent while sampling,
+	 * so multiplying the values by the sample interval gives the time spent
+	 * in the event. */
+	vector<uint64_t> event_samples;
+	vector<uint64_t> shader_samples;
+	vector<uint64_t> object_samples;
+
+	/* Hit counts of the threads that were already removed. */
+	vector<uint64_t> shader_hits;
+	vector<uint64_t> object_hits;
+
+	double sample_interval;
+	volatile bool do_stop_worker;
+	thread *worker;
+
+	thread_mutex mutex;
+	vector<ProfilingState*> states;
+};
+
+/* Scoped change of the event of a thread, restoring the previous event when
+ * going out of scope so nested kernel stages are attributed correctly. */
+class ProfilingHelper {
+public:
+	ProfilingHelper(ProfilingState *state, ProfilingEvent event)
+	: state(state)
+	{
+		previous_event = state->event;
+		state->event = event;
+	}
+
+	inline void set_event(ProfilingEvent event)
+	{
+		state->event = event;
+	}
+
+	inline void set_shader(int shader)
+	{
+		state->shader = shader;
+		if(state->active) {
+			assert((size_t)shader < state->shader_hits.size());
+			state->shader_hits[shader]++;
+		}
+	}
+
+	inline void set_object(int object)
+	{
+		state->object = object;
+		if(state->active) {
+			assert((size_t)object < state->object_hits.size());
+			state->object_hits[object]++;
+		}
+	}
+
+	~ProfilingHelper()
+	{
+		state->event = previous_event;
+	}
+
+private:
+	ProfilingState *state;
+	uint32_t previous_event;
+};
+
+CCL_NAMESPACE_END
+
+#endif  /* __UTIL_PROFILING_H__ */
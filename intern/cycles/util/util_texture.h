@@ -60,6 +60,18 @@ typedef enum ImageDataType {
 #define IMAGE_DATA_TYPE_SHIFT 3
 #define IMAGE_DATA_TYPE_MASK 0x7
 
+/* Compression of texture storage. */
+typedef enum ImageCompression {
+	IMAGE_COMPRESSION_NONE = 0,
+	/* 4x4 texel blocks of byte4 textures, see util_texture_compression.h. */
+	IMAGE_COMPRESSION_BC3 = 1,
+} ImageCompression;
+
+/* Sparse 3D textures are stored in tiles of TEX_SPARSE_TILE_SIZE^3 voxels,
+ * tiles in which all voxels are zero share a single empty tile. */
+#define TEX_SPARSE_TILE_SHIFT 3
+#define TEX_SPARSE_TILE_SIZE (1 << TEX_SPARSE_TILE_SHIFT)
+
 /* Extension types for textures.
  *
  * Defines how the image is extrapolated past its original bounds. */
@@ -83,6 +95,11 @@ typedef struct TextureInfo {
 	uint interpolation, extension;
 	/* Dimensions. */
 	uint width, height, depth;
+	/* Tile index of sparse 3D textures, 0 for dense textures. */
+	uint64_t grid;
+	/* Compression of the texture storage (CPU only). */
+	uint compression;
+	uint pad;
 } TextureInfo;
 
 CCL_NAMESPACE_END
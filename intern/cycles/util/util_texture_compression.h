@@ -0,0 +1,243 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __UTIL_TEXTURE_COMPRESSION_H__
+#define __UTIL_TEXTURE_COMPRESSION_H__
+
+#include "util/util_math.h"
+#include "util/util_types.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* BC3 block compression of byte textures.
+ *
+ * Blocks of 4x4 texels take 16 bytes: two 8 bit alpha endpoints followed by
+ * 3 bit alpha indices, then two RGB565 color endpoints followed by 2 bit
+ * color indices, all little endian. This matches the BC3 (DXT5) layout of
+ * GPU texture formats. */
+
+#define TEX_BC3_BLOCK_SIZE 4
+#define TEX_BC3_BLOCK_BYTES 16
+
+ccl_device_inline float3 texture_bc3_color(uint c)
+{
+	return make_float3(((c >> 11) & 31) * (1.0f/31.0f),
+	                   ((c >> 5) & 63) * (1.0f/63.0f),
+	                   (c & 31) * (1.0f/31.0f));
+}
+
+ccl_device_inline float texture_bc3_alpha(int a0, int a1, int index)
+{
+	if(index == 0) {
+		return a0 * (1.0f/255.0f);
+	}
+	else if(index == 1) {
+		return a1 * (1.0f/255.0f);
+	}
+	else if(a0 > a1) {
+		return ((8 - index)*a0 + (index - 1)*a1) * (1.0f/(7.0f*255.0f));
+	}
+	else if(index == 6) {
+		return 0.0f;
+	}
+	else if(index == 7) {
+		return 1.0f;
+	}
+	else {
+		return ((6 - index)*a0 + (index - 1)*a1) * (1.0f/(5.0f*255.0f));
+	}
+}
+
+/* Decode texel x, y (0..3) of a block. */
+ccl_device_inline float4 texture_bc3_decode(const uchar *block, int x, int y)
+{
+	const int i = y*TEX_BC3_BLOCK_SIZE + x;
+
+	/* Alpha, 3 bit indices start at byte 2. */
+	const int bit = 3*i;
+	const int alpha_bits = block[2 + (bit >> 3)] | (block[3 + (bit >> 3)] << 8);
+	const int alpha_index = (alpha_bits >> (bit & 7)) & 7;
+	const float alpha = texture_bc3_alpha(block[0], block[1], alpha_index);
+
+	/* Color, 2 bit indices in bytes 12 to 15. */
+	const float3 c0 = texture_bc3_color(block[8] | (block[9] << 8));
+	const float3 c1 = texture_bc3_color(block[10] | (block[11] << 8));
+	const int color_index = (block[12 + (i >> 2)] >> (2*(i & 3))) & 3;
+	float3 color;
+	switch(color_index) {
+		case 0: color = c0; break;
+		case 1: color = c1; break;
+		case 2: color = (2.0f/3.0f)*c0 + (1.0f/3.0f)*c1; break;
+		default: color = (1.0f/3.0f)*c0 + (2.0f/3.0f)*c1; break;
+	}
+
+	return make_float4(color.x, color.y, color.z, alpha);
+}
+
+#ifndef __KERNEL_GPU__
+
+/* Encode a block of 4x4 texels, in rows. Color endpoints are the extremes of
+ * the texels along the principal axis of their colors, alpha endpoints are
+ * the minimum and maximum alpha. Texels use the closest palette entry. */
+inline void texture_bc3_encode(const uchar4 *texels, uchar *block)
+{
+	const int num_texels = TEX_BC3_BLOCK_SIZE*TEX_BC3_BLOCK_SIZE;
+
+	float3 mean = make_float3(0.0f, 0.0f, 0.0f);
+	int min_alpha = 255, max_alpha = 0;
+	for(int i = 0; i < num_texels; i++) {
+		mean += make_float3(texels[i].x, texels[i].y, texels[i].z);
+		min_alpha = min(min_alpha, (int)texels[i].w);
+		max_alpha = max(max_alpha, (int)texels[i].w);
+	}
+	mean *= 1.0f/num_texels;
+
+	/* Principal axis of the colors by power iteration on the covariance. */
+	float cov[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+	for(int i = 0; i < num_texels; i++) {
+		const float3 d = make_float3(texels[i].x, texels[i].y, texels[i].z) - mean;
+		cov[0] += d.x*d.x; cov[1] += d.x*d.y; cov[2] += d.x*d.z;
+		cov[3] += d.y*d.y; cov[4] += d.y*d.z; cov[5] += d.z*d.z;
+	}
+	/* Start from the covariance of the channel with the largest variance, a
+	 * fixed start vector can be orthogonal to the principal axis. */
+	float3 axis = make_float3(cov[0], cov[1], cov[2]);
+	if(cov[3] > cov[0] && cov[3] >= cov[5]) {
+		axis = make_float3(cov[1], cov[3], cov[4]);
+	}
+	else if(cov[5] > cov[0] && cov[5] > cov[3]) {
+		axis = make_float3(cov[2], cov[4], cov[5]);
+	}
+	for(int iteration = 0; iteration < 8; iteration++) {
+		const float3 next = make_float3(cov[0]*axis.x + cov[1]*axis.y + cov[2]*axis.z,
+		                                cov[1]*axis.x + cov[3]*axis.y + cov[4]*axis.z,
+		                                cov[2]*axis.x + cov[4]*axis.y + cov[5]*axis.z);
+		const float length = max3(fabs(next));
+		if(length == 0.0f) {
+			break;
+		}
+		axis = next/length;
+	}
+
+	float min_t = FLT_MAX, max_t = -FLT_MAX;
+	for(int i = 0; i < num_texels; i++) {
+		const float t = dot(make_float3(texels[i].x, texels[i].y, texels[i].z) - mean, axis);
+		min_t = min(min_t, t);
+		max_t = max(max_t, t);
+	}
+	const float3 color_max = clamp(mean + max_t*axis, make_float3(0.0f, 0.0f, 0.0f), make_float3(255.0f, 255.0f, 255.0f));
+	const float3 color_min = clamp(mean + min_t*axis, make_float3(0.0f, 0.0f, 0.0f), make_float3(255.0f, 255.0f, 255.0f));
+
+	/* Alpha, endpoints ordered so all eight palette entries are interpolated. */
+	const int a0 = max_alpha, a1 = min_alpha;
+	block[0] = (uchar)a0;
+	block[1] = (uchar)a1;
+	uint64_t alpha_bits = 0;
+	for(int i = 0; i < num_texels && a0 != a1; i++) {
+		int best = 0, best_error = 256;
+		for(int index = 0; index < 8; index++) {
+			const int a = (int)(texture_bc3_alpha(a0, a1, index)*255.0f + 0.5f);
+			const int error = (a > texels[i].w)? a - texels[i].w: texels[i].w - a;
+			if(error < best_error) {
+				best = index;
+				best_error = error;
+			}
+		}
+		alpha_bits |= (uint64_t)best << (3*i);
+	}
+	for(int i = 0; i < 6; i++) {
+		block[2 + i] = (uchar)(alpha_bits >> (8*i));
+	}
+
+	/* Color endpoints in RGB565. */
+	const uint c0 = (((uint)(color_max.x*(31.0f/255.0f) + 0.5f)) << 11) |
+	                (((uint)(color_max.y*(63.0f/255.0f) + 0.5f)) << 5) |
+	                ((uint)(color_max.z*(31.0f/255.0f) + 0.5f));
+	const uint c1 = (((uint)(color_min.x*(31.0f/255.0f) + 0.5f)) << 11) |
+	                (((uint)(color_min.y*(63.0f/255.0f) + 0.5f)) << 5) |
+	                ((uint)(color_min.z*(31.0f/255.0f) + 0.5f));
+	block[8] = (uchar)(c0 & 255);
+	block[9] = (uchar)(c0 >> 8);
+	block[10] = (uchar)(c1 & 255);
+	block[11] = (uchar)(c1 >> 8);
+
+	const float3 e0 = texture_bc3_color(c0)*255.0f;
+	const float3 e1 = texture_bc3_color(c1)*255.0f;
+	const float3 palette[4] = {e0,
+	                           (2.0f/3.0f)*e0 + (1.0f/3.0f)*e1,
+	                           (1.0f/3.0f)*e0 + (2.0f/3.0f)*e1,
+	                           e1};
+	/* Palette entries in the order of increasing distance from c0. */
+	const int palette_index[4] = {0, 2, 3, 1};
+
+	for(int i = 0; i < 4; i++) {
+		block[12 + i] = 0;
+	}
+	for(int i = 0; i < num_texels; i++) {
+		const float3 t = make_float3(texels[i].x, texels[i].y, texels[i].z);
+		int best = 0;
+		float best_error = FLT_MAX;
+		for(int p = 0; p < 4; p++) {
+			const float3 d = t - palette[p];
+			const float error = dot(d, d);
+			if(error < best_error) {
+				best = p;
+				best_error = error;
+			}
+		}
+		block[12 + (i >> 2)] |= (uchar)(palette_index[best] << (2*(i & 3)));
+	}
+}
+
+/* Size in bytes of a compressed texture of the given dimensions. */
+inline size_t texture_bc3_size(size_t width, size_t height)
+{
+	return divide_up(width, TEX_BC3_BLOCK_SIZE) *
+	       divide_up(height, TEX_BC3_BLOCK_SIZE) *
+	       TEX_BC3_BLOCK_BYTES;
+}
+
+/* Encode a texture of the given dimensions, with blocks in rows. Blocks at
+ * the right and bottom border repeat the last texels. */
+inline void texture_bc3_encode_image(const uchar4 *texels,
+                                     size_t width, size_t height,
+                                     uchar *blocks)
+{
+	const size_t blocks_x = divide_up(width, TEX_BC3_BLOCK_SIZE);
+	const size_t blocks_y = divide_up(height, TEX_BC3_BLOCK_SIZE);
+
+	for(size_t by = 0; by < blocks_y; by++) {
+		for(size_t bx = 0; bx < blocks_x; bx++) {
+			uchar4 block_texels[TEX_BC3_BLOCK_SIZE*TEX_BC3_BLOCK_SIZE];
+			for(size_t y = 0; y < TEX_BC3_BLOCK_SIZE; y++) {
+				size_t ty = by*TEX_BC3_BLOCK_SIZE + y;
+				ty = (ty < height)? ty: height - 1;
+				for(size_t x = 0; x < TEX_BC3_BLOCK_SIZE; x++) {
+					size_t tx = bx*TEX_BC3_BLOCK_SIZE + x;
+					tx = (tx < width)? tx: width - 1;
+					block_texels[y*TEX_BC3_BLOCK_SIZE + x] = texels[ty*width + tx];
+				}
+			}
+			texture_bc3_encode(block_texels, blocks + (by*blocks_x + bx)*TEX_BC3_BLOCK_BYTES);
+		}
+	}
+}
+
+#endif  /* __KERNEL_GPU__ */
+
+CCL_NAMESPACE_END
+
+#endif /* __UTIL_TEXTURE_COMPRESSION_H__ */
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __UTIL_TEXTURE_SPARSE_H__
+#define __UTIL_TEXTURE_SPARSE_H__
+
+#include "util/util_algorithm.h"
+#include "util/util_math.h"
+#include "util/util_texture.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Sparse storage of 3D textures.
+ *
+ * The volume is split in tiles of TEX_SPARSE_TILE_SIZE^3 voxels. The tile
+ * index at the start maps every tile to its voxels: it is followed by an
+ * empty tile shared by all tiles in which all voxels are zero, and then by
+ * the remaining tiles. Voxels within a tile are stored in x, y, z order, the
+ * part of tiles at the border past the texture dimensions is zero. */
+
+/* Number of elements of type T taken by the tile index. */
+template<typename T>
+inline size_t texture_sparse_grid_size(size_t num_tiles)
+{
+	return divide_up(num_tiles*sizeof(int), sizeof(T));
+}
+
+/* Number of elements of type T taken by sparse storage. */
+template<typename T>
+inline size_t texture_sparse_size(size_t num_tiles, size_t num_used_tiles)
+{
+	const size_t tile_voxels = TEX_SPARSE_TILE_SIZE*TEX_SPARSE_TILE_SIZE*TEX_SPARSE_TILE_SIZE;
+	return texture_sparse_grid_size<T>(num_tiles) + (num_used_tiles + 1)*tile_voxels;
+}
+
+/* Build the tile index of dense voxels, returns the number of tiles which
+ * contain non-zero voxels. */
+template<typename T>
+size_t texture_sparse_tiles(const T *voxels,
+                            size_t width, size_t height, size_t depth,
+                            vector<int>& grid)
+{
+	const size_t tile_size = TEX_SPARSE_TILE_SIZE;
+	const size_t tiles_x = divide_up(width, tile_size);
+	const size_t tiles_y = divide_up(height, tile_size);
+	const size_t tiles_z = divide_up(depth, tile_size);
+
+	T zero;
+	memset(&zero, 0, sizeof(zero));
+
+	grid.clear();
+	grid.resize(tiles_x*tiles_y*tiles_z, 0);
+	size_t num_used_tiles = 0;
+	for(size_t tz = 0, tile = 0; tz < tiles_z; tz++) {
+		for(size_t ty = 0; ty < tiles_y; ty++) {
+			for(size_t tx = 0; tx < tiles_x; tx++, tile++) {
+				bool is_empty = true;
+				for(size_t z = tz*tile_size; z < min((tz+1)*tile_size, depth) && is_empty; z++) {
+					for(size_t y = ty*tile_size; y < min((ty+1)*tile_size, height) && is_empty; y++) {
+						const T *row = voxels + (z*height + y)*width;
+						for(size_t x = tx*tile_size; x < min((tx+1)*tile_size, width); x++) {
+							if(memcmp(&row[x], &zero, sizeof(zero)) != 0) {
+								is_empty = false;
+								break;
+							}
+						}
+					}
+				}
+				if(!is_empty) {
+					/* Tile 0 is the empty tile. */
+					grid[tile] = ++num_used_tiles;
+				}
+			}
+		}
+	}
+
+	return num_used_tiles;
+}
+
+/* Write the sparse storage of dense voxels with the given tile index, sparse
+ * takes texture_sparse_size() elements. */
+template<typename T>
+void texture_sparse_encode(const T *voxels,
+                           size_t width, size_t height, size_t depth,
+                           const vector<int>& grid,
+                           T *sparse)
+{
+	const size_t tile_size = TEX_SPARSE_TILE_SIZE;
+	const size_t tile_voxels = tile_size*tile_size*tile_size;
+	const size_t tiles_x = divide_up(width, tile_size);
+	const size_t tiles_y = divide_up(height, tile_size);
+	const size_t tiles_z = divide_up(depth, tile_size);
+	const size_t grid_size = texture_sparse_grid_size<T>(grid.size());
+
+	/* Tile index and empty tile. */
+	memset(sparse, 0, (grid_size + tile_voxels)*sizeof(T));
+	memcpy(sparse, &grid[0], grid.size()*sizeof(int));
+
+	T *tiles = sparse + grid_size;
+	for(size_t tz = 0, tile = 0; tz < tiles_z; tz++) {
+		for(size_t ty = 0; ty < tiles_y; ty++) {
+			for(size_t tx = 0; tx < tiles_x; tx++, tile++) {
+				if(grid[tile] == 0) {
+					continue;
+				}
+				T *tile_voxel = tiles + grid[tile]*tile_voxels;
+				const size_t x = tx*tile_size;
+				const size_t num_x = min(x + tile_size, width) - x;
+				if(num_x < tile_size ||
+				   (ty+1)*tile_size > height ||
+				   (tz+1)*tile_size > depth)
+				{
+					memset(tile_voxel, 0, tile_voxels*sizeof(T));
+				}
+				for(size_t z = tz*tile_size; z < min((tz+1)*tile_size, depth); z++) {
+					for(size_t y = ty*tile_size; y < min((ty+1)*tile_size, height); y++) {
+						const size_t local = ((z - tz*tile_size)*tile_size + (y - ty*tile_size))*tile_size;
+						memcpy(tile_voxel + local,
+						       voxels + (z*height + y)*width + x,
+						       num_x*sizeof(T));
+					}
+				}
+			}
+		}
+	}
+}
+
+CCL_NAMESPACE_END
+
+#endif /* __UTIL_TEXTURE_SPARSE_H__ */
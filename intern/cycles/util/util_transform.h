@@ -138,6 +138,51 @@ ccl_device_inline Transform make_transform_frame(float3 N)
 	                      N.x , N.y,  N.z,  0.0f);
 }
 
+/* Packs the normal of a coordinate frame into 16 bit octahedral coordinates,
+ * see make_transform_frame_packed(). */
+ccl_device_inline uint transform_frame_pack(float3 N)
+{
+	const float inv_sum = 1.0f / (fabsf(N.x) + fabsf(N.y) + fabsf(N.z));
+	float u = N.x * inv_sum;
+	float v = N.y * inv_sum;
+	if(N.z < 0.0f) {
+		const float folded_u = (1.0f - fabsf(v)) * ((u >= 0.0f)? 1.0f: -1.0f);
+		v = (1.0f - fabsf(u)) * ((v >= 0.0f)? 1.0f: -1.0f);
+		u = folded_u;
+	}
+	const uint pu = (uint)(clamp(u, -1.0f, 1.0f) * 32767.0f + 32767.5f);
+	const uint pv = (uint)(clamp(v, -1.0f, 1.0f) * 32767.0f + 32767.5f);
+	return pu | (pv << 16);
+}
+
+/* Constructs a coordinate frame like make_transform_frame(), from a normal
+ * packed with transform_frame_pack(). The tangent is chosen by comparing the
+ * packed coordinates, which are exact, so all devices get the same frame. */
+ccl_device_inline Transform make_transform_frame_packed(uint packed)
+{
+	const float u = (float)(packed & 0xffff) - 32767.0f;
+	const float v = (float)(packed >> 16) - 32767.0f;
+	const float au = fabsf(u), av = fabsf(v);
+	const float z = 32767.0f - au - av;
+	float3 N;
+	if(z >= 0.0f) {
+		N = make_float3(u, v, z);
+	}
+	else {
+		N = make_float3((u >= 0.0f)? 32767.0f - av: av - 32767.0f,
+		                (v >= 0.0f)? 32767.0f - au: au - 32767.0f,
+		                z);
+	}
+	N = normalize(N);
+	/* |N.y| > |N.x| exactly when av > au, for both hemispheres. */
+	const float3 dx = normalize((av > au)? make_float3(0.0f, -N.z, N.y):
+	                                       make_float3(N.z, 0.0f, -N.x));
+	const float3 dy = normalize(cross(N, dx));
+	return make_transform(dx.x, dx.y, dx.z, 0.0f,
+	                      dy.x, dy.y, dy.z, 0.0f,
+	                      N.x , N.y,  N.z,  0.0f);
+}
+
 #ifndef __KERNEL_GPU__
 
 ccl_device_inline Transform operator*(const Transform a, const Transform b)
@@ -74,6 +74,11 @@ typedef struct GHashIterState {
 enum {
 	GHASH_FLAG_ALLOW_DUPES  = (1 << 0),  /* Only checked for in debug mode */
 	GHASH_FLAG_ALLOW_SHRINK = (1 << 1),  /* Allow to shrink buckets' size. */
+	/* Store entries inline in a flat array of slots (Robin Hood hashing) instead of chained buckets,
+	 * cheaper lookups since no pointers are chased, but entries move on insertion & removal:
+	 * pointers from #BLI_ghash_lookup_p & #BLI_ghash_ensure_p (and friends) are only valid until then.
+	 * Degenerate hash functions make it fall back to chained buckets (clearing the flag). */
+	GHASH_FLAG_OPEN_ADDRESSING = (1 << 2),
 
 #ifdef GHASH_INTERNAL_API
 	/* Internal usage only */
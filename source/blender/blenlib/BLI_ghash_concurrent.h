@@ -0,0 +1,80 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+#ifndef __BLI_GHASH_CONCURRENT_H__
+#define __BLI_GHASH_CONCURRENT_H__
+
+/** \file BLI_ghash_concurrent.h
+ *  \ingroup bli
+ *
+ * A hash-map which can be accessed from multiple threads at once,
+ * to replace a #GHash guarded by a single mutex in threaded code.
+ *
+ * Entries are spread over a fixed number of shards, each one a #GHash with its own lock,
+ * so threads only wait for each other when they happen to access the same shard.
+ */
+
+#include "BLI_compiler_attrs.h"
+#include "BLI_ghash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct GHashConcurrent GHashConcurrent;
+
+/** Creates the value of a key added by #BLI_ghash_concurrent_ensure. */
+typedef void *(*GHashConcurrentValCreateFP)(void *userdata, const void *key);
+/** Called for every entry by #BLI_ghash_concurrent_foreach. */
+typedef void  (*GHashConcurrentForeachFP)(void *userdata, void *key, void *val);
+
+GHashConcurrent *BLI_ghash_concurrent_new_ex(
+        GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info,
+        const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+GHashConcurrent *BLI_ghash_concurrent_new(
+        GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void   BLI_ghash_concurrent_free(GHashConcurrent *cgh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+
+/* Thread-safe. */
+bool   BLI_ghash_concurrent_add(GHashConcurrent *cgh, void *key, void *val);
+void  *BLI_ghash_concurrent_ensure(
+        GHashConcurrent *cgh, void *key,
+        GHashConcurrentValCreateFP createfp, void *userdata, bool *r_added);
+void  *BLI_ghash_concurrent_lookup(GHashConcurrent *cgh, const void *key) ATTR_WARN_UNUSED_RESULT;
+bool   BLI_ghash_concurrent_haskey(GHashConcurrent *cgh, const void *key) ATTR_WARN_UNUSED_RESULT;
+bool   BLI_ghash_concurrent_remove(
+        GHashConcurrent *cgh, const void *key, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+unsigned int BLI_ghash_concurrent_len(GHashConcurrent *cgh) ATTR_WARN_UNUSED_RESULT;
+
+/* Not thread-safe against modifications. */
+void   BLI_ghash_concurrent_foreach(
+        GHashConcurrent *cgh, GHashConcurrentForeachFP func, void *userdata,
+        const bool use_threading);
+
+/* For testing, debugging only */
+#ifdef GHASH_INTERNAL_API
+int    BLI_ghash_concurrent_buckets_len(GHashConcurrent *cgh);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __BLI_GHASH_CONCURRENT_H__ */
@@ -84,6 +84,12 @@ enum {
 	 * \note order of iteration is only assured to be the order of allocation when no chunks have been freed.
 	 */
 	BLI_MEMPOOL_ALLOW_ITER = (1 << 0),
+	/** allow allocating and freeing from multiple threads at once.
+	 *
+	 * \note each thread keeps its own list of free elements, taken from the pool a chunk at a time.
+	 * \note chunks are only released by #BLI_mempool_clear & #BLI_mempool_destroy, which are not thread-safe.
+	 */
+	BLI_MEMPOOL_THREADSAFE = (1 << 1),
 };
 
 void  BLI_mempool_iternew(BLI_mempool *pool, BLI_mempool_iter *iter) ATTR_NONNULL();
@@ -41,8 +41,9 @@ struct BLI_mempool;
 
 /* Task Scheduler
  * 
- * Central scheduler that holds running threads ready to execute tasks. A single
- * queue holds the task from all pools.
+ * Central scheduler that holds running threads ready to execute tasks. Every
+ * thread has its own queue of tasks it pushed, idle threads steal tasks from
+ * the queues of other threads.
  *
  * Init/exit must be called before/after any task pools are created/freed, and
  * must be called from the main threads. All other scheduler and pool functions
@@ -72,6 +73,11 @@ int BLI_task_scheduler_num_threads(TaskScheduler *scheduler);
  * pool with smaller tasks. When other threads are busy they will continue
  * working on their own tasks, if not they will join in, no new threads will
  * be launched.
+ *
+ * A nested pool belongs to the task group of the pool whose task created it.
+ * Threads waiting for a pool also run tasks of its group instead of sleeping,
+ * so nested parallel loops keep all threads busy. Nested pools must be freed
+ * before the task which created them returns.
  */
 
 typedef enum TaskPriority {
@@ -110,9 +116,8 @@ void *BLI_task_pool_userdata(TaskPool *pool);
 /* optional mutex to use from run function */
 ThreadMutex *BLI_task_pool_user_mutex(TaskPool *pool);
 
-/* Delayed push, use that to reduce thread overhead by accumulating
- * all new tasks into local queue first and pushing it to scheduler
- * from within a single mutex lock.
+/* Delayed push, use that to reduce thread overhead when pushing many
+ * tasks at once, sleeping threads are only woken up once at the end.
  */
 void BLI_task_pool_delayed_push_begin(TaskPool *pool, int thread_id);
 void BLI_task_pool_delayed_push_end(TaskPool *pool, int thread_id);
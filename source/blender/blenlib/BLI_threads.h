@@ -64,6 +64,7 @@ void    BLI_threadpool_remove_index(struct ListBase *threadbase, int index);
 void    BLI_threadpool_clear(struct ListBase *threadbase);
 void    BLI_threadpool_end(struct ListBase *threadbase);
 int     BLI_thread_is_main(void);
+unsigned int BLI_thread_index(void);
 
 
 void BLI_threaded_malloc_begin(void);
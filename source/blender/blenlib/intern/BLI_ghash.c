@@ -31,6 +31,9 @@
  * A general (pointer -> pointer) chaining hash table
  * for 'Abstract Data Types' (known as an ADT Hash Table).
  *
+ * Hashes using #GHASH_FLAG_OPEN_ADDRESSING store their entries inline in an array of slots instead,
+ * see the 'Open Addressing Internal API' below.
+ *
  * \note edgehash.c is based on this, make sure they stay in sync.
  */
 
@@ -105,6 +108,26 @@ typedef Entry GSetEntry;
 #define GHASH_ENTRY_SIZE(_is_gset) \
 	((_is_gset) ? sizeof(GSetEntry) : sizeof(GHashEntry))
 
+/* WARNING! Keep 'key' & 'val' in sync with ugly _gh_Entry in header too,
+ * iterators point directly to the slots of open addressing hashes. */
+typedef struct OpenEntry {
+	uintptr_t hash;  /* Full hash of the key, same size as #Entry.next. */
+
+	void *key;
+	void *val;  /* Unused (NULL) for GSet. */
+} OpenEntry;
+
+BLI_STATIC_ASSERT(sizeof(OpenEntry) == sizeof(GHashEntry), "Invalid 'OpenEntry' size");
+
+#define GHASH_OPEN_BIT_MIN 3
+#define GHASH_OPEN_BIT_MAX 28u
+/* Growing further rarely helps when probe distances overflow, keys then share most of their hash. */
+#define GHASH_OPEN_RESIZE_BIT_RETRY 2u
+/* Probe distances are stored one based, zero is an empty slot. */
+#define GHASH_OPEN_DIST_MAX UINT16_MAX
+
+#define GHASH_IS_OPEN(_gh) (((_gh)->flag & GHASH_FLAG_OPEN_ADDRESSING) != 0)
+
 struct GHash {
 	GHashHashFP hashfp;
 	GHashCmpFP cmpfp;
@@ -119,12 +142,369 @@ struct GHash {
 	uint bucket_mask, bucket_bit, bucket_bit_min;
 #endif
 
+	/* Used instead of 'buckets' & 'entrypool' with #GHASH_FLAG_OPEN_ADDRESSING,
+	 * 'nbuckets' is then the number of slots. */
+	OpenEntry *slots;
+	uint16_t *slot_dists;
+	uint slot_bit, slot_bit_min;
+
 	uint nentries;
 	uint flag;
 };
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Open Addressing Internal API
+ *
+ * Storage used by #GHASH_FLAG_OPEN_ADDRESSING: Robin Hood hashing with linear probing
+ * in a power of two array of slots. Keys and values are stored in the slots themselves,
+ * so a lookup reads one or two adjacent cache lines instead of following a chain of mempool entries.
+ *
+ * The probe distance of each slot is kept in a separate, compact array.
+ * Robin Hood insertion keeps those distances short and even, and a lookup can stop
+ * as soon as it reaches a slot closer to its home than the key would be.
+ * Removal shifts the following entries back, so no tombstones are needed.
+ * \{ */
+
+/**
+ * Get the home slot of an already-computed full hash.
+ */
+BLI_INLINE uint ghash_open_home_index(GHash *gh, const uint hash)
+{
+	/* Fibonacci hashing, otherwise power of two sizes only use the lowest bits
+	 * of weak hashes (like #BLI_ghashutil_ptrhash). */
+	return (hash * 2654435769u) >> (32 - gh->slot_bit);
+}
+
+BLI_INLINE uint ghash_open_next_index(GHash *gh, const uint index)
+{
+	return (index + 1) & (gh->nbuckets - 1);
+}
+
+/**
+ * Find the index of next used slot, starting from \a index (\a gh is assumed non-empty).
+ */
+BLI_INLINE uint ghash_open_find_next_index(GHash *gh, uint index)
+{
+	if (index >= gh->nbuckets) {
+		index = 0;
+	}
+	while (gh->slot_dists[index] == 0) {
+		index = ghash_open_next_index(gh, index);
+	}
+	return index;
+}
+
+BLI_INLINE OpenEntry *ghash_open_lookup_entry_ex(
+        GHash *gh, const void *key, const uint hash)
+{
+	uint index = ghash_open_home_index(gh, hash);
+
+	for (uint dist = 1; dist <= gh->slot_dists[index]; dist++) {
+		OpenEntry *e = &gh->slots[index];
+		if (((uint)e->hash == hash) && UNLIKELY(gh->cmpfp(key, e->key) == false)) {
+			return e;
+		}
+		index = ghash_open_next_index(gh, index);
+	}
+
+	return NULL;
+}
+
+BLI_INLINE OpenEntry *ghash_open_lookup_entry(GHash *gh, const void *key)
+{
+	return ghash_open_lookup_entry_ex(gh, key, gh->hashfp(key));
+}
+
+/**
+ * Place \a carry in the slots (without resizing), \a r_index is set to the slot where it ends up.
+ *
+ * \return false when a probe distance overflows, \a carry is then the entry that still needs a slot
+ * (it may be another entry displaced by the one passed in).
+ */
+static bool ghash_open_place(GHash *gh, OpenEntry *carry, uint *r_index)
+{
+	uint index = ghash_open_home_index(gh, (uint)carry->hash);
+	uint dist = 1;
+
+	*r_index = UINT_MAX;
+
+	for (;;) {
+		const uint dist_slot = gh->slot_dists[index];
+
+		if (dist_slot == 0) {
+			gh->slots[index] = *carry;
+			gh->slot_dists[index] = (uint16_t)dist;
+			if (*r_index == UINT_MAX) {
+				*r_index = index;
+			}
+			return true;
+		}
+		else if (dist_slot < dist) {
+			/* Take the slot of an entry closer to its home, and place that one instead. */
+			SWAP(OpenEntry, *carry, gh->slots[index]);
+			gh->slot_dists[index] = (uint16_t)dist;
+			dist = dist_slot;
+			if (*r_index == UINT_MAX) {
+				*r_index = index;
+			}
+		}
+
+		if (UNLIKELY(++dist > GHASH_OPEN_DIST_MAX)) {
+			return false;
+		}
+		index = ghash_open_next_index(gh, index);
+	}
+}
+
+/**
+ * Re-allocate the slots for `2 ^ slot_bit` entries, optionally placing \a e_extra too.
+ *
+ * \return false when probe distances keep overflowing, the previous slots are then kept unchanged
+ * (without \a e_extra).
+ */
+static bool ghash_open_resize(GHash *gh, uint slot_bit, const OpenEntry *e_extra)
+{
+	OpenEntry *slots_old = gh->slots;
+	uint16_t *slot_dists_old = gh->slot_dists;
+	const uint slot_bit_old = gh->slot_bit;
+	const uint nslots_old = slots_old ? gh->nbuckets : 0;
+	const uint slot_bit_max = MIN2(slot_bit + GHASH_OPEN_RESIZE_BIT_RETRY, GHASH_OPEN_BIT_MAX);
+	bool ok;
+
+	BLI_assert(slot_bit <= GHASH_OPEN_BIT_MAX);
+
+	do {
+		uint index;
+
+		gh->slot_bit = slot_bit;
+		gh->nbuckets = 1u << slot_bit;
+		gh->slots = MEM_mallocN(sizeof(*gh->slots) * gh->nbuckets, __func__);
+		gh->slot_dists = MEM_callocN(sizeof(*gh->slot_dists) * gh->nbuckets, __func__);
+
+		ok = true;
+		for (uint i = 0; ok && (i < nslots_old); i++) {
+			if (slot_dists_old[i]) {
+				OpenEntry carry = slots_old[i];
+				ok = ghash_open_place(gh, &carry, &index);
+			}
+		}
+		if (ok && e_extra) {
+			OpenEntry carry = *e_extra;
+			ok = ghash_open_place(gh, &carry, &index);
+		}
+
+		if (UNLIKELY(!ok)) {
+			/* Only happens with degenerate hashes, spread them over more slots. */
+			MEM_freeN(gh->slots);
+			MEM_freeN(gh->slot_dists);
+
+			if (slot_bit == slot_bit_max) {
+				gh->slots = slots_old;
+				gh->slot_dists = slot_dists_old;
+				gh->slot_bit = slot_bit_old;
+				gh->nbuckets = 1u << slot_bit_old;
+				return false;
+			}
+			slot_bit++;
+		}
+	} while (!ok);
+
+	gh->limit_grow   = GHASH_LIMIT_GROW(gh->nbuckets);
+	gh->limit_shrink = GHASH_LIMIT_SHRINK(gh->nbuckets);
+
+	if (slots_old) {
+		MEM_freeN(slots_old);
+		MEM_freeN(slot_dists_old);
+	}
+
+	return true;
+}
+
+/**
+ * Open addressing version of #ghash_buckets_expand.
+ */
+static void ghash_open_expand(
+        GHash *gh, const uint nentries, const bool user_defined)
+{
+	uint slot_bit = gh->slot_bit;
+
+	if (LIKELY(gh->slots && (nentries <= gh->limit_grow))) {
+		return;
+	}
+
+	while ((nentries > GHASH_LIMIT_GROW(1u << slot_bit)) &&
+	       (slot_bit < GHASH_OPEN_BIT_MAX))
+	{
+		slot_bit++;
+	}
+
+	if (user_defined) {
+		gh->slot_bit_min = slot_bit;
+	}
+
+	if ((slot_bit == gh->slot_bit) && gh->slots) {
+		return;
+	}
+
+	/* On failure the current slots are kept, only the load is higher than intended. */
+	ghash_open_resize(gh, slot_bit, NULL);
+}
+
+/**
+ * Open addressing version of #ghash_buckets_contract.
+ */
+static void ghash_open_contract(
+        GHash *gh, const uint nentries, const bool user_defined, const bool force_shrink)
+{
+	uint slot_bit = gh->slot_bit;
+
+	if (!(force_shrink || (gh->flag & GHASH_FLAG_ALLOW_SHRINK))) {
+		return;
+	}
+
+	if (LIKELY(gh->slots && (nentries > gh->limit_shrink))) {
+		return;
+	}
+
+	while ((nentries < GHASH_LIMIT_SHRINK(1u << slot_bit)) &&
+	       (slot_bit > gh->slot_bit_min))
+	{
+		slot_bit--;
+	}
+
+	if (user_defined) {
+		gh->slot_bit_min = slot_bit;
+	}
+
+	if ((slot_bit == gh->slot_bit) && gh->slots) {
+		return;
+	}
+
+	/* On failure the current slots are kept, only the load is higher than intended. */
+	ghash_open_resize(gh, slot_bit, NULL);
+}
+
+/**
+ * Clear and reset \a gh slots, reserve again slots for given number of entries.
+ */
+static void ghash_open_reset(GHash *gh, const uint nentries)
+{
+	MEM_SAFE_FREE(gh->slots);
+	MEM_SAFE_FREE(gh->slot_dists);
+
+	gh->slot_bit = GHASH_OPEN_BIT_MIN;
+	gh->slot_bit_min = GHASH_OPEN_BIT_MIN;
+	gh->nbuckets = 1u << gh->slot_bit;
+
+	gh->limit_grow   = GHASH_LIMIT_GROW(gh->nbuckets);
+	gh->limit_shrink = GHASH_LIMIT_SHRINK(gh->nbuckets);
+
+	gh->nentries = 0;
+
+	ghash_open_expand(gh, nentries, (nentries != 0));
+}
+
+static OpenEntry *ghash_open_insert_fallback(GHash *gh, void *key, const uint hash, const OpenEntry *carry);
+
+/**
+ * Add \a key to the slots and return its entry, the caller sets the value (never for a GSet).
+ *
+ * \warning Entries move on insertion and removal, the returned pointer is only valid until then.
+ */
+static OpenEntry *ghash_open_insert_ex(GHash *gh, void *key, const uint hash)
+{
+	OpenEntry carry = {hash, key, NULL};
+	uint index;
+
+	BLI_assert((gh->flag & GHASH_FLAG_ALLOW_DUPES) || (BLI_ghash_haskey(gh, key) == 0));
+
+	ghash_open_expand(gh, gh->nentries + 1, false);
+	gh->nentries++;
+
+	if (UNLIKELY(!ghash_open_place(gh, &carry, &index))) {
+		if (UNLIKELY(gh->slot_bit == GHASH_OPEN_BIT_MAX) ||
+		    UNLIKELY(!ghash_open_resize(gh, gh->slot_bit + 1, &carry)))
+		{
+			return ghash_open_insert_fallback(gh, key, hash, &carry);
+		}
+		return ghash_open_lookup_entry_ex(gh, key, hash);
+	}
+
+	return &gh->slots[index];
+}
+
+BLI_INLINE bool ghash_open_insert_safe(
+        GHash *gh, void *key, void *val, const bool override,
+        GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	const uint hash = gh->hashfp(key);
+	OpenEntry *e = ghash_open_lookup_entry_ex(gh, key, hash);
+
+	if (e) {
+		if (override) {
+			if (keyfreefp) {
+				keyfreefp(e->key);
+			}
+			if (valfreefp) {
+				valfreefp(e->val);
+			}
+			e->key = key;
+			e->val = val;
+		}
+		return false;
+	}
+	else {
+		OpenEntry *e_new = ghash_open_insert_ex(gh, key, hash);
+		if (!(gh->flag & GHASH_FLAG_IS_GSET)) {
+			e_new->val = val;
+		}
+		return true;
+	}
+}
+
+/**
+ * Remove the entry \a e, shifting back the following entries of the probe sequence.
+ */
+static void ghash_open_remove_entry(GHash *gh, OpenEntry *e)
+{
+	uint index = (uint)(e - gh->slots);
+	uint index_next = ghash_open_next_index(gh, index);
+
+	while (gh->slot_dists[index_next] > 1) {
+		gh->slots[index] = gh->slots[index_next];
+		gh->slot_dists[index] = (uint16_t)(gh->slot_dists[index_next] - 1);
+		index = index_next;
+		index_next = ghash_open_next_index(gh, index);
+	}
+	gh->slot_dists[index] = 0;
+
+	ghash_open_contract(gh, --gh->nentries, false, false);
+}
+
+/**
+ * Run free callbacks for freeing entries.
+ */
+static void ghash_open_free_cb(
+        GHash *gh,
+        GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	for (uint i = 0; i < gh->nbuckets; i++) {
+		if (gh->slot_dists[i]) {
+			OpenEntry *e = &gh->slots[i];
+			if (keyfreefp) {
+				keyfreefp(e->key);
+			}
+			if (valfreefp) {
+				valfreefp(e->val);
+			}
+		}
+	}
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Internal Utility API
  * \{ */
@@ -446,14 +826,38 @@ static GHash *ghash_new(
 	gh->cmpfp = cmpfp;
 
 	gh->buckets = NULL;
+	gh->slots = NULL;
+	gh->slot_dists = NULL;
 	gh->flag = flag;
 
-	ghash_buckets_reset(gh, nentries_reserve);
-	gh->entrypool = BLI_mempool_create(GHASH_ENTRY_SIZE(flag & GHASH_FLAG_IS_GSET), 64, 64, BLI_MEMPOOL_NOP);
+	if (flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		gh->entrypool = NULL;
+		ghash_open_reset(gh, nentries_reserve);
+	}
+	else {
+		ghash_buckets_reset(gh, nentries_reserve);
+		gh->entrypool = BLI_mempool_create(GHASH_ENTRY_SIZE(flag & GHASH_FLAG_IS_GSET), 64, 64, BLI_MEMPOOL_NOP);
+	}
 
 	return gh;
 }
 
+/**
+ * Free the buckets and entries (or slots) of \a gh, but not \a gh itself.
+ */
+static void ghash_storage_free(GHash *gh)
+{
+	if (GHASH_IS_OPEN(gh)) {
+		MEM_SAFE_FREE(gh->slots);
+		MEM_SAFE_FREE(gh->slot_dists);
+	}
+	else {
+		BLI_assert((int)gh->nentries == BLI_mempool_len(gh->entrypool));
+		MEM_freeN(gh->buckets);
+		BLI_mempool_destroy(gh->entrypool);
+	}
+}
+
 /**
  * Internal insert function.
  * Takes hash and bucket_index arguments to avoid calling #ghash_keyhash and #ghash_bucket_index multiple times.
@@ -520,6 +924,11 @@ BLI_INLINE bool ghash_insert_safe(
         GHash *gh, void *key, void *val, const bool override,
         GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
 {
+	if (GHASH_IS_OPEN(gh)) {
+		BLI_assert(!(gh->flag & GHASH_FLAG_IS_GSET));
+		return ghash_open_insert_safe(gh, key, val, override, keyfreefp, valfreefp);
+	}
+
 	const uint hash = ghash_keyhash(gh, key);
 	const uint bucket_index = ghash_bucket_index(gh, hash);
 	GHashEntry *e = (GHashEntry *)ghash_lookup_entry_ex(gh, key, bucket_index);
@@ -549,6 +958,11 @@ BLI_INLINE bool ghash_insert_safe_keyonly(
         GHash *gh, void *key, const bool override,
         GHashKeyFreeFP keyfreefp)
 {
+	if (GHASH_IS_OPEN(gh)) {
+		BLI_assert((gh->flag & GHASH_FLAG_IS_GSET) != 0);
+		return ghash_open_insert_safe(gh, key, NULL, override, keyfreefp, NULL);
+	}
+
 	const uint hash = ghash_keyhash(gh, key);
 	const uint bucket_index = ghash_bucket_index(gh, hash);
 	Entry *e = ghash_lookup_entry_ex(gh, key, bucket_index);
@@ -614,6 +1028,8 @@ static Entry *ghash_pop(GHash *gh, GHashIterState *state)
 		return NULL;
 	}
 
+	BLI_assert(!GHASH_IS_OPEN(gh));
+
 	/* Note: using first_bucket_index here allows us to avoid potential huge number of loops over buckets,
 	 *       in case we are popping from a large ghash with few items in it... */
 	curr_bucket = ghash_find_next_bucket_index(gh, curr_bucket);
@@ -627,6 +1043,25 @@ static Entry *ghash_pop(GHash *gh, GHashIterState *state)
 	return e;
 }
 
+/**
+ * Open addressing version of #ghash_pop, entries are not allocated so the key and value are returned.
+ */
+static bool ghash_open_pop(GHash *gh, GHashIterState *state, void **r_key, void **r_val)
+{
+	if (gh->nentries == 0) {
+		return false;
+	}
+
+	state->curr_bucket = ghash_open_find_next_index(gh, state->curr_bucket);
+
+	OpenEntry *e = &gh->slots[state->curr_bucket];
+	*r_key = e->key;
+	*r_val = e->val;
+
+	ghash_open_remove_entry(gh, e);
+	return true;
+}
+
 /**
  * Run free callbacks for freeing entries.
  */
@@ -639,6 +1074,11 @@ static void ghash_free_cb(
 	BLI_assert(keyfreefp  || valfreefp);
 	BLI_assert(!valfreefp || !(gh->flag & GHASH_FLAG_IS_GSET));
 
+	if (GHASH_IS_OPEN(gh)) {
+		ghash_open_free_cb(gh, keyfreefp, valfreefp);
+		return;
+	}
+
 	for (i = 0; i < gh->nbuckets; i++) {
 		Entry *e;
 
@@ -666,6 +1106,26 @@ static GHash *ghash_copy(GHash *gh, GHashKeyCopyFP keycopyfp, GHashValCopyFP val
 	BLI_assert(!valcopyfp || !(gh->flag & GHASH_FLAG_IS_GSET));
 
 	gh_new = ghash_new(gh->hashfp, gh->cmpfp, __func__, 0, gh->flag);
+
+	if (GHASH_IS_OPEN(gh)) {
+		/* Same number of slots, so entries can be copied in place. */
+		ghash_open_resize(gh_new, gh->slot_bit, NULL);
+		memcpy(gh_new->slot_dists, gh->slot_dists, sizeof(*gh->slot_dists) * gh->nbuckets);
+
+		for (i = 0; i < gh->nbuckets; i++) {
+			if (gh->slot_dists[i]) {
+				const OpenEntry *e = &gh->slots[i];
+				OpenEntry *e_new = &gh_new->slots[i];
+				e_new->hash = e->hash;
+				e_new->key = (keycopyfp) ? keycopyfp(e->key) : e->key;
+				e_new->val = (valcopyfp) ? valcopyfp(e->val) : e->val;
+			}
+		}
+		gh_new->nentries = gh->nentries;
+
+		return gh_new;
+	}
+
 	ghash_buckets_expand(gh_new, reserve_nentries_new, false);
 
 	BLI_assert(gh_new->nbuckets == gh->nbuckets);
@@ -691,6 +1151,86 @@ static GHash *ghash_copy(GHash *gh, GHashKeyCopyFP keycopyfp, GHashValCopyFP val
 	return gh_new;
 }
 
+/**
+ * \return the number of entries reserved with #BLI_ghash_reserve (or on creation), zero when none.
+ */
+static uint ghash_reserve_get(GHash *gh)
+{
+	if (GHASH_IS_OPEN(gh)) {
+		return (gh->slot_bit_min > GHASH_OPEN_BIT_MIN) ? GHASH_LIMIT_GROW(1u << gh->slot_bit_min) : 0;
+	}
+#ifdef GHASH_USE_MODULO_BUCKETS
+	return (gh->size_min > 0) ? GHASH_LIMIT_GROW(hashsizes[gh->size_min]) : 0;
+#else
+	return (gh->bucket_bit_min > GHASH_BUCKET_BIT_MIN) ? GHASH_LIMIT_GROW(1u << gh->bucket_bit_min) : 0;
+#endif
+}
+
+/**
+ * Move all entries of \a gh to the storage matching \a flag (chained buckets or open addressing),
+ * keeping the reserved size.
+ */
+static void ghash_storage_convert(GHash *gh, const uint flag)
+{
+	GHash *gh_new = ghash_new(gh->hashfp, gh->cmpfp, __func__, ghash_reserve_get(gh), flag);
+	const bool is_gset = (gh->flag & GHASH_FLAG_IS_GSET) != 0;
+	GHashIterator gh_iter;
+
+	if (GHASH_IS_OPEN(gh_new)) {
+		ghash_open_expand(gh_new, gh->nentries, false);
+	}
+	else {
+		ghash_buckets_expand(gh_new, gh->nentries, false);
+	}
+
+	GHASH_ITER (gh_iter, gh) {
+		void *key = BLI_ghashIterator_getKey(&gh_iter);
+		/* Chained GSet entries have no value. */
+		void *val = is_gset ? NULL : BLI_ghashIterator_getValue(&gh_iter);
+		const uint hash = ghash_keyhash(gh_new, key);
+
+		if (GHASH_IS_OPEN(gh_new)) {
+			OpenEntry *e_new = ghash_open_insert_ex(gh_new, key, hash);
+			if (!is_gset) {
+				e_new->val = val;
+			}
+		}
+		else if (is_gset) {
+			ghash_insert_ex_keyonly(gh_new, key, ghash_bucket_index(gh_new, hash));
+		}
+		else {
+			ghash_insert_ex(gh_new, key, val, ghash_bucket_index(gh_new, hash));
+		}
+	}
+
+	SWAP(GHash, *gh, *gh_new);
+
+	ghash_storage_free(gh_new);
+	MEM_freeN(gh_new);
+}
+
+/**
+ * Switch \a gh to chained buckets, when a degenerate hash overflows the probe distances
+ * even in the largest table we are willing to allocate.
+ *
+ * \param carry  The entry left over by #ghash_open_place, not in the slots (but counted).
+ * \return the entry of \a key, its key (and value for a GHash) are at the same offsets as in #OpenEntry.
+ */
+static OpenEntry *ghash_open_insert_fallback(GHash *gh, void *key, const uint hash, const OpenEntry *carry)
+{
+	gh->nentries--;
+	ghash_storage_convert(gh, gh->flag & ~(uint)GHASH_FLAG_OPEN_ADDRESSING);
+
+	if (gh->flag & GHASH_FLAG_IS_GSET) {
+		ghash_insert_ex_keyonly(gh, carry->key, ghash_bucket_index(gh, (uint)carry->hash));
+	}
+	else {
+		ghash_insert_ex(gh, carry->key, carry->val, ghash_bucket_index(gh, (uint)carry->hash));
+	}
+
+	return (OpenEntry *)ghash_lookup_entry_ex(gh, key, ghash_bucket_index(gh, hash));
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -735,6 +1275,12 @@ GHash *BLI_ghash_copy(GHash *gh, GHashKeyCopyFP keycopyfp, GHashValCopyFP valcop
  */
 void BLI_ghash_reserve(GHash *gh, const uint nentries_reserve)
 {
+	if (GHASH_IS_OPEN(gh)) {
+		ghash_open_expand(gh, nentries_reserve, true);
+		ghash_open_contract(gh, nentries_reserve, true, false);
+		return;
+	}
+
 	ghash_buckets_expand(gh, nentries_reserve, true);
 	ghash_buckets_contract(gh, nentries_reserve, true, false);
 }
@@ -756,6 +1302,12 @@ uint BLI_ghash_len(GHash *gh)
  */
 void BLI_ghash_insert(GHash *gh, void *key, void *val)
 {
+	if (GHASH_IS_OPEN(gh)) {
+		BLI_assert(!(gh->flag & GHASH_FLAG_IS_GSET));
+		ghash_open_insert_ex(gh, key, ghash_keyhash(gh, key))->val = val;
+		return;
+	}
+
 	ghash_insert(gh, key, val);
 }
 
@@ -780,6 +1332,16 @@ bool BLI_ghash_reinsert(GHash *gh, void *key, void *val, GHashKeyFreeFP keyfreef
  */
 void *BLI_ghash_replace_key(GHash *gh, void *key)
 {
+	if (GHASH_IS_OPEN(gh)) {
+		OpenEntry *e = ghash_open_lookup_entry(gh, key);
+		if (e != NULL) {
+			void *key_prev = e->key;
+			e->key = key;
+			return key_prev;
+		}
+		return NULL;
+	}
+
 	const uint hash = ghash_keyhash(gh, key);
 	const uint bucket_index = ghash_bucket_index(gh, hash);
 	GHashEntry *e = (GHashEntry *)ghash_lookup_entry_ex(gh, key, bucket_index);
@@ -804,6 +1366,12 @@ void *BLI_ghash_replace_key(GHash *gh, void *key)
  */
 void *BLI_ghash_lookup(GHash *gh, const void *key)
 {
+	if (GHASH_IS_OPEN(gh)) {
+		OpenEntry *e = ghash_open_lookup_entry(gh, key);
+		BLI_assert(!(gh->flag & GHASH_FLAG_IS_GSET));
+		return e ? e->val : NULL;
+	}
+
 	GHashEntry *e = (GHashEntry *)ghash_lookup_entry(gh, key);
 	BLI_assert(!(gh->flag & GHASH_FLAG_IS_GSET));
 	return e ? e->val : NULL;
@@ -814,6 +1382,12 @@ void *BLI_ghash_lookup(GHash *gh, const void *key)
  */
 void *BLI_ghash_lookup_default(GHash *gh, const void *key, void *val_default)
 {
+	if (GHASH_IS_OPEN(gh)) {
+		OpenEntry *e = ghash_open_lookup_entry(gh, key);
+		BLI_assert(!(gh->flag & GHASH_FLAG_IS_GSET));
+		return e ? e->val : val_default;
+	}
+
 	GHashEntry *e = (GHashEntry *)ghash_lookup_entry(gh, key);
 	BLI_assert(!(gh->flag & GHASH_FLAG_IS_GSET));
 	return e ? e->val : val_default;
@@ -828,9 +1402,17 @@ void *BLI_ghash_lookup_default(GHash *gh, const void *key, void *val_default)
  * \note This has 2 main benefits over #BLI_ghash_lookup.
  * - A NULL return always means that \a key isn't in \a gh.
  * - The value can be modified in-place without further function calls (faster).
+ *
+ * \warning With #GHASH_FLAG_OPEN_ADDRESSING the pointer is only valid until the next insertion or removal.
  */
 void **BLI_ghash_lookup_p(GHash *gh, const void *key)
 {
+	if (GHASH_IS_OPEN(gh)) {
+		OpenEntry *e = ghash_open_lookup_entry(gh, key);
+		BLI_assert(!(gh->flag & GHASH_FLAG_IS_GSET));
+		return e ? &e->val : NULL;
+	}
+
 	GHashEntry *e = (GHashEntry *)ghash_lookup_entry(gh, key);
 	BLI_assert(!(gh->flag & GHASH_FLAG_IS_GSET));
 	return e ? &e->val : NULL;
@@ -852,6 +1434,19 @@ void **BLI_ghash_lookup_p(GHash *gh, const void *key)
  */
 bool BLI_ghash_ensure_p(GHash *gh, void *key, void ***r_val)
 {
+	if (GHASH_IS_OPEN(gh)) {
+		const uint hash = ghash_keyhash(gh, key);
+		OpenEntry *e = ghash_open_lookup_entry_ex(gh, key, hash);
+		const bool haskey = (e != NULL);
+
+		if (!haskey) {
+			e = ghash_open_insert_ex(gh, key, hash);
+		}
+
+		*r_val = &e->val;
+		return haskey;
+	}
+
 	const uint hash = ghash_keyhash(gh, key);
 	const uint bucket_index = ghash_bucket_index(gh, hash);
 	GHashEntry *e = (GHashEntry *)ghash_lookup_entry_ex(gh, key, bucket_index);
@@ -875,6 +1470,21 @@ bool BLI_ghash_ensure_p(GHash *gh, void *key, void ***r_val)
 bool BLI_ghash_ensure_p_ex(
         GHash *gh, const void *key, void ***r_key, void ***r_val)
 {
+	if (GHASH_IS_OPEN(gh)) {
+		const uint hash = ghash_keyhash(gh, key);
+		OpenEntry *e = ghash_open_lookup_entry_ex(gh, key, hash);
+		const bool haskey = (e != NULL);
+
+		if (!haskey) {
+			e = ghash_open_insert_ex(gh, (void *)key, hash);
+			e->key = NULL;  /* caller must re-assign */
+		}
+
+		*r_key = &e->key;
+		*r_val = &e->val;
+		return haskey;
+	}
+
 	const uint hash = ghash_keyhash(gh, key);
 	const uint bucket_index = ghash_bucket_index(gh, hash);
 	GHashEntry *e = (GHashEntry *)ghash_lookup_entry_ex(gh, key, bucket_index);
@@ -902,6 +1512,22 @@ bool BLI_ghash_ensure_p_ex(
  */
 bool BLI_ghash_remove(GHash *gh, const void *key, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
 {
+	if (GHASH_IS_OPEN(gh)) {
+		OpenEntry *e = ghash_open_lookup_entry(gh, key);
+		BLI_assert(!valfreefp || !(gh->flag & GHASH_FLAG_IS_GSET));
+		if (e) {
+			if (keyfreefp) {
+				keyfreefp(e->key);
+			}
+			if (valfreefp) {
+				valfreefp(e->val);
+			}
+			ghash_open_remove_entry(gh, e);
+			return true;
+		}
+		return false;
+	}
+
 	const uint hash = ghash_keyhash(gh, key);
 	const uint bucket_index = ghash_bucket_index(gh, hash);
 	Entry *e = ghash_remove_ex(gh, key, keyfreefp, valfreefp, bucket_index);
@@ -925,6 +1551,20 @@ bool BLI_ghash_remove(GHash *gh, const void *key, GHashKeyFreeFP keyfreefp, GHas
  */
 void *BLI_ghash_popkey(GHash *gh, const void *key, GHashKeyFreeFP keyfreefp)
 {
+	if (GHASH_IS_OPEN(gh)) {
+		OpenEntry *e = ghash_open_lookup_entry(gh, key);
+		BLI_assert(!(gh->flag & GHASH_FLAG_IS_GSET));
+		if (e) {
+			void *val = e->val;
+			if (keyfreefp) {
+				keyfreefp(e->key);
+			}
+			ghash_open_remove_entry(gh, e);
+			return val;
+		}
+		return NULL;
+	}
+
 	const uint hash = ghash_keyhash(gh, key);
 	const uint bucket_index = ghash_bucket_index(gh, hash);
 	GHashEntry *e = (GHashEntry *)ghash_remove_ex(gh, key, keyfreefp, NULL, bucket_index);
@@ -944,6 +1584,9 @@ void *BLI_ghash_popkey(GHash *gh, const void *key, GHashKeyFreeFP keyfreefp)
  */
 bool BLI_ghash_haskey(GHash *gh, const void *key)
 {
+	if (GHASH_IS_OPEN(gh)) {
+		return (ghash_open_lookup_entry(gh, key) != NULL);
+	}
 	return (ghash_lookup_entry(gh, key) != NULL);
 }
 
@@ -959,6 +1602,15 @@ bool BLI_ghash_pop(
         GHash *gh, GHashIterState *state,
         void **r_key, void **r_val)
 {
+	if (GHASH_IS_OPEN(gh)) {
+		BLI_assert(!(gh->flag & GHASH_FLAG_IS_GSET));
+		if (ghash_open_pop(gh, state, r_key, r_val)) {
+			return true;
+		}
+		*r_key = *r_val = NULL;
+		return false;
+	}
+
 	GHashEntry *e = (GHashEntry *)ghash_pop(gh, state);
 
 	BLI_assert(!(gh->flag & GHASH_FLAG_IS_GSET));
@@ -990,6 +1642,11 @@ void BLI_ghash_clear_ex(
 	if (keyfreefp || valfreefp)
 		ghash_free_cb(gh, keyfreefp, valfreefp);
 
+	if (GHASH_IS_OPEN(gh)) {
+		ghash_open_reset(gh, nentries_reserve);
+		return;
+	}
+
 	ghash_buckets_reset(gh, nentries_reserve);
 	BLI_mempool_clear_ex(gh->entrypool, nentries_reserve ? (int)nentries_reserve : -1);
 }
@@ -1011,20 +1668,26 @@ void BLI_ghash_clear(GHash *gh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfree
  */
 void BLI_ghash_free(GHash *gh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
 {
-	BLI_assert((int)gh->nentries == BLI_mempool_len(gh->entrypool));
 	if (keyfreefp || valfreefp)
 		ghash_free_cb(gh, keyfreefp, valfreefp);
 
-	MEM_freeN(gh->buckets);
-	BLI_mempool_destroy(gh->entrypool);
+	ghash_storage_free(gh);
 	MEM_freeN(gh);
 }
 
 /**
  * Sets a GHash flag.
+ *
+ * \note Setting #GHASH_FLAG_OPEN_ADDRESSING moves existing entries to the new storage,
+ * this is cheapest right after creation.
  */
 void BLI_ghash_flag_set(GHash *gh, uint flag)
 {
+	if ((flag & GHASH_FLAG_OPEN_ADDRESSING) && !GHASH_IS_OPEN(gh)) {
+		/* Sets the flag, unless a degenerate hash made it fall back to chained buckets. */
+		ghash_storage_convert(gh, gh->flag | flag);
+		flag &= ~(uint)GHASH_FLAG_OPEN_ADDRESSING;
+	}
 	gh->flag |= flag;
 }
 
@@ -1033,6 +1696,9 @@ void BLI_ghash_flag_set(GHash *gh, uint flag)
  */
 void BLI_ghash_flag_clear(GHash *gh, uint flag)
 {
+	if ((flag & GHASH_FLAG_OPEN_ADDRESSING) && GHASH_IS_OPEN(gh)) {
+		ghash_storage_convert(gh, gh->flag & ~flag);
+	}
 	gh->flag &= ~flag;
 }
 
@@ -1070,6 +1736,13 @@ void BLI_ghashIterator_init(GHashIterator *ghi, GHash *gh)
 	ghi->gh = gh;
 	ghi->curEntry = NULL;
 	ghi->curBucket = UINT_MAX;  /* wraps to zero */
+	if (GHASH_IS_OPEN(gh)) {
+		if (gh->nentries) {
+			ghi->curBucket = ghash_open_find_next_index(gh, 0);
+			ghi->curEntry = (Entry *)&gh->slots[ghi->curBucket];
+		}
+		return;
+	}
 	if (gh->nentries) {
 		do {
 			ghi->curBucket++;
@@ -1087,7 +1760,17 @@ void BLI_ghashIterator_init(GHashIterator *ghi, GHash *gh)
  */
 void BLI_ghashIterator_step(GHashIterator *ghi)
 {
-	if (ghi->curEntry) {
+	if (ghi->curEntry && GHASH_IS_OPEN(ghi->gh)) {
+		GHash *gh = ghi->gh;
+		ghi->curEntry = NULL;
+		while (++ghi->curBucket < gh->nbuckets) {
+			if (gh->slot_dists[ghi->curBucket]) {
+				ghi->curEntry = (Entry *)&gh->slots[ghi->curBucket];
+				break;
+			}
+		}
+	}
+	else if (ghi->curEntry) {
 		ghi->curEntry = ghi->curEntry->next;
 		while (!ghi->curEntry) {
 			ghi->curBucket++;
@@ -1197,6 +1880,11 @@ uint BLI_gset_len(GSet *gs)
  */
 void BLI_gset_insert(GSet *gs, void *key)
 {
+	if (GHASH_IS_OPEN((GHash *)gs)) {
+		ghash_open_insert_ex((GHash *)gs, key, ghash_keyhash((GHash *)gs, key));
+		return;
+	}
+
 	const uint hash = ghash_keyhash((GHash *)gs, key);
 	const uint bucket_index = ghash_bucket_index((GHash *)gs, hash);
 	ghash_insert_ex_keyonly((GHash *)gs, key, bucket_index);
@@ -1221,6 +1909,11 @@ bool BLI_gset_add(GSet *gs, void *key)
  */
 bool BLI_gset_ensure_p_ex(GSet *gs, const void *key, void ***r_key)
 {
+	if (GHASH_IS_OPEN((GHash *)gs)) {
+		void **r_val;
+		return BLI_ghash_ensure_p_ex((GHash *)gs, key, r_key, &r_val);
+	}
+
 	const uint hash = ghash_keyhash((GHash *)gs, key);
 	const uint bucket_index = ghash_bucket_index((GHash *)gs, hash);
 	GSetEntry *e = (GSetEntry *)ghash_lookup_entry_ex((GHash *)gs, key, bucket_index);
@@ -1268,7 +1961,7 @@ bool BLI_gset_remove(GSet *gs, const void *key, GSetKeyFreeFP keyfreefp)
 
 bool BLI_gset_haskey(GSet *gs, const void *key)
 {
-	return (ghash_lookup_entry((GHash *)gs, key) != NULL);
+	return BLI_ghash_haskey((GHash *)gs, key);
 }
 
 /**
@@ -1282,6 +1975,15 @@ bool BLI_gset_pop(
         GSet *gs, GSetIterState *state,
         void **r_key)
 {
+	if (GHASH_IS_OPEN((GHash *)gs)) {
+		void *val;
+		if (ghash_open_pop((GHash *)gs, (GHashIterState *)state, r_key, &val)) {
+			return true;
+		}
+		*r_key = NULL;
+		return false;
+	}
+
 	GSetEntry *e = (GSetEntry *)ghash_pop((GHash *)gs, (GHashIterState *)state);
 
 	if (e) {
@@ -1317,12 +2019,12 @@ void BLI_gset_free(GSet *gs, GSetKeyFreeFP keyfreefp)
 
 void BLI_gset_flag_set(GSet *gs, uint flag)
 {
-	((GHash *)gs)->flag |= flag;
+	BLI_ghash_flag_set((GHash *)gs, flag);
 }
 
 void BLI_gset_flag_clear(GSet *gs, uint flag)
 {
-	((GHash *)gs)->flag &= ~flag;
+	BLI_ghash_flag_clear((GHash *)gs, flag);
 }
 
 /** \} */
@@ -1339,6 +2041,11 @@ void BLI_gset_flag_clear(GSet *gs, uint flag)
  */
 void *BLI_gset_lookup(GSet *gs, const void *key)
 {
+	if (GHASH_IS_OPEN((GHash *)gs)) {
+		OpenEntry *e = ghash_open_lookup_entry((GHash *)gs, key);
+		return e ? e->key : NULL;
+	}
+
 	Entry *e = ghash_lookup_entry((GHash *)gs, key);
 	return e ? e->key : NULL;
 }
@@ -1349,6 +2056,16 @@ void *BLI_gset_lookup(GSet *gs, const void *key)
  */
 void *BLI_gset_pop_key(GSet *gs, const void *key)
 {
+	if (GHASH_IS_OPEN((GHash *)gs)) {
+		OpenEntry *e = ghash_open_lookup_entry((GHash *)gs, key);
+		if (e) {
+			void *key_ret = e->key;
+			ghash_open_remove_entry((GHash *)gs, e);
+			return key_ret;
+		}
+		return NULL;
+	}
+
 	const uint hash = ghash_keyhash((GHash *)gs, key);
 	const uint bucket_index = ghash_bucket_index((GHash *)gs, hash);
 	Entry *e = ghash_remove_ex((GHash *)gs, key, NULL, NULL, bucket_index);
@@ -1382,6 +2099,24 @@ int BLI_gset_buckets_len(GSet *gs)
 	return BLI_ghash_buckets_len((GHash *)gs);
 }
 
+/**
+ * Number of entries in bucket \a i, with open addressing these are the entries whose home slot is \a i
+ * (counted beforehand in \a open_counts).
+ */
+static uint ghash_bucket_len(GHash *gh, const uint *open_counts, const uint i)
+{
+	uint count = 0;
+
+	if (open_counts) {
+		return open_counts[i];
+	}
+
+	for (Entry *e = gh->buckets[i]; e; e = e->next) {
+		count++;
+	}
+	return count;
+}
+
 /**
  * Measure how well the hash function performs (1.0 is approx as good as random distribution),
  * and return a few other stats like load, variance of the distribution of the entries in the buckets, etc.
@@ -1392,7 +2127,8 @@ double BLI_ghash_calc_quality_ex(
         GHash *gh, double *r_load, double *r_variance,
         double *r_prop_empty_buckets, double *r_prop_overloaded_buckets, int *r_biggest_bucket)
 {
-	double mean;
+	double mean, quality;
+	uint *open_counts = NULL;
 	uint i;
 
 	if (gh->nentries == 0) {
@@ -1415,6 +2151,15 @@ double BLI_ghash_calc_quality_ex(
 		return 0.0;
 	}
 
+	if (GHASH_IS_OPEN(gh)) {
+		open_counts = MEM_callocN(sizeof(*open_counts) * gh->nbuckets, __func__);
+		for (i = 0; i < gh->nbuckets; i++) {
+			if (gh->slot_dists[i]) {
+				open_counts[ghash_open_home_index(gh, (uint)gh->slots[i].hash)]++;
+			}
+		}
+	}
+
 	mean = (double)gh->nentries / (double)gh->nbuckets;
 	if (r_load) {
 		*r_load = mean;
@@ -1429,11 +2174,7 @@ double BLI_ghash_calc_quality_ex(
 		 */
 		double sum = 0.0;
 		for (i = 0; i < gh->nbuckets; i++) {
-			int count = 0;
-			Entry *e;
-			for (e = gh->buckets[i]; e; e = e->next) {
-				count++;
-			}
+			const int count = (int)ghash_bucket_len(gh, open_counts, i);
 			sum += ((double)count - mean) * ((double)count - mean);
 		}
 		*r_variance = sum / (double)(gh->nbuckets - 1);
@@ -1446,11 +2187,7 @@ double BLI_ghash_calc_quality_ex(
 		uint64_t sum_empty = 0;
 
 		for (i = 0; i < gh->nbuckets; i++) {
-			uint64_t count = 0;
-			Entry *e;
-			for (e = gh->buckets[i]; e; e = e->next) {
-				count++;
-			}
+			const uint64_t count = ghash_bucket_len(gh, open_counts, i);
 			if (r_biggest_bucket) {
 				*r_biggest_bucket = max_ii(*r_biggest_bucket, (int)count);
 			}
@@ -1468,9 +2205,15 @@ double BLI_ghash_calc_quality_ex(
 		if (r_prop_empty_buckets) {
 			*r_prop_empty_buckets = (double)sum_empty / (double)gh->nbuckets;
 		}
-		return ((double)sum * (double)gh->nbuckets /
-		        ((double)gh->nentries * (gh->nentries + 2 * gh->nbuckets - 1)));
+		quality = ((double)sum * (double)gh->nbuckets /
+		           ((double)gh->nentries * (gh->nentries + 2 * gh->nbuckets - 1)));
 	}
+
+	if (open_counts) {
+		MEM_freeN(open_counts);
+	}
+
+	return quality;
 }
 double BLI_gset_calc_quality_ex(
         GSet *gs, double *r_load, double *r_variance,
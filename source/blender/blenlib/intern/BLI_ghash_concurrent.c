@@ -0,0 +1,331 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/blenlib/intern/BLI_ghash_concurrent.c
+ *  \ingroup bli
+ *
+ * A sharded hash-map for concurrent access.
+ *
+ * Keys are distributed over #GHASH_CONCURRENT_SHARDS shards, each a regular #GHash protected by a spin-lock.
+ * Critical sections are a single #GHash operation, so with enough shards
+ * threads rarely have to wait, and no lock is ever held while waiting for another one.
+ */
+
+#include <stdlib.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+
+#define GHASH_INTERNAL_API
+#include "BLI_ghash.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "BLI_ghash_concurrent.h"  /* own include */
+
+/* keep last */
+#include "BLI_strict_flags.h"
+
+/* -------------------------------------------------------------------- */
+/** \name Structs & Constants
+ * \{ */
+
+/* Should be well above the number of threads, so the chance of two threads
+ * accessing the same shard at once stays low. */
+#define GHASH_CONCURRENT_SHARDS_BIT 6
+#define GHASH_CONCURRENT_SHARDS (1 << GHASH_CONCURRENT_SHARDS_BIT)
+
+/* Used to keep each shard on its own cache line. */
+#define CACHE_LINE_SIZE 64
+
+typedef struct GHashShard {
+	SpinLock lock;
+	GHash *gh;
+
+	char pad[CACHE_LINE_SIZE - sizeof(SpinLock) - sizeof(GHash *)];
+} GHashShard;
+
+struct GHashConcurrent {
+	GHashHashFP hashfp;
+
+	GHashShard shards[GHASH_CONCURRENT_SHARDS];
+};
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Internal Utility API
+ * \{ */
+
+BLI_INLINE GHashShard *ghash_concurrent_shard(GHashConcurrent *cgh, const void *key)
+{
+	uint hash = cgh->hashfp(key);
+
+	/* Scramble the hash before picking the shard, the shard's own #GHash uses the
+	 * same hash, which would otherwise only use part of its buckets. */
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35u;
+	hash ^= hash >> 16;
+
+	return &cgh->shards[hash >> (32 - GHASH_CONCURRENT_SHARDS_BIT)];
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Public API
+ * \{ */
+
+/**
+ * Creates a new, empty concurrent hash.
+ *
+ * \param nentries_reserve  Optionally reserve the number of members that the hash will hold.
+ */
+GHashConcurrent *BLI_ghash_concurrent_new_ex(
+        GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info,
+        const uint nentries_reserve)
+{
+	GHashConcurrent *cgh = MEM_mallocN(sizeof(*cgh), info);
+	const uint shard_reserve = (nentries_reserve + GHASH_CONCURRENT_SHARDS - 1) / GHASH_CONCURRENT_SHARDS;
+
+	cgh->hashfp = hashfp;
+
+	for (int i = 0; i < GHASH_CONCURRENT_SHARDS; i++) {
+		GHashShard *shard = &cgh->shards[i];
+		BLI_spin_init(&shard->lock);
+		/* Switch the storage while empty, then reserve the open addressing slots directly. */
+		shard->gh = BLI_ghash_new(hashfp, cmpfp, info);
+		BLI_ghash_flag_set(shard->gh, GHASH_FLAG_OPEN_ADDRESSING);
+		if (shard_reserve) {
+			BLI_ghash_reserve(shard->gh, shard_reserve);
+		}
+	}
+
+	return cgh;
+}
+
+/**
+ * Wraps #BLI_ghash_concurrent_new_ex with zero entries reserved.
+ */
+GHashConcurrent *BLI_ghash_concurrent_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info)
+{
+	return BLI_ghash_concurrent_new_ex(hashfp, cmpfp, info, 0);
+}
+
+/**
+ * Frees the hash and its members, no other thread may access it anymore.
+ */
+void BLI_ghash_concurrent_free(GHashConcurrent *cgh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	for (int i = 0; i < GHASH_CONCURRENT_SHARDS; i++) {
+		GHashShard *shard = &cgh->shards[i];
+		BLI_ghash_free(shard->gh, keyfreefp, valfreefp);
+		BLI_spin_end(&shard->lock);
+	}
+
+	MEM_freeN(cgh);
+}
+
+/**
+ * Insert a key/value pair unless \a key is already in \a cgh.
+ *
+ * \returns true if the pair has been added.
+ */
+bool BLI_ghash_concurrent_add(GHashConcurrent *cgh, void *key, void *val)
+{
+	GHashShard *shard = ghash_concurrent_shard(cgh, key);
+	void **val_p;
+	bool haskey;
+
+	BLI_spin_lock(&shard->lock);
+	haskey = BLI_ghash_ensure_p(shard->gh, key, &val_p);
+	if (!haskey) {
+		*val_p = val;
+	}
+	BLI_spin_unlock(&shard->lock);
+
+	return !haskey;
+}
+
+/**
+ * Lookup the value of \a key, adding it with a value from \a createfp if it isn't in \a cgh yet.
+ *
+ * \a createfp runs while the shard is locked, so it is called once per key even when
+ * several threads ensure the same key, it must not access \a cgh itself.
+ *
+ * \param r_added  Optionally set to true when \a key has been added.
+ * \returns the value of \a key.
+ */
+void *BLI_ghash_concurrent_ensure(
+        GHashConcurrent *cgh, void *key,
+        GHashConcurrentValCreateFP createfp, void *userdata, bool *r_added)
+{
+	GHashShard *shard = ghash_concurrent_shard(cgh, key);
+	void **val_p;
+	void *val;
+	bool haskey;
+
+	BLI_spin_lock(&shard->lock);
+	haskey = BLI_ghash_ensure_p(shard->gh, key, &val_p);
+	if (!haskey) {
+		*val_p = createfp(userdata, key);
+	}
+	val = *val_p;
+	BLI_spin_unlock(&shard->lock);
+
+	if (r_added) {
+		*r_added = !haskey;
+	}
+	return val;
+}
+
+/**
+ * Lookup the value of \a key in \a cgh.
+ *
+ * \returns the value for \a key or NULL.
+ */
+void *BLI_ghash_concurrent_lookup(GHashConcurrent *cgh, const void *key)
+{
+	GHashShard *shard = ghash_concurrent_shard(cgh, key);
+	void *val;
+
+	BLI_spin_lock(&shard->lock);
+	val = BLI_ghash_lookup(shard->gh, key);
+	BLI_spin_unlock(&shard->lock);
+
+	return val;
+}
+
+/**
+ * \return true if the \a key is in \a cgh.
+ */
+bool BLI_ghash_concurrent_haskey(GHashConcurrent *cgh, const void *key)
+{
+	GHashShard *shard = ghash_concurrent_shard(cgh, key);
+	bool haskey;
+
+	BLI_spin_lock(&shard->lock);
+	haskey = BLI_ghash_haskey(shard->gh, key);
+	BLI_spin_unlock(&shard->lock);
+
+	return haskey;
+}
+
+/**
+ * Remove \a key from \a cgh, or return false if the key wasn't found.
+ */
+bool BLI_ghash_concurrent_remove(
+        GHashConcurrent *cgh, const void *key, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	GHashShard *shard = ghash_concurrent_shard(cgh, key);
+	bool removed;
+
+	BLI_spin_lock(&shard->lock);
+	removed = BLI_ghash_remove(shard->gh, key, keyfreefp, valfreefp);
+	BLI_spin_unlock(&shard->lock);
+
+	return removed;
+}
+
+/**
+ * \return size of the hash, only exact when no other thread is modifying it.
+ */
+uint BLI_ghash_concurrent_len(GHashConcurrent *cgh)
+{
+	uint len = 0;
+
+	for (int i = 0; i < GHASH_CONCURRENT_SHARDS; i++) {
+		GHashShard *shard = &cgh->shards[i];
+		BLI_spin_lock(&shard->lock);
+		len += BLI_ghash_len(shard->gh);
+		BLI_spin_unlock(&shard->lock);
+	}
+
+	return len;
+}
+
+typedef struct GHashConcurrentForeachData {
+	GHashConcurrent *cgh;
+	GHashConcurrentForeachFP func;
+	void *userdata;
+} GHashConcurrentForeachData;
+
+static void ghash_concurrent_foreach_shard(
+        void *__restrict userdata,
+        const int iter,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	GHashConcurrentForeachData *data = userdata;
+	GHashIterator gh_iter;
+
+	GHASH_ITER (gh_iter, data->cgh->shards[iter].gh) {
+		data->func(data->userdata, BLI_ghashIterator_getKey(&gh_iter), BLI_ghashIterator_getValue(&gh_iter));
+	}
+}
+
+/**
+ * Call \a func for every entry of \a cgh, shards are processed in parallel when \a use_threading is set,
+ * so \a func must be thread-safe then.
+ *
+ * \note No locks are taken, \a cgh must not be modified until this returns (also not by \a func).
+ */
+void BLI_ghash_concurrent_foreach(
+        GHashConcurrent *cgh, GHashConcurrentForeachFP func, void *userdata,
+        const bool use_threading)
+{
+	GHashConcurrentForeachData data = {
+		.cgh = cgh,
+		.func = func,
+		.userdata = userdata,
+	};
+	ParallelRangeSettings settings;
+
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.use_threading = use_threading;
+	/* Shards may be of rather different sizes. */
+	settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+
+	BLI_task_parallel_range(0, GHASH_CONCURRENT_SHARDS, &data, ghash_concurrent_foreach_shard, &settings);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Debugging API
+ * \{ */
+
+/**
+ * \return number of buckets (slots) of all shards together, for testing.
+ */
+int BLI_ghash_concurrent_buckets_len(GHashConcurrent *cgh)
+{
+	int len = 0;
+
+	for (int i = 0; i < GHASH_CONCURRENT_SHARDS; i++) {
+		len += BLI_ghash_buckets_len(cgh->shards[i].gh);
+	}
+
+	return len;
+}
+
+/** \} */
@@ -36,6 +36,8 @@
  * - Freeing chunks.
  * - Iterating over allocated chunks
  *   (optionally when using the #BLI_MEMPOOL_ALLOW_ITER flag).
+ * - Allocating and freeing from multiple threads
+ *   (optionally when using the #BLI_MEMPOOL_THREADSAFE flag).
  */
 
 #include <string.h>
@@ -46,6 +48,7 @@
 #include "BLI_utildefines.h"
 
 #include "BLI_mempool.h" /* own include */
+#include "BLI_threads.h"
 
 #include "MEM_guardedalloc.h"
 
@@ -93,6 +96,10 @@
 /* optimize pool size */
 #define USE_CHUNK_POW2
 
+/* number of free lists for #BLI_MEMPOOL_THREADSAFE, threads beyond this share them */
+#define MEMPOOL_THREAD_CACHES 32
+#define CACHE_LINE_SIZE 64
+
 
 #ifndef NDEBUG
 static bool mempool_debug_memset = false;
@@ -120,6 +127,18 @@ typedef struct BLI_mempool_chunk {
 #endif
 } BLI_mempool_chunk;
 
+/**
+ * Free elements used by the threads assigned to this cache, see #BLI_MEMPOOL_THREADSAFE.
+ * The lock is only contended when two threads share a cache.
+ */
+typedef struct BLI_mempool_thread_cache {
+	BLI_freenode *free;
+	uint totfree;
+	SpinLock lock;
+
+	char _pad[CACHE_LINE_SIZE - sizeof(BLI_freenode *) - sizeof(uint) - sizeof(SpinLock)];
+} BLI_mempool_thread_cache;
+
 /**
  * The mempool, stores and tracks memory \a chunks and elements within those chunks \a free.
  */
@@ -141,6 +160,10 @@ struct BLI_mempool {
 #ifdef USE_TOTALLOC
 	uint totalloc;          /* number of elements allocated in total */
 #endif
+
+	/* only for BLI_MEMPOOL_THREADSAFE */
+	BLI_mempool_thread_cache *thread_caches;  /* MEMPOOL_THREAD_CACHES free lists */
+	SpinLock lock;                            /* protects chunks and free */
 };
 
 #define MEMPOOL_ELEM_SIZE_MIN (sizeof(void *) * 2)
@@ -337,6 +360,21 @@ BLI_mempool *BLI_mempool_create(uint esize, uint totelem,
 #endif
 	pool->totused = 0;
 
+	if (flag & BLI_MEMPOOL_THREADSAFE) {
+		pool->thread_caches = MEM_mallocN_aligned(
+		        sizeof(*pool->thread_caches) * MEMPOOL_THREAD_CACHES, CACHE_LINE_SIZE, "memory pool thread caches");
+		for (i = 0; i < MEMPOOL_THREAD_CACHES; i++) {
+			BLI_mempool_thread_cache *cache = &pool->thread_caches[i];
+			cache->free = NULL;
+			cache->totfree = 0;
+			BLI_spin_init(&cache->lock);
+		}
+		BLI_spin_init(&pool->lock);
+	}
+	else {
+		pool->thread_caches = NULL;
+	}
+
 	if (totelem) {
 		/* allocate the actual chunks */
 		for (i = 0; i < maxchunks; i++) {
@@ -352,27 +390,133 @@ BLI_mempool *BLI_mempool_create(uint esize, uint totelem,
 	return pool;
 }
 
-void *BLI_mempool_alloc(BLI_mempool *pool)
+/* -------------------------------------------------------------------- */
+/** \name Thread Caches
+ *
+ * With #BLI_MEMPOOL_THREADSAFE each thread allocates from and frees into its own cache,
+ * only moving a chunk worth of elements from or to #BLI_mempool.free at once.
+ * Lock order is always the cache first, then the pool.
+ * \{ */
+
+BLI_INLINE BLI_mempool_thread_cache *mempool_thread_cache_get(BLI_mempool *pool)
 {
-	BLI_freenode *free_pop;
+	return &pool->thread_caches[BLI_thread_index() % MEMPOOL_THREAD_CACHES];
+}
+
+/**
+ * Move up to a chunk worth of free elements from the pool into \a cache (which must be empty and locked),
+ * allocating a new chunk when the pool has none left.
+ */
+static void mempool_thread_cache_refill(BLI_mempool *pool, BLI_mempool_thread_cache *cache)
+{
+	BLI_freenode *head, *tail;
+	uint totfree = 1;
+
+	BLI_assert(cache->free == NULL);
+
+	BLI_spin_lock(&pool->lock);
 
 	if (UNLIKELY(pool->free == NULL)) {
-		/* need to allocate a new chunk */
 		BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
 		mempool_chunk_add(pool, mpchunk, NULL);
 	}
 
-	free_pop = pool->free;
+	head = tail = pool->free;
+	while ((totfree < pool->pchunk) && tail->next) {
+		tail = tail->next;
+		totfree++;
+	}
+	pool->free = tail->next;
+
+	BLI_spin_unlock(&pool->lock);
+
+	tail->next = NULL;
+	cache->free = head;
+	cache->totfree = totfree;
+}
+
+static BLI_freenode *mempool_thread_cache_pop(BLI_mempool *pool)
+{
+	BLI_mempool_thread_cache *cache = mempool_thread_cache_get(pool);
+	BLI_freenode *free_pop;
 
-	BLI_assert(pool->chunk_tail->next == NULL);
+	BLI_spin_lock(&cache->lock);
+
+	if (UNLIKELY(cache->free == NULL)) {
+		mempool_thread_cache_refill(pool, cache);
+	}
+
+	free_pop = cache->free;
+	cache->free = free_pop->next;
+	cache->totfree--;
+
+	BLI_spin_unlock(&cache->lock);
+
+	atomic_add_and_fetch_u(&pool->totused, 1);
+
+	return free_pop;
+}
+
+static void mempool_thread_cache_push(BLI_mempool *pool, BLI_freenode *newhead)
+{
+	BLI_mempool_thread_cache *cache = mempool_thread_cache_get(pool);
+
+	BLI_spin_lock(&cache->lock);
+
+	newhead->next = cache->free;
+	cache->free = newhead;
+	cache->totfree++;
+
+	/* Give a chunk worth back, so a thread that only frees doesn't hold on to all the memory. */
+	if (UNLIKELY(cache->totfree >= pool->pchunk * 2)) {
+		BLI_freenode *head = cache->free, *tail = head;
+		uint i;
+
+		for (i = 1; i < pool->pchunk; i++) {
+			tail = tail->next;
+		}
+		cache->free = tail->next;
+		cache->totfree -= pool->pchunk;
+
+		BLI_spin_lock(&pool->lock);
+		tail->next = pool->free;
+		pool->free = head;
+		BLI_spin_unlock(&pool->lock);
+	}
+
+	BLI_spin_unlock(&cache->lock);
+
+	atomic_sub_and_fetch_u(&pool->totused, 1);
+}
+
+/** \} */
+
+void *BLI_mempool_alloc(BLI_mempool *pool)
+{
+	BLI_freenode *free_pop;
+
+	if (pool->flag & BLI_MEMPOOL_THREADSAFE) {
+		free_pop = mempool_thread_cache_pop(pool);
+	}
+	else {
+		if (UNLIKELY(pool->free == NULL)) {
+			/* need to allocate a new chunk */
+			BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
+			mempool_chunk_add(pool, mpchunk, NULL);
+		}
+
+		free_pop = pool->free;
+
+		BLI_assert(pool->chunk_tail->next == NULL);
+
+		pool->free = free_pop->next;
+		pool->totused++;
+	}
 
 	if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
 		free_pop->freeword = USEDWORD;
 	}
 
-	pool->free = free_pop->next;
-	pool->totused++;
-
 #ifdef WITH_MEM_VALGRIND
 	VALGRIND_MEMPOOL_ALLOC(pool, free_pop, pool->esize);
 #endif
@@ -400,12 +544,18 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
 	{
 		BLI_mempool_chunk *chunk;
 		bool found = false;
+		if (pool->flag & BLI_MEMPOOL_THREADSAFE) {
+			BLI_spin_lock(&pool->lock);
+		}
 		for (chunk = pool->chunks; chunk; chunk = chunk->next) {
 			if (ARRAY_HAS_ITEM((char *)addr, (char *)CHUNK_DATA(chunk), pool->csize)) {
 				found = true;
 				break;
 			}
 		}
+		if (pool->flag & BLI_MEMPOOL_THREADSAFE) {
+			BLI_spin_unlock(&pool->lock);
+		}
 		if (!found) {
 			BLI_assert(!"Attempt to free data which is not in pool.\n");
 		}
@@ -425,6 +575,15 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
 		newhead->freeword = FREEWORD;
 	}
 
+	if (pool->flag & BLI_MEMPOOL_THREADSAFE) {
+		/* other threads may hold free elements of any chunk, so chunks are kept */
+		mempool_thread_cache_push(pool, newhead);
+#ifdef WITH_MEM_VALGRIND
+		VALGRIND_MEMPOOL_FREE(pool, addr);
+#endif
+		return;
+	}
+
 	newhead->next = pool->free;
 	pool->free = newhead;
 
@@ -578,6 +737,8 @@ void BLI_mempool_iternew(BLI_mempool *pool, BLI_mempool_iter *iter)
  * To be used when creating a task for each single item in the pool is totally overkill.
  *
  * See BLI_task_parallel_mempool implementation for detailed usage example.
+ *
+ * \note With #BLI_MEMPOOL_THREADSAFE, no elements may be allocated or freed while iterating.
  */
 BLI_mempool_iter *BLI_mempool_iter_threadsafe_create(BLI_mempool *pool, const size_t num_iter)
 {
@@ -741,6 +902,13 @@ void BLI_mempool_clear_ex(BLI_mempool *pool, const int totelem_reserve)
 	}
 
 	/* re-initialize */
+	if (pool->thread_caches) {
+		uint i;
+		for (i = 0; i < MEMPOOL_THREAD_CACHES; i++) {
+			pool->thread_caches[i].free = NULL;
+			pool->thread_caches[i].totfree = 0;
+		}
+	}
 	pool->free = NULL;
 	pool->totused = 0;
 #ifdef USE_TOTALLOC
@@ -772,6 +940,15 @@ void BLI_mempool_destroy(BLI_mempool *pool)
 {
 	mempool_chunk_free_all(pool->chunks);
 
+	if (pool->thread_caches) {
+		uint i;
+		for (i = 0; i < MEMPOOL_THREAD_CACHES; i++) {
+			BLI_spin_end(&pool->thread_caches[i].lock);
+		}
+		MEM_freeN(pool->thread_caches);
+		BLI_spin_end(&pool->lock);
+	}
+
 #ifdef WITH_MEM_VALGRIND
 	VALGRIND_DESTROY_MEMPOOL(pool);
 #endif
@@ -49,18 +49,23 @@
  */
 #define MEMPOOL_SIZE 256
 
-/* Number of tasks which are pushed directly to local thread queue.
+/* Number of tasks which fit into a per-thread work stealing deque, must be a
+ * power of two.
  *
- * This allows thread to fetch next task without locking the whole queue.
+ * Tasks pushed while the deque is full go to the scheduler's global queue.
  */
-#define LOCAL_QUEUE_SIZE 1
+#define DEQUE_SIZE 4096
+#define DEQUE_MASK (DEQUE_SIZE - 1)
 
-/* Number of tasks which are allowed to be scheduled in a delayed manner.
+/* Used to keep both ends of a deque on different cache lines. */
+#define CACHE_LINE_SIZE 64
+
+/* Number of parent levels of a pool which are stored next to its tasks in
+ * deques, to check them without accessing the pool.
  *
- * This allows to use less locks per graph node children schedule. More details
- * could be found at TaskThreadLocalStorage::do_delayed_push.
+ * For more details see description of TaskDequeEntry.
  */
-#define DELAYED_QUEUE_SIZE 4096
+#define TASK_GROUP_DEPTH 2
 
 #ifndef NDEBUG
 #  define ASSERT_THREAD_ID(scheduler, thread_id)                              \
@@ -142,37 +147,77 @@ typedef struct TaskThreadLocalStorage {
 	 */
 	TaskMemPool task_mempool;
 
-	/* Local queue keeps thread alive by keeping small amount of tasks ready
-	 * to be picked up without causing global thread locks for synchronization.
-	 */
-	int num_local_queue;
-	Task *local_queue[LOCAL_QUEUE_SIZE];
-
 	/* Thread can be marked for delayed tasks push. This is helpful when it's
 	 * know that lots of subsequent task pushed will happen from the same thread
 	 * without "interrupting" for task execution.
 	 *
-	 * We try to accumulate as much tasks as possible in a local queue without
-	 * any locks first, and then we push all of them into a scheduler's queue
-	 * from within a single mutex lock.
+	 * Tasks still go to the thread's deque right away, but sleeping threads
+	 * are only woken up once, when all of them are pushed.
 	 */
 	bool do_delayed_push;
-	int num_delayed_queue;
-	Task *delayed_queue[DELAYED_QUEUE_SIZE];
 } TaskThreadLocalStorage;
 
+/* Chase-Lev work stealing deque.
+ *
+ * The owner thread pushes and pops tasks at the bottom without any locks,
+ * other threads steal tasks from the top using compare-and-swap. The pool of
+ * a task and its closest parents are stored next to it, so threads which are
+ * only allowed to run tasks of a specific group can check them before
+ * stealing, without accessing a pool which might be freed meanwhile. Tasks of
+ * pools nested deeper are taken first and checked afterwards.
+ *
+ * Indices only grow, wrapping around the entries, so a stale top can never
+ * be swapped successfully.
+ */
+typedef struct TaskDequeEntry {
+	Task *task;
+	TaskPool *pool;
+	TaskPool *parents[TASK_GROUP_DEPTH];
+	/* Pool has more parents than stored above. */
+	bool has_more_parents;
+} TaskDequeEntry;
+
+typedef struct TaskDeque {
+	volatile int64_t top;
+	char pad_top[CACHE_LINE_SIZE - sizeof(int64_t)];
+	volatile int64_t bottom;
+	char pad_bottom[CACHE_LINE_SIZE - sizeof(int64_t)];
+	TaskDequeEntry entries[DEQUE_SIZE];
+} TaskDeque;
+
 struct TaskPool {
 	TaskScheduler *scheduler;
 
+	/* Number of tasks which are not finished yet, and how many of them are
+	 * still waiting in a deque or the global queue.
+	 */
 	volatile size_t num;
-	ThreadMutex num_mutex;
+	volatile size_t num_queued;
+
+	/* Pools form task groups: a pool created while the thread runs a task of
+	 * another pool is nested into that pool, at any depth. Threads waiting for
+	 * a pool also run tasks of nested pools rather than sleeping. This is safe
+	 * from deadlocks since those tasks can only wait for their own nested
+	 * pools in turn.
+	 *
+	 * Nested pools keep a reference to their parent, so its counters stay
+	 * valid when a nested pool outlives the task which created it.
+	 */
+	TaskPool *parent;
+	volatile uint32_t num_users;
+	/* Number of queued tasks of nested pools. */
+	volatile size_t num_group_queued;
+
+	/* Threads waiting for the pool sleep on this condition, which is used with
+	 * the scheduler's queue mutex.
+	 */
+	volatile uint32_t num_waiting;
 	ThreadCondition num_cond;
 
 	void *userdata;
 	ThreadMutex user_mutex;
 
 	volatile bool do_cancel;
-	volatile bool do_work;
 
 	volatile bool is_suspended;
 	ListBase suspended_queue;
@@ -210,10 +255,18 @@ struct TaskScheduler {
 	int num_threads;
 	bool background_thread_only;
 
+	/* Global queue, for tasks pushed from threads which are not managed by the
+	 * scheduler, tasks which did not fit into a deque, and all tasks when only
+	 * the background thread is used.
+	 */
 	ListBase queue;
+	volatile size_t num_queued;
 	ThreadMutex queue_mutex;
 	ThreadCondition queue_cond;
 
+	/* Number of worker threads sleeping on queue_cond. */
+	volatile uint32_t num_sleeping;
+
 	volatile bool do_exit;
 
 	/* NOTE: In pthread's TLS we store the whole TaskThread structure. */
@@ -223,7 +276,12 @@ struct TaskScheduler {
 typedef struct TaskThread {
 	TaskScheduler *scheduler;
 	int id;
+	/* Pool of the task the thread is running, parent of new pools. */
+	TaskPool *current_pool;
+	/* State of the random generator used to pick threads to steal from. */
+	uint32_t rng_state;
 	TaskThreadLocalStorage tls;
+	TaskDeque deque;
 } TaskThread;
 
 /* Helper */
@@ -258,7 +316,7 @@ BLI_INLINE TaskThreadLocalStorage *get_task_tls(TaskPool *pool,
 	}
 	if (thread_id == 0) {
 		BLI_assert(BLI_thread_is_main());
-		return &scheduler->task_threads[pool->thread_id].tls;
+		return &scheduler->task_threads[0].tls;
 	}
 	return &scheduler->task_threads[thread_id].tls;
 }
@@ -326,106 +384,452 @@ static void task_free(TaskPool *pool, Task *task, const int thread_id)
 	}
 }
 
+/* Task Deque */
+
+BLI_INLINE void task_entry_init(TaskDequeEntry *entry, Task *task)
+{
+	TaskPool *parent = task->pool->parent;
+
+	entry->task = task;
+	entry->pool = task->pool;
+	for (int i = 0; i < TASK_GROUP_DEPTH; i++) {
+		entry->parents[i] = parent;
+		if (parent != NULL) {
+			parent = parent->parent;
+		}
+	}
+	entry->has_more_parents = (parent != NULL);
+}
+
+/* Check whether the task might belong to the given pool or, if use_group is
+ * set, to a pool nested into it. NULL pool matches all tasks. Tasks of pools
+ * nested deeper than the stored parents always match, and must be checked
+ * with task_match() once they are taken.
+ */
+BLI_INLINE bool task_entry_match(const TaskDequeEntry *entry, const TaskPool *pool, const bool use_group)
+{
+	if (pool == NULL || entry->pool == pool) {
+		return true;
+	}
+	if (use_group) {
+		for (int i = 0; i < TASK_GROUP_DEPTH; i++) {
+			if (entry->parents[i] == pool) {
+				return true;
+			}
+		}
+		return entry->has_more_parents;
+	}
+	return false;
+}
+
+/* Check whether the task belongs to the given pool or, if use_group is set,
+ * to a pool nested into it. Only called for tasks which are not in a deque,
+ * so their pool can not be freed meanwhile.
+ */
+BLI_INLINE bool task_match(Task *task, const TaskPool *pool, const bool use_group)
+{
+	if (task->pool == pool) {
+		return true;
+	}
+	if (use_group) {
+		for (TaskPool *parent = task->pool->parent; parent != NULL; parent = parent->parent) {
+			if (parent == pool) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+BLI_INLINE void task_deque_init(TaskDeque *deque)
+{
+	deque->top = 0;
+	deque->bottom = 0;
+}
+
+BLI_INLINE bool task_deque_is_empty(const TaskDeque *deque)
+{
+	return deque->top >= deque->bottom;
+}
+
+/* Push task to the bottom of the deque, only called from the owner thread.
+ * Returns false if the deque is full.
+ */
+static bool task_deque_push(TaskDeque *deque, Task *task)
+{
+	const int64_t bottom = deque->bottom;
+	if (bottom - deque->top >= DEQUE_SIZE) {
+		return false;
+	}
+	task_entry_init(&deque->entries[bottom & DEQUE_MASK], task);
+	/* Atomic operations are full barriers, so the entry is written before
+	 * other threads can see the new bottom.
+	 */
+	atomic_fetch_and_add_int64((int64_t *)&deque->bottom, 1);
+	return true;
+}
+
+/* Pop the most recently pushed task from the bottom of the deque, only called
+ * from the owner thread. If pool is not NULL only a task matching it is
+ * popped, see task_entry_match().
+ */
+static Task *task_deque_pop(TaskDeque *deque, const TaskPool *pool, const bool use_group)
+{
+	const int64_t bottom = deque->bottom - 1;
+	if (pool != NULL) {
+		if (bottom < deque->top ||
+		    !task_entry_match(&deque->entries[bottom & DEQUE_MASK], pool, use_group))
+		{
+			return NULL;
+		}
+	}
+	/* Claim the bottom entry before reading top, so stealing threads either
+	 * see it claimed or we see them taking it.
+	 */
+	atomic_fetch_and_sub_int64((int64_t *)&deque->bottom, 1);
+	const int64_t top = deque->top;
+	if (top > bottom) {
+		/* Deque was empty. */
+		deque->bottom = bottom + 1;
+		return NULL;
+	}
+	Task *task = deque->entries[bottom & DEQUE_MASK].task;
+	if (top == bottom) {
+		/* Last task, race stealing threads for it. */
+		if (atomic_cas_int64((int64_t *)&deque->top, top, top + 1) != top) {
+			task = NULL;
+		}
+		deque->bottom = bottom + 1;
+	}
+	return task;
+}
+
+/* Steal the oldest task from the top of the deque, called from any thread.
+ * If pool is not NULL only a task matching it is stolen. Returns NULL when
+ * there is nothing to steal or another thread took the task first.
+ */
+static Task *task_deque_steal(TaskDeque *deque, const TaskPool *pool, const bool use_group)
+{
+	/* Cheap check first, to avoid atomics on deques of busy threads. */
+	if (task_deque_is_empty(deque)) {
+		return NULL;
+	}
+	/* Atomic reads of top act as barriers, ordering the reads of top, bottom
+	 * and the entry.
+	 */
+	const int64_t top = atomic_fetch_and_add_int64((int64_t *)&deque->top, 0);
+	const int64_t bottom = deque->bottom;
+	if (top >= bottom) {
+		return NULL;
+	}
+	if (atomic_fetch_and_add_int64((int64_t *)&deque->top, 0) != top) {
+		return NULL;
+	}
+	/* The entry might be overwritten once another thread took it, in which
+	 * case the swap below fails.
+	 */
+	const TaskDequeEntry entry = deque->entries[top & DEQUE_MASK];
+	if (!task_entry_match(&entry, pool, use_group)) {
+		return NULL;
+	}
+	if (atomic_cas_int64((int64_t *)&deque->top, top, top + 1) != top) {
+		return NULL;
+	}
+	return entry.task;
+}
+
 /* Task Scheduler */
 
 static void task_pool_num_decrease(TaskPool *pool, size_t done)
 {
-	BLI_mutex_lock(&pool->num_mutex);
+	TaskScheduler *scheduler = pool->scheduler;
+	size_t num = pool->num;
 
-	BLI_assert(pool->num >= done);
+	BLI_assert(num >= done);
 
-	pool->num -= done;
+	if (done == 0) {
+		return;
+	}
+
+	while (num > done) {
+		const size_t prev_num = atomic_cas_z((size_t *)&pool->num, num, num - done);
+		if (prev_num == num) {
+			return;
+		}
+		num = prev_num;
+	}
 
-	if (pool->num == 0)
+	/* The last tasks are done. Decrease with the lock held, so a waiting
+	 * thread can not free the pool before it is notified.
+	 */
+	BLI_mutex_lock(&scheduler->queue_mutex);
+	atomic_sub_and_fetch_z((size_t *)&pool->num, done);
+	if (pool->num_waiting != 0) {
 		BLI_condition_notify_all(&pool->num_cond);
+	}
+	BLI_mutex_unlock(&scheduler->queue_mutex);
+}
+
+/* Count tasks which were queued or taken from a queue, for the pool and the
+ * pools it is nested into.
+ */
+static void task_pool_queued_increase(TaskPool *pool, size_t new)
+{
+	atomic_add_and_fetch_z((size_t *)&pool->num_queued, new);
+	for (TaskPool *parent = pool->parent; parent != NULL; parent = parent->parent) {
+		atomic_add_and_fetch_z((size_t *)&parent->num_group_queued, new);
+	}
+}
 
-	BLI_mutex_unlock(&pool->num_mutex);
+static void task_pool_queued_decrease(TaskPool *pool, size_t done)
+{
+	atomic_sub_and_fetch_z((size_t *)&pool->num_queued, done);
+	for (TaskPool *parent = pool->parent; parent != NULL; parent = parent->parent) {
+		atomic_sub_and_fetch_z((size_t *)&parent->num_group_queued, done);
+	}
 }
 
 static void task_pool_num_increase(TaskPool *pool, size_t new)
 {
-	BLI_mutex_lock(&pool->num_mutex);
+	atomic_add_and_fetch_z((size_t *)&pool->num, new);
+	task_pool_queued_increase(pool, new);
+}
+
+/* Check for threads waiting for the pool or a pool it is nested into. */
+BLI_INLINE bool task_pool_has_waiting(TaskPool *pool)
+{
+	if (pool->num_waiting != 0) {
+		return true;
+	}
+	for (TaskPool *parent = pool->parent; parent != NULL; parent = parent->parent) {
+		if (parent->num_waiting != 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Wake up threads waiting for the pool or a pool it is nested into, called
+ * with the queue mutex held.
+ */
+static void task_pool_notify_waiting(TaskPool *pool)
+{
+	if (pool->num_waiting != 0) {
+		BLI_condition_notify_all(&pool->num_cond);
+	}
+	for (TaskPool *parent = pool->parent; parent != NULL; parent = parent->parent) {
+		if (parent->num_waiting != 0) {
+			BLI_condition_notify_all(&parent->num_cond);
+		}
+	}
+}
 
-	pool->num += new;
-	BLI_condition_notify_all(&pool->num_cond);
+/* Get the scheduler thread the calling thread is running as, for access to
+ * its deque. Threads which are not managed by the scheduler get NULL and use
+ * the global queue, as does everything when there is only the background
+ * thread, which must not pick up tasks of regular pools.
+ */
+BLI_INLINE TaskThread *task_scheduler_current_thread(TaskScheduler *scheduler)
+{
+	if (scheduler->background_thread_only) {
+		return NULL;
+	}
+	if (BLI_thread_is_main()) {
+		return &scheduler->task_threads[0];
+	}
+	return pthread_getspecific(scheduler->tls_id_key);
+}
 
-	BLI_mutex_unlock(&pool->num_mutex);
+BLI_INLINE uint32_t task_thread_rng_next(TaskThread *thread)
+{
+	/* Xorshift, good enough to spread stealing over threads. */
+	uint32_t x = thread->rng_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	thread->rng_state = x;
+	return x;
 }
 
-static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, Task **task)
+/* Wake up threads after tasks of the pool were pushed to a deque. The push
+ * acted as a barrier, so threads which went to sleep before it are counted
+ * here and threads which are about to sleep will see the new tasks.
+ */
+static void task_scheduler_wakeup(TaskScheduler *scheduler, TaskPool *pool, const bool wake_all)
 {
-	bool found_task = false;
+	if (scheduler->num_sleeping == 0 && !task_pool_has_waiting(pool)) {
+		return;
+	}
+
 	BLI_mutex_lock(&scheduler->queue_mutex);
+	if (wake_all) {
+		BLI_condition_notify_all(&scheduler->queue_cond);
+	}
+	else {
+		BLI_condition_notify_one(&scheduler->queue_cond);
+	}
+	task_pool_notify_waiting(pool);
+	BLI_mutex_unlock(&scheduler->queue_mutex);
+}
 
-	while (!scheduler->queue.first && !scheduler->do_exit)
-		BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+static void task_scheduler_queue_push(TaskScheduler *scheduler, Task *task, TaskPriority priority)
+{
+	BLI_mutex_lock(&scheduler->queue_mutex);
 
-	do {
-		Task *current_task;
+	if (priority == TASK_PRIORITY_HIGH)
+		BLI_addhead(&scheduler->queue, task);
+	else
+		BLI_addtail(&scheduler->queue, task);
+	scheduler->num_queued++;
 
-		/* Assuming we can only have a void queue in 'exit' case here seems logical (we should only be here after
-		 * our worker thread has been woken up from a condition_wait(), which only happens after a new task was
-		 * added to the queue), but it is wrong.
-		 * Waiting on condition may wake up the thread even if condition is not signaled (spurious wake-ups), and some
-		 * race condition may also empty the queue **after** condition has been signaled, but **before** awoken thread
-		 * reaches this point...
-		 * See http://stackoverflow.com/questions/8594591
-		 *
-		 * So we only abort here if do_exit is set.
-		 */
-		if (scheduler->do_exit) {
-			BLI_mutex_unlock(&scheduler->queue_mutex);
-			return false;
-		}
+	BLI_condition_notify_one(&scheduler->queue_cond);
+	task_pool_notify_waiting(task->pool);
+	BLI_mutex_unlock(&scheduler->queue_mutex);
+}
 
-		for (current_task = scheduler->queue.first;
-		     current_task != NULL;
-		     current_task = current_task->next)
-		{
-			TaskPool *pool = current_task->pool;
+/* Pop task from the global queue. If pool is NULL any task which a worker
+ * thread is allowed to run is popped, otherwise only a task matching it.
+ */
+static Task *task_scheduler_queue_pop(TaskScheduler *scheduler, const TaskPool *pool, const bool use_group)
+{
+	Task *task;
+
+	if (scheduler->num_queued == 0) {
+		return NULL;
+	}
+
+	BLI_mutex_lock(&scheduler->queue_mutex);
 
-			if (scheduler->background_thread_only && !pool->run_in_background) {
+	for (task = scheduler->queue.first; task; task = task->next) {
+		if (pool != NULL) {
+			if (!task_match(task, pool, use_group)) {
 				continue;
 			}
-
-			*task = current_task;
-			found_task = true;
-			BLI_remlink(&scheduler->queue, *task);
-			break;
 		}
-		if (!found_task)
-			BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
-	} while (!found_task);
+		else if (scheduler->background_thread_only && !task->pool->run_in_background) {
+			continue;
+		}
+
+		BLI_remlink(&scheduler->queue, task);
+		scheduler->num_queued--;
+		break;
+	}
 
 	BLI_mutex_unlock(&scheduler->queue_mutex);
 
-	return true;
+	return task;
 }
 
-BLI_INLINE void handle_local_queue(TaskThreadLocalStorage *tls,
-                                   const int thread_id)
+/* Check whether a sleeping worker thread could find a task, called with the
+ * queue mutex held.
+ */
+static bool task_scheduler_has_work(TaskScheduler *scheduler)
 {
-	BLI_assert(!tls->do_delayed_push);
-	while (tls->num_local_queue > 0) {
-		/* We pop task from queue before handling it so handler of the task can
-		 * push next job to the local queue.
-		 */
-		tls->num_local_queue--;
-		Task *local_task = tls->local_queue[tls->num_local_queue];
-		/* TODO(sergey): Double-check work_and_wait() doesn't handle other's
-		 * pool tasks.
+	if (scheduler->background_thread_only) {
+		for (Task *task = scheduler->queue.first; task; task = task->next) {
+			if (task->pool->run_in_background) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	if (scheduler->num_queued != 0) {
+		return true;
+	}
+	for (int i = 0; i < scheduler->num_threads + 1; i++) {
+		if (!task_deque_is_empty(&scheduler->task_threads[i].deque)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Find any task for a worker thread: its own most recent one first, then the
+ * oldest one of a random other thread, then the global queue.
+ */
+static Task *task_scheduler_find_task(TaskScheduler *scheduler, TaskThread *thread)
+{
+	Task *task;
+
+	if (!scheduler->background_thread_only) {
+		const int num_deques = scheduler->num_threads + 1;
+
+		if ((task = task_deque_pop(&thread->deque, NULL, false)) != NULL) {
+			return task;
+		}
+
+		const int start = (int)(task_thread_rng_next(thread) % (uint32_t)num_deques);
+		for (int i = 0; i < num_deques; i++) {
+			const int victim = (start + i) % num_deques;
+			if (victim == thread->id) {
+				continue;
+			}
+			if ((task = task_deque_steal(&scheduler->task_threads[victim].deque, NULL, false)) != NULL) {
+				return task;
+			}
+		}
+	}
+
+	return task_scheduler_queue_pop(scheduler, NULL, false);
+}
+
+static Task *task_scheduler_thread_wait_pop(TaskScheduler *scheduler, TaskThread *thread)
+{
+	while (!scheduler->do_exit) {
+		Task *task = task_scheduler_find_task(scheduler, thread);
+		if (task != NULL) {
+			task_pool_queued_decrease(task->pool, 1);
+			return task;
+		}
+
+		/* Nothing to do, sleep until new tasks are pushed. Spurious wake-ups
+		 * are fine, we simply look for tasks again.
 		 */
-		TaskPool *local_pool = local_task->pool;
-		local_task->run(local_pool, local_task->taskdata, thread_id);
-		task_free(local_pool, local_task, thread_id);
+		BLI_mutex_lock(&scheduler->queue_mutex);
+		atomic_add_and_fetch_uint32((uint32_t *)&scheduler->num_sleeping, 1);
+		if (!scheduler->do_exit && !task_scheduler_has_work(scheduler)) {
+			BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+		}
+		atomic_sub_and_fetch_uint32((uint32_t *)&scheduler->num_sleeping, 1);
+		BLI_mutex_unlock(&scheduler->queue_mutex);
 	}
-	BLI_assert(!tls->do_delayed_push);
+
+	return NULL;
+}
+
+BLI_INLINE void task_run(Task *task, TaskThread *thread, const int thread_id)
+{
+	TaskPool *pool = task->pool;
+	TaskPool *current_pool = NULL;
+
+	/* Pools created by the task are nested into its pool. */
+	if (thread != NULL) {
+		current_pool = thread->current_pool;
+		thread->current_pool = pool;
+	}
+
+	/* Tasks of canceled pools are still picked up from the deques, but
+	 * discarded without running them.
+	 */
+	if (!pool->do_cancel) {
+		task->run(pool, task->taskdata, thread_id);
+	}
+
+	if (thread != NULL) {
+		thread->current_pool = current_pool;
+	}
+
+	/* delete task */
+	task_free(pool, task, thread_id);
+
+	/* notify pool task was done */
+	task_pool_num_decrease(pool, 1);
 }
 
 static void *task_scheduler_thread_run(void *thread_p)
 {
 	TaskThread *thread = (TaskThread *) thread_p;
-	TaskThreadLocalStorage *tls = &thread->tls;
 	TaskScheduler *scheduler = thread->scheduler;
 	int thread_id = thread->id;
 	Task *task;
@@ -433,27 +837,23 @@ static void *task_scheduler_thread_run(void *thread_p)
 	pthread_setspecific(scheduler->tls_id_key, thread);
 
 	/* keep popping off tasks */
-	while (task_scheduler_thread_wait_pop(scheduler, &task)) {
-		TaskPool *pool = task->pool;
-
-		/* run task */
-		BLI_assert(!tls->do_delayed_push);
-		task->run(pool, task->taskdata, thread_id);
-		BLI_assert(!tls->do_delayed_push);
-
-		/* delete task */
-		task_free(pool, task, thread_id);
-
-		/* Handle all tasks from local queue. */
-		handle_local_queue(tls, thread_id);
-
-		/* notify pool task was done */
-		task_pool_num_decrease(pool, 1);
+	while ((task = task_scheduler_thread_wait_pop(scheduler, thread)) != NULL) {
+		task_run(task, thread, thread_id);
 	}
 
 	return NULL;
 }
 
+static void task_thread_init(TaskScheduler *scheduler, TaskThread *thread, int id)
+{
+	thread->scheduler = scheduler;
+	thread->id = id;
+	thread->current_pool = NULL;
+	thread->rng_state = 0x9e3779b9u * (uint32_t)(id + 1);
+	initialize_task_tls(&thread->tls);
+	task_deque_init(&thread->deque);
+}
+
 TaskScheduler *BLI_task_scheduler_create(int num_threads)
 {
 	TaskScheduler *scheduler = MEM_callocN(sizeof(TaskScheduler), "TaskScheduler");
@@ -483,8 +883,8 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
 	scheduler->task_threads = MEM_mallocN(sizeof(TaskThread) * (num_threads + 1),
 	                                      "TaskScheduler task threads");
 
-	/* Initialize TLS for main thread. */
-	initialize_task_tls(&scheduler->task_threads[0].tls);
+	/* Initialize TLS and deque for main thread. */
+	task_thread_init(scheduler, &scheduler->task_threads[0], 0);
 
 	pthread_key_create(&scheduler->tls_id_key, NULL);
 
@@ -495,12 +895,13 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
 		scheduler->num_threads = num_threads;
 		scheduler->threads = MEM_callocN(sizeof(pthread_t) * num_threads, "TaskScheduler threads");
 
+		/* All deques must be initialized before any thread starts stealing. */
 		for (i = 0; i < num_threads; i++) {
-			TaskThread *thread = &scheduler->task_threads[i + 1];
-			thread->scheduler = scheduler;
-			thread->id = i + 1;
-			initialize_task_tls(&thread->tls);
+			task_thread_init(scheduler, &scheduler->task_threads[i + 1], i + 1);
+		}
 
+		for (i = 0; i < num_threads; i++) {
+			TaskThread *thread = &scheduler->task_threads[i + 1];
 			if (pthread_create(&scheduler->threads[i], NULL, task_scheduler_thread_run, thread) != 0) {
 				fprintf(stderr, "TaskScheduler failed to launch thread %d/%d\n", i, num_threads);
 			}
@@ -534,11 +935,15 @@ void BLI_task_scheduler_free(TaskScheduler *scheduler)
 		MEM_freeN(scheduler->threads);
 	}
 
-	/* Delete task thread data */
+	/* Delete task thread data and leftover tasks in the deques. */
 	if (scheduler->task_threads) {
 		for (int i = 0; i < scheduler->num_threads + 1; ++i) {
-			TaskThreadLocalStorage *tls = &scheduler->task_threads[i].tls;
-			free_task_tls(tls);
+			TaskThread *thread = &scheduler->task_threads[i];
+			while ((task = task_deque_steal(&thread->deque, NULL, false)) != NULL) {
+				task_data_free(task, 0);
+				MEM_freeN(task);
+			}
+			free_task_tls(&thread->tls);
 		}
 
 		MEM_freeN(scheduler->task_threads);
@@ -562,41 +967,25 @@ int BLI_task_scheduler_num_threads(TaskScheduler *scheduler)
 	return scheduler->num_threads + 1;
 }
 
+/* Push task to the deque of the calling thread, where it is picked up without
+ * locks. Priority only matters for the global queue, deques always run the
+ * most recent task of their own thread first.
+ */
 static void task_scheduler_push(TaskScheduler *scheduler, Task *task, TaskPriority priority)
 {
-	task_pool_num_increase(task->pool, 1);
+	TaskPool *pool = task->pool;
+	TaskThread *thread = task_scheduler_current_thread(scheduler);
 
-	/* add task to queue */
-	BLI_mutex_lock(&scheduler->queue_mutex);
+	task_pool_num_increase(pool, 1);
 
-	if (priority == TASK_PRIORITY_HIGH)
-		BLI_addhead(&scheduler->queue, task);
-	else
-		BLI_addtail(&scheduler->queue, task);
-
-	BLI_condition_notify_one(&scheduler->queue_cond);
-	BLI_mutex_unlock(&scheduler->queue_mutex);
-}
-
-static void task_scheduler_push_all(TaskScheduler *scheduler,
-                                    TaskPool *pool,
-                                    Task **tasks,
-                                    int num_tasks)
-{
-	if (num_tasks == 0) {
+	if (thread != NULL && task_deque_push(&thread->deque, task)) {
+		if (!thread->tls.do_delayed_push) {
+			task_scheduler_wakeup(scheduler, pool, false);
+		}
 		return;
 	}
 
-	task_pool_num_increase(pool, num_tasks);
-
-	BLI_mutex_lock(&scheduler->queue_mutex);
-
-	for (int i = 0; i < num_tasks; i++) {
-		BLI_addhead(&scheduler->queue, tasks[i]);
-	}
-
-	BLI_condition_notify_all(&scheduler->queue_cond);
-	BLI_mutex_unlock(&scheduler->queue_mutex);
+	task_scheduler_queue_push(scheduler, task, priority);
 }
 
 static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
@@ -613,6 +1002,7 @@ static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
 		if (task->pool == pool) {
 			task_data_free(task, pool->thread_id);
 			BLI_freelinkN(&scheduler->queue, task);
+			scheduler->num_queued--;
 
 			done++;
 		}
@@ -621,6 +1011,7 @@ static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
 	BLI_mutex_unlock(&scheduler->queue_mutex);
 
 	/* notify done */
+	task_pool_queued_decrease(pool, done);
 	task_pool_num_decrease(pool, done);
 }
 
@@ -647,15 +1038,16 @@ static TaskPool *task_pool_create_ex(TaskScheduler *scheduler,
 
 	pool->scheduler = scheduler;
 	pool->num = 0;
+	pool->num_queued = 0;
+	pool->num_group_queued = 0;
+	pool->num_waiting = 0;
 	pool->do_cancel = false;
-	pool->do_work = false;
 	pool->is_suspended = is_suspended;
 	pool->num_suspended = 0;
 	pool->suspended_queue.first = pool->suspended_queue.last = NULL;
 	pool->run_in_background = is_background;
 	pool->use_local_tls = false;
 
-	BLI_mutex_init(&pool->num_mutex);
 	BLI_condition_init(&pool->num_cond);
 
 	pool->userdata = userdata;
@@ -684,6 +1076,19 @@ static TaskPool *task_pool_create_ex(TaskScheduler *scheduler,
 		}
 	}
 
+	/* Nest the pool into the pool of the task which is running. Background
+	 * pools are not waited for by that task, so they are never nested.
+	 */
+	pool->parent = NULL;
+	pool->num_users = 1;
+	if (!is_background) {
+		TaskThread *thread = task_scheduler_current_thread(scheduler);
+		if (thread != NULL && thread->current_pool != NULL) {
+			pool->parent = thread->current_pool;
+			atomic_add_and_fetch_uint32((uint32_t *)&pool->parent->num_users, 1);
+		}
+	}
+
 #ifdef DEBUG_STATS
 	pool->mempool_stats =
 	        MEM_callocN(sizeof(*pool->mempool_stats) * (scheduler->num_threads + 1),
@@ -736,13 +1141,23 @@ TaskPool *BLI_task_pool_create_suspended(TaskScheduler *scheduler, void *userdat
 	return task_pool_create_ex(scheduler, userdata, false, true);
 }
 
+/* Release a reference to the pool, freeing it once neither its owner nor
+ * pools nested into it use it anymore.
+ */
+static void task_pool_release(TaskPool *pool)
+{
+	while (pool != NULL && atomic_sub_and_fetch_uint32((uint32_t *)&pool->num_users, 1) == 0) {
+		TaskPool *parent = pool->parent;
+		BLI_condition_end(&pool->num_cond);
+		MEM_freeN(pool);
+		pool = parent;
+	}
+}
+
 void BLI_task_pool_free(TaskPool *pool)
 {
 	BLI_task_pool_cancel(pool);
 
-	BLI_mutex_end(&pool->num_mutex);
-	BLI_condition_end(&pool->num_cond);
-
 	BLI_mutex_end(&pool->user_mutex);
 
 #ifdef DEBUG_STATS
@@ -761,16 +1176,11 @@ void BLI_task_pool_free(TaskPool *pool)
 		free_task_tls(&pool->local_tls);
 	}
 
-	MEM_freeN(pool);
+	task_pool_release(pool);
 
 	BLI_threaded_malloc_end();
 }
 
-BLI_INLINE bool task_can_use_local_queues(TaskPool *pool, int thread_id)
-{
-	return (thread_id != -1 && (thread_id != pool->thread_id || pool->do_work));
-}
-
 static void task_pool_push(
         TaskPool *pool, TaskRunFunction run, void *taskdata,
         bool free_taskdata, TaskFreeFunction freedata, TaskPriority priority,
@@ -794,31 +1204,6 @@ static void task_pool_push(
 		atomic_fetch_and_add_z(&pool->num_suspended, 1);
 		return;
 	}
-	/* Populate to any local queue first, this is cheapest push ever. */
-	if (task_can_use_local_queues(pool, thread_id)) {
-		ASSERT_THREAD_ID(pool->scheduler, thread_id);
-		TaskThreadLocalStorage *tls = get_task_tls(pool, thread_id);
-		/* Try to push to a local execution queue.
-		 * These tasks will be picked up next.
-		 */
-		if (tls->num_local_queue < LOCAL_QUEUE_SIZE) {
-			tls->local_queue[tls->num_local_queue] = task;
-			tls->num_local_queue++;
-			return;
-		}
-		/* If we are in the delayed tasks push mode, we push tasks to a
-		 * temporary local queue first without any locks, and then move them
-		 * to global execution queue with a single lock.
-		 */
-		if (tls->do_delayed_push && tls->num_delayed_queue < DELAYED_QUEUE_SIZE) {
-			tls->delayed_queue[tls->num_delayed_queue] = task;
-			tls->num_delayed_queue++;
-			return;
-		}
-	}
-	/* Do push to a global execution ppol, slowest possible method,
-	 * causes quite reasonable amount of threading overhead.
-	 */
 	task_scheduler_push(pool->scheduler, task, priority);
 }
 
@@ -841,79 +1226,150 @@ void BLI_task_pool_push_from_thread(TaskPool *pool, TaskRunFunction run,
 	task_pool_push(pool, run, taskdata, free_taskdata, NULL, priority, thread_id);
 }
 
-void BLI_task_pool_work_and_wait(TaskPool *pool)
+/* Check a task taken from a deque for a thread waiting for the pool. Tasks of
+ * deeply nested pools which turn out to belong to another group are moved to
+ * the global queue, where worker threads still pick them up.
+ */
+static Task *task_pool_check_task(TaskPool *pool, Task *task, const bool use_group)
 {
-	TaskThreadLocalStorage *tls = get_task_tls(pool, pool->thread_id);
-	TaskScheduler *scheduler = pool->scheduler;
+	if (task == NULL || task_match(task, pool, use_group)) {
+		return task;
+	}
+	task_scheduler_queue_push(pool->scheduler, task, TASK_PRIORITY_LOW);
+	return NULL;
+}
 
-	if (atomic_fetch_and_and_uint8((uint8_t *)&pool->is_suspended, 0)) {
-		if (pool->num_suspended) {
-			task_pool_num_increase(pool, pool->num_suspended);
-			BLI_mutex_lock(&scheduler->queue_mutex);
+/* Find a task of the given pool for a thread waiting for the pool. Tasks of
+ * other pools are never run here, if we get a task from another pool, we can
+ * get into deadlock. Tasks of pools nested into this one are fine though, and
+ * are run by scheduler threads (use_group) rather than sleeping.
+ */
+static Task *task_pool_find_task(TaskPool *pool, TaskThread *thread, const bool use_group)
+{
+	TaskScheduler *scheduler = pool->scheduler;
+	const int num_deques = scheduler->num_threads + 1;
+	Task *task;
 
-			BLI_movelisttolist(&scheduler->queue, &pool->suspended_queue);
+	if (pool->num_queued == 0 && (!use_group || pool->num_group_queued == 0)) {
+		return NULL;
+	}
 
-			BLI_condition_notify_all(&scheduler->queue_cond);
-			BLI_mutex_unlock(&scheduler->queue_mutex);
+	/* Most recent task of our own deque, then the oldest ones of others. */
+	if (thread != NULL) {
+		while ((task = task_deque_pop(&thread->deque, pool, use_group)) != NULL) {
+			if ((task = task_pool_check_task(pool, task, use_group)) != NULL) {
+				return task;
+			}
+		}
+	}
+	if (!scheduler->background_thread_only) {
+		for (int i = 0; i < num_deques; i++) {
+			TaskDeque *deque = &scheduler->task_threads[i].deque;
+			while ((task = task_deque_steal(deque, pool, use_group)) != NULL) {
+				if ((task = task_pool_check_task(pool, task, use_group)) != NULL) {
+					return task;
+				}
+			}
 		}
 	}
 
-	pool->do_work = true;
-
-	ASSERT_THREAD_ID(pool->scheduler, pool->thread_id);
-
-	BLI_mutex_lock(&pool->num_mutex);
-
-	while (pool->num != 0) {
-		Task *task, *work_task = NULL;
-		bool found_task = false;
-
-		BLI_mutex_unlock(&pool->num_mutex);
-
-		BLI_mutex_lock(&scheduler->queue_mutex);
-
-		/* find task from this pool. if we get a task from another pool,
-		 * we can get into deadlock */
+	if ((task = task_scheduler_queue_pop(scheduler, pool, use_group)) != NULL) {
+		return task;
+	}
 
-		for (task = scheduler->queue.first; task; task = task->next) {
-			if (task->pool == pool) {
-				work_task = task;
-				found_task = true;
-				BLI_remlink(&scheduler->queue, task);
+	/* Tasks of this pool are queued below tasks of other pools. Move those to
+	 * the global queue, where worker threads still pick them up, until ours
+	 * become reachable.
+	 */
+	if (!scheduler->background_thread_only) {
+		for (int i = 0; i < num_deques; i++) {
+			TaskDeque *deque = &scheduler->task_threads[i].deque;
+			if (pool->num_queued == 0 && (!use_group || pool->num_group_queued == 0)) {
 				break;
 			}
+			while ((task = task_deque_steal(deque, NULL, false)) != NULL) {
+				if (task_match(task, pool, use_group)) {
+					return task;
+				}
+				task_scheduler_queue_push(scheduler, task, TASK_PRIORITY_LOW);
+			}
 		}
+	}
 
-		BLI_mutex_unlock(&scheduler->queue_mutex);
+	return NULL;
+}
 
-		/* if found task, do it, otherwise wait until other tasks are done */
-		if (found_task) {
-			/* run task */
-			BLI_assert(!tls->do_delayed_push);
-			work_task->run(pool, work_task->taskdata, pool->thread_id);
-			BLI_assert(!tls->do_delayed_push);
+/* Run tasks of the pool from the calling thread until all of them are done,
+ * sleeping while the remaining ones are running in other threads.
+ */
+static void task_pool_wait(TaskPool *pool)
+{
+	TaskScheduler *scheduler = pool->scheduler;
+	TaskThread *thread = task_scheduler_current_thread(scheduler);
+	/* Threads which are not managed by the scheduler have no ID of their own
+	 * to run tasks of nested pools with.
+	 */
+	const bool use_group = (thread != NULL);
+	const int thread_id = (thread != NULL) ? thread->id : pool->thread_id;
 
-			/* delete task */
-			task_free(pool, task, pool->thread_id);
+	for (;;) {
+		Task *task = task_pool_find_task(pool, thread, use_group);
 
-			/* Handle all tasks from local queue. */
-			handle_local_queue(tls, pool->thread_id);
+		if (task != NULL) {
+			task_pool_queued_decrease(task->pool, 1);
+			task_run(task, thread, thread_id);
+			continue;
+		}
 
-			/* notify pool task was done */
-			task_pool_num_decrease(pool, 1);
+		/* Only stop waiting with the lock held, the last decrease of the
+		 * number of tasks happens with it held as well.
+		 */
+		BLI_mutex_lock(&scheduler->queue_mutex);
+		atomic_add_and_fetch_uint32((uint32_t *)&pool->num_waiting, 1);
+		while (pool->num != 0 && pool->num_queued == 0 &&
+		       (!use_group || pool->num_group_queued == 0))
+		{
+			BLI_condition_wait(&pool->num_cond, &scheduler->queue_mutex);
 		}
+		atomic_sub_and_fetch_uint32((uint32_t *)&pool->num_waiting, 1);
+		const bool is_done = (pool->num == 0);
+		BLI_mutex_unlock(&scheduler->queue_mutex);
 
-		BLI_mutex_lock(&pool->num_mutex);
-		if (pool->num == 0)
+		if (is_done) {
 			break;
+		}
+	}
+}
+
+void BLI_task_pool_work_and_wait(TaskPool *pool)
+{
+	TaskScheduler *scheduler = pool->scheduler;
 
-		if (!found_task)
-			BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
+	if (atomic_fetch_and_and_uint8((uint8_t *)&pool->is_suspended, 0)) {
+		if (pool->num_suspended) {
+			TaskThread *thread = task_scheduler_current_thread(scheduler);
+			Task *task, *nexttask;
+
+			/* Push all tasks before waking up threads, like a delayed push. */
+			const bool do_delayed_push = (thread != NULL) ? thread->tls.do_delayed_push : false;
+			if (thread != NULL) {
+				thread->tls.do_delayed_push = true;
+			}
+			for (task = pool->suspended_queue.first; task; task = nexttask) {
+				nexttask = task->next;
+				task_scheduler_push(scheduler, task, TASK_PRIORITY_HIGH);
+			}
+			BLI_listbase_clear(&pool->suspended_queue);
+			if (thread != NULL) {
+				thread->tls.do_delayed_push = do_delayed_push;
+				task_scheduler_wakeup(scheduler, pool, true);
+			}
+		}
 	}
 
-	BLI_mutex_unlock(&pool->num_mutex);
+	ASSERT_THREAD_ID(pool->scheduler, pool->thread_id);
 
-	handle_local_queue(tls, pool->thread_id);
+	task_pool_wait(pool);
 }
 
 void BLI_task_pool_cancel(TaskPool *pool)
@@ -922,11 +1378,10 @@ void BLI_task_pool_cancel(TaskPool *pool)
 
 	task_scheduler_clear(pool->scheduler, pool);
 
-	/* wait until all entries are cleared */
-	BLI_mutex_lock(&pool->num_mutex);
-	while (pool->num)
-		BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
-	BLI_mutex_unlock(&pool->num_mutex);
+	/* Tasks left in deques are discarded when picked up, wait until those and
+	 * the running ones are done.
+	 */
+	task_pool_wait(pool);
 
 	pool->do_cancel = false;
 }
@@ -948,7 +1403,7 @@ ThreadMutex *BLI_task_pool_user_mutex(TaskPool *pool)
 
 void BLI_task_pool_delayed_push_begin(TaskPool *pool, int thread_id)
 {
-	if (task_can_use_local_queues(pool, thread_id)) {
+	if (thread_id != -1) {
 		ASSERT_THREAD_ID(pool->scheduler, thread_id);
 		TaskThreadLocalStorage *tls = get_task_tls(pool, thread_id);
 		tls->do_delayed_push = true;
@@ -957,16 +1412,12 @@ void BLI_task_pool_delayed_push_begin(TaskPool *pool, int thread_id)
 
 void BLI_task_pool_delayed_push_end(TaskPool *pool, int thread_id)
 {
-	if (task_can_use_local_queues(pool, thread_id)) {
+	if (thread_id != -1) {
 		ASSERT_THREAD_ID(pool->scheduler, thread_id);
 		TaskThreadLocalStorage *tls = get_task_tls(pool, thread_id);
 		BLI_assert(tls->do_delayed_push);
-		task_scheduler_push_all(pool->scheduler,
-		                        pool,
-		                        tls->delayed_queue,
-		                        tls->num_delayed_queue);
 		tls->do_delayed_push = false;
-		tls->num_delayed_queue = 0;
+		task_scheduler_wakeup(pool->scheduler, pool, true);
 	}
 }
 
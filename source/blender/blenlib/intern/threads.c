@@ -127,6 +127,8 @@ static pthread_mutex_t _fftw_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t _view3d_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_t mainid;
 static unsigned int thread_levels = 0;  /* threads can be invoked inside threads */
+static unsigned int thread_index_next = 0;
+static ThreadLocal(void *) thread_index_tls;  /* index + 1, NULL until assigned */
 static int num_threads_override = 0;
 
 /* just a max for security reasons */
@@ -155,14 +157,17 @@ void BLI_threadapi_init(void)
 	mainid = pthread_self();
 
 	BLI_spin_init(&_malloc_lock);
+	BLI_thread_local_create(thread_index_tls);
 }
 
 void BLI_threadapi_exit(void)
 {
 	if (task_scheduler) {
 		BLI_task_scheduler_free(task_scheduler);
+		task_scheduler = NULL;
 	}
 	BLI_spin_end(&_malloc_lock);
+	BLI_thread_local_delete(thread_index_tls);
 }
 
 TaskScheduler *BLI_task_scheduler_get(void)
@@ -258,6 +263,23 @@ int BLI_thread_is_main(void)
 	return pthread_equal(pthread_self(), mainid);
 }
 
+/**
+ * \return a small number identifying the calling thread, assigned on first use.
+ *
+ * Indices are never reused, use them to spread per thread data over a fixed number of slots.
+ */
+unsigned int BLI_thread_index(void)
+{
+	void *index_p = BLI_thread_local_get(thread_index_tls);
+
+	if (UNLIKELY(index_p == NULL)) {
+		index_p = SET_UINT_IN_POINTER(atomic_add_and_fetch_u(&thread_index_next, 1));
+		BLI_thread_local_set(thread_index_tls, index_p);
+	}
+
+	return GET_UINT_FROM_POINTER(index_p) - 1;
+}
+
 void BLI_threadpool_insert(ListBase *threadbase, void *callerdata)
 {
 	ThreadSlot *tslot;
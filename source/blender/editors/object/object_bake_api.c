@@ -793,6 +793,8 @@ static int bake(
 		CollectionPointerLink *link;
 		ModifierData *md, *nmd;
 		ListBase modifiers_tmp, modifiers_original;
+		Object **highpoly_objects;
+		int failed_object;
 		int i = 0;
 
 		/* prepare cage mesh */
@@ -880,14 +882,20 @@ static int bake(
 			goto cage_cleanup;
 		}
 
-		/* the baking itself */
+		/* the baking itself, all objects at once when the engine supports it */
+		highpoly_objects = MEM_mallocN(sizeof(Object *) * tot_highpoly, "bake highpoly objects");
 		for (i = 0; i < tot_highpoly; i++) {
-			ok = RE_bake_engine(re, highpoly[i].ob, i, pixel_array_high,
-			                    num_pixels, depth, pass_type, pass_filter, result);
-			if (!ok) {
-				BKE_reportf(reports, RPT_ERROR, "Error baking from object \"%s\"", highpoly[i].ob->id.name + 2);
-				goto cage_cleanup;
-			}
+			highpoly_objects[i] = highpoly[i].ob;
+		}
+
+		ok = RE_bake_engine_objects(re, highpoly_objects, tot_highpoly, pixel_array_high,
+		                            num_pixels, depth, pass_type, pass_filter, result, &failed_object);
+
+		MEM_freeN(highpoly_objects);
+
+		if (!ok) {
+			BKE_reportf(reports, RPT_ERROR, "Error baking from object \"%s\"", highpoly[failed_object].ob->id.name + 2);
+			goto cage_cleanup;
 		}
 
 cage_cleanup:
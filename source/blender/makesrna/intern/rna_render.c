@@ -209,6 +209,35 @@ static void engine_bake(RenderEngine *engine, struct Scene *scene,
 	RNA_parameter_list_free(&list);
 }
 
+static void engine_bake_batch(RenderEngine *engine, struct Scene *scene,
+                              struct Object **objects, const int num_objects,
+                              const int pass_type, const int pass_filter,
+                              const struct BakePixel *pixel_array,
+                              const int num_pixels, const int depth, void *result)
+{
+	extern FunctionRNA rna_RenderEngine_bake_batch_func;
+	PointerRNA ptr;
+	ParameterList list;
+	FunctionRNA *func;
+
+	RNA_pointer_create(NULL, engine->type->ext.srna, engine, &ptr);
+	func = &rna_RenderEngine_bake_batch_func;
+
+	RNA_parameter_list_create(&list, &ptr, func);
+	RNA_parameter_set_lookup(&list, "scene", &scene);
+	RNA_parameter_set_lookup(&list, "objects", &objects);
+	RNA_parameter_set_lookup(&list, "num_objects", &num_objects);
+	RNA_parameter_set_lookup(&list, "pass_type", &pass_type);
+	RNA_parameter_set_lookup(&list, "pass_filter", &pass_filter);
+	RNA_parameter_set_lookup(&list, "pixel_array", &pixel_array);
+	RNA_parameter_set_lookup(&list, "num_pixels", &num_pixels);
+	RNA_parameter_set_lookup(&list, "depth", &depth);
+	RNA_parameter_set_lookup(&list, "result", &result);
+	engine->type->ext.call(NULL, &ptr, func, &list);
+
+	RNA_parameter_list_free(&list);
+}
+
 static void engine_view_update(RenderEngine *engine, const struct bContext *context)
 {
 	extern FunctionRNA rna_RenderEngine_view_update_func;
@@ -303,7 +332,7 @@ static StructRNA *rna_RenderEngine_register(
 	RenderEngineType *et, dummyet = {NULL};
 	RenderEngine dummyengine = {NULL};
 	PointerRNA dummyptr;
-	int have_function[7];
+	int have_function[8];
 
 	/* setup dummy engine & engine type to store static properties in */
 	dummyengine.type = &dummyet;
@@ -342,10 +371,11 @@ static StructRNA *rna_RenderEngine_register(
 	et->update = (have_function[0]) ? engine_update : NULL;
 	et->render = (have_function[1]) ? engine_render : NULL;
 	et->bake = (have_function[2]) ? engine_bake : NULL;
-	et->view_update = (have_function[3]) ? engine_view_update : NULL;
-	et->view_draw = (have_function[4]) ? engine_view_draw : NULL;
-	et->update_script_node = (have_function[5]) ? engine_update_script_node : NULL;
-	et->update_render_passes = (have_function[6]) ? engine_update_render_passes : NULL;
+	et->bake_batch = (have_function[3]) ? engine_bake_batch : NULL;
+	et->view_update = (have_function[4]) ? engine_view_update : NULL;
+	et->view_draw = (have_function[5]) ? engine_view_draw : NULL;
+	et->update_script_node = (have_function[6]) ? engine_update_script_node : NULL;
+	et->update_render_passes = (have_function[7]) ? engine_update_render_passes : NULL;
 
 	BLI_addtail(&R_engines, et);
 
@@ -512,6 +542,29 @@ static void rna_def_render_engine(BlenderRNA *brna)
 	parm = RNA_def_pointer(func, "result", "AnyType", "", "");
 	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
 
+	func = RNA_def_function(srna, "bake_batch", NULL);
+	RNA_def_function_ui_description(func, "Bake passes of multiple objects at once");
+	RNA_def_function_flag(func, FUNC_REGISTER_OPTIONAL | FUNC_ALLOW_WRITE);
+	parm = RNA_def_pointer(func, "scene", "Scene", "", "");
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+	/* array of object pointers, the id of an object is its index */
+	parm = RNA_def_pointer(func, "objects", "AnyType", "", "");
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+	parm = RNA_def_int(func, "num_objects", 0, 0, INT_MAX, "Number of Objects", "Number of objects to bake", 0, INT_MAX);
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+	parm = RNA_def_enum(func, "pass_type", rna_enum_bake_pass_type_items, 0, "Pass", "Pass to bake");
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+	parm = RNA_def_int(func, "pass_filter", 0, 0, INT_MAX, "Pass Filter", "Filter to combined, diffuse, glossy, transmission and subsurface passes", 0, INT_MAX);
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+	parm = RNA_def_pointer(func, "pixel_array", "BakePixel", "", "");
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+	parm = RNA_def_int(func, "num_pixels", 0, 0, INT_MAX, "Number of Pixels", "Size of the baking batch", 0, INT_MAX);
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+	parm = RNA_def_int(func, "depth", 0, 0, INT_MAX, "Pixels depth", "Number of channels", 1, INT_MAX);
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+	parm = RNA_def_pointer(func, "result", "AnyType", "", "");
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+
 	/* viewport render callbacks */
 	func = RNA_def_function(srna, "view_update", NULL);
 	RNA_def_function_ui_description(func, "Update on data changes for viewport render");
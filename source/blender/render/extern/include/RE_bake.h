@@ -74,6 +74,11 @@ bool RE_bake_engine(
         struct Render *re, struct Object *object, const int object_id, const BakePixel pixel_array[],
         const size_t num_pixels, const int depth, const eScenePassType pass_type, const int pass_filter, float result[]);
 
+bool RE_bake_engine_objects(
+        struct Render *re, struct Object **objects, const int num_objects, const BakePixel pixel_array[],
+        const size_t num_pixels, const int depth, const eScenePassType pass_type, const int pass_filter, float result[],
+        int *r_failed_object);
+
 /* bake.c */
 int RE_pass_depth(const eScenePassType pass_type);
 bool RE_bake_internal(
@@ -91,6 +91,8 @@ typedef struct RenderEngineType {
 	void (*update)(struct RenderEngine *engine, struct Main *bmain, struct Scene *scene);
 	void (*render)(struct RenderEngine *engine, struct Scene *scene);
 	void (*bake)(struct RenderEngine *engine, struct Scene *scene, struct Object *object, const int pass_type, const int pass_filter, const int object_id, const struct BakePixel *pixel_array, const int num_pixels, const int depth, void *result);
+	/* bake multiple objects at once, the object id of a pixel is the index of its object */
+	void (*bake_batch)(struct RenderEngine *engine, struct Scene *scene, struct Object **objects, const int num_objects, const int pass_type, const int pass_filter, const struct BakePixel *pixel_array, const int num_pixels, const int depth, void *result);
 
 	void (*view_update)(struct RenderEngine *engine, const struct bContext *context);
 	void (*view_draw)(struct RenderEngine *engine, const struct bContext *context);
@@ -68,7 +68,7 @@
 static RenderEngineType internal_render_type = {
 	NULL, NULL,
 	"BLENDER_RENDER", N_("Blender Render"), RE_INTERNAL,
-	NULL, NULL, NULL, NULL, NULL, NULL, render_internal_update_passes,
+	NULL, NULL, NULL, NULL, NULL, NULL, NULL, render_internal_update_passes,
 	{NULL, NULL, NULL}
 };
 
@@ -77,7 +77,7 @@ static RenderEngineType internal_render_type = {
 static RenderEngineType internal_game_type = {
 	NULL, NULL,
 	"BLENDER_GAME", N_("Blender Game"), RE_INTERNAL | RE_GAME,
-	NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+	NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
 	{NULL, NULL, NULL}
 };
 
@@ -503,16 +503,10 @@ bool RE_bake_has_engine(Render *re)
 	return (type->bake != NULL);
 }
 
-bool RE_bake_engine(
-        Render *re, Object *object,
-        const int object_id, const BakePixel pixel_array[],
-        const size_t num_pixels, const int depth,
-        const eScenePassType pass_type, const int pass_filter,
-        float result[])
+static RenderEngine *bake_engine_begin(Render *re)
 {
 	RenderEngineType *type = RE_engines_find(re->r.engine);
 	RenderEngine *engine;
-	bool persistent_data = (re->r.mode & R_PERSISTENT_DATA) != 0;
 
 	/* set render info */
 	re->i.cfra = re->scene->r.cfra;
@@ -543,8 +537,12 @@ bool RE_bake_engine(
 	if (type->update)
 		type->update(engine, re->main, re->scene);
 
-	if (type->bake)
-		type->bake(engine, re->scene, object, pass_type, pass_filter, object_id, pixel_array, num_pixels, depth, result);
+	return engine;
+}
+
+static void bake_engine_end(Render *re, RenderEngine *engine)
+{
+	bool persistent_data = (re->r.mode & R_PERSISTENT_DATA) != 0;
 
 	engine->tile_x = 0;
 	engine->tile_y = 0;
@@ -563,6 +561,58 @@ bool RE_bake_engine(
 
 	if (BKE_reports_contain(re->reports, RPT_ERROR))
 		G.is_break = true;
+}
+
+bool RE_bake_engine(
+        Render *re, Object *object,
+        const int object_id, const BakePixel pixel_array[],
+        const size_t num_pixels, const int depth,
+        const eScenePassType pass_type, const int pass_filter,
+        float result[])
+{
+	RenderEngineType *type = RE_engines_find(re->r.engine);
+	RenderEngine *engine = bake_engine_begin(re);
+
+	if (type->bake)
+		type->bake(engine, re->scene, object, pass_type, pass_filter, object_id, pixel_array, num_pixels, depth, result);
+
+	bake_engine_end(re, engine);
+
+	return true;
+}
+
+/**
+ * Bake multiple objects into the same result, the object id of every pixel is the index of its object.
+ * Engines which support it bake all objects at once, instead of updating the scene for every object.
+ * On failure \a r_failed_object is set to the index of the object that could not be baked.
+ */
+bool RE_bake_engine_objects(
+        Render *re, Object **objects, const int num_objects,
+        const BakePixel pixel_array[], const size_t num_pixels, const int depth,
+        const eScenePassType pass_type, const int pass_filter,
+        float result[], int *r_failed_object)
+{
+	RenderEngineType *type = RE_engines_find(re->r.engine);
+	RenderEngine *engine;
+	int i;
+
+	*r_failed_object = 0;
+
+	if (type->bake_batch == NULL) {
+		for (i = 0; i < num_objects; i++) {
+			if (!RE_bake_engine(re, objects[i], i, pixel_array, num_pixels, depth, pass_type, pass_filter, result)) {
+				*r_failed_object = i;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	engine = bake_engine_begin(re);
+
+	type->bake_batch(engine, re->scene, objects, num_objects, pass_type, pass_filter, pixel_array, num_pixels, depth, result);
+
+	bake_engine_end(re, engine);
 
 	return true;
 }
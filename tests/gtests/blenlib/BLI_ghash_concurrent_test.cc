@@ -0,0 +1,211 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "atomic_ops.h"
+
+#define GHASH_INTERNAL_API
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_ghash.h"
+#include "BLI_ghash_concurrent.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+};
+
+/* Use more threads than there are likely to be cores, to get all the interleavings. */
+#define NUM_THREADS 8
+#define NUM_TASKS 32
+#define NUM_KEYS 20000
+
+/* Keys are 0 based, values never NULL. */
+#define KEY(_i) SET_UINT_IN_POINTER(_i)
+#define VAL(_i) SET_UINT_IN_POINTER((_i) + 1)
+
+typedef struct StressData {
+	GHashConcurrent *cgh;
+	uint32_t num_added;
+	uint32_t num_created;
+	uint32_t num_removed;
+	uint32_t num_errors;
+} StressData;
+
+/* Each task visits all keys, in its own order so tasks collide on different shards. */
+BLI_INLINE unsigned int stress_key(const int task_index, const unsigned int i)
+{
+	return (i * 7919u + (unsigned int)task_index * 104729u) % NUM_KEYS;
+}
+
+static void stress_add_func(TaskPool *__restrict pool, void *taskdata, int UNUSED(threadid))
+{
+	StressData *data = (StressData *)BLI_task_pool_userdata(pool);
+	const int task_index = GET_INT_FROM_POINTER(taskdata);
+
+	for (unsigned int i = 0; i < NUM_KEYS; i++) {
+		const unsigned int key = stress_key(task_index, i);
+		if (BLI_ghash_concurrent_add(data->cgh, KEY(key), VAL(key))) {
+			atomic_add_and_fetch_uint32(&data->num_added, 1);
+		}
+		/* Whoever added it, the key must be there now with the right value. */
+		if (BLI_ghash_concurrent_lookup(data->cgh, KEY(key)) != VAL(key)) {
+			atomic_add_and_fetch_uint32(&data->num_errors, 1);
+		}
+	}
+}
+
+static void *stress_create_func(void *userdata, const void *key)
+{
+	StressData *data = (StressData *)userdata;
+	atomic_add_and_fetch_uint32(&data->num_created, 1);
+	return VAL(GET_UINT_FROM_POINTER(key));
+}
+
+static void stress_ensure_func(TaskPool *__restrict pool, void *taskdata, int UNUSED(threadid))
+{
+	StressData *data = (StressData *)BLI_task_pool_userdata(pool);
+	const int task_index = GET_INT_FROM_POINTER(taskdata);
+
+	for (unsigned int i = 0; i < NUM_KEYS; i++) {
+		const unsigned int key = stress_key(task_index, i);
+		bool added;
+		void *val = BLI_ghash_concurrent_ensure(data->cgh, KEY(key), stress_create_func, data, &added);
+		if (added) {
+			atomic_add_and_fetch_uint32(&data->num_added, 1);
+		}
+		if (val != VAL(key)) {
+			atomic_add_and_fetch_uint32(&data->num_errors, 1);
+		}
+	}
+}
+
+/* Odd keys are removed by the task they belong to, while all tasks keep checking the even ones. */
+static void stress_remove_func(TaskPool *__restrict pool, void *taskdata, int UNUSED(threadid))
+{
+	StressData *data = (StressData *)BLI_task_pool_userdata(pool);
+	const int task_index = GET_INT_FROM_POINTER(taskdata);
+
+	for (unsigned int key = (unsigned int)task_index; key < NUM_KEYS; key += NUM_TASKS) {
+		if (key % 2) {
+			if (BLI_ghash_concurrent_remove(data->cgh, KEY(key), NULL, NULL)) {
+				atomic_add_and_fetch_uint32(&data->num_removed, 1);
+			}
+		}
+		for (unsigned int i = 0; i < NUM_KEYS; i += 2 * NUM_TASKS + 2) {
+			if (!BLI_ghash_concurrent_haskey(data->cgh, KEY(i))) {
+				atomic_add_and_fetch_uint32(&data->num_errors, 1);
+			}
+		}
+	}
+}
+
+static void stress_run(StressData *data, TaskRunFunction func)
+{
+	TaskScheduler *scheduler = BLI_task_scheduler_create(NUM_THREADS);
+	TaskPool *pool = BLI_task_pool_create(scheduler, data);
+
+	for (int i = 0; i < NUM_TASKS; i++) {
+		BLI_task_pool_push(pool, func, SET_INT_IN_POINTER(i), false, TASK_PRIORITY_HIGH);
+	}
+	BLI_task_pool_work_and_wait(pool);
+
+	BLI_task_pool_free(pool);
+	BLI_task_scheduler_free(scheduler);
+}
+
+static void stress_sum_func(void *userdata, void *key, void *val)
+{
+	uint32_t *sum = (uint32_t *)userdata;
+	EXPECT_EQ(GET_UINT_FROM_POINTER(val), GET_UINT_FROM_POINTER(key) + 1);
+	atomic_add_and_fetch_uint32(sum, GET_UINT_FROM_POINTER(val));
+}
+
+TEST(ghash_concurrent, StressAdd)
+{
+	StressData data = {NULL};
+	data.cgh = BLI_ghash_concurrent_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+
+	stress_run(&data, stress_add_func);
+
+	EXPECT_EQ(data.num_added, NUM_KEYS);
+	EXPECT_EQ(data.num_errors, 0);
+	EXPECT_EQ(BLI_ghash_concurrent_len(data.cgh), NUM_KEYS);
+
+	for (unsigned int key = 0; key < NUM_KEYS; key++) {
+		EXPECT_EQ(BLI_ghash_concurrent_lookup(data.cgh, KEY(key)), VAL(key));
+	}
+	EXPECT_EQ(BLI_ghash_concurrent_lookup(data.cgh, KEY(NUM_KEYS)), (void *)NULL);
+
+	BLI_ghash_concurrent_free(data.cgh, NULL, NULL);
+}
+
+TEST(ghash_concurrent, StressEnsure)
+{
+	StressData data = {NULL};
+	data.cgh = BLI_ghash_concurrent_new_ex(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__, NUM_KEYS);
+
+	stress_run(&data, stress_ensure_func);
+
+	/* The value of each key is created exactly once. */
+	EXPECT_EQ(data.num_added, NUM_KEYS);
+	EXPECT_EQ(data.num_created, NUM_KEYS);
+	EXPECT_EQ(data.num_errors, 0);
+	EXPECT_EQ(BLI_ghash_concurrent_len(data.cgh), NUM_KEYS);
+
+	BLI_ghash_concurrent_free(data.cgh, NULL, NULL);
+}
+
+TEST(ghash_concurrent, StressRemove)
+{
+	StressData data = {NULL};
+	data.cgh = BLI_ghash_concurrent_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+
+	for (unsigned int key = 0; key < NUM_KEYS; key++) {
+		EXPECT_TRUE(BLI_ghash_concurrent_add(data.cgh, KEY(key), VAL(key)));
+	}
+
+	stress_run(&data, stress_remove_func);
+
+	EXPECT_EQ(data.num_removed, NUM_KEYS / 2);
+	EXPECT_EQ(data.num_errors, 0);
+	EXPECT_EQ(BLI_ghash_concurrent_len(data.cgh), NUM_KEYS / 2);
+
+	for (unsigned int key = 0; key < NUM_KEYS; key++) {
+		EXPECT_EQ(BLI_ghash_concurrent_haskey(data.cgh, KEY(key)), (key % 2) == 0);
+	}
+
+	BLI_ghash_concurrent_free(data.cgh, NULL, NULL);
+}
+
+TEST(ghash_concurrent, Foreach)
+{
+	GHashConcurrent *cgh = BLI_ghash_concurrent_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	uint32_t sum_expected = 0;
+
+	for (unsigned int key = 0; key < NUM_KEYS; key++) {
+		BLI_ghash_concurrent_add(cgh, KEY(key), VAL(key));
+		sum_expected += key + 1;
+	}
+
+	for (int use_threading = 0; use_threading < 2; use_threading++) {
+		uint32_t sum = 0;
+		BLI_ghash_concurrent_foreach(cgh, stress_sum_func, &sum, use_threading != 0);
+		EXPECT_EQ(sum, sum_expected);
+	}
+
+	BLI_ghash_concurrent_free(cgh, NULL, NULL);
+}
+
+/* The reserve is spread over the shards, so adding that many keys rarely resizes one. */
+TEST(ghash_concurrent, Reserve)
+{
+	GHashConcurrent *cgh = BLI_ghash_concurrent_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	GHashConcurrent *cgh_reserve = BLI_ghash_concurrent_new_ex(
+	        BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__, NUM_KEYS);
+
+	EXPECT_LT(BLI_ghash_concurrent_buckets_len(cgh) * 3 / 4, NUM_KEYS);
+	EXPECT_GE(BLI_ghash_concurrent_buckets_len(cgh_reserve) * 3 / 4, NUM_KEYS);
+
+	BLI_ghash_concurrent_free(cgh, NULL, NULL);
+	BLI_ghash_concurrent_free(cgh_reserve, NULL, NULL);
+}
@@ -163,6 +163,14 @@ TEST(ghash, TextMurmur2a)
 	str_ghash_tests(ghash, "StrGHash - Murmur");
 }
 
+TEST(ghash, TextGHashOpen)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_strhash_p, BLI_ghashutil_strcmp, __func__);
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+
+	str_ghash_tests(ghash, "StrGHash - GHash - Open Addressing");
+}
+
 
 /* Int: uniform 100M first integers. */
 
@@ -228,6 +236,14 @@ TEST(ghash, IntGHash12000)
 	int_ghash_tests(ghash, "IntGHash - GHash - 12000", 12000);
 }
 
+TEST(ghash, IntGHashOpen12000)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+
+	int_ghash_tests(ghash, "IntGHash - GHash - Open Addressing - 12000", 12000);
+}
+
 #ifdef GHASH_RUN_BIG
 TEST(ghash, IntGHash100000000)
 {
@@ -237,6 +253,16 @@ TEST(ghash, IntGHash100000000)
 }
 #endif
 
+#ifdef GHASH_RUN_BIG
+TEST(ghash, IntGHashOpen100000000)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+
+	int_ghash_tests(ghash, "IntGHash - GHash - Open Addressing - 100000000", 100000000);
+}
+#endif
+
 TEST(ghash, IntMurmur2a12000)
 {
 	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p_murmur, BLI_ghashutil_intcmp, __func__);
@@ -310,6 +336,14 @@ TEST(ghash, IntRandGHash12000)
 	randint_ghash_tests(ghash, "RandIntGHash - GHash - 12000", 12000);
 }
 
+TEST(ghash, IntRandGHashOpen12000)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+
+	randint_ghash_tests(ghash, "RandIntGHash - GHash - Open Addressing - 12000", 12000);
+}
+
 #ifdef GHASH_RUN_BIG
 TEST(ghash, IntRandGHash50000000)
 {
@@ -319,6 +353,16 @@ TEST(ghash, IntRandGHash50000000)
 }
 #endif
 
+#ifdef GHASH_RUN_BIG
+TEST(ghash, IntRandGHashOpen50000000)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+
+	randint_ghash_tests(ghash, "RandIntGHash - GHash - Open Addressing - 50000000", 50000000);
+}
+#endif
+
 TEST(ghash, IntRandMurmur2a12000)
 {
 	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p_murmur, BLI_ghashutil_intcmp, __func__);
@@ -352,6 +396,14 @@ TEST(ghash, Int4NoHash12000)
 	randint_ghash_tests(ghash, "RandIntGHash - No Hash - 12000", 12000);
 }
 
+TEST(ghash, Int4NoHashOpen12000)
+{
+	GHash *ghash = BLI_ghash_new(ghashutil_tests_nohash_p, ghashutil_tests_cmp_p, __func__);
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+
+	randint_ghash_tests(ghash, "RandIntGHash - No Hash - Open Addressing - 12000", 12000);
+}
+
 #ifdef GHASH_RUN_BIG
 TEST(ghash, Int4NoHash50000000)
 {
@@ -422,6 +474,14 @@ TEST(ghash, Int4GHash2000)
 	int4_ghash_tests(ghash, "Int4GHash - GHash - 2000", 2000);
 }
 
+TEST(ghash, Int4GHashOpen2000)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_uinthash_v4_p, BLI_ghashutil_uinthash_v4_cmp, __func__);
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+
+	int4_ghash_tests(ghash, "Int4GHash - GHash - Open Addressing - 2000", 2000);
+}
+
 #ifdef GHASH_RUN_BIG
 TEST(ghash, Int4GHash20000000)
 {
@@ -431,6 +491,16 @@ TEST(ghash, Int4GHash20000000)
 }
 #endif
 
+#ifdef GHASH_RUN_BIG
+TEST(ghash, Int4GHashOpen20000000)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_uinthash_v4_p, BLI_ghashutil_uinthash_v4_cmp, __func__);
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+
+	int4_ghash_tests(ghash, "Int4GHash - GHash - Open Addressing - 20000000", 20000000);
+}
+#endif
+
 TEST(ghash, Int4Murmur2a2000)
 {
 	GHash *ghash = BLI_ghash_new(BLI_ghashutil_uinthash_v4_p_murmur, BLI_ghashutil_uinthash_v4_cmp, __func__);
@@ -521,6 +591,22 @@ TEST(ghash, MultiRandIntGHash200000)
 	multi_small_ghash_tests(ghash, "MultiSmall RandIntGHash - GHash - 200000", 200000);
 }
 
+TEST(ghash, MultiRandIntGHashOpen2000)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+
+	multi_small_ghash_tests(ghash, "MultiSmall RandIntGHash - GHash - Open Addressing - 2000", 2000);
+}
+
+TEST(ghash, MultiRandIntGHashOpen200000)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+
+	multi_small_ghash_tests(ghash, "MultiSmall RandIntGHash - GHash - Open Addressing - 200000", 200000);
+}
+
 TEST(ghash, MultiRandIntMurmur2a2000)
 {
 	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p_murmur, BLI_ghashutil_intcmp, __func__);
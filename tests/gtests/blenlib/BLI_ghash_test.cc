@@ -198,3 +198,146 @@ TEST(ghash, Pop)
 
 	BLI_ghash_free(ghash, NULL, NULL);
 }
+
+/* Same as InsertRemoveShrink, with open addressing storage. */
+TEST(ghash, OpenInsertRemoveShrink)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i, bkt_size;
+
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING | GHASH_FLAG_ALLOW_SHRINK);
+	init_keys(keys, 40);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		BLI_ghash_insert(ghash, SET_UINT_IN_POINTER(*k), SET_UINT_IN_POINTER(*k));
+	}
+
+	EXPECT_EQ(BLI_ghash_len(ghash), TESTCASE_SIZE);
+	bkt_size = BLI_ghash_buckets_len(ghash);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		void *v = BLI_ghash_lookup(ghash, SET_UINT_IN_POINTER(*k));
+		EXPECT_EQ(GET_UINT_FROM_POINTER(v), *k);
+	}
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		void *v = BLI_ghash_popkey(ghash, SET_UINT_IN_POINTER(*k), NULL);
+		EXPECT_EQ(GET_UINT_FROM_POINTER(v), *k);
+		/* Removal shifts entries back, the others must remain reachable. */
+		if (i % 1000 == 0) {
+			for (unsigned int *k_other = k + 1; k_other != keys + TESTCASE_SIZE; k_other++) {
+				EXPECT_TRUE(BLI_ghash_haskey(ghash, SET_UINT_IN_POINTER(*k_other)));
+			}
+		}
+	}
+
+	EXPECT_EQ(BLI_ghash_len(ghash), 0);
+	EXPECT_LT(BLI_ghash_buckets_len(ghash), bkt_size);
+
+	BLI_ghash_free(ghash, NULL, NULL);
+}
+
+/* Check pop, copy and iteration with open addressing storage. */
+TEST(ghash, OpenCopyIterPop)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	GHash *ghash_copy;
+	GHashIterator gh_iter;
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i;
+
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+	init_keys(keys, 50);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		void **val_p;
+		EXPECT_FALSE(BLI_ghash_ensure_p(ghash, SET_UINT_IN_POINTER(*k), &val_p));
+		*val_p = SET_UINT_IN_POINTER(*k);
+	}
+
+	ghash_copy = BLI_ghash_copy(ghash, NULL, NULL);
+	EXPECT_EQ(BLI_ghash_len(ghash_copy), TESTCASE_SIZE);
+	EXPECT_EQ(BLI_ghash_buckets_len(ghash_copy), BLI_ghash_buckets_len(ghash));
+
+	i = 0;
+	GHASH_ITER (gh_iter, ghash_copy) {
+		EXPECT_EQ(BLI_ghashIterator_getKey(&gh_iter), BLI_ghashIterator_getValue(&gh_iter));
+		EXPECT_EQ(BLI_ghash_lookup(ghash, BLI_ghashIterator_getKey(&gh_iter)), BLI_ghashIterator_getValue(&gh_iter));
+		i++;
+	}
+	EXPECT_EQ(i, TESTCASE_SIZE);
+
+	GHashIterState pop_state = {0};
+	void *k_pop, *v_pop;
+	while (BLI_ghash_pop(ghash, &pop_state, &k_pop, &v_pop)) {
+		EXPECT_EQ(k_pop, v_pop);
+		EXPECT_TRUE(BLI_ghash_remove(ghash_copy, k_pop, NULL, NULL));
+	}
+	EXPECT_EQ(BLI_ghash_len(ghash), 0);
+	EXPECT_EQ(BLI_ghash_len(ghash_copy), 0);
+
+	BLI_ghash_free(ghash, NULL, NULL);
+	BLI_ghash_free(ghash_copy, NULL, NULL);
+}
+
+/* Switching storage keeps all entries. */
+TEST(ghash, OpenFlagSwitch)
+{
+	GSet *gset = BLI_gset_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i;
+
+	init_keys(keys, 60);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		EXPECT_TRUE(BLI_gset_add(gset, SET_UINT_IN_POINTER(*k)));
+		if (i == TESTCASE_SIZE / 2) {
+			BLI_gset_flag_set(gset, GHASH_FLAG_OPEN_ADDRESSING);
+		}
+	}
+	EXPECT_EQ(BLI_gset_len(gset), TESTCASE_SIZE);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		EXPECT_FALSE(BLI_gset_add(gset, SET_UINT_IN_POINTER(*k)));
+	}
+
+	BLI_gset_flag_clear(gset, GHASH_FLAG_OPEN_ADDRESSING);
+	EXPECT_EQ(BLI_gset_len(gset), TESTCASE_SIZE);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		EXPECT_TRUE(BLI_gset_haskey(gset, SET_UINT_IN_POINTER(*k)));
+	}
+
+	BLI_gset_free(gset, NULL);
+}
+
+/* Switching the storage keeps the reserved size. */
+TEST(ghash, OpenFlagSwitchReserve)
+{
+	GHash *ghash = BLI_ghash_new_ex(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__, TESTCASE_SIZE);
+	const int nbuckets = BLI_ghash_buckets_len(ghash);
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i;
+
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING | GHASH_FLAG_ALLOW_SHRINK);
+	const int nslots = BLI_ghash_buckets_len(ghash);
+	EXPECT_GE(nslots * 3 / 4, TESTCASE_SIZE);
+
+	init_keys(keys, 70);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		BLI_ghash_insert(ghash, SET_UINT_IN_POINTER(*k), SET_UINT_IN_POINTER(*k));
+	}
+	EXPECT_EQ(BLI_ghash_buckets_len(ghash), nslots);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		EXPECT_TRUE(BLI_ghash_remove(ghash, SET_UINT_IN_POINTER(*k), NULL, NULL));
+	}
+	EXPECT_EQ(BLI_ghash_buckets_len(ghash), nslots);
+
+	BLI_ghash_flag_clear(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+	EXPECT_GE(BLI_ghash_buckets_len(ghash), nbuckets);
+
+	BLI_ghash_free(ghash, NULL, NULL);
+}
@@ -0,0 +1,74 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "atomic_ops.h"
+
+extern "C" {
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "PIL_time.h"
+};
+
+/* Scaling benchmark: throughput of small tasks versus number of threads. Every task
+ * spawns two more, so most of them are pushed from worker threads. */
+
+#define SCALING_TREE_DEPTH 16
+#define SCALING_NUM_RUNS 5
+
+static void task_scaling_func(TaskPool *__restrict pool, void *taskdata, int thread_id)
+{
+	const int depth = GET_INT_FROM_POINTER(taskdata);
+	int *count = (int *)BLI_task_pool_userdata(pool);
+
+	atomic_add_and_fetch_uint32((uint32_t *)count, 1);
+
+	if (depth > 0) {
+		for (int i = 0; i < 2; i++) {
+			BLI_task_pool_push_from_thread(pool, task_scaling_func, SET_INT_IN_POINTER(depth - 1),
+			                               false, TASK_PRIORITY_HIGH, thread_id);
+		}
+	}
+}
+
+TEST(task, Scaling)
+{
+	const int max_threads = BLI_system_thread_count();
+	const int num_tasks = (1 << (SCALING_TREE_DEPTH + 1)) - 1;
+
+	printf("\n========== STARTING task scaling ==========\n");
+
+	for (int num_threads = 1; ; num_threads = MIN2(num_threads * 2, max_threads)) {
+		TaskScheduler *scheduler = BLI_task_scheduler_create(num_threads);
+		double best_time = 0.0;
+
+		for (int run = 0; run < SCALING_NUM_RUNS; run++) {
+			int count = 0;
+			TaskPool *pool = BLI_task_pool_create(scheduler, &count);
+
+			const double start_time = PIL_check_seconds_timer();
+			BLI_task_pool_push(pool, task_scaling_func, SET_INT_IN_POINTER(SCALING_TREE_DEPTH),
+			                   false, TASK_PRIORITY_HIGH);
+			BLI_task_pool_work_and_wait(pool);
+			const double time = PIL_check_seconds_timer() - start_time;
+
+			BLI_task_pool_free(pool);
+
+			EXPECT_EQ(count, num_tasks);
+			if (run == 0 || time < best_time) {
+				best_time = time;
+			}
+		}
+
+		printf("%3d threads: %8.3f ms, %6.2f Mtasks/s\n",
+		       num_threads, best_time * 1000.0, num_tasks / best_time * 1e-6);
+
+		BLI_task_scheduler_free(scheduler);
+
+		if (num_threads == max_threads) {
+			break;
+		}
+	}
+}
@@ -8,6 +8,7 @@
 extern "C" {
 #include "BLI_mempool.h"
 #include "BLI_task.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 };
 
@@ -74,3 +75,216 @@ TEST(task, MempoolIter)
 
 	BLI_mempool_destroy(mempool);
 }
+
+/* Allocate and free from many tasks at once, as when a parallel operator creates geometry. */
+
+#define THREADSAFE_NUM_TASKS 32
+#define THREADSAFE_ITEMS_PER_TASK 2000
+
+static void task_mempool_threadsafe_func(TaskPool *__restrict pool, void *taskdata, int UNUSED(threadid))
+{
+	BLI_mempool *mempool = (BLI_mempool *)BLI_task_pool_userdata(pool);
+	const int task_index = GET_INT_FROM_POINTER(taskdata);
+	int *data[THREADSAFE_ITEMS_PER_TASK];
+
+	for (int i = 0; i < THREADSAFE_ITEMS_PER_TASK; i++) {
+		data[i] = (int *)BLI_mempool_alloc(mempool);
+		*data[i] = task_index;
+	}
+	/* Keep every third item. */
+	for (int i = 0; i < THREADSAFE_ITEMS_PER_TASK; i++) {
+		EXPECT_EQ(*data[i], task_index);
+		if (i % 3) {
+			BLI_mempool_free(mempool, data[i]);
+		}
+	}
+}
+
+static void task_mempool_count_func(void *userdata, MempoolIterData *item)
+{
+	int *counts = (int *)userdata;
+	atomic_add_and_fetch_uint32((uint32_t *)&counts[*(int *)item], 1);
+}
+
+TEST(task, MempoolThreadsafe)
+{
+	/* Creates the thread index TLS used by thread-safe pools. */
+	BLI_threadapi_init();
+
+	BLI_mempool *mempool = BLI_mempool_create(sizeof(int), 0, 64, BLI_MEMPOOL_ALLOW_ITER | BLI_MEMPOOL_THREADSAFE);
+	TaskScheduler *scheduler = BLI_task_scheduler_create(8);
+	TaskPool *pool = BLI_task_pool_create(scheduler, mempool);
+	const int num_kept = (THREADSAFE_ITEMS_PER_TASK + 2) / 3;
+
+	for (int i = 0; i < THREADSAFE_NUM_TASKS; i++) {
+		BLI_task_pool_push(pool, task_mempool_threadsafe_func, SET_INT_IN_POINTER(i), false, TASK_PRIORITY_HIGH);
+	}
+	BLI_task_pool_work_and_wait(pool);
+
+	BLI_task_pool_free(pool);
+	BLI_task_scheduler_free(scheduler);
+
+	EXPECT_EQ(BLI_mempool_len(mempool), THREADSAFE_NUM_TASKS * num_kept);
+
+	/* Every kept item is found exactly once by threaded iteration. */
+	int counts[THREADSAFE_NUM_TASKS] = {0};
+	BLI_task_parallel_mempool(mempool, counts, task_mempool_count_func, true);
+	for (int i = 0; i < THREADSAFE_NUM_TASKS; i++) {
+		EXPECT_EQ(counts[i], num_kept);
+	}
+
+	BLI_mempool_destroy(mempool);
+
+	BLI_threadapi_exit();
+}
+
+/* Nested parallel range with reduction, like modifiers evaluated from within
+ * parallel object evaluation. */
+
+#define NESTED_OUTER_ITEMS 64
+#define NESTED_INNER_ITEMS 1000
+
+static void task_nested_inner_func(void *__restrict UNUSED(userdata),
+                                   const int iter,
+                                   const ParallelRangeTLS *__restrict tls)
+{
+	*(int *)tls->userdata_chunk += iter;
+}
+
+static void task_nested_inner_finalize(void *__restrict userdata, void *__restrict userdata_chunk)
+{
+	atomic_add_and_fetch_uint32((uint32_t *)userdata, *(uint32_t *)userdata_chunk);
+}
+
+static void task_nested_outer_func(void *__restrict userdata,
+                                   const int iter,
+                                   const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	int *sums = (int *)userdata;
+	int sum = 0;
+
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.userdata_chunk = &sum;
+	settings.userdata_chunk_size = sizeof(sum);
+	settings.func_finalize = task_nested_inner_finalize;
+	settings.min_iter_per_thread = 16;
+
+	BLI_task_parallel_range(0, NESTED_INNER_ITEMS + iter, &sums[iter], task_nested_inner_func, &settings);
+}
+
+TEST(task, ParallelRangeNested)
+{
+	int sums[NESTED_OUTER_ITEMS] = {0};
+
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+
+	BLI_task_parallel_range(0, NESTED_OUTER_ITEMS, sums, task_nested_outer_func, &settings);
+
+	for (int i = 0; i < NESTED_OUTER_ITEMS; i++) {
+		const int num_inner = NESTED_INNER_ITEMS + i;
+		EXPECT_EQ(sums[i], num_inner * (num_inner - 1) / 2);
+	}
+}
+
+/* Pools nested deeper than the parents stored with tasks in deques, each
+ * task waiting for a pool of its own. */
+
+#define DEEP_NESTED_DEPTH 6
+#define DEEP_NESTED_TASKS 4
+
+typedef struct DeepNestedData {
+	TaskScheduler *scheduler;
+	int count;
+} DeepNestedData;
+
+static void task_deep_nested_func(TaskPool *__restrict pool, void *taskdata, int UNUSED(thread_id))
+{
+	const int depth = GET_INT_FROM_POINTER(taskdata);
+	DeepNestedData *data = (DeepNestedData *)BLI_task_pool_userdata(pool);
+
+	if (depth == 0) {
+		atomic_add_and_fetch_uint32((uint32_t *)&data->count, 1);
+		return;
+	}
+
+	TaskPool *nested_pool = BLI_task_pool_create(data->scheduler, data);
+	for (int i = 0; i < DEEP_NESTED_TASKS; i++) {
+		BLI_task_pool_push(nested_pool, task_deep_nested_func, SET_INT_IN_POINTER(depth - 1),
+		                   false, TASK_PRIORITY_HIGH);
+	}
+	BLI_task_pool_work_and_wait(nested_pool);
+	BLI_task_pool_free(nested_pool);
+}
+
+TEST(task, PoolNestedDeep)
+{
+	TaskScheduler *scheduler = BLI_task_scheduler_get();
+	DeepNestedData data = {scheduler, 0};
+	int num_leaves = 1;
+
+	for (int i = 0; i < DEEP_NESTED_DEPTH; i++) {
+		num_leaves *= DEEP_NESTED_TASKS;
+	}
+
+	TaskPool *pool = BLI_task_pool_create(scheduler, &data);
+	BLI_task_pool_push(pool, task_deep_nested_func, SET_INT_IN_POINTER(DEEP_NESTED_DEPTH),
+	                   false, TASK_PRIORITY_HIGH);
+	BLI_task_pool_work_and_wait(pool);
+	BLI_task_pool_free(pool);
+
+	EXPECT_EQ(data.count, num_leaves);
+}
+
+/* Nested pools which are still used after the task which created them is
+ * done, and after their parent pool is freed. */
+
+#define OUTLIVE_NUM_POOLS 16
+#define OUTLIVE_NUM_TASKS 64
+
+typedef struct OutliveData {
+	TaskScheduler *scheduler;
+	TaskPool *pools[OUTLIVE_NUM_POOLS];
+	int count;
+} OutliveData;
+
+static void task_outlive_inner_func(TaskPool *__restrict pool, void *UNUSED(taskdata), int UNUSED(thread_id))
+{
+	OutliveData *data = (OutliveData *)BLI_task_pool_userdata(pool);
+	atomic_add_and_fetch_uint32((uint32_t *)&data->count, 1);
+}
+
+static void task_outlive_outer_func(TaskPool *__restrict pool, void *taskdata, int UNUSED(thread_id))
+{
+	OutliveData *data = (OutliveData *)BLI_task_pool_userdata(pool);
+	TaskPool *nested_pool = BLI_task_pool_create(data->scheduler, data);
+
+	for (int i = 0; i < OUTLIVE_NUM_TASKS; i++) {
+		BLI_task_pool_push(nested_pool, task_outlive_inner_func, NULL, false, TASK_PRIORITY_LOW);
+	}
+	data->pools[GET_INT_FROM_POINTER(taskdata)] = nested_pool;
+}
+
+TEST(task, PoolNestedOutlive)
+{
+	TaskScheduler *scheduler = BLI_task_scheduler_get();
+	OutliveData data;
+	data.scheduler = scheduler;
+	data.count = 0;
+
+	TaskPool *pool = BLI_task_pool_create(scheduler, &data);
+	for (int i = 0; i < OUTLIVE_NUM_POOLS; i++) {
+		BLI_task_pool_push(pool, task_outlive_outer_func, SET_INT_IN_POINTER(i), false, TASK_PRIORITY_HIGH);
+	}
+	BLI_task_pool_work_and_wait(pool);
+	BLI_task_pool_free(pool);
+
+	/* Freeing waits for tasks which are running, queued ones are discarded. */
+	for (int i = 0; i < OUTLIVE_NUM_POOLS; i++) {
+		BLI_task_pool_free(data.pools[i]);
+	}
+
+	EXPECT_LE(data.count, OUTLIVE_NUM_POOLS * OUTLIVE_NUM_TASKS);
+}